@@ -1,5 +1,4 @@
 #include <iostream>
-#include <fstream>
 #include <string>
 
 #include "kdtree.h"
@@ -47,40 +46,15 @@ int main( int argc, char *argv[] )
 
     const string sampleFileName = argv[ 1 ];
 
-    ifstream treeData( sampleFileName );
-
-    if ( !treeData.is_open() )
-    {
-        cerr << "Unable to open '" << sampleFileName << "' for reading"
-                  << endl;
-        return 1;
-    }
-
     Types::Points< double > points;
-    string line;
+    const KDStatus loaded = Loader::readCsv( sampleFileName, points );
 
-    while ( getline ( treeData, line ) )
+    if ( !loaded )
     {
-        Types::Point< double > point;
-        size_t pos = 0;
-
-        while ( true )
-        {
-            point.push_back( static_cast< double >( stof( line, &pos ) ) );
-
-            if ( line[ pos ] == ',')
-            {
-                line = line.substr( pos + 1u );
-            }
-            else
-            {
-                break;
-            }
-        }
-
-        points.push_back( point );
+        cerr << "Unable to load '" << sampleFileName << "' : "
+             << loaded << endl;
+        return 1;
     }
-    treeData.close();
 
     string treeFileName;
     if ( 2 == argc )
@@ -93,11 +67,17 @@ int main( int argc, char *argv[] )
     }
 
     KDTree< double > tree( points );
+
+    // Store points in leaf order, the permutation back to the sample file
+    // rows is serialized along with the tree
+    tree.reorder();
     cout << tree << endl;
 
-    if ( !tree.serialize( treeFileName )  )
+    const KDStatus serialized = tree.serialize( treeFileName );
+
+    if ( !serialized )
     {
-        cout << "Unable to serialize KDTree" << endl;
+        cout << "Unable to serialize KDTree : " << serialized << endl;
         return 1;
     }
 
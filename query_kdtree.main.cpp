@@ -1,8 +1,11 @@
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "kdtree.h"
+#include "kdtree_query_cache.h"
 
 using namespace std;
 using namespace datastructures;
@@ -11,7 +14,7 @@ const string defaultResultsFilename = "results.csv";
 
 static void printHelp()
 {
-    cout << "Usage: query_kdtree tree_file query_file answers_file                      " << endl;
+    cout << "Usage: query_kdtree [--cache] tree_file query_file answers_file            " << endl;
     cout << "                                                                           " << endl;
     cout << "    Where :                                                                " << endl;
     cout << "      tree_file          - path to file produced by successful             " << endl;
@@ -26,11 +29,15 @@ static void printHelp()
               << defaultResultsFilename << "'" << endl;
     cout << "                           Note that all contents of an existing file will " << endl;
     cout << "                           be erased.                                      " << endl;
+    cout << "                                                                           " << endl;
+    cout << "      --cache            - answer queries through a KDQueryCache, which    " << endl;
+    cout << "                           pays off when query_file repeats coordinates,   " << endl;
+    cout << "                           and report its statistics                       " << endl;
 }
 
-static bool validateInputs( int argc, char *argv[] )
+static bool validateInputs( const vector< string >& arguments )
 {
-    if ( argc < 3 )
+    if ( arguments.size() < 2u )
     {
         return false;
     }
@@ -44,73 +51,89 @@ static bool validateInputs( int argc, char *argv[] )
 
 int main( int argc, char *argv[] )
 {
-    if ( !validateInputs( argc, argv ) )
+    bool useCache = false;
+    vector< string > arguments;
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( string( "--cache" ) == argv[ i ] )
+        {
+            useCache = true;
+        }
+        else
+        {
+            arguments.push_back( argv[ i ] );
+        }
+    }
+
+    if ( !validateInputs( arguments ) )
     {
         printHelp();
         return 1;
     }
 
-    const string treeFileName = argv[ 1 ];
+    const string treeFileName = arguments[ 0 ];
+
+    std::shared_ptr< KDTree< float > > tree( new KDTree< float >() );
 
-    KDTree< float > tree;
+    const KDStatus deserialized = tree->deserialize( treeFileName );
 
-    if ( !tree.deserialize( treeFileName  ) )
+    if ( !deserialized )
     {
+        cerr << "Unable to deserialize '" << treeFileName << "' : "
+             << deserialized << endl;
         printHelp();
         return 1;
     }
 
-    cout << tree << endl;
+    cout << *tree << endl;
 
-    const string queryFileName = argv[ 2 ];
+    std::unique_ptr< KDQueryCache< float > > cache;
+    if ( useCache )
+    {
+        cache.reset( new KDQueryCache< float >( tree ) );
+    }
 
-    ifstream queryData( queryFileName );
+    const string queryFileName = arguments[ 1 ];
 
-    if ( !queryData.is_open() )
+    Types::Points< float > queryPoints;
+    const KDStatus loaded = Loader::readCsv( queryFileName, queryPoints );
+
+    if ( !loaded )
     {
-        cout << "query_kdtree is unable to open '"
-                  << queryFileName << "' for reading"
-                  << endl;
+        cerr << "Unable to load '" << queryFileName << "' : "
+             << loaded << endl;
         return 1;
     }
 
     string resultsFilename;
 
-    if ( 3 == argc )
+    if ( 2u == arguments.size() )
     {
         resultsFilename = defaultResultsFilename;
     }
     else
     {
-        resultsFilename = argv[ 3 ];
+        resultsFilename = arguments[ 2 ];
     }
 
     fstream results;
     results.open( resultsFilename, fstream::out | fstream::trunc );
 
     int numQueriesProcessed = 0;
-    string line;
-    while ( getline ( queryData, line ) )
+    for ( Types::Points< float >::const_iterator queryPoint =
+                  queryPoints.cbegin();
+          queryPoint != queryPoints.cend(); ++queryPoint )
     {
-        Types::Point< float > queryPoint;
-
-        size_t pos = 0;
-
-        while ( true )
+        const size_t index = cache ? cache->nearestPointIndex( *queryPoint ) :
+                                     tree->nearestPointIndex( *queryPoint );
+        if ( Constants::KDTREE_ERROR_INDEX == index )
         {
-            queryPoint.push_back( static_cast< float >( stof( line, &pos ) ) );
-
-            if ( line[ pos ] == ',')
-            {
-                line = line.substr( pos + 1u );
-            }
-            else
-            {
-                break;
-            }
+            results << index << '\n';
+        }
+        else
+        {
+            results << tree->originalIndex( index ) << '\n';
         }
-
-        results << tree.nearestPointIndex( queryPoint ) << '\n';
         ++numQueriesProcessed;
     }
 
@@ -124,6 +147,12 @@ int main( int argc, char *argv[] )
               << resultsFilename
               << "'"
               << endl;
+    if ( cache )
+    {
+        cout << "    cache                   : "
+                  << cache->statistics()
+                  << endl;
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -1,14 +1,31 @@
 #ifndef KDTREE_H
 #define KDTREE_H
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <type_traits>
 
 #include "kdtree_types.h"
 #include "kdtree_node.h"
 #include "kdtree_hyperplane.h"
 #include "kdtree_utils.h"
 #include "kdtree_constants.h"
+#include "kdtree_aggregate.h"
+#include "kdtree_knn_graph.h"
+#include "kdtree_loader.h"
+#include "kdtree_lookup_grid.h"
+#include "kdtree_metrics.h"
+#include "kdtree_morton.h"
+#include "kdtree_parallel.h"
+#include "kdtree_simd.h"
+#include "kdtree_split_policies.h"
+#include "kdtree_status.h"
+#include "kdtree_text.h"
 
 // @Purpose
 //
@@ -18,13 +35,12 @@
 // from the original list as well as looking up the *index* of the nearest
 // point from the original list.
 //
-// Override chooseBestSplit() in order to implement a different heuristic
-// of splitting a set of n-dimensional points with a KDHyperplane object
-//
-// Overriding child classes must also provide a clear textual description
-// of the new type. This is dictated by the rather simplistic implementation
-// of operator<<(). Not providing an override for this value will lead to
-// many hours with a debugger!
+// The heuristic of splitting a set of n-dimensional points with a
+// KDHyperplane object and the distance metric of all the searches are
+// template parameters resolved at compile time, see
+// kdtree_split_policies.h and kdtree_metrics.h. KDTree< T > keeps the
+// original median split and Euclidean distance. Kernel density estimation
+// is defined over the Euclidean distance whatever the metric.
 //
 // Note that baseline implementation is defined by
 // Constants::KDTREE_SIMPLE_VARIETY
@@ -32,14 +48,16 @@
 
 namespace datastructures {
 
-template< typename T >
+template< typename T,
+          typename SplitPolicy = KDMedianSplit< T >,
+          typename Metric      = KDEuclideanMetric >
 class KDTree {
 public:
 
     KDTree();
         // default ctor
 
-    KDTree( const KDTree< T >& other );
+    KDTree( const KDTree& other );
         // Copy constructor, copies the pointer contained in other, not the
         // bisection
         // Calls build() helper
@@ -48,35 +66,77 @@ public:
         // Constructor, throws in case points are of different length
         // Calls build() helper
 
-    virtual ~KDTree();
+    KDTree( const Types::Points< T >&    points,
+            const std::vector< double >& values );
+        // Constructor attaching a value to every point, values[ i ]
+        // belongs to points[ i ]. build() maintains per subtree sums of
+        // the values for aggregateInBox() and aggregateInRadius().
+        // Values are dropped if their number does not match the number
+        // of points. Values are not serialized.
+        // Calls build() helper
+
+    KDTree( const Types::Points< T >& points,
+            const Types::BuildMethod  method,
+            const size_t              numThreads = 0u );
+        // Constructor building the tree with the provided method, see
+        // Types::BuildMethod. Every method produces a valid tree for the
+        // whole query interface. Types::BuildMethod::PRESORTED produces
+        // the same tree as KDMedianSplit without calling it, other split
+        // policies fall back to the regular build.
+        // Types::BuildMethod::MORTON quantizes the points to Morton codes,
+        // radix sorts them and derives every split from the highest bit in
+        // which the codes of a node differ, with independent subtrees built
+        // by separate threads. It falls back to the split policy for runs
+        // of identical codes and for dimensions beyond 64.
+        // The tree, and with it the output of serialize(), depends only on
+        // the points and the method, never on numThreads or on how the
+        // threads are scheduled.
+        // numThreads of 0 uses all hardware threads.
+        // Calls buildPresorted(), buildMorton() or build() helper
+
+    ~KDTree();
         // default dtor
 
     // OPERATORS
-    KDTree& operator=( const KDTree< T >& other );
+    KDTree& operator=( const KDTree& other );
         // Assignment operator. Calls copy; do this in child classes
         // when overloaded.
         // Note that this operator will copy the the points contained within
         // the provided tree, yet will build its own bisecting structure of the
-        // space using own chooseBestSplit() implementation
+        // space using own split policy
         // Calls build() helper
 
-    bool operator==( const KDTree< T >& other ) const;
+    bool operator==( const KDTree& other ) const;
         // Equality. Calls equals, do this in child classes
         // when overloaded.
         // Calls build() helper
 
-    bool operator!=( const KDTree< T >& other ) const;
+    bool operator!=( const KDTree& other ) const;
         // Non-equality.  Calls equals, do this in child classes
         // when overloaded.
 
     // PRIMARY INTERFACE
-    bool serialize( const std::string& filename ) const;
-        // Writes the tree to the provided file location.
-        // Returns true on success and false otherwise.
-
-    bool deserialize( const std::string& filename );
-        // Loads the contents of the data via the contents of the file
-        // Returns true on success and false otherwise.
+    KDStatus serialize( const std::string& filename,
+                        const size_t       numThreads = 0u ) const;
+        // Writes the tree to the provided file location. Numbers are
+        // written in their shortest exact form, so a deserialized tree
+        // holds bit for bit the same points and hyperplanes. Points and
+        // subtrees are formatted by several threads into separate buffers
+        // written in order, the file does not depend on numThreads.
+        // numThreads of 0 uses all hardware threads.
+        // Returns successful status or the reason of the failure.
+
+    KDStatus deserialize( const std::string& filename,
+                          const size_t       numThreads = 0u );
+        // Loads the contents of the data via the contents of the file.
+        // The file is read at once and its points, permutation and
+        // subtrees are parsed by several threads.
+        // numThreads of 0 uses all hardware threads.
+        // The whole file is validated before the tree is replaced, so the
+        // tree is left untouched on failure and queries never have to
+        // check the loaded structure.
+        // Returns successful status or the reason of the failure, with
+        // the line of the file it was detected on.
 
     const Types::Point< T > nearestPoint(
             const Types::Point< T >& pointOfInterest ) const;
@@ -89,18 +149,280 @@ public:
         // Returns index closes point in a tree to the point of interest.
         // In case the tree is empty or there is a cardinality mismatch -
         // KDTREE_ERROR_INDEX is returned
+        // With a lookup grid the search starts at the subtree of the grid
+        // cell of the point of interest, see buildLookupGrid().
         // Calls nearestPointIndexHelper()
 
+    size_t find( const Types::Point< T >& point ) const;
+        // Returns index of a point in a tree equal to point, coordinate by
+        // coordinate. Walks down a single root-to-leaf path, following
+        // both children only where point lies on a hyperplane, as points
+        // equal to its value may sit on either side, and then only into
+        // the children whose bounds contain point. In case there is no
+        // such point, the tree is empty or there is a cardinality mismatch
+        // KDTREE_ERROR_INDEX is returned.
+        // Calls findHelper()
+
+    std::vector< Types::Indexes > duplicates() const;
+        // Returns every group of at least two indexes of equal points,
+        // each group in increasing order and the groups ordered by their
+        // first index. O(D N log N).
+
+    Types::Indexes pointIndexesInRadius(
+            const Types::Point< T >& pointOfInterest,
+            const double             radius ) const;
+        // Returns indexes of all points in a tree whose distance to the
+        // point of interest is less or equal to radius, in no particular
+        // order. In case the tree is empty or there is a cardinality
+        // mismatch - empty container is returned.
+        // Safe to call concurrently from several threads.
+        // Calls pointIndexesInRadiusHelper()
+
+    Types::Indexes nearestPointIndexes(
+            const Types::Point< T >& pointOfInterest,
+            const size_t             k ) const;
+        // Returns indexes of the k closest points in a tree to the point of
+        // interest sorted by increasing distance, ties are broken by the
+        // smaller index. Fewer than k indexes are returned when the tree
+        // holds fewer than k points. In case the tree is empty or there is
+        // a cardinality mismatch - empty container is returned.
+        // Calls nearestPointIndexesHelper()
+
+    Types::Neighbours correspondences(
+            const Types::Points< T >& sourcePoints,
+            const double              maxDistance =
+                                          Constants::KDTREE_MAX_DISTANCE,
+            const Types::Neighbours&  previous = Types::Neighbours(),
+            const size_t              numThreads = 0u,
+            const bool                blocked = false ) const;
+        // Batched nearest neighbour search for point cloud registration
+        // (e.g. ICP) against this tree as the fixed target. Returns, for
+        // every source point, the distance rank of and the index of its
+        // nearest point in the tree, ties broken by the smaller index. The
+        // rank is the squared distance for KDEuclideanMetric.
+        // Source points with no tree point within maxDistance are rejected
+        // early and reported as ( KDTREE_MAX_DISTANCE,
+        // KDTREE_ERROR_INDEX ).
+        // previous may hold the result of the previous iteration for the
+        // same source points; its indexes then seed every search with the
+        // distance to the previous correspondence, which is usually tight
+        // after a small transform update. It is ignored if its size does
+        // not match the number of source points.
+        // numThreads of 0 uses all hardware threads.
+        // By default every search walks the tree. Setting blocked opts
+        // float and double trees with KDEuclideanMetric of at least
+        // KDTREE_BLOCKED_SEARCH_MIN_DIMENSION dimensions and at most
+        // KDTREE_BLOCKED_SEARCH_MAX_POINTS points into comparing blocks of
+        // source points against all tree points with
+        // Simd::squaredDistances() instead, seeded from previous as well.
+        // That scan costs the number of source points times the number of
+        // tree points, so it only pays off when the searches would visit
+        // most leaves anyway, i.e. for data of high intrinsic dimension.
+        // The result is the same either way.
+        // In case the tree is empty or there is a cardinality mismatch -
+        // empty container is returned.
+        // Calls nearestPointIndexesHelper() or correspondencesBlockedHelper()
+
+    Types::Indexes pointIndexesInBox(
+            const Types::AxisMinMax< T >& box ) const;
+        // Returns indexes of all points in a tree that lie inside of the
+        // axis aligned box, boundary included, in no particular order.
+        // Subtrees whose bounding box lies inside of the box are reported
+        // without testing their points. In case the tree is empty or
+        // there is a cardinality mismatch - empty container is returned.
+        // Calls pointIndexesInBoxHelper()
+
+    KDAggregate aggregateInBox( const Types::AxisMinMax< T >& box ) const;
+        // Returns count and sum of values of the points inside of the axis
+        // aligned box, boundary included. Subtrees whose bounding box lies
+        // inside of the box are answered from their summary without
+        // visiting their points. Sum is 0 if the tree holds no values.
+        // In case the tree is empty or there is a cardinality mismatch -
+        // empty aggregate is returned.
+        // Calls aggregateInBoxHelper()
+
+    KDAggregate aggregateInRadius( const Types::Point< T >& pointOfInterest,
+                                   const double             radius ) const;
+        // Returns count and sum of values of the points within radius of
+        // the point of interest, boundary included. Subtrees whose
+        // bounding box lies inside of the ball are answered from their
+        // summary without visiting their points. Sum is 0 if the tree
+        // holds no values. In case the tree is empty or there is a
+        // cardinality mismatch - empty aggregate is returned.
+        // Calls aggregateInRadiusHelper()
+
+    KDKnnGraph buildKnnGraph( const size_t k,
+                              const double epsilon    = 0.0,
+                              const size_t numThreads = 0u ) const;
+        // Builds the k-nearest-neighbour graph of all the points stored in
+        // the tree, excluding every point from its own neighbour list.
+        // Points are processed in leaf order and the search of every point
+        // is seeded with a bound derived from the previously processed
+        // point, so neighbouring searches prune each other.
+        // epsilon > 0 enables approximate mode : a subtree is skipped
+        // unless it may hold a point closer than 1 / ( 1 + epsilon ) of
+        // the current k-th distance, so reported distances are within a
+        // factor of ( 1 + epsilon ) of the exact ones.
+        // numThreads of 0 uses all hardware threads.
+        // Returns empty graph if the tree holds more than 2^32 points.
+
+    double kernelDensity( const Types::Point< T >& pointOfInterest,
+                          const double             bandwidth,
+                          const double             tolerance = 0.0 ) const;
+        // Returns the Gaussian kernel density estimate at the point of
+        // interest,
+        //     1 / N * sum( exp( -|x - p|^2 / ( 2 h^2 ) ) ) / ( 2 pi h^2 )^( D / 2 ),
+        // where h is the bandwidth. A subtree whose kernel values are known
+        // to within 2 * tolerance / ( 2 pi h^2 )^( -D / 2 ) from its count
+        // and bounding box is added as a whole, which bounds the absolute
+        // error of the result by tolerance. Tolerance of 0 gives an exact
+        // answer. Returns 0 for an empty tree and KDTREE_INVALID_DENSITY
+        // for a non-positive bandwidth or a cardinality mismatch.
+        // Calls kernelDensityHelper()
+
+    std::vector< double > kernelDensities(
+            const Types::Points< T >& pointsOfInterest,
+            const double              bandwidth,
+            const double              tolerance  = 0.0,
+            const size_t              numThreads = 0u ) const;
+        // Batch version of kernelDensity() with the same error guarantee.
+        // Builds a KDTree over the points of interest and traverses both
+        // trees together, so a pair of distant or compact subtrees is
+        // settled once for all of its query points. Disjoint query
+        // subtrees are processed by separate threads.
+        // numThreads of 0 uses all hardware threads.
+        // Returns empty container on the same errors as kernelDensity().
+        // Calls kernelDensitiesHelper()
+
+    size_t size() const;
+        // Returns number of points stored in this KDTree
+
+    const Types::Point< T >& point( const size_t index ) const;
+        // Returns const ref to the point stored under index. Behaviour is
+        // undefined for index >= size()
+
     const Types::Points< T > points() const;
         // Returns the set of points represented by this KDTree. Used
         // primarily for testing.
 
+    const std::vector< double >& values() const;
+        // Returns values attached to the points, empty if there are none
+
+    size_t originalIndex( const size_t index ) const;
+        // Returns the index the point stored under index had in the points
+        // the tree was built or deserialized from, before any reorder().
+        // Behaviour is undefined for index >= size()
+
+    const std::vector< uint32_t >& permutation() const;
+        // Returns original indexes of all the stored points, empty if the
+        // points were never reordered
+
     const std::string& type() const;
         // Returns type of this KDTree object
 
+    const KDLookupGrid< T >& lookupGrid() const;
+        // Returns the lookup grid, empty unless buildLookupGrid() was
+        // called
+
     // MANIPULATORS
     void copy( const KDTree& other );
-        // Copies the value of other into this
+        // Copies the value of other into this, rebuilding the lookup grid
+        // of other if there is one
+
+    void buildLookupGrid( const size_t cellsPerAxis = 0u,
+                          const size_t numThreads   = 0u );
+        // Builds a KDLookupGrid of cellsPerAxis cells per axis over the
+        // bounding box of the points, so that nearestPointIndex() skips
+        // the upper levels of the tree for points inside of it.
+        // cellsPerAxis of 0 picks KDLookupGrid::defaultCellsPerAxis(),
+        // which builds no grid beyond
+        // Constants::KDTREE_GRID_MAX_DIMENSION dimensions. The grid is
+        // dropped whenever the tree is rebuilt or deserialized.
+        // numThreads of 0 uses all hardware threads.
+
+    void clearLookupGrid();
+        // Drops the lookup grid
+
+    KDStatus reorder();
+        // Permutes the stored points and their values into depth-first
+        // leaf order and renumbers the leaves to match, so that points of
+        // neighbouring leaves are adjacent in memory. Every index reported
+        // by the tree afterwards refers to the new order, originalIndex()
+        // maps it back. Repeated calls compose the permutation. The tree
+        // structure is kept, the permutation is serialized with it.
+        // Returns KDStatus::Code::SIZE_LIMIT, leaving the tree untouched,
+        // for trees of more than 2^32 points.
+        // Calls renumberLeavesHelper()
+
+    KDStatus merge( const KDTree& other );
+        // Adds the points of other, with their values, to this tree. The
+        // points of other are stored after the points of this tree, the
+        // point stored under index i in other is stored under index
+        // size() + i afterwards, with original index size() + i when
+        // either tree was reordered. Subtrees of both trees are reused
+        // wherever their cells do not overlap and only the overlapping
+        // regions are cut along the hyperplanes of the other tree, or
+        // rebuilt where that would unbalance them, keeping every node within
+        // Constants::KDTREE_MAX_CHILD_SHARE balance. If only one of
+        // the trees has values the points of the other get values of 0.
+        // The lookup grid is dropped.
+        // Returns KDStatus::Code::CARDINALITY_MISMATCH for trees of
+        // different dimensions and KDStatus::Code::SIZE_LIMIT for
+        // reordered trees of more than 2^32 points together, leaving the
+        // tree untouched.
+        // Calls mergeHelper()
+
+    size_t eraseIf( const Types::AxisMinMax< T >& box );
+        // Erases all points inside of the box, boundary included, and
+        // returns their number. Subtrees whose bounding box lies inside of
+        // the box are dropped without visiting their points, subtrees
+        // outside of it are kept as they are. Nodes left with more than
+        // Constants::KDTREE_MAX_CHILD_SHARE of their points in one child
+        // are rebuilt, once for the highest such node. The remaining
+        // points and their values are compacted keeping their order, so
+        // indexes reported afterwards differ from the ones before, the
+        // original indexes of reordered trees are compacted the same way.
+        // The lookup grid is dropped.
+        // In case of a cardinality mismatch nothing is erased.
+        // Calls eraseWrapper()
+
+    template< typename Predicate >
+    size_t eraseIf( Predicate predicate );
+        // Erases all points for whose index predicate( index ) returns
+        // true and returns their number. Every point is tested once,
+        // before anything is erased, so that predicate may look up the
+        // point and its value through point() and values(). Subtrees
+        // without erased points are kept as they are, otherwise the same
+        // as eraseIf( box ).
+        // Calls eraseWrapper()
+
+    KDStatus update( const size_t index, const Types::Point< T >& newPoint );
+        // Moves the point stored under index to newPoint, keeping its
+        // index and value. The first update() after the tree was built
+        // centres every hyperplane in the gap between its subtrees and
+        // widens the bounds of every inner node to its loose cell, the
+        // part of the bounding box of the points enlarged by
+        // Constants::KDTREE_LOOSE_CELL_MARGIN on every side that its
+        // hyperplanes assign to it. A point staying within the cell of
+        // its parent, on the side of its leaf, is updated in place in
+        // O(D). Otherwise its leaf is removed and inserted again next to
+        // the leaf the new point falls into, replacing the nodes along
+        // both paths. The tree is rebuilt once more than
+        // Constants::KDTREE_UPDATE_REBUILD_SHARE of the points were moved
+        // that way. Every query stays exact, the ones working on bounds
+        // prune less while the cells are loose. The lookup grid is
+        // dropped by the first update() and whenever a leaf moves.
+        // Returns KDStatus::Code::NOT_FOUND for index >= size() and
+        // KDStatus::Code::CARDINALITY_MISMATCH for a newPoint of another
+        // dimension, leaving the tree untouched.
+        // Calls removeHelper() and insertHelper()
+
+    size_t collapseDuplicates();
+        // Erases every point equal to a point of a lower index, see
+        // duplicates(), and returns their number. The remaining points
+        // keep their order and values, the tree is otherwise handled as in
+        // eraseIf( predicate ).
+        // Calls eraseWrapper()
 
     // ACCESSORS
     bool equals( const KDTree& other ) const;
@@ -112,40 +434,303 @@ public:
         // format
 
 protected:
-    virtual const KDHyperplane< T > chooseBestSplit(
+    const KDHyperplane< T > chooseBestSplit(
             const Types::Indexes& indexes ) const;
-        // To be overloaded by children when extending the vanilla KDTree
         // Serves as a heuristics in determining optimal hyperplane to split the
         // provided points as defined by the index array into m_points variable.
+        // Calls SplitPolicy::chooseBestSplit()
 
 private:
-    void buildWrapper();
+    void buildWrapper(
+            const Types::BuildMethod method = Types::BuildMethod::MEDIAN,
+            const size_t             numThreads = 1u );
         // Simple helper function that is invoked once the tree is ready to
-        // be build. Calls build();
+        // be build. Calls build(), buildPresorted() or buildMorton()
 
     std::shared_ptr< KDNode< T > > build( const Types::Indexes& indexes );
         // Function that builds the recursive bisection of the tree, as
         // described by the assignment specification. Calls chooseBestSplit()
         // at each level of recursion until leaf nodes is reached.
 
+    std::shared_ptr< KDNode< T > > buildPresorted(
+            std::vector< Types::Indexes >& sortedIndexes,
+            Types::Indexes&                scratch,
+            std::vector< char >&           isLeft,
+            const size_t                   begin,
+            const size_t                   end,
+            const size_t                   numThreads );
+        // Builds the subtree over positions [ begin, end ) of the per axis
+        // sorted index lists, which hold the same points for every axis.
+        // Extents and the median are read off the lists, every list is
+        // then stably partitioned around the split with the help of the
+        // scratch and isLeft buffers. Splits numThreads between the two
+        // children while more than one is available.
+
+    std::shared_ptr< KDNode< T > > buildMorton(
+            const std::vector< uint64_t >& codes,
+            const Types::Indexes&          indexes,
+            const size_t                   begin,
+            const size_t                   end,
+            const size_t                   numThreads,
+            Types::AxisMinMax< T >&        bounds );
+        // Builds the subtree over sorted positions [ begin, end ) of codes
+        // and indexes, splitting at the highest differing code bit. Stores
+        // the bounding box of the subtree points in bounds, the right
+        // child box provides the exact split value. Splits numThreads
+        // between the two children while more than one is available.
+
     const size_t nearestPointIndexHelper(
             std::shared_ptr< KDNode< T > > root,
             const Types::Point< T >&       pointOfInterest,
             const size_t                   bestSoFarIndex ) const;
         // A recursive helper function, finds the closes point in to the
-        // point of interest
-
-    void serializeHelper( std::fstream&                   fileStream,
-                          std::shared_ptr< KDNode< T > >  root ) const;
-        // A recursive helper function, writes the KD tree structure to
-        // provided file stream. This function expects a valid file
-        // stream to function properly.
+        // point of interest. Cardinality is validated by the caller.
+
+    size_t findHelper( const KDNode< T >*       root,
+                       const Types::Point< T >& point ) const;
+        // A recursive helper function, returns index of a point of the
+        // subtree equal to point or KDTREE_ERROR_INDEX. Cardinality is
+        // validated by the caller.
+
+    void pointIndexesInRadiusHelper( const KDNode< T >*       root,
+                                     const Types::Point< T >& pointOfInterest,
+                                     const double             maxRank,
+                                     Types::Indexes&          result ) const;
+        // A recursive helper function, appends indexes of all points whose
+        // distance rank to the point of interest is at most maxRank to
+        // result. Expects cardinality of the point of interest to be
+        // validated by the caller.
+
+    void nearestPointIndexesHelper( const KDNode< T >*       root,
+                                    const Types::Point< T >& pointOfInterest,
+                                    const size_t             k,
+                                    const size_t             excludedIndex,
+                                    const double             pruneScale,
+                                    Types::Neighbours&       best,
+                                    double&                  bound ) const;
+        // A recursive helper function, maintains best as a max-heap of at
+        // most k closest points found so far whose distance rank is at
+        // most bound, tightening bound once k points were found. Point
+        // stored under excludedIndex is never reported. Subtrees are
+        // skipped when the rank of the distance to their hyperplane scaled
+        // by pruneScale exceeds bound. Expects cardinality of the point of
+        // interest to be validated by the caller.
+
+    void leafOrderHelper( const KDNode< T >* root,
+                          Types::Indexes&    order ) const;
+        // A recursive helper function, appends point indexes of all leaves
+        // to order in depth-first, left to right order
+
+    void renumberLeavesHelper( KDNode< T >* root, size_t& next );
+        // A recursive helper function, numbers the leaves of the subtree in
+        // depth-first, left to right order starting from next
+
+    void summarizeHelper( KDNode< T >* root );
+        // A recursive helper function, sets bounding boxes and value sums
+        // of all the nodes in the subtree bottom up. Called whenever the
+        // tree structure is assembled.
+
+    void summarizeNodeHelper( KDNode< T >* root );
+        // Sets bounding box and value sum of the non-leaf root from its
+        // children, which must be summarized already
+
+    std::shared_ptr< KDNode< T > > mergeHelper(
+            const std::shared_ptr< KDNode< T > >& lhs,
+            const std::shared_ptr< KDNode< T > >& rhs );
+        // A recursive helper function, returns a summarized subtree over
+        // the points of both summarized subtrees. Subtrees with disjoint
+        // bounding boxes are joined under a new hyperplane, otherwise the
+        // smaller subtree is cut by the root hyperplane of the bigger one
+        // and its parts are merged into either side, as long as no child
+        // ends up with more than Constants::KDTREE_MAX_CHILD_SHARE
+        // of the points. Anything else is rebuilt from scratch by build().
+
+    void splitHelper( const std::shared_ptr< KDNode< T > >& root,
+                      const KDHyperplane< T >&              hyperplane,
+                      std::shared_ptr< KDNode< T > >&       left,
+                      std::shared_ptr< KDNode< T > >&       right );
+        // A recursive helper function, cuts the summarized subtree into
+        // the summarized parts left and right of hyperplane, either
+        // possibly empty. Subtrees entirely on one side are shared, only
+        // nodes the hyperplane passes through are replaced.
+
+    std::shared_ptr< KDNode< T > > joinHelper(
+            const KDHyperplane< T >&              hyperplane,
+            const std::shared_ptr< KDNode< T > >& left,
+            const std::shared_ptr< KDNode< T > >& right );
+        // Returns a summarized node of hyperplane over the summarized
+        // subtrees, or the only one of them that is not empty
+
+    enum class Coverage {
+        NONE,
+        PARTIAL,
+        ALL
+    };
+        // Share of the points of a subtree eraseIf() erases
+
+    template< typename Classify >
+    size_t eraseWrapper( const std::vector< char >& erased,
+                         const Classify&            classify );
+        // Compacts the points not flagged in erased and drops the subtrees
+        // classify( node ) reports Coverage::ALL for, which must be the
+        // ones of exactly the flagged points. Returns their number.
+        // Calls eraseHelper()
+
+    template< typename Classify >
+    std::shared_ptr< KDNode< T > > eraseHelper(
+            const std::shared_ptr< KDNode< T > >& root,
+            const Classify&                       classify,
+            const Types::Indexes&                 newIndexes,
+            bool&                                 unbalanced );
+        // A recursive helper function, returns the summarized subtree
+        // without the erased points and with every leaf index i replaced
+        // by newIndexes[ i ], root itself if nothing was erased.
+        // Sets unbalanced if the returned root holds more than
+        // Constants::KDTREE_MAX_CHILD_SHARE of its points in one child,
+        // leaving the rebuild to the caller. Unbalanced children of a
+        // balanced root are rebuilt.
+
+    std::shared_ptr< KDNode< T > > rebuildHelper( const KDNode< T >* root );
+        // Returns a summarized subtree over the points of the subtree
+        // built from scratch by build()
+
+    static void remapLeavesHelper( KDNode< T >*          root,
+                                   const Types::Indexes& newIndexes );
+        // A recursive helper function, replaces index i of every leaf of
+        // the subtree by newIndexes[ i ]
+
+    void loosenHelper( KDNode< T >*                  root,
+                       const Types::AxisMinMax< T >& region,
+                       KDNode< T >*                  parent );
+        // A recursive helper function, centres every hyperplane of the
+        // subtree between the bounds of its children, sets the bounds of
+        // every inner node to its part of region and records the parent
+        // of every leaf in m_parents
+
+    void adoptHelper( KDNode< T >* root );
+        // Records root in m_parents as the parent of its leaf children
+
+    std::shared_ptr< KDNode< T > > removeHelper(
+            const std::shared_ptr< KDNode< T > >& root,
+            const size_t                          index,
+            bool&                                 found );
+        // A recursive helper function, returns the subtree without the
+        // leaf of the point stored under index, found through the bounds
+        // of the subtree, and sets found. The sibling of the leaf takes
+        // the place of their parent, the other nodes on the path are
+        // replaced keeping their bounds. Returns root itself if the leaf
+        // is not in the subtree.
+
+    std::shared_ptr< KDNode< T > > insertHelper(
+            const std::shared_ptr< KDNode< T > >& root,
+            const Types::AxisMinMax< T >&         region,
+            const size_t                          index );
+        // A recursive helper function, returns the subtree with a new leaf
+        // for the point stored under index, which must lie within region,
+        // the loose cell of root. The leaf the point falls into is split
+        // halfway to the point along the axis they differ most in and the
+        // new node takes region as bounds, the nodes on the path are
+        // replaced with bounds grown to the point.
+
+    void correspondencesBlockedHelper(
+            const Types::Points< T >& sourcePoints,
+            const double              maxRank,
+            const Types::Neighbours&  previous,
+            const size_t              numThreads,
+            Types::Neighbours&        result ) const;
+        // Stores in result the nearest point of every source point within
+        // maxRank, ties broken by the smaller index, found by expanding
+        // the squared distances of blocks of source points and blocks of
+        // tree points through their squared norms. Every point the
+        // expansion cannot rule out within its rounding error is ranked
+        // exactly by Metric::rank(). previous, if not empty, holds a
+        // correspondence per source point that seeds its search.
+
+    static std::shared_ptr< KDNode< T > > cloneHelper(
+            const KDNode< T >* root,
+            const size_t       offset );
+        // A recursive helper function, returns a deep copy of the
+        // summarized subtree with offset added to every leaf index
+
+    void pointIndexesInBoxHelper( const KDNode< T >*            root,
+                                  const Types::AxisMinMax< T >& box,
+                                  Types::Indexes&               result )
+                                                                      const;
+        // A recursive helper function, appends indexes of all points of the
+        // subtree inside of the box to result
+
+    KDAggregate aggregateInBoxHelper( const KDNode< T >*            root,
+                                      const Types::AxisMinMax< T >& box )
+                                                                      const;
+        // A recursive helper function, aggregates points of the subtree
+        // inside of the box
+
+    KDAggregate aggregateInRadiusHelper(
+            const KDNode< T >*       root,
+            const Types::Point< T >& pointOfInterest,
+            const double             maxRank ) const;
+        // A recursive helper function, aggregates points of the subtree
+        // whose distance rank to the point of interest is at most maxRank
+
+    double kernelDensityHelper( const KDNode< T >*       root,
+                                const Types::Point< T >& pointOfInterest,
+                                const double             scale,
+                                const double             maxKernelError )
+                                                                      const;
+        // A recursive helper function, returns the sum of
+        // exp( -|x - p|^2 * scale ) over the subtree, approximating
+        // subtrees whose kernel values vary by at most maxKernelError
+
+    void kernelDensitiesHelper( const KDNode< T >*     queryRoot,
+                                const KDTree&          queryTree,
+                                const KDNode< T >*     referenceRoot,
+                                const double           scale,
+                                const double           maxKernelError,
+                                std::vector< double >& sums ) const;
+        // A recursive dual tree helper function, adds the kernel sums of
+        // the reference subtree to sums of every query in query subtree
+
+    static void addToLeaves( const KDNode< T >*     root,
+                             const double           value,
+                             std::vector< double >& sums );
+        // A recursive helper function, adds value to sums of every leaf
+        // index in the subtree
+
+    void serializeTopHelper(
+            const KDNode< T >*                 root,
+            const size_t                       levels,
+            std::vector< std::string >&        pieces,
+            std::vector< const KDNode< T >* >& subtrees,
+            std::vector< size_t >&             subtreePieces ) const;
+        // A recursive helper function, appends the hyperplanes of the top
+        // levels of the tree to the last of pieces and reserves a piece
+        // for every subtree below them, to be written by
+        // serializeHelper()
+
+    void serializeHelper( std::string&       out,
+                          const KDNode< T >* root ) const;
+        // A recursive helper function, appends the KD tree structure in
+        // preorder to out
+
+    static size_t skipSubtreeHelper(
+            const std::vector< const char* >& lines,
+            size_t                            position );
+        // Returns the line following the serialized subtree starting at
+        // line position, looking at the node markers only.
+        // Returns KDTREE_ERROR_INDEX if the markers are malformed.
 
     std::shared_ptr< KDNode< T > > deserializeHelper(
-                          std::ifstream& fileStream );
-        // A recursive helper function, writes the KD tree structure to
-        // provided file stream. This function expects a valid file
-        // stream to function properly.
+            const std::vector< const char* >& lines,
+            size_t&                           position,
+            const Types::Points< T >&         points,
+            const size_t                      numThreads,
+            KDStatus&                         status );
+        // A recursive helper function, reads the KD tree structure from
+        // lines starting at position and checks every leaf index and
+        // hyperplane axis against points. Advances position past the
+        // lines read. While numThreads > 1 the left subtree is read by a
+        // separate thread.
+        // Sets status and returns nullptr on failure.
 
     // The following allows creating of derived classes for test purposes
     // while not exposing the vital components in productions classes
@@ -156,45 +741,100 @@ protected:
     Types::Points< T >                 m_points;
         // Points that the tree is built on
 
+    std::vector< double >              m_values;
+        // Optional values attached to the points, either empty or of the
+        // same size as m_points
+
+    std::vector< uint32_t >            m_permutation;
+        // Original index of every point after reorder(), empty while the
+        // points are in their original order
+
 private:
 
     std::string                        m_type;
         // Type of the KDTree. Used primarily for debugging/logs
+
+    KDLookupGrid< T >                  m_grid;
+        // Optional starting subtrees of nearestPointIndex() searches
+
+    std::vector< KDNode< T >* >        m_parents;
+        // Parent of the leaf of every point, nullptr for a leaf at the
+        // root, while the bounds of the inner nodes are loose cells, empty
+        // otherwise. Filled by the first update() after the tree structure
+        // was assembled.
+
+    size_t                             m_reinserted;
+        // Number of points update() moved to another leaf since the tree
+        // was last built
 };
 
 // INDEPENDENT OPERATORS
-template< typename T >
+template< typename T, typename SplitPolicy, typename Metric >
 std::ostream& operator<<( std::ostream& lhs,
-                          const KDTree< T >& rhs );
+                          const KDTree< T, SplitPolicy, Metric >& rhs );
 
 //============================================================================
 //                  CREATORS
 //============================================================================
 
-template< typename T >
-KDTree< T >::KDTree()
+template< typename T, typename SplitPolicy, typename Metric >
+KDTree< T, SplitPolicy, Metric >::KDTree()
 : m_type( Constants::KDTREE_SIMPLE_VARIETY )
+, m_reinserted( 0u )
 {
     // nothing to do here
 }
 
-template< typename T >
-KDTree< T >::KDTree( const Types::Points< T >& points )
+template< typename T, typename SplitPolicy, typename Metric >
+KDTree< T, SplitPolicy, Metric >::KDTree( const Types::Points< T >& points )
+: m_points( points )
+, m_type( Constants::KDTREE_SIMPLE_VARIETY )
+, m_reinserted( 0u )
+{
+    buildWrapper();
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDTree< T, SplitPolicy, Metric >::KDTree( const Types::Points< T >&    points,
+                                          const std::vector< double >& values )
 : m_points( points )
+, m_values( values )
 , m_type( Constants::KDTREE_SIMPLE_VARIETY )
+, m_reinserted( 0u )
 {
+    if ( m_values.size() != m_points.size() )
+    {
+        std::cerr << "KDTree::KDTree() number of values = "
+                  << m_values.size() << " does not match number of "
+                  << "points = " << m_points.size() << ", values dropped"
+                  << std::endl;
+        m_values.clear();
+    }
+
     buildWrapper();
 }
 
-template< typename T >
-KDTree< T >::KDTree( const KDTree& other )
+template< typename T, typename SplitPolicy, typename Metric >
+KDTree< T, SplitPolicy, Metric >::KDTree( const Types::Points< T >& points,
+                                          const Types::BuildMethod  method,
+                                          const size_t              numThreads )
+: m_points( points )
+, m_type( Constants::KDTREE_SIMPLE_VARIETY )
+, m_reinserted( 0u )
+{
+    buildWrapper( method, Parallel::numThreads( numThreads ) );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDTree< T, SplitPolicy, Metric >::KDTree( const KDTree& other )
 : m_type( Constants::KDTREE_SIMPLE_VARIETY )
+, m_reinserted( 0u )
 {
     copy( other );
 }
 
-template< typename T >
-KDTree< T >::~KDTree()
+template< typename T, typename SplitPolicy, typename Metric >
+KDTree< T, SplitPolicy, Metric >::~KDTree()
 {
     // nothing to do here
 }
@@ -203,24 +843,23 @@ KDTree< T >::~KDTree()
 //                  OPERATORS
 //============================================================================
 
-template< typename T >
-KDTree< T >&
-KDTree< T >::operator=( const KDTree< T >& other )
+template< typename T, typename SplitPolicy, typename Metric >
+KDTree< T, SplitPolicy, Metric >&
+KDTree< T, SplitPolicy, Metric >::operator=( const KDTree& other )
 {
     copy( other );
     return *this;
 }
 
-template< typename T >
+template< typename T, typename SplitPolicy, typename Metric >
 bool
-KDTree< T >::operator==( const KDTree< T >& other ) const
+KDTree< T, SplitPolicy, Metric >::operator==( const KDTree& other ) const
 {
     return equals( other );
 }
 
-template< typename T >
-bool KDTree< T >::operator!=(
-        const KDTree< T >& other ) const
+template< typename T, typename SplitPolicy, typename Metric >
+bool KDTree< T, SplitPolicy, Metric >::operator!=( const KDTree& other ) const
 {
     return !equals( other );
 }
@@ -228,268 +867,522 @@ bool KDTree< T >::operator!=(
 //============================================================================
 //                  PRIMARY INTERFACE
 //============================================================================
-template< typename T >
-bool
-KDTree< T >::serialize( const std::string& filename ) const
+template< typename T, typename SplitPolicy, typename Metric >
+KDStatus
+KDTree< T, SplitPolicy, Metric >::serialize( const std::string& filename,
+                                             const size_t       numThreads ) const
 {
-    std::fstream serializedData;
-    serializedData.open( filename, std::fstream::out | std::fstream::trunc );
-
-    if ( !serializedData.is_open() )
-    {
-        std::cerr << "KDTree:serialize() is unable to open "
-                  << "'" << filename << "' for writing"
-                  << std::endl;
-        return false;
-    }
+    const size_t threads = Parallel::numThreads( numThreads );
+    std::vector< std::string > pieces( 1u );
 
     // First serialize tree type
-    serializedData << m_type << '\n';
+    pieces.back() += m_type;
+    pieces.back() += '\n';
 
     // Second serialize number of lines
-    serializedData << m_points.size() << '\n';
-
-    // Third all the points
-    for ( size_t i = 0; i < m_points.size(); ++i )
+    Text::appendNumber( pieces.back(), m_points.size() );
+    pieces.back() += '\n';
+
+    // Third all the points, a piece per thread
+    const size_t pointPieces = pieces.size();
+    pieces.resize( pieces.size() + threads );
+    Parallel::forEachRange( m_points.size(), threads,
+        [ & ]( const size_t begin, const size_t end, const size_t chunk )
+        {
+            std::string& out = pieces[ pointPieces + chunk ];
+            out.reserve( ( end - begin ) * m_points[ begin ].size() * 24u );
+            for ( size_t i = begin; i < end; ++i )
+            {
+                Text::appendPoint( out, m_points[ i ] );
+            }
+        } );
+
+    // Fourth serialize tree structure in preorder. The top levels are
+    // written here, the subtrees below them by separate threads into
+    // pieces of their own
+    std::vector< const KDNode< T >* > subtrees;
+    std::vector< size_t >             subtreePieces;
+    size_t levels = 0u;
+    while ( ( static_cast< size_t >( 1u ) << levels ) < threads * 4u )
     {
-        const Types::Point< T >& point = m_points[ i ];
-        serializedData << point[ 0 ];
+        ++levels;
+    }
+    pieces.push_back( std::string() );
+    serializeTopHelper( m_root.get(), threads > 1u ? levels : 0u,
+                        pieces, subtrees, subtreePieces );
 
-        for ( size_t j = 1; j < point.size(); ++j )
+    Parallel::forEachRange( subtrees.size(), threads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
         {
-            serializedData << ',' << point[ j ];
-        }
+            for ( size_t i = begin; i < end; ++i )
+            {
+                serializeHelper( pieces[ subtreePieces[ i ] ], subtrees[ i ] );
+            }
+        } );
+
+    // Fifth the original indexes of reordered points
+    if ( !m_permutation.empty() )
+    {
+        pieces.back() += Constants::KDTREE_PERMUTATION_MARKER;
+        pieces.back() += '\n';
 
-        serializedData << '\n';
+        const size_t permutationPieces = pieces.size();
+        pieces.resize( pieces.size() + threads );
+        Parallel::forEachRange( m_permutation.size(), threads,
+            [ & ]( const size_t begin, const size_t end, const size_t chunk )
+            {
+                std::string& out = pieces[ permutationPieces + chunk ];
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    Text::appendNumber( out, m_permutation[ i ] );
+                    out += '\n';
+                }
+            } );
     }
 
-    // Fourth serialize tree structure in postorder
-    serializeHelper( serializedData, m_root );
+    return Text::writeFile( filename, pieces );
+}
 
-    serializedData.close();
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::serializeTopHelper(
+        const KDNode< T >*                 root,
+        const size_t                       levels,
+        std::vector< std::string >&        pieces,
+        std::vector< const KDNode< T >* >& subtrees,
+        std::vector< size_t >&             subtreePieces ) const
+{
+    if ( nullptr != root && !root->isLeaf() && levels )
+    {
+        std::string& out = pieces.back();
+        out += Constants::KDTREE_HYPERPLANE_MARKER;
+        out += '\n';
+        root->hyperplane().serialize( out );
+        out += '\n';
+
+        serializeTopHelper( root->left().get(), levels - 1u,
+                            pieces, subtrees, subtreePieces );
+        serializeTopHelper( root->right().get(), levels - 1u,
+                            pieces, subtrees, subtreePieces );
+        return;
+    }
 
-    return true;
+    // The subtree gets a piece of its own, text of the remaining top
+    // levels continues in a new piece after it
+    subtrees.push_back( root );
+    subtreePieces.push_back( pieces.size() );
+    pieces.push_back( std::string() );
+    pieces.push_back( std::string() );
 }
 
-template< typename T >
+template< typename T, typename SplitPolicy, typename Metric >
 void
-KDTree< T >::serializeHelper( std::fstream&                  fileStream,
-                              std::shared_ptr< KDNode< T > > root ) const
+KDTree< T, SplitPolicy, Metric >::serializeHelper(
+        std::string&       out,
+        const KDNode< T >* root ) const
 {
     // Handle special case of an empty tree
     if ( nullptr == root )
     {
-        fileStream << Constants::KDTREE_EMPTY_MARKER << '\n';
+        out += Constants::KDTREE_EMPTY_MARKER;
+        out += '\n';
         return;
     }
 
     // Handle hyperplane and leaf nodes differently
     if ( root->isLeaf() )
     {
-        fileStream << Constants::KDTREE_LEAF_MARKER << '\n';
-        fileStream << root->leafPointIndex()        << '\n';
+        out += Constants::KDTREE_LEAF_MARKER;
+        out += '\n';
+        Text::appendNumber( out, root->leafPointIndex() );
+        out += '\n';
         return;
     }
 
-    fileStream << Constants::KDTREE_HYPERPLANE_MARKER << '\n';
-    fileStream << root->hyperplane().serialize() << '\n';
+    out += Constants::KDTREE_HYPERPLANE_MARKER;
+    out += '\n';
+    root->hyperplane().serialize( out );
+    out += '\n';
 
     // Then store children
-    if ( nullptr != root->left() )
-    {
-        serializeHelper( fileStream, root->left() );
-    }
-    if ( nullptr != root->right() )
-    {
-        serializeHelper( fileStream, root->right() );
-    }
+    serializeHelper( out, root->left().get() );
+    serializeHelper( out, root->right().get() );
 }
 
-template< typename T >
-bool
-KDTree< T >::deserialize( const std::string& filename )
+template< typename T, typename SplitPolicy, typename Metric >
+KDStatus
+KDTree< T, SplitPolicy, Metric >::deserialize( const std::string& filename,
+                                               const size_t       numThreads )
 {
-    std::ifstream treeData( filename );
+    const size_t threads = Parallel::numThreads( numThreads );
 
-    if ( !treeData.is_open() )
+    std::string contents;
+    const KDStatus read = Text::readFile( filename, contents );
+    if ( !read )
     {
-        std::cerr << "KDTree< T >::serialize() is unable to open "
-                  << "'" << filename << "' for reading"
-                  << std::endl;
-        return false;
+        return read;
     }
 
-    size_t pos;
-    std::string line;
+    std::vector< const char* > lines;
+    Text::splitLines( contents, lines, threads );
+    const size_t numLines = lines.size() - 1u;
 
     // First check tree type
-    getline ( treeData, line );
+    if ( numLines < 1u || !Text::lineEquals( lines, 0u, m_type ) )
+    {
+        return KDStatus( KDStatus::Code::TYPE_MISMATCH,
+                         "unexpected tree type",
+                         1u );
+    }
 
-    if ( line != m_type )
+    // Then number of points
+    size_t numOfPoints;
+    const char* cursor = numLines < 2u ? nullptr : lines[ 1 ];
+    if ( nullptr == cursor ||
+         !Loader::parseIndex( cursor, Text::lineEnd( lines, 1u ), numOfPoints ) ||
+         cursor != Text::lineEnd( lines, 1u ) )
     {
-        std::cerr << "Tree type mismatch encountered in"
-                  << "KDTree::deserialize() "
-                  << "expected    : '" << m_type << "', "
-                  << "encountered : '" << line   << "'"
-                  << std::endl;
-                  return false;
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "malformed number of points",
+                         2u );
+    }
+
+    if ( numLines - 2u < numOfPoints )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "fewer points than declared",
+                         numLines + 1u );
     }
 
-    // First deserialize number of lines
-    getline ( treeData, line );
-    int numOfPoints;
+    // Second all the points, parsed in place by several threads. Every
+    // thread stops at its first failure, the earliest one is reported
+    Types::Points< T > points( numOfPoints );
+    std::vector< KDStatus > failures( threads );
+    Parallel::forEachRange( numOfPoints, threads,
+        [ & ]( const size_t begin, const size_t end, const size_t chunk )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                const KDStatus status = Loader::parsePoint(
+                        lines[ 2u + i ], Text::lineEnd( lines, 2u + i ),
+                        points[ i ], 3u + i );
+                if ( !status )
+                {
+                    failures[ chunk ] = status;
+                    return;
+                }
+            }
+        } );
 
-    try
+    for ( size_t chunk = 0; chunk < failures.size(); ++chunk )
     {
-        numOfPoints = std::stoi( line );
+        if ( !failures[ chunk ] )
+        {
+            return failures[ chunk ];
+        }
     }
-    catch ( std::exception e )
+
+    for ( size_t i = 1; i < points.size(); ++i )
     {
-        std::cerr << "Exception encountered during num tree points parsing in"
-                 << "KDTree::deserialize() "
-                 << "line : '" << line << "', "
-                 << "what : '" << e.what() << "'"
-                 << std::endl;
-                 return false;
+        if ( points[ 0 ].size() != points[ i ].size() )
+        {
+            return KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                             "point dimension differs from the first point",
+                             3u + i );
+        }
     }
-    catch ( ... )
+
+    // Third tree structure from preorder, every point must be referenced
+    // by exactly one leaf so that no query can step out of the points
+    size_t position = 2u + numOfPoints;
+    KDStatus status;
+    std::shared_ptr< KDNode< T > > root =
+            deserializeHelper( lines, position, points, threads, status );
+    if ( !status )
     {
-        std::cerr << "Unknown exception encountered during num tree points "
-                  << "parsing in KDTree::deserialize() "
-                  << "line : '" << line << "'"
-                  << std::endl;
-                  return false;
+        return status;
     }
 
-    // Second all the points
-    Types::Points< T > points;
-    points.reserve( numOfPoints );
-    for ( int i = 0; i < numOfPoints; ++i )
+    Types::Indexes order;
+    order.reserve( points.size() );
+    leafOrderHelper( root.get(), order );
+
+    std::vector< bool > referenced( points.size(), false );
+    for ( size_t i = 0; i < order.size(); ++i )
     {
-        Types::Point< T > point;
-        getline ( treeData, line );
+        if ( referenced[ order[ i ] ] )
+        {
+            order.clear();
+            break;
+        }
+        referenced[ order[ i ] ] = true;
+    }
+
+    if ( order.size() != points.size() )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "leaves do not reference every point exactly once",
+                         position );
+    }
 
-        while ( true )
+    // Fourth the optional original indexes of reordered points
+    std::vector< uint32_t > permutation;
+    if ( position < numLines &&
+         Text::lineEquals( lines, position,
+                           Constants::KDTREE_PERMUTATION_MARKER ) )
+    {
+        ++position;
+        if ( numLines - position < points.size() )
         {
-            try
-            {
-                point.push_back( static_cast< T >( stof( line, &pos ) ) );
-            }
-            catch ( std::exception e )
-            {
-                std::cerr << "Exception encountered during tree point parsing in"
-                          << "KDTree::deserialize() "
-                          << "line : '" << line << "', "
-                          << "what : '" << e.what() << "'"
-                          << std::endl;
-                          return false;
-            }
-            catch ( ... )
-            {
-                std::cerr << "Unknown exception encountered during tree point "
-                          << "parsing in KDTree::deserialize() "
-                          << "line : '" << line << "'"
-                          << std::endl;
-                return false;
-            }
+            return KDStatus( KDStatus::Code::PARSE_ERROR,
+                             "malformed permutation",
+                             numLines + 1u );
+        }
 
-            if ( line[ pos ] == ',')
+        permutation.resize( points.size() );
+        Parallel::forEachRange( points.size(), threads,
+            [ & ]( const size_t begin, const size_t end, const size_t chunk )
             {
-                line = line.substr( pos + 1u );
-            }
-            else
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    const char* cursor = lines[ position + i ];
+                    const char* last   = Text::lineEnd( lines, position + i );
+                    size_t index;
+                    if ( !Loader::parseIndex( cursor, last, index ) ||
+                         cursor != last ||
+                         index >= points.size() )
+                    {
+                        failures[ chunk ] =
+                                KDStatus( KDStatus::Code::PARSE_ERROR,
+                                          "malformed permutation",
+                                          position + i + 1u );
+                        return;
+                    }
+                    permutation[ i ] = static_cast< uint32_t >( index );
+                }
+            } );
+
+        for ( size_t chunk = 0; chunk < failures.size(); ++chunk )
+        {
+            if ( !failures[ chunk ] )
             {
-                break;
+                return failures[ chunk ];
             }
         }
-
-        points.push_back( point );
     }
-    m_points = points;
 
-    std::cout << "deserialization begins" << std::endl;
+    m_points.swap( points );
+    m_values.clear();
+    m_permutation.swap( permutation );
+    m_root = root;
+    summarizeHelper( m_root.get() );
+    m_grid.clear();
+    m_parents.clear();
+    m_reinserted = 0u;
+
+    return KDStatus();
+}
 
-    // Third tree structure from postorder
-    m_root = deserializeHelper( treeData );
+template< typename T, typename SplitPolicy, typename Metric >
+size_t
+KDTree< T, SplitPolicy, Metric >::skipSubtreeHelper(
+        const std::vector< const char* >& lines,
+        size_t                            position )
+{
+    const size_t numLines = lines.size() - 1u;
 
-    treeData.close();
+    // Every hyperplane replaces one pending node by two, every leaf and
+    // empty marker completes one
+    size_t pending = 1u;
+    while ( pending && position < numLines )
+    {
+        if ( Text::lineEquals( lines, position,
+                               Constants::KDTREE_HYPERPLANE_MARKER ) )
+        {
+            ++pending;
+            position += 2u;
+        }
+        else if ( Text::lineEquals( lines, position,
+                                    Constants::KDTREE_LEAF_MARKER ) )
+        {
+            --pending;
+            position += 2u;
+        }
+        else if ( Text::lineEquals( lines, position,
+                                    Constants::KDTREE_EMPTY_MARKER ) )
+        {
+            --pending;
+            position += 1u;
+        }
+        else
+        {
+            break;
+        }
+    }
 
-    return true;
+    return pending ? Constants::KDTREE_ERROR_INDEX : position;
 }
 
-template< typename T >
+template< typename T, typename SplitPolicy, typename Metric >
 std::shared_ptr< KDNode< T > >
-KDTree< T >::deserializeHelper( std::ifstream& fileStream )
+KDTree< T, SplitPolicy, Metric >::deserializeHelper(
+        const std::vector< const char* >& lines,
+        size_t&                           position,
+        const Types::Points< T >&         points,
+        const size_t                      numThreads,
+        KDStatus&                         status )
 {
+    const size_t numLines = lines.size() - 1u;
+
     // Inspect node type first
-    std::string line;
-    getline ( fileStream, line );
+    if ( position >= numLines )
+    {
+        status = KDStatus( KDStatus::Code::PARSE_ERROR,
+                           "truncated tree structure",
+                           position + 1u );
+        return nullptr;
+    }
 
     // Handle empty tree special case
-    if ( Constants::KDTREE_EMPTY_MARKER == line )
+    if ( Text::lineEquals( lines, position, Constants::KDTREE_EMPTY_MARKER ) )
     {
+        ++position;
         return nullptr;
     }
 
     // Handle Leaf type
-    if ( Constants::KDTREE_LEAF_MARKER == line )
+    if ( Text::lineEquals( lines, position, Constants::KDTREE_LEAF_MARKER ) )
     {
-        getline ( fileStream, line );
-        int index;
-        try
-        {
-            index = std::stoi( line );
-        }
-        catch ( std::exception e )
+        position += 2u;
+
+        size_t index;
+        const char* cursor = position > numLines ? nullptr :
+                                                   lines[ position - 1u ];
+        if ( nullptr == cursor ||
+             !Loader::parseIndex( cursor,
+                                  Text::lineEnd( lines, position - 1u ),
+                                  index ) )
         {
-            std::cerr << "Exception encountered during leaf index parsing in"
-                      << "KDTree::deserializeHelper()"
-                      << "line : '" << line << "', "
-                      << "what : '" << e.what() << "'"
-                      << std::endl;
+            status = KDStatus( KDStatus::Code::PARSE_ERROR,
+                               "malformed leaf index",
+                               position );
             return nullptr;
         }
-        catch ( ... )
+
+        if ( index >= points.size() )
         {
-            std::cerr << "Unknown exception encountered during leaf index "
-                      << "parsing in KDTree::deserializeHelper()"
-                      << "line : '" << line << "'"
-                      << std::endl;
+            status = KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                               "leaf index out of range of the points",
+                               position );
             return nullptr;
         }
 
-        return std::shared_ptr< KDNode< T > >(
-                new KDNode< T >( static_cast< size_t >( index ) ) );
+        return std::shared_ptr< KDNode< T > >( new KDNode< T >( index ) );
     }
 
     // Handle Hyperplane type
-    if ( Constants::KDTREE_HYPERPLANE_MARKER == line )
+    if ( Text::lineEquals( lines, position,
+                           Constants::KDTREE_HYPERPLANE_MARKER ) )
     {
         // Then load the hyperplane
-        getline( fileStream, line );
+        position += 2u;
+
         KDHyperplane< T > hyperplane;
-        hyperplane.deserialize( line );
+        const KDStatus hyperplaneStatus = position > numLines ?
+                KDStatus( KDStatus::Code::PARSE_ERROR,
+                          "truncated tree structure" ) :
+                hyperplane.deserialize( lines[ position - 1u ],
+                                        Text::lineEnd( lines,
+                                                       position - 1u ) );
+        if ( !hyperplaneStatus )
+        {
+            status = KDStatus( hyperplaneStatus.code(),
+                               hyperplaneStatus.message(),
+                               position );
+            return nullptr;
+        }
+
+        if ( points.empty() ||
+             hyperplane.hyperplaneIndex() >= points[ 0 ].size() )
+        {
+            status = KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                               "hyperplane axis out of range of the points",
+                               position );
+            return nullptr;
+        }
+
+        // Then load children, the left one by a separate thread once the
+        // start of the right one is known from the markers alone
+        std::shared_ptr< KDNode< T > > left;
+        std::shared_ptr< KDNode< T > > right;
+
+        const size_t rightPosition = numThreads > 1u ?
+                skipSubtreeHelper( lines, position ) :
+                Constants::KDTREE_ERROR_INDEX;
+
+        if ( Constants::KDTREE_ERROR_INDEX != rightPosition )
+        {
+            const size_t leftThreads = numThreads / 2u;
+            size_t   leftPosition = position;
+            KDStatus leftStatus;
+
+            std::thread leftWorker( [ & ]()
+                {
+                    left = deserializeHelper( lines, leftPosition, points,
+                                              leftThreads, leftStatus );
+                } );
+
+            position = rightPosition;
+            right = deserializeHelper( lines, position, points,
+                                       numThreads - leftThreads, status );
+            leftWorker.join();
+
+            if ( !leftStatus )
+            {
+                status = leftStatus;
+                return nullptr;
+            }
+        }
+        else
+        {
+            left = deserializeHelper( lines, position, points, 1u, status );
+            if ( !status )
+            {
+                return nullptr;
+            }
+
+            right = deserializeHelper( lines, position, points, 1u, status );
+        }
+
+        if ( !status )
+        {
+            return nullptr;
+        }
 
-        // Then load children
-        std::shared_ptr <KDNode< T > > left = deserializeHelper( fileStream );
-        std::shared_ptr <KDNode< T > > right = deserializeHelper( fileStream );
+        if ( nullptr == left || nullptr == right )
+        {
+            status = KDStatus( KDStatus::Code::PARSE_ERROR,
+                               "hyperplane without two children",
+                               position );
+            return nullptr;
+        }
 
         return std::shared_ptr< KDNode< T > >( new KDNode< T >( hyperplane,
                                                                 left,
                                                                 right ) );
     }
 
-    std::cerr << "Unxpected line encountered during"
-              << "parsing in KDTree::deserializeHelper()"
-              << "line : '" << line << "'"
-              << std::endl;
+    status = KDStatus( KDStatus::Code::PARSE_ERROR,
+                       "unexpected node marker",
+                       position + 1u );
 
     return nullptr;
 }
 
-template< typename T >
+template< typename T, typename SplitPolicy, typename Metric >
 const Types::Point< T >
-KDTree< T >::nearestPoint( const Types::Point< T >& pointOfInterest ) const
+KDTree< T, SplitPolicy, Metric >::nearestPoint(
+        const Types::Point< T >& pointOfInterest ) const
 {
     const size_t index = nearestPointIndex( pointOfInterest );
     if ( Constants::KDTREE_ERROR_INDEX == index )
@@ -500,242 +1393,2554 @@ KDTree< T >::nearestPoint( const Types::Point< T >& pointOfInterest ) const
     return m_points[ index ];
 }
 
-template< typename T >
+template< typename T, typename SplitPolicy, typename Metric >
 size_t
-KDTree< T >::nearestPointIndex(
+KDTree< T, SplitPolicy, Metric >::nearestPointIndex(
         const Types::Point< T >& pointOfInterest ) const
 {
-    return nearestPointIndexHelper( m_root,
-                                    pointOfInterest,
-                                    Constants::KDTREE_ERROR_INDEX );
-}
+    // Sanity
+    if ( m_points.empty() || m_points[ 0 ].size() != pointOfInterest.size() )
+    {
+        return Constants::KDTREE_ERROR_INDEX;
+    }
 
-template< typename T >
-const Types::Points< T >
-KDTree< T >::points() const
-{
-    return m_points;
+    const double* region = nullptr;
+    const std::shared_ptr< KDNode< T > >* start =
+            m_grid.find( pointOfInterest, region );
+    if ( nullptr == start || *start == m_root )
+    {
+        return nearestPointIndexHelper( m_root,
+                                        pointOfInterest,
+                                        Constants::KDTREE_ERROR_INDEX );
+    }
+
+    // The subtree answer stands if no point outside of the subtree region
+    // can be closer, otherwise it seeds the search from the root
+    const size_t startIndex = nearestPointIndexHelper(
+            *start, pointOfInterest, Constants::KDTREE_ERROR_INDEX );
+    if ( KDLookupGrid< T >::template containsBall< Metric >(
+                 region, pointOfInterest,
+                 Metric::rank( pointOfInterest, m_points[ startIndex ] ) ) )
+    {
+        return startIndex;
+    }
+
+    return nearestPointIndexHelper( m_root, pointOfInterest, startIndex );
 }
 
-template< typename T >
-const std::string&
-KDTree< T >::type() const
+template< typename T, typename SplitPolicy, typename Metric >
+size_t
+KDTree< T, SplitPolicy, Metric >::find( const Types::Point< T >& point ) const
 {
-    return m_type;
+    // Sanity
+    if ( m_points.empty() || m_points[ 0 ].size() != point.size() )
+    {
+        return Constants::KDTREE_ERROR_INDEX;
+    }
+
+    return findHelper( m_root.get(), point );
 }
 
-template< typename T >
-const KDHyperplane< T >
-KDTree< T >::chooseBestSplit( const Types::Indexes& indexes ) const
+template< typename T, typename SplitPolicy, typename Metric >
+std::vector< Types::Indexes >
+KDTree< T, SplitPolicy, Metric >::duplicates() const
 {
-    Types::Points< T > tempPoints;
-    tempPoints.reserve( indexes.size() );
-
-    for ( typename Types::Indexes::const_iterator it = indexes.cbegin();
-          it != indexes.cend(); ++it )
+    Types::Indexes order( m_points.size() );
+    std::iota( order.begin(), order.end(), 0u );
+    std::sort( order.begin(), order.end(),
+               [ & ]( const size_t lhs, const size_t rhs )
+               {
+                   return m_points[ lhs ] != m_points[ rhs ] ?
+                          m_points[ lhs ] <  m_points[ rhs ] :
+                          lhs < rhs;
+               } );
+
+    std::vector< Types::Indexes > groups;
+    for ( size_t begin = 0, end = 0; begin < order.size(); begin = end )
     {
-        tempPoints.push_back( m_points[ ( *it ) ] );
+        for ( end = begin + 1u; end < order.size() &&
+              m_points[ order[ end ] ] == m_points[ order[ begin ] ]; ++end )
+        {
+            // nothing to do here
+        }
+
+        if ( end - begin > 1u )
+        {
+            groups.push_back( Types::Indexes( order.begin() + begin,
+                                              order.begin() + end ) );
+        }
     }
 
-    const size_t axis  = Utils::axisOfHighestVariance( tempPoints );
-    const T      value = Utils::medianValueInAxis( tempPoints, axis );
+    std::sort( groups.begin(), groups.end(),
+               []( const Types::Indexes& lhs, const Types::Indexes& rhs )
+               {
+                   return lhs[ 0 ] < rhs[ 0 ];
+               } );
 
-    return KDHyperplane< T >( axis, value );
+    return groups;
 }
 
-template< typename T >
-void
-KDTree< T >::buildWrapper()
+template< typename T, typename SplitPolicy, typename Metric >
+Types::Indexes
+KDTree< T, SplitPolicy, Metric >::pointIndexesInRadius(
+        const Types::Point< T >& pointOfInterest,
+        const double             radius ) const
 {
-    Types::Indexes globalIndexes;
-    globalIndexes.reserve( m_points.size() );
-    for ( size_t i = 0; i < m_points.size(); ++i )
+    Types::Indexes result;
+
+    // Sanity
+    if ( m_points.empty() ||
+         m_points[ 0 ].size() != pointOfInterest.size() ||
+         radius < 0.0L )
     {
-        globalIndexes.push_back( i );
+        return result;
     }
 
-    m_root = build( globalIndexes );
+    pointIndexesInRadiusHelper( m_root.get(),
+                                pointOfInterest,
+                                Metric::toRank( radius ),
+                                result );
+
+    return result;
 }
 
-template< typename T >
-std::shared_ptr< KDNode< T > >
-KDTree< T >::build( const Types::Indexes& indexes )
+template< typename T, typename SplitPolicy, typename Metric >
+Types::Indexes
+KDTree< T, SplitPolicy, Metric >::nearestPointIndexes(
+        const Types::Point< T >& pointOfInterest,
+        const size_t             k ) const
 {
+    Types::Indexes result;
+
     // Sanity
-    if ( !indexes.size() )
+    if ( m_points.empty() ||
+         m_points[ 0 ].size() != pointOfInterest.size() ||
+         !k )
     {
-        std::cerr << "KDTree< T >::build() points container is empty"
-                  << std::endl;
-        return std::shared_ptr< KDNode< T > >( nullptr );
+        return result;
     }
 
-    // Base Case
-    if ( indexes.size() == 1u )
-    {
-        // Make a leaf node
-        typename Types::Indexes::const_iterator it = indexes.cbegin();
-        return std::shared_ptr< KDNode< T > >(
-                new KDNode< T >( ( *it ) ) );
-    }
+    Types::Neighbours best;
+    best.reserve( std::min( k, m_points.size() ) );
+    double bound = std::numeric_limits< double >::max();
 
-    // Recursive case
-    const KDHyperplane< T > hyperplane = chooseBestSplit( indexes );
+    nearestPointIndexesHelper( m_root.get(),
+                               pointOfInterest,
+                               k,
+                               Constants::KDTREE_ERROR_INDEX,
+                               1.0L,
+                               best,
+                               bound );
 
-    Types::Indexes leftIndexes;
-    Types::Indexes rightIndexes;
+    std::sort_heap( best.begin(), best.end() );
 
-    for ( typename Types::Indexes::const_iterator it = indexes.cbegin();
-          it != indexes.cend(); ++it )
+    result.reserve( best.size() );
+    for ( typename Types::Neighbours::const_iterator it = best.cbegin();
+          it != best.cend(); ++it )
     {
-        Types::Point< T > point = m_points[ (*it) ];
-
-        if ( point[ hyperplane.hyperplaneIndex() ] < hyperplane.value() )
-        {
-            leftIndexes.push_back( *it );
-        }
-        else
-        {
-            rightIndexes.push_back( *it );
-        }
+        result.push_back( it->second );
     }
 
-    std::shared_ptr< KDNode< T > > leftSubtree(  build( leftIndexes  ) );
-    std::shared_ptr< KDNode< T > > rightSubtree( build( rightIndexes ) );
-
-    return std::shared_ptr< KDNode< T > >( new KDNode< T >( hyperplane,
-                                                            leftSubtree,
-                                                            rightSubtree ) );
+    return result;
 }
 
-template< typename T >
-const size_t
-KDTree< T >::nearestPointIndexHelper(
-        std::shared_ptr< KDNode< T > > root,
-        const Types::Point< T >&       pointOfInterest,
-        const size_t                   bestSoFarIndex ) const
+template< typename T, typename SplitPolicy, typename Metric >
+Types::Neighbours
+KDTree< T, SplitPolicy, Metric >::correspondences(
+        const Types::Points< T >& sourcePoints,
+        const double              maxDistance,
+        const Types::Neighbours&  previous,
+        const size_t              numThreads,
+        const bool                blocked ) const
 {
-    // Base case
-    if ( nullptr == root )
+    Types::Neighbours result;
+
+    // Sanity
+    if ( m_points.empty() || maxDistance < 0.0L )
     {
-        return Constants::KDTREE_ERROR_INDEX;
+        return result;
     }
 
-    if ( root->isLeaf() )
+    for ( typename Types::Points< T >::const_iterator it =
+                  sourcePoints.cbegin();
+          it != sourcePoints.cend(); ++it )
     {
-        // Sanity
-        if ( Constants::KDTREE_ERROR_INDEX == root->leafPointIndex() )
+        if ( m_points[ 0 ].size() != it->size() )
         {
-            std::cerr << "Internal logic error, root " << root << " must not "
-                      << "have Constants::KDTREE_ERROR_INDEX index"
-                      << std::endl;
-            return root->leafPointIndex();
+            return result;
         }
+    }
 
-        // Initial greedy search
-        if ( Constants::KDTREE_ERROR_INDEX == bestSoFarIndex )
-        {
-            return root->leafPointIndex();
-        }
+    const bool   warmStart = previous.size() == sourcePoints.size();
+    const double maxRank =
+            maxDistance >= Metric::fromRank( Constants::KDTREE_MAX_DISTANCE ) ?
+            Constants::KDTREE_MAX_DISTANCE :
+            Metric::toRank( maxDistance );
+
+    result.resize( sourcePoints.size() );
+
+    if ( blocked &&
+         std::is_same< Metric, KDEuclideanMetric >::value &&
+         ( std::is_same< T, float >::value ||
+           std::is_same< T, double >::value ) &&
+         m_points[ 0 ].size() >=
+                 Constants::KDTREE_BLOCKED_SEARCH_MIN_DIMENSION &&
+         m_points.size() <= Constants::KDTREE_BLOCKED_SEARCH_MAX_POINTS )
+    {
+        correspondencesBlockedHelper( sourcePoints, maxRank,
+                                      warmStart ? previous :
+                                                  Types::Neighbours(),
+                                      numThreads, result );
+        return result;
+    }
 
-        const Types::Point< T >& leafPoint =
-                m_points[ root->leafPointIndex() ];
+    Parallel::forEachRange( sourcePoints.size(), numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            Types::Neighbours best;
+            best.reserve( 1u );
 
-        const double distance = Utils::distance< T >( leafPoint,
-                                                      pointOfInterest );
+            for ( size_t i = begin; i < end; ++i )
+            {
+                const Types::Point< T >& source = sourcePoints[ i ];
+
+                best.clear();
+                double bound = maxRank;
+
+                if ( warmStart && previous[ i ].second < m_points.size() )
+                {
+                    const double previousRank = Metric::rank(
+                            m_points[ previous[ i ].second ], source );
+
+                    if ( previousRank <= bound )
+                    {
+                        best.push_back( Types::Neighbour(
+                                previousRank, previous[ i ].second ) );
+                        bound = previousRank;
+                    }
+                }
+
+                nearestPointIndexesHelper( m_root.get(), source, 1u,
+                                           Constants::KDTREE_ERROR_INDEX,
+                                           1.0L, best, bound );
+
+                result[ i ] = best.empty() ?
+                        Types::Neighbour( Constants::KDTREE_MAX_DISTANCE,
+                                          Constants::KDTREE_ERROR_INDEX ) :
+                        best.front();
+            }
+        } );
 
-        if ( Constants::KDTREE_INVALID_DISTANCE == distance )
-        {
-            std::cerr << "Point cardinality mismatch. Point of interest has"
-                      << "cardinality = " << pointOfInterest.size() << " "
-                      << "while points stored in the tree have "
-                      << "cardinality = " << leafPoint << " "
-                      << std::endl;
-            return Constants::KDTREE_ERROR_INDEX;
-        }
+    return result;
+}
 
-        if ( distance < Utils::distance< T >( m_points[ bestSoFarIndex ],
-                                              pointOfInterest ) )
-        {
-            return root->leafPointIndex();
-        }
-        else
-        {
-            return bestSoFarIndex;
-        }
-    }
+template< typename T, typename SplitPolicy, typename Metric >
+Types::Indexes
+KDTree< T, SplitPolicy, Metric >::pointIndexesInBox(
+        const Types::AxisMinMax< T >& box ) const
+{
+    Types::Indexes result;
 
     // Sanity
-    if ( pointOfInterest.size() <= root->hyperplane().hyperplaneIndex() )
+    if ( m_points.empty() || m_points[ 0 ].size() != box.size() )
     {
-        std::cerr << "Point cardinality mismatch. Point of interest has"
-                  << "cardinality = " << pointOfInterest.size() << " "
-                  << "while points stored in the tree have "
-                  << "cardinality of at least = "
-                  << root->hyperplane().hyperplaneIndex() << " "
-                  << std::endl;
-        return Constants::KDTREE_ERROR_INDEX;
+        return result;
     }
 
-    // Recursive case
-    std::shared_ptr< KDNode< T > > greedy;
+    pointIndexesInBoxHelper( m_root.get(), box, result );
+
+    return result;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDAggregate
+KDTree< T, SplitPolicy, Metric >::aggregateInBox(
+        const Types::AxisMinMax< T >& box ) const
+{
+    // Sanity
+    if ( m_points.empty() || m_points[ 0 ].size() != box.size() )
+    {
+        return KDAggregate();
+    }
+
+    return aggregateInBoxHelper( m_root.get(), box );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDAggregate
+KDTree< T, SplitPolicy, Metric >::aggregateInRadius(
+        const Types::Point< T >& pointOfInterest,
+        const double             radius ) const
+{
+    // Sanity
+    if ( m_points.empty() ||
+         m_points[ 0 ].size() != pointOfInterest.size() ||
+         radius < 0.0L )
+    {
+        return KDAggregate();
+    }
+
+    return aggregateInRadiusHelper( m_root.get(),
+                                    pointOfInterest,
+                                    Metric::toRank( radius ) );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDKnnGraph
+KDTree< T, SplitPolicy, Metric >::buildKnnGraph( const size_t k,
+                                                 const double epsilon,
+                                                 const size_t numThreads ) const
+{
+    const size_t size = m_points.size();
+
+    // Sanity
+    if ( size > std::numeric_limits< uint32_t >::max() || epsilon < 0.0L )
+    {
+        std::cerr << "KDTree::buildKnnGraph() supports at most 2^32 points "
+                  << "and non-negative epsilon, "
+                  << "num points = " << size << ", "
+                  << "epsilon = " << epsilon
+                  << std::endl;
+        return KDKnnGraph();
+    }
+
+    const size_t degree = std::min( k, size ? size - 1u : 0u );
+    KDKnnGraph graph( size, degree );
+
+    if ( !degree )
+    {
+        return graph;
+    }
+
+    Types::Indexes order;
+    order.reserve( size );
+    leafOrderHelper( m_root.get(), order );
+
+    const double pruneScale = Metric::toRank( 1.0L + epsilon );
+
+    Parallel::forEachRange( size, numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            Types::Neighbours best;
+            best.reserve( degree );
+
+            size_t previous       = Constants::KDTREE_ERROR_INDEX;
+            double previousRadius = 0.0L;
+
+            for ( size_t pos = begin; pos < end; ++pos )
+            {
+                const size_t             index           = order[ pos ];
+                const Types::Point< T >& pointOfInterest = m_points[ index ];
+
+                // The degree neighbours of the previous point are all
+                // within previousRadius + |previous - pointOfInterest| of
+                // the point of interest, the same holds for the previous
+                // point itself if it was one of them
+                double bound = std::numeric_limits< double >::max();
+                if ( Constants::KDTREE_ERROR_INDEX != previous )
+                {
+                    const double radius = previousRadius +
+                            Metric::fromRank( Metric::rank(
+                                    m_points[ previous ],
+                                    pointOfInterest ) );
+                    bound = Metric::toRank( radius ) * ( 1.0L + 1e-9 );
+                }
+
+                best.clear();
+                nearestPointIndexesHelper( m_root.get(), pointOfInterest,
+                                           degree, index, pruneScale,
+                                           best, bound );
+
+                // Rounding may have cut the seeded bound too tight
+                if ( best.size() < degree )
+                {
+                    best.clear();
+                    bound = std::numeric_limits< double >::max();
+                    nearestPointIndexesHelper( m_root.get(), pointOfInterest,
+                                               degree, index, pruneScale,
+                                               best, bound );
+                }
+
+                std::sort_heap( best.begin(), best.end() );
+
+                uint32_t* neighbours = graph.neighbours( index );
+                float*    distances  = graph.distances( index );
+                for ( size_t i = 0; i < degree; ++i )
+                {
+                    neighbours[ i ] = static_cast< uint32_t >(
+                            best[ i ].second );
+                    distances[ i ]  = static_cast< float >(
+                            Metric::fromRank( best[ i ].first ) );
+                }
+
+                previous       = index;
+                previousRadius = Metric::fromRank( best.back().first );
+            }
+        } );
+
+    return graph;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+double
+KDTree< T, SplitPolicy, Metric >::kernelDensity(
+        const Types::Point< T >& pointOfInterest,
+        const double             bandwidth,
+        const double             tolerance ) const
+{
+    // Sanity
+    if ( bandwidth <= 0.0L ||
+         ( !m_points.empty() &&
+           m_points[ 0 ].size() != pointOfInterest.size() ) )
+    {
+        return Constants::KDTREE_INVALID_DENSITY;
+    }
+
+    if ( m_points.empty() )
+    {
+        return 0.0L;
+    }
+
+    const double variance2 = 2.0L * bandwidth * bandwidth;
+    const double norm = std::pow( M_PI * variance2,
+                                  -0.5L * pointOfInterest.size() );
+
+    const double sum = kernelDensityHelper( m_root.get(),
+                                            pointOfInterest,
+                                            1.0L / variance2,
+                                            2.0L * tolerance / norm );
+
+    return norm * sum / m_points.size();
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::vector< double >
+KDTree< T, SplitPolicy, Metric >::kernelDensities(
+        const Types::Points< T >& pointsOfInterest,
+        const double              bandwidth,
+        const double              tolerance,
+        const size_t              numThreads ) const
+{
+    std::vector< double > densities;
+
+    // Sanity
+    if ( bandwidth <= 0.0L )
+    {
+        return densities;
+    }
+
+    for ( typename Types::Points< T >::const_iterator it =
+                  pointsOfInterest.cbegin();
+          it != pointsOfInterest.cend(); ++it )
+    {
+        if ( !m_points.empty() && m_points[ 0 ].size() != it->size() )
+        {
+            return densities;
+        }
+    }
+
+    densities.resize( pointsOfInterest.size(), 0.0L );
+
+    if ( m_points.empty() || pointsOfInterest.empty() )
+    {
+        return densities;
+    }
+
+    const KDTree< T, SplitPolicy, Metric > queryTree( pointsOfInterest );
+
+    // Split the query tree into enough disjoint subtrees to keep every
+    // thread busy, each thread then owns the sums of its subtrees
+    const size_t threads = Parallel::numThreads( numThreads );
+    std::vector< const KDNode< T >* > tasks( 1u, queryTree.m_root.get() );
+    while ( tasks.size() < 4u * threads )
+    {
+        std::vector< const KDNode< T >* > next;
+        for ( size_t i = 0; i < tasks.size(); ++i )
+        {
+            if ( tasks[ i ]->isLeaf() )
+            {
+                next.push_back( tasks[ i ] );
+                continue;
+            }
+            next.push_back( tasks[ i ]->left().get() );
+            next.push_back( tasks[ i ]->right().get() );
+        }
+
+        if ( next.size() == tasks.size() )
+        {
+            break;
+        }
+        tasks.swap( next );
+    }
+
+    const double variance2 = 2.0L * bandwidth * bandwidth;
+    const double norm = std::pow( M_PI * variance2,
+                                  -0.5L * m_points[ 0 ].size() );
+    const double scale          = 1.0L / variance2;
+    const double maxKernelError = 2.0L * tolerance / norm;
+
+    Parallel::forEachRange( tasks.size(), threads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                kernelDensitiesHelper( tasks[ i ], queryTree, m_root.get(),
+                                       scale, maxKernelError, densities );
+            }
+        } );
+
+    for ( std::vector< double >::iterator it = densities.begin();
+          it != densities.end(); ++it )
+    {
+        *it *= norm / m_points.size();
+    }
+
+    return densities;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+size_t
+KDTree< T, SplitPolicy, Metric >::size() const
+{
+    return m_points.size();
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+const Types::Point< T >&
+KDTree< T, SplitPolicy, Metric >::point( const size_t index ) const
+{
+    return m_points[ index ];
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+const Types::Points< T >
+KDTree< T, SplitPolicy, Metric >::points() const
+{
+    return m_points;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+const std::vector< double >&
+KDTree< T, SplitPolicy, Metric >::values() const
+{
+    return m_values;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+size_t
+KDTree< T, SplitPolicy, Metric >::originalIndex( const size_t index ) const
+{
+    return m_permutation.empty() ? index : m_permutation[ index ];
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+const std::vector< uint32_t >&
+KDTree< T, SplitPolicy, Metric >::permutation() const
+{
+    return m_permutation;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+const std::string&
+KDTree< T, SplitPolicy, Metric >::type() const
+{
+    return m_type;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+const KDLookupGrid< T >&
+KDTree< T, SplitPolicy, Metric >::lookupGrid() const
+{
+    return m_grid;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+const KDHyperplane< T >
+KDTree< T, SplitPolicy, Metric >::chooseBestSplit(
+        const Types::Indexes& indexes ) const
+{
+    return SplitPolicy::chooseBestSplit( m_points, indexes );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::buildWrapper(
+        const Types::BuildMethod method,
+        const size_t             numThreads )
+{
+    Types::Indexes globalIndexes;
+    globalIndexes.reserve( m_points.size() );
+    for ( size_t i = 0; i < m_points.size(); ++i )
+    {
+        globalIndexes.push_back( i );
+    }
+
+    if ( Types::BuildMethod::PRESORTED == method &&
+         std::is_same< SplitPolicy, KDMedianSplit< T > >::value &&
+         !m_points.empty() )
+    {
+        const size_t dimension = m_points[ 0 ].size();
+
+        std::vector< Types::Indexes > sortedIndexes( dimension,
+                                                     globalIndexes );
+        Parallel::forEachRange( dimension, numThreads,
+            [ & ]( const size_t begin, const size_t end, const size_t )
+            {
+                for ( size_t axis = begin; axis < end; ++axis )
+                {
+                    std::sort( sortedIndexes[ axis ].begin(),
+                               sortedIndexes[ axis ].end(),
+                               [ & ]( const size_t lhs, const size_t rhs )
+                               {
+                                   return m_points[ lhs ][ axis ] !=
+                                                  m_points[ rhs ][ axis ] ?
+                                          m_points[ lhs ][ axis ] <
+                                                  m_points[ rhs ][ axis ] :
+                                          lhs < rhs;
+                               } );
+                }
+            } );
+
+        Types::Indexes      scratch( m_points.size() );
+        std::vector< char > isLeft( m_points.size() );
+        m_root = buildPresorted( sortedIndexes, scratch, isLeft,
+                                 0u, m_points.size(), numThreads );
+    }
+    else if ( Types::BuildMethod::MORTON == method &&
+         !m_points.empty() &&
+         Morton::bitsPerAxis( m_points[ 0 ].size() ) )
+    {
+        std::vector< uint64_t > codes =
+                Morton::encode( m_points,
+                                Utils::minMaxPerAxis( m_points ),
+                                numThreads );
+        Morton::radixSort( codes, globalIndexes, numThreads );
+
+        Types::AxisMinMax< T > bounds;
+        m_root = buildMorton( codes, globalIndexes, 0u, codes.size(),
+                              numThreads, bounds );
+    }
+    else
+    {
+        m_root = build( globalIndexes );
+    }
+
+    summarizeHelper( m_root.get() );
+    m_grid.clear();
+    m_parents.clear();
+    m_reinserted = 0u;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::shared_ptr< KDNode< T > >
+KDTree< T, SplitPolicy, Metric >::build( const Types::Indexes& indexes )
+{
+    // Empty tree
+    if ( !indexes.size() )
+    {
+        return std::shared_ptr< KDNode< T > >( nullptr );
+    }
+
+    // Base Case
+    if ( indexes.size() == 1u )
+    {
+        // Make a leaf node
+        typename Types::Indexes::const_iterator it = indexes.cbegin();
+        return std::shared_ptr< KDNode< T > >(
+                new KDNode< T >( ( *it ) ) );
+    }
+
+    // Recursive case
+    const KDHyperplane< T > hyperplane = chooseBestSplit( indexes );
+
+    std::vector< T > column( indexes.size() );
+    for ( size_t i = 0; i < indexes.size(); ++i )
+    {
+        column[ i ] = m_points[ indexes[ i ] ][ hyperplane.hyperplaneIndex() ];
+    }
+
+    Types::Indexes leftIndexes(  indexes.size() );
+    Types::Indexes rightIndexes( indexes.size() );
+
+    const size_t numLeft = Simd::partition( column.data(),
+                                            indexes.data(),
+                                            indexes.size(),
+                                            hyperplane.value(),
+                                            leftIndexes.data(),
+                                            rightIndexes.data() );
+    leftIndexes.resize( numLeft );
+    rightIndexes.resize( indexes.size() - numLeft );
+
+    // Median equal to the minimum sends everything right, so points equal
+    // to the hyperplane value go left instead. Both sides then still
+    // satisfy left <= value <= right, which is all the searches rely on.
+    if ( leftIndexes.empty() )
+    {
+        rightIndexes.clear();
+        for ( typename Types::Indexes::const_iterator it = indexes.cbegin();
+              it != indexes.cend(); ++it )
+        {
+            if ( m_points[ *it ][ hyperplane.hyperplaneIndex() ] ==
+                         hyperplane.value() )
+            {
+                leftIndexes.push_back( *it );
+            }
+            else
+            {
+                rightIndexes.push_back( *it );
+            }
+        }
+
+        // Only identical points remain, split them in halves
+        if ( rightIndexes.empty() )
+        {
+            const size_t half = leftIndexes.size() / 2u;
+            rightIndexes.assign( leftIndexes.begin() + half,
+                                 leftIndexes.end() );
+            leftIndexes.resize( half );
+        }
+    }
+
+    std::shared_ptr< KDNode< T > > leftSubtree(  build( leftIndexes  ) );
+    std::shared_ptr< KDNode< T > > rightSubtree( build( rightIndexes ) );
+
+    return std::shared_ptr< KDNode< T > >( new KDNode< T >( hyperplane,
+                                                            leftSubtree,
+                                                            rightSubtree ) );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::shared_ptr< KDNode< T > >
+KDTree< T, SplitPolicy, Metric >::buildPresorted(
+        std::vector< Types::Indexes >& sortedIndexes,
+        Types::Indexes&                scratch,
+        std::vector< char >&           isLeft,
+        const size_t                   begin,
+        const size_t                   end,
+        const size_t                   numThreads )
+{
+    const size_t size = end - begin;
+
+    // Base case
+    if ( size == 1u )
+    {
+        return std::shared_ptr< KDNode< T > >(
+                new KDNode< T >( sortedIndexes[ 0 ][ begin ] ) );
+    }
+
+    // Axis of highest spread, ties go to the lowest axis as in
+    // Utils::axisOfHighestVariance()
+    size_t axis = 0;
+    T largestExtent = 0;
+    for ( size_t i = 0; i < sortedIndexes.size(); ++i )
+    {
+        const Types::Indexes& axisIndexes = sortedIndexes[ i ];
+        const T extent = std::abs( m_points[ axisIndexes[ end - 1u ] ][ i ] -
+                                   m_points[ axisIndexes[ begin ] ][ i ] );
+        if ( !i || extent > largestExtent )
+        {
+            largestExtent = extent;
+            axis = i;
+        }
+    }
+
+    const Types::Indexes& axisIndexes = sortedIndexes[ axis ];
+    const T value = m_points[ axisIndexes[ begin + size / 2u ] ][ axis ];
+
+    // Points strictly below the median lead the sorted segment. Median
+    // equal to the minimum sends points equal to it left instead, and
+    // identical points are split in halves, exactly as build() does.
+    typename Types::Indexes::const_iterator split =
+            std::lower_bound( axisIndexes.begin() + begin,
+                              axisIndexes.begin() + begin + size / 2u,
+                              value,
+                              [ & ]( const size_t index, const T& bound )
+                              {
+                                  return m_points[ index ][ axis ] < bound;
+                              } );
+    if ( split == axisIndexes.begin() + begin )
+    {
+        split = std::upper_bound( axisIndexes.begin() + begin,
+                                  axisIndexes.begin() + end,
+                                  value,
+                                  [ & ]( const T& bound, const size_t index )
+                                  {
+                                      return bound < m_points[ index ][ axis ];
+                                  } );
+        if ( split == axisIndexes.begin() + end )
+        {
+            split = axisIndexes.begin() + begin + size / 2u;
+        }
+    }
+    const size_t middle = split - axisIndexes.begin();
+
+    for ( size_t i = begin; i < end; ++i )
+    {
+        isLeft[ axisIndexes[ i ] ] = i < middle;
+    }
+
+    // Stable partition keeps every other list sorted
+    for ( size_t i = 0; i < sortedIndexes.size(); ++i )
+    {
+        if ( i == axis )
+        {
+            continue;
+        }
+
+        Types::Indexes& indexes = sortedIndexes[ i ];
+        size_t left  = begin;
+        size_t right = begin;
+        for ( size_t j = begin; j < end; ++j )
+        {
+            if ( isLeft[ indexes[ j ] ] )
+            {
+                indexes[ left++ ] = indexes[ j ];
+            }
+            else
+            {
+                scratch[ right++ ] = indexes[ j ];
+            }
+        }
+        std::copy( scratch.begin() + begin, scratch.begin() + right,
+                   indexes.begin() + left );
+    }
+
+    std::shared_ptr< KDNode< T > > leftSubtree;
+    std::shared_ptr< KDNode< T > > rightSubtree;
+
+    if ( numThreads > 1u )
+    {
+        const size_t leftThreads = numThreads / 2u;
+        std::thread leftWorker( [ & ]()
+        {
+            leftSubtree = buildPresorted( sortedIndexes, scratch, isLeft,
+                                          begin, middle, leftThreads );
+        } );
+        rightSubtree = buildPresorted( sortedIndexes, scratch, isLeft,
+                                       middle, end,
+                                       numThreads - leftThreads );
+        leftWorker.join();
+    }
+    else
+    {
+        leftSubtree  = buildPresorted( sortedIndexes, scratch, isLeft,
+                                       begin, middle, 1u );
+        rightSubtree = buildPresorted( sortedIndexes, scratch, isLeft,
+                                       middle, end, 1u );
+    }
+
+    return std::shared_ptr< KDNode< T > >(
+            new KDNode< T >( KDHyperplane< T >( axis, value ),
+                             leftSubtree,
+                             rightSubtree ) );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::shared_ptr< KDNode< T > >
+KDTree< T, SplitPolicy, Metric >::buildMorton(
+        const std::vector< uint64_t >& codes,
+        const Types::Indexes&          indexes,
+        const size_t                   begin,
+        const size_t                   end,
+        const size_t                   numThreads,
+        Types::AxisMinMax< T >&        bounds )
+{
+    // Base case
+    if ( end - begin == 1u )
+    {
+        const Types::Point< T >& point = m_points[ indexes[ begin ] ];
+
+        bounds.clear();
+        bounds.reserve( point.size() );
+        for ( size_t i = 0; i < point.size(); ++i )
+        {
+            bounds.push_back( std::pair< T, T >( point[ i ], point[ i ] ) );
+        }
+
+        return std::shared_ptr< KDNode< T > >(
+                new KDNode< T >( indexes[ begin ] ) );
+    }
+
+    // Points sharing a cell cannot be told apart by their codes
+    if ( codes[ begin ] == codes[ end - 1u ] )
+    {
+        const Types::Indexes cellIndexes( indexes.begin() + begin,
+                                          indexes.begin() + end );
+
+        Types::Points< T > cellPoints;
+        cellPoints.reserve( cellIndexes.size() );
+        for ( size_t i = 0; i < cellIndexes.size(); ++i )
+        {
+            cellPoints.push_back( m_points[ cellIndexes[ i ] ] );
+        }
+        bounds = Utils::minMaxPerAxis( cellPoints );
+
+        return build( cellIndexes );
+    }
+
+    // Codes are sorted and share all the bits above the highest differing
+    // one, so that bit splits the range in two
+    const size_t bit =
+            63u - __builtin_clzll( codes[ begin ] ^ codes[ end - 1u ] );
+    const size_t axis = bit % m_points[ 0 ].size();
+    const uint64_t mask = static_cast< uint64_t >( 1u ) << bit;
+
+    size_t split = begin;
+    size_t last  = end;
+    while ( split < last )
+    {
+        const size_t middle = split + ( last - split ) / 2u;
+        if ( codes[ middle ] & mask )
+        {
+            last = middle;
+        }
+        else
+        {
+            split = middle + 1u;
+        }
+    }
+
+    Types::AxisMinMax< T > leftBounds;
+    Types::AxisMinMax< T > rightBounds;
+    std::shared_ptr< KDNode< T > > leftSubtree;
+    std::shared_ptr< KDNode< T > > rightSubtree;
+
+    if ( numThreads > 1u )
+    {
+        const size_t leftThreads = numThreads / 2u;
+        std::thread leftWorker( [ & ]()
+        {
+            leftSubtree = buildMorton( codes, indexes, begin, split,
+                                       leftThreads, leftBounds );
+        } );
+        rightSubtree = buildMorton( codes, indexes, split, end,
+                                    numThreads - leftThreads, rightBounds );
+        leftWorker.join();
+    }
+    else
+    {
+        leftSubtree  = buildMorton( codes, indexes, begin, split,
+                                    1u, leftBounds );
+        rightSubtree = buildMorton( codes, indexes, split, end,
+                                    1u, rightBounds );
+    }
+
+    // Quantization is monotone, so every left coordinate on the split axis
+    // is strictly below every right one
+    const KDHyperplane< T > hyperplane( axis, rightBounds[ axis ].first );
+
+    bounds = leftBounds;
+    for ( size_t i = 0; i < bounds.size(); ++i )
+    {
+        bounds[ i ].first  = std::min( bounds[ i ].first,
+                                       rightBounds[ i ].first );
+        bounds[ i ].second = std::max( bounds[ i ].second,
+                                       rightBounds[ i ].second );
+    }
+
+    return std::shared_ptr< KDNode< T > >( new KDNode< T >( hyperplane,
+                                                            leftSubtree,
+                                                            rightSubtree ) );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+const size_t
+KDTree< T, SplitPolicy, Metric >::nearestPointIndexHelper(
+        std::shared_ptr< KDNode< T > > root,
+        const Types::Point< T >&       pointOfInterest,
+        const size_t                   bestSoFarIndex ) const
+{
+    // Base case
+    if ( nullptr == root )
+    {
+        return Constants::KDTREE_ERROR_INDEX;
+    }
+
+    if ( root->isLeaf() )
+    {
+        // Initial greedy search
+        if ( Constants::KDTREE_ERROR_INDEX == bestSoFarIndex )
+        {
+            return root->leafPointIndex();
+        }
+
+        const Types::Point< T >& leafPoint =
+                m_points[ root->leafPointIndex() ];
+
+        if ( Metric::rank( leafPoint, pointOfInterest ) <
+             Metric::rank( m_points[ bestSoFarIndex ], pointOfInterest ) )
+        {
+            return root->leafPointIndex();
+        }
+        else
+        {
+            return bestSoFarIndex;
+        }
+    }
+
+    // Recursive case
+    std::shared_ptr< KDNode< T > > greedy;
     std::shared_ptr< KDNode< T > > other;
 
-    if ( pointOfInterest[ root->hyperplane().hyperplaneIndex() ] <
-                root->hyperplane().value() )
+    if ( pointOfInterest[ root->hyperplane().hyperplaneIndex() ] <
+                root->hyperplane().value() )
+    {
+        greedy = root->left();
+        other = root->right();
+    }
+    else
+    {
+        greedy = root->right();
+        other = root->left();
+    }
+
+    // First search greedily
+    const size_t greedyBestIndex = nearestPointIndexHelper( greedy,
+                                                            pointOfInterest,
+                                                            bestSoFarIndex );
+    // If the distance to the greedy best is bigger than distance to the
+    // hyperplane at this node, search the other partition as well
+    if ( Metric::axisRank(
+                 static_cast< double >(
+                         pointOfInterest[ root->hyperplane().hyperplaneIndex() ] ) -
+                 root->hyperplane().value() ) <
+         Metric::rank( pointOfInterest, m_points[ greedyBestIndex ] ) )
+    {
+        return nearestPointIndexHelper( other,
+                                        pointOfInterest,
+                                        greedyBestIndex );
+    }
+
+    return greedyBestIndex;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+size_t
+KDTree< T, SplitPolicy, Metric >::findHelper(
+        const KDNode< T >*       root,
+        const Types::Point< T >& point ) const
+{
+    if ( nullptr == root )
+    {
+        return Constants::KDTREE_ERROR_INDEX;
+    }
+
+    if ( root->isLeaf() )
+    {
+        return m_points[ root->leafPointIndex() ] == point ?
+               root->leafPointIndex() : Constants::KDTREE_ERROR_INDEX;
+    }
+
+    const T coordinate = point[ root->hyperplane().hyperplaneIndex() ];
+    if ( coordinate < root->hyperplane().value() )
+    {
+        return findHelper( root->left().get(), point );
+    }
+
+    if ( coordinate > root->hyperplane().value() )
+    {
+        return findHelper( root->right().get(), point );
+    }
+
+    // Points equal to the hyperplane value may lie on either side
+    size_t index = Constants::KDTREE_ERROR_INDEX;
+    if ( nullptr != root->left() &&
+         Utils::boxContainsPoint( root->left()->bounds(), point ) )
+    {
+        index = findHelper( root->left().get(), point );
+    }
+
+    if ( Constants::KDTREE_ERROR_INDEX == index &&
+         nullptr != root->right() &&
+         Utils::boxContainsPoint( root->right()->bounds(), point ) )
+    {
+        index = findHelper( root->right().get(), point );
+    }
+
+    return index;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::pointIndexesInRadiusHelper(
+        const KDNode< T >*       root,
+        const Types::Point< T >& pointOfInterest,
+        const double             maxRank,
+        Types::Indexes&          result ) const
+{
+    // Base case
+    if ( nullptr == root )
+    {
+        return;
+    }
+
+    if ( root->isLeaf() )
+    {
+        if ( Metric::rank( m_points[ root->leafPointIndex() ],
+                           pointOfInterest ) <= maxRank )
+        {
+            result.push_back( root->leafPointIndex() );
+        }
+        return;
+    }
+
+    // Recursive case, only descend into the far side when the ball around
+    // the point of interest crosses the hyperplane
+    const KDHyperplane< T >& hyperplane = root->hyperplane();
+    const double offset =
+            static_cast< double >(
+                    pointOfInterest[ hyperplane.hyperplaneIndex() ] ) -
+            hyperplane.value();
+
+    const KDNode< T >* greedy = root->right().get();
+    const KDNode< T >* other  = root->left().get();
+    if ( offset < 0.0L )
+    {
+        std::swap( greedy, other );
+    }
+
+    pointIndexesInRadiusHelper( greedy, pointOfInterest, maxRank, result );
+    if ( Metric::axisRank( offset ) <= maxRank )
+    {
+        pointIndexesInRadiusHelper( other, pointOfInterest, maxRank, result );
+    }
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::nearestPointIndexesHelper(
+        const KDNode< T >*       root,
+        const Types::Point< T >& pointOfInterest,
+        const size_t             k,
+        const size_t             excludedIndex,
+        const double             pruneScale,
+        Types::Neighbours&       best,
+        double&                  bound ) const
+{
+    // Base case
+    if ( nullptr == root )
+    {
+        return;
+    }
+
+    if ( root->isLeaf() )
+    {
+        const size_t index = root->leafPointIndex();
+        if ( index == excludedIndex )
+        {
+            return;
+        }
+
+        const Types::Neighbour candidate(
+                Metric::rank( m_points[ index ], pointOfInterest ), index );
+
+        if ( candidate.first > bound )
+        {
+            return;
+        }
+
+        if ( best.size() < k )
+        {
+            best.push_back( candidate );
+            std::push_heap( best.begin(), best.end() );
+        }
+        else if ( candidate < best.front() )
+        {
+            std::pop_heap( best.begin(), best.end() );
+            best.back() = candidate;
+            std::push_heap( best.begin(), best.end() );
+        }
+        else
+        {
+            return;
+        }
+
+        if ( best.size() == k )
+        {
+            bound = best.front().first;
+        }
+        return;
+    }
+
+    // Recursive case
+    const KDHyperplane< T >& hyperplane = root->hyperplane();
+    const double offset =
+            static_cast< double >(
+                    pointOfInterest[ hyperplane.hyperplaneIndex() ] ) -
+            hyperplane.value();
+
+    const KDNode< T >* greedy = root->right().get();
+    const KDNode< T >* other  = root->left().get();
+    if ( offset < 0.0L )
+    {
+        std::swap( greedy, other );
+    }
+
+    nearestPointIndexesHelper( greedy, pointOfInterest, k, excludedIndex,
+                               pruneScale, best, bound );
+
+    // Equality keeps ties deterministic, a point on the far side at exactly
+    // the current bound may still win on its index
+    if ( Metric::axisRank( offset ) * pruneScale <= bound )
+    {
+        nearestPointIndexesHelper( other, pointOfInterest, k, excludedIndex,
+                                   pruneScale, best, bound );
+    }
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::leafOrderHelper(
+        const KDNode< T >* root,
+        Types::Indexes&    order ) const
+{
+    if ( nullptr == root )
+    {
+        return;
+    }
+
+    if ( root->isLeaf() )
+    {
+        order.push_back( root->leafPointIndex() );
+        return;
+    }
+
+    leafOrderHelper( root->left().get(),  order );
+    leafOrderHelper( root->right().get(), order );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::renumberLeavesHelper(
+        KDNode< T >* root,
+        size_t&      next )
+{
+    if ( nullptr == root )
+    {
+        return;
+    }
+
+    if ( root->isLeaf() )
+    {
+        root->setLeafPointIndex( next++ );
+        return;
+    }
+
+    renumberLeavesHelper( root->left().get(),  next );
+    renumberLeavesHelper( root->right().get(), next );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::summarizeHelper( KDNode< T >* root )
+{
+    if ( nullptr == root )
+    {
+        return;
+    }
+
+    if ( root->isLeaf() )
+    {
+        const Types::Point< T >& point = m_points[ root->leafPointIndex() ];
+
+        Types::AxisMinMax< T > bounds;
+        bounds.reserve( point.size() );
+        for ( size_t i = 0; i < point.size(); ++i )
+        {
+            bounds.push_back( std::pair< T, T >( point[ i ], point[ i ] ) );
+        }
+        root->setBounds( bounds );
+        root->setSum( m_values.empty() ? 0.0L :
+                                         m_values[ root->leafPointIndex() ] );
+        return;
+    }
+
+    summarizeHelper( root->left().get() );
+    summarizeHelper( root->right().get() );
+    summarizeNodeHelper( root );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::summarizeNodeHelper( KDNode< T >* root )
+{
+    // Non-leaf nodes produced by build() always have both children, a
+    // malformed deserialized tree may not
+    root->setSum( ( nullptr == root->left()  ? 0.0L : root->left()->sum() ) +
+                  ( nullptr == root->right() ? 0.0L : root->right()->sum() ) );
+
+    if ( nullptr == root->left() || nullptr == root->right() )
+    {
+        root->setBounds( nullptr == root->left() ?
+                         ( nullptr == root->right() ?
+                           Types::AxisMinMax< T >() :
+                           root->right()->bounds() ) :
+                         root->left()->bounds() );
+        return;
+    }
+
+    Types::AxisMinMax< T > bounds = root->left()->bounds();
+    const Types::AxisMinMax< T >& right = root->right()->bounds();
+    for ( size_t i = 0; i < bounds.size() && i < right.size(); ++i )
+    {
+        bounds[ i ].first  = std::min( bounds[ i ].first,  right[ i ].first  );
+        bounds[ i ].second = std::max( bounds[ i ].second, right[ i ].second );
+    }
+    root->setBounds( bounds );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::shared_ptr< KDNode< T > >
+KDTree< T, SplitPolicy, Metric >::mergeHelper(
+        const std::shared_ptr< KDNode< T > >& lhs,
+        const std::shared_ptr< KDNode< T > >& rhs )
+{
+    if ( nullptr == lhs || nullptr == rhs )
+    {
+        return nullptr == lhs ? rhs : lhs;
+    }
+
+    const bool lhsBigger = lhs->count() >= rhs->count();
+    const std::shared_ptr< KDNode< T > >& big   = lhsBigger ? lhs : rhs;
+    const std::shared_ptr< KDNode< T > >& small = lhsBigger ? rhs : lhs;
+    const double maxChild = Constants::KDTREE_MAX_CHILD_SHARE *
+                            ( big->count() + small->count() );
+
+    // Disjoint subtrees of comparable size are joined through the widest
+    // gap between their boxes, everything left of it stays left
+    if ( big->count() <= maxChild )
+    {
+        const Types::AxisMinMax< T >& bigBounds   = big->bounds();
+        const Types::AxisMinMax< T >& smallBounds = small->bounds();
+
+        size_t axis     = Constants::KDTREE_ERROR_INDEX;
+        bool   bigFirst = false;
+        double widest   = 0.0L;
+        for ( size_t i = 0; i < bigBounds.size(); ++i )
+        {
+            const double after  = static_cast< double >( smallBounds[ i ].first ) -
+                                  bigBounds[ i ].second;
+            const double before = static_cast< double >( bigBounds[ i ].first ) -
+                                  smallBounds[ i ].second;
+            if ( after > widest || before > widest )
+            {
+                axis     = i;
+                bigFirst = after > before;
+                widest   = bigFirst ? after : before;
+            }
+        }
+
+        if ( Constants::KDTREE_ERROR_INDEX != axis )
+        {
+            const std::shared_ptr< KDNode< T > >& left  = bigFirst ? big : small;
+            const std::shared_ptr< KDNode< T > >& right = bigFirst ? small : big;
+
+            return joinHelper(
+                    KDHyperplane< T >( axis, left->bounds()[ axis ].second ),
+                    left, right );
+        }
+    }
+
+    // The smaller subtree is cut by the hyperplane of the bigger one and
+    // either part goes down its side. A subtree on one side of the
+    // hyperplane leaves the other side as it is
+    if ( !big->isLeaf() )
+    {
+        const KDHyperplane< T >& hyperplane = big->hyperplane();
+
+        std::shared_ptr< KDNode< T > > smallLeft;
+        std::shared_ptr< KDNode< T > > smallRight;
+        splitHelper( small, hyperplane, smallLeft, smallRight );
+
+        const size_t numLeft =
+                ( nullptr == big->left()  ? 0u : big->left()->count()  ) +
+                ( nullptr == smallLeft    ? 0u : smallLeft->count()    );
+        const size_t numRight =
+                ( nullptr == big->right() ? 0u : big->right()->count() ) +
+                ( nullptr == smallRight   ? 0u : smallRight->count()   );
+
+        if ( numLeft <= maxChild && numRight <= maxChild )
+        {
+            return joinHelper( hyperplane,
+                               mergeHelper( big->left(),  smallLeft  ),
+                               mergeHelper( big->right(), smallRight ) );
+        }
+    }
+
+    // Too many points would end up on one side
+    Types::Indexes indexes;
+    indexes.reserve( big->count() + small->count() );
+    leafOrderHelper( big.get(),   indexes );
+    leafOrderHelper( small.get(), indexes );
+
+    std::shared_ptr< KDNode< T > > node = build( indexes );
+    summarizeHelper( node.get() );
+
+    return node;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::splitHelper(
+        const std::shared_ptr< KDNode< T > >& root,
+        const KDHyperplane< T >&              hyperplane,
+        std::shared_ptr< KDNode< T > >&       left,
+        std::shared_ptr< KDNode< T > >&       right )
+{
+    left.reset();
+    right.reset();
+
+    if ( nullptr == root )
+    {
+        return;
+    }
+
+    // Subtrees on one side are kept whole, leaves always are
+    const std::pair< T, T >& extent =
+            root->bounds()[ hyperplane.hyperplaneIndex() ];
+    if ( extent.second <= hyperplane.value() )
+    {
+        left = root;
+        return;
+    }
+    if ( extent.first >= hyperplane.value() )
+    {
+        right = root;
+        return;
+    }
+
+    // Parts of either child still lie on the same side of the hyperplane
+    // of the root as the child itself
+    std::shared_ptr< KDNode< T > > leftOfLeft;
+    std::shared_ptr< KDNode< T > > rightOfLeft;
+    std::shared_ptr< KDNode< T > > leftOfRight;
+    std::shared_ptr< KDNode< T > > rightOfRight;
+    splitHelper( root->left(),  hyperplane, leftOfLeft,  rightOfLeft  );
+    splitHelper( root->right(), hyperplane, leftOfRight, rightOfRight );
+
+    left  = joinHelper( root->hyperplane(), leftOfLeft,  leftOfRight  );
+    right = joinHelper( root->hyperplane(), rightOfLeft, rightOfRight );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::shared_ptr< KDNode< T > >
+KDTree< T, SplitPolicy, Metric >::joinHelper(
+        const KDHyperplane< T >&              hyperplane,
+        const std::shared_ptr< KDNode< T > >& left,
+        const std::shared_ptr< KDNode< T > >& right )
+{
+    if ( nullptr == left || nullptr == right )
+    {
+        return nullptr == left ? right : left;
+    }
+
+    std::shared_ptr< KDNode< T > > node( new KDNode< T >( hyperplane,
+                                                          left, right ) );
+    summarizeNodeHelper( node.get() );
+
+    return node;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+template< typename Classify >
+size_t
+KDTree< T, SplitPolicy, Metric >::eraseWrapper(
+        const std::vector< char >& erased,
+        const Classify&            classify )
+{
+    // Remaining points move down keeping their order, before the tree is
+    // touched so that rebuilt subtrees work on the compacted points
+    Types::Indexes newIndexes( m_points.size(),
+                               Constants::KDTREE_ERROR_INDEX );
+    size_t numKept = 0;
+    for ( size_t i = 0; i < m_points.size(); ++i )
+    {
+        if ( erased[ i ] )
+        {
+            continue;
+        }
+
+        newIndexes[ i ] = numKept;
+        if ( numKept != i )
+        {
+            m_points[ numKept ].swap( m_points[ i ] );
+            if ( !m_values.empty() )
+            {
+                m_values[ numKept ] = m_values[ i ];
+            }
+            if ( !m_permutation.empty() )
+            {
+                m_permutation[ numKept ] = m_permutation[ i ];
+            }
+        }
+        ++numKept;
+    }
+
+    // Original indexes keep their order as well
+    if ( !m_permutation.empty() )
+    {
+        std::vector< uint32_t > ranks( m_points.size(), 0u );
+        for ( size_t i = 0; i < numKept; ++i )
+        {
+            ranks[ m_permutation[ i ] ] = 1u;
+        }
+        uint32_t next = 0u;
+        for ( size_t i = 0; i < ranks.size(); ++i )
+        {
+            const uint32_t survives = ranks[ i ];
+            ranks[ i ] = next;
+            next += survives;
+        }
+        for ( size_t i = 0; i < numKept; ++i )
+        {
+            m_permutation[ i ] = ranks[ m_permutation[ i ] ];
+        }
+        m_permutation.resize( numKept );
+    }
+
+    const size_t numErased = m_points.size() - numKept;
+    m_points.resize( numKept );
+    if ( !m_values.empty() )
+    {
+        m_values.resize( numKept );
+    }
+
+    bool unbalanced = false;
+    m_root = eraseHelper( m_root, classify, newIndexes, unbalanced );
+    if ( unbalanced )
+    {
+        m_root = rebuildHelper( m_root.get() );
+    }
+    m_grid.clear();
+    m_parents.clear();
+
+    return numErased;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+template< typename Classify >
+std::shared_ptr< KDNode< T > >
+KDTree< T, SplitPolicy, Metric >::eraseHelper(
+        const std::shared_ptr< KDNode< T > >& root,
+        const Classify&                       classify,
+        const Types::Indexes&                 newIndexes,
+        bool&                                 unbalanced )
+{
+    unbalanced = false;
+
+    if ( nullptr == root )
+    {
+        return root;
+    }
+
+    const Coverage coverage = classify( root.get() );
+    if ( Coverage::ALL == coverage )
+    {
+        return std::shared_ptr< KDNode< T > >( nullptr );
+    }
+    if ( Coverage::NONE == coverage || root->isLeaf() )
+    {
+        remapLeavesHelper( root.get(), newIndexes );
+        return root;
+    }
+
+    bool leftUnbalanced  = false;
+    bool rightUnbalanced = false;
+    std::shared_ptr< KDNode< T > > left =
+            eraseHelper( root->left(),  classify, newIndexes, leftUnbalanced  );
+    std::shared_ptr< KDNode< T > > right =
+            eraseHelper( root->right(), classify, newIndexes, rightUnbalanced );
+
+    if ( left == root->left() && right == root->right() )
+    {
+        return root;
+    }
+
+    // A single remaining child takes the place of the root
+    if ( nullptr == left || nullptr == right )
+    {
+        unbalanced = nullptr == left ? rightUnbalanced : leftUnbalanced;
+        return nullptr == left ? right : left;
+    }
+
+    // The highest unbalanced node is rebuilt, which covers any below it.
+    // Children the erased points left further apart than either is wide
+    // count as unbalanced too, the hyperplane between them no longer
+    // prunes searches in the space that opened up
+    const size_t axis  = root->hyperplane().hyperplaneIndex();
+    const size_t count = left->count() + right->count();
+    const double widened =
+            ( static_cast< double >( right->bounds()[ axis ].first ) -
+              root->right()->bounds()[ axis ].first ) +
+            ( static_cast< double >( root->left()->bounds()[ axis ].second ) -
+              left->bounds()[ axis ].second );
+    unbalanced = std::max( left->count(), right->count() ) >
+                         Constants::KDTREE_MAX_CHILD_SHARE * count ||
+                 widened > static_cast< double >(
+                                   left->bounds()[ axis ].second ) -
+                                   left->bounds()[ axis ].first ||
+                 widened > static_cast< double >(
+                                   right->bounds()[ axis ].second ) -
+                                   right->bounds()[ axis ].first;
+    if ( !unbalanced )
+    {
+        if ( leftUnbalanced )
+        {
+            left = rebuildHelper( left.get() );
+        }
+        if ( rightUnbalanced )
+        {
+            right = rebuildHelper( right.get() );
+        }
+    }
+
+    return joinHelper( root->hyperplane(), left, right );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::shared_ptr< KDNode< T > >
+KDTree< T, SplitPolicy, Metric >::rebuildHelper( const KDNode< T >* root )
+{
+    Types::Indexes indexes;
+    indexes.reserve( nullptr == root ? 0u : root->count() );
+    leafOrderHelper( root, indexes );
+    std::sort( indexes.begin(), indexes.end() );
+
+    std::shared_ptr< KDNode< T > > node = build( indexes );
+    summarizeHelper( node.get() );
+
+    return node;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::remapLeavesHelper(
+        KDNode< T >*          root,
+        const Types::Indexes& newIndexes )
+{
+    if ( nullptr == root )
+    {
+        return;
+    }
+
+    if ( root->isLeaf() )
+    {
+        root->setLeafPointIndex( newIndexes[ root->leafPointIndex() ] );
+        return;
+    }
+
+    remapLeavesHelper( root->left().get(),  newIndexes );
+    remapLeavesHelper( root->right().get(), newIndexes );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::loosenHelper(
+        KDNode< T >*                  root,
+        const Types::AxisMinMax< T >& region,
+        KDNode< T >*                  parent )
+{
+    if ( nullptr == root )
+    {
+        return;
+    }
+
+    if ( root->isLeaf() )
+    {
+        m_parents[ root->leafPointIndex() ] = parent;
+        return;
+    }
+
+    root->setBounds( region );
+
+    // Centre the hyperplane in the gap between the subtrees, still bounded
+    // tightly, so that points lying on it get room to move
+    const size_t axis  = root->hyperplane().hyperplaneIndex();
+    if ( nullptr != root->left() && nullptr != root->right() &&
+         root->left()->bounds()[ axis ].second <=
+         root->right()->bounds()[ axis ].first )
+    {
+        root->setHyperplane( KDHyperplane< T >( axis, static_cast< T >(
+                ( static_cast< double >(
+                          root->left()->bounds()[ axis ].second ) +
+                  root->right()->bounds()[ axis ].first ) / 2.0L ) ) );
+    }
+    const T      value = root->hyperplane().value();
+
+    Types::AxisMinMax< T > half = region;
+    half[ axis ].second = std::min( region[ axis ].second, value );
+    loosenHelper( root->left().get(), half, root );
+
+    half[ axis ] = std::pair< T, T >( std::max( region[ axis ].first, value ),
+                                      region[ axis ].second );
+    loosenHelper( root->right().get(), half, root );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::adoptHelper( KDNode< T >* root )
+{
+    if ( nullptr != root->left() && root->left()->isLeaf() )
+    {
+        m_parents[ root->left()->leafPointIndex() ] = root;
+    }
+
+    if ( nullptr != root->right() && root->right()->isLeaf() )
+    {
+        m_parents[ root->right()->leafPointIndex() ] = root;
+    }
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::shared_ptr< KDNode< T > >
+KDTree< T, SplitPolicy, Metric >::removeHelper(
+        const std::shared_ptr< KDNode< T > >& root,
+        const size_t                          index,
+        bool&                                 found )
+{
+    found = false;
+
+    if ( nullptr == root ||
+         !Utils::boxContainsPoint( root->bounds(), m_points[ index ] ) )
+    {
+        return root;
+    }
+
+    if ( root->isLeaf() )
+    {
+        found = root->leafPointIndex() == index;
+        return found ? std::shared_ptr< KDNode< T > >( nullptr ) : root;
+    }
+
+    std::shared_ptr< KDNode< T > > left =
+            removeHelper( root->left(), index, found );
+    std::shared_ptr< KDNode< T > > right = root->right();
+    if ( !found )
+    {
+        right = removeHelper( root->right(), index, found );
+    }
+
+    if ( !found )
+    {
+        return root;
+    }
+
+    if ( nullptr == left || nullptr == right )
+    {
+        return nullptr == left ? right : left;
+    }
+
+    std::shared_ptr< KDNode< T > > node( new KDNode< T >( root->hyperplane(),
+                                                          left, right ) );
+    node->setBounds( root->bounds() );
+    node->setSum( left->sum() + right->sum() );
+    adoptHelper( node.get() );
+
+    return node;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::shared_ptr< KDNode< T > >
+KDTree< T, SplitPolicy, Metric >::insertHelper(
+        const std::shared_ptr< KDNode< T > >& root,
+        const Types::AxisMinMax< T >&         region,
+        const size_t                          index )
+{
+    const Types::Point< T >& point = m_points[ index ];
+
+    std::shared_ptr< KDNode< T > > left  = root->left();
+    std::shared_ptr< KDNode< T > > right = root->right();
+    KDHyperplane< T >              hyperplane = root->hyperplane();
+    Types::AxisMinMax< T >         bounds = region;
+
+    if ( root->isLeaf() )
+    {
+        // Split halfway between the two points
+        const Types::Point< T >& other = m_points[ root->leafPointIndex() ];
+        size_t axis   = 0;
+        double widest = -1.0L;
+        for ( size_t i = 0; i < point.size(); ++i )
+        {
+            const double difference = std::fabs(
+                    static_cast< double >( point[ i ] ) - other[ i ] );
+            if ( difference > widest )
+            {
+                axis   = i;
+                widest = difference;
+            }
+        }
+        hyperplane = KDHyperplane< T >( axis, static_cast< T >(
+                ( static_cast< double >( point[ axis ] ) + other[ axis ] ) /
+                2.0L ) );
+
+        std::shared_ptr< KDNode< T > > leaf( new KDNode< T >( index ) );
+        summarizeHelper( leaf.get() );
+
+        const bool pointFirst = point[ axis ] < other[ axis ];
+        left  = pointFirst ? leaf : root;
+        right = pointFirst ? root : leaf;
+    }
+    else
+    {
+        bounds = root->bounds();
+        for ( size_t i = 0; i < bounds.size(); ++i )
+        {
+            bounds[ i ].first  = std::min( bounds[ i ].first,  point[ i ] );
+            bounds[ i ].second = std::max( bounds[ i ].second, point[ i ] );
+        }
+
+        const size_t axis  = hyperplane.hyperplaneIndex();
+        const T      value = hyperplane.value();
+        Types::AxisMinMax< T > half = bounds;
+        if ( point[ axis ] <= value && nullptr != left )
+        {
+            half[ axis ].second = std::min( bounds[ axis ].second, value );
+            left = insertHelper( left, half, index );
+        }
+        else if ( nullptr != right )
+        {
+            half[ axis ].first = std::max( bounds[ axis ].first, value );
+            right = insertHelper( right, half, index );
+        }
+        else
+        {
+            // Only found in malformed deserialized trees
+            right.reset( new KDNode< T >( index ) );
+            summarizeHelper( right.get() );
+        }
+    }
+
+    std::shared_ptr< KDNode< T > > node( new KDNode< T >( hyperplane,
+                                                          left, right ) );
+    node->setBounds( bounds );
+    node->setSum( ( nullptr == left  ? 0.0L : left->sum()  ) +
+                  ( nullptr == right ? 0.0L : right->sum() ) );
+    adoptHelper( node.get() );
+
+    return node;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::correspondencesBlockedHelper(
+        const Types::Points< T >& sourcePoints,
+        const double              maxRank,
+        const Types::Neighbours&  previous,
+        const size_t              numThreads,
+        Types::Neighbours&        result ) const
+{
+    const size_t dimension    = m_points[ 0 ].size();
+    const size_t blockQueries = Constants::KDTREE_BLOCKED_SEARCH_QUERIES;
+    const size_t blockPoints  = std::max< size_t >(
+            1u, Constants::KDTREE_BLOCKED_SEARCH_BLOCK_BYTES /
+                ( dimension * sizeof( T ) ) );
+
+    // Products are summed in T, the expanded distance may be off by
+    // about dimension epsilons of T times the sum of the two norms
+    const double slack = 2.0 * ( dimension + 4u ) *
+                         std::numeric_limits< T >::epsilon();
+
+    const Types::Point< T > origin( dimension, static_cast< T >( 0 ) );
+
+    std::vector< const T* > rows( m_points.size() );
+    std::vector< double >   norms( m_points.size() );
+    for ( size_t j = 0; j < m_points.size(); ++j )
     {
-        greedy = root->left();
-        other = root->right();
+        rows[ j ]  = m_points[ j ].data();
+        norms[ j ] = Utils::squaredDistance( m_points[ j ], origin );
     }
-    else
+
+    Parallel::forEachRange( sourcePoints.size(), numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            std::vector< const T* > queryRows( blockQueries );
+            std::vector< double >   queryNorms( blockQueries );
+            std::vector< double >   distances( blockQueries * blockPoints );
+
+            for ( size_t first = begin; first < end; first += blockQueries )
+            {
+                const size_t numQueries = std::min( blockQueries,
+                                                    end - first );
+
+                for ( size_t i = 0; i < numQueries; ++i )
+                {
+                    queryRows[ i ]  = sourcePoints[ first + i ].data();
+                    queryNorms[ i ] = Utils::squaredDistance(
+                            sourcePoints[ first + i ], origin );
+                    result[ first + i ] = Types::Neighbour(
+                            maxRank, Constants::KDTREE_ERROR_INDEX );
+
+                    if ( !previous.empty() &&
+                         previous[ first + i ].second < m_points.size() )
+                    {
+                        const size_t index = previous[ first + i ].second;
+                        const double previousRank = Metric::rank(
+                                m_points[ index ],
+                                sourcePoints[ first + i ] );
+
+                        if ( previousRank <= maxRank )
+                        {
+                            result[ first + i ] =
+                                    Types::Neighbour( previousRank, index );
+                        }
+                    }
+                }
+
+                for ( size_t offset = 0; offset < m_points.size();
+                      offset += blockPoints )
+                {
+                    const size_t numPoints = std::min( blockPoints,
+                                                       m_points.size() -
+                                                       offset );
+
+                    Simd::squaredDistances( queryRows.data(), numQueries,
+                                            rows.data() + offset, numPoints,
+                                            dimension, queryNorms.data(),
+                                            norms.data() + offset,
+                                            distances.data() );
+
+                    for ( size_t i = 0; i < numQueries; ++i )
+                    {
+                        const double* row = distances.data() +
+                                            i * numPoints;
+                        Types::Neighbour& best = result[ first + i ];
+
+                        // The nearest point of the block is no farther
+                        // than the smallest expanded distance plus slack
+                        double bound = best.first;
+                        for ( size_t j = 0; j < numPoints; ++j )
+                        {
+                            bound = std::min( bound, row[ j ] + slack *
+                                    ( queryNorms[ i ] +
+                                      norms[ offset + j ] ) );
+                        }
+
+                        for ( size_t j = 0; j < numPoints; ++j )
+                        {
+                            if ( row[ j ] - slack * ( queryNorms[ i ] +
+                                                      norms[ offset + j ] ) >
+                                 bound )
+                            {
+                                continue;
+                            }
+
+                            const double rank = Metric::rank(
+                                    m_points[ offset + j ],
+                                    sourcePoints[ first + i ] );
+
+                            if ( rank < best.first ||
+                                 ( rank == best.first &&
+                                   offset + j < best.second ) )
+                            {
+                                best = Types::Neighbour( rank, offset + j );
+                            }
+                        }
+                    }
+                }
+
+                for ( size_t i = 0; i < numQueries; ++i )
+                {
+                    if ( Constants::KDTREE_ERROR_INDEX ==
+                                 result[ first + i ].second )
+                    {
+                        result[ first + i ].first =
+                                Constants::KDTREE_MAX_DISTANCE;
+                    }
+                }
+            }
+        } );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::shared_ptr< KDNode< T > >
+KDTree< T, SplitPolicy, Metric >::cloneHelper( const KDNode< T >* root,
+                                               const size_t       offset )
+{
+    if ( nullptr == root )
     {
-        greedy = root->right();
-        other = root->left();
+        return std::shared_ptr< KDNode< T > >( nullptr );
     }
 
-    // First search greedily
-    const size_t greedyBestIndex = nearestPointIndexHelper( greedy,
-                                                            pointOfInterest,
-                                                            bestSoFarIndex );
-    // If the distance to the greedy best is bigger than distance to the
-    // hyperplane at this node, search the other partition as well
-    if ( Utils::distance< T >( pointOfInterest, root->hyperplane() ) <
-         Utils::distance< T >( pointOfInterest, m_points[ greedyBestIndex ] ) )
+    std::shared_ptr< KDNode< T > > node( root->isLeaf() ?
+            new KDNode< T >( root->leafPointIndex() + offset ) :
+            new KDNode< T >( root->hyperplane(),
+                             cloneHelper( root->left().get(),  offset ),
+                             cloneHelper( root->right().get(), offset ) ) );
+    node->setBounds( root->bounds() );
+    node->setSum( root->sum() );
+
+    return node;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::pointIndexesInBoxHelper(
+        const KDNode< T >*            root,
+        const Types::AxisMinMax< T >& box,
+        Types::Indexes&               result )
+                                         const
+{
+    if ( nullptr == root || !Utils::boxesIntersect< T >( box, root->bounds() ) )
     {
-        return nearestPointIndexHelper( other,
-                                        pointOfInterest,
-                                        greedyBestIndex );
+        return;
     }
 
-    return greedyBestIndex;
+    if ( Utils::boxContainsBox< T >( box, root->bounds() ) )
+    {
+        leafOrderHelper( root, result );
+        return;
+    }
+
+    // A leaf box is its point, so it is either contained or disjoint
+    pointIndexesInBoxHelper( root->left().get(),  box, result );
+    pointIndexesInBoxHelper( root->right().get(), box, result );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDAggregate
+KDTree< T, SplitPolicy, Metric >::aggregateInBoxHelper(
+        const KDNode< T >*            root,
+        const Types::AxisMinMax< T >& box ) const
+{
+    if ( nullptr == root || !Utils::boxesIntersect< T >( box, root->bounds() ) )
+    {
+        return KDAggregate();
+    }
+
+    if ( Utils::boxContainsBox< T >( box, root->bounds() ) )
+    {
+        return KDAggregate( root->count(), root->sum() );
+    }
+
+    KDAggregate aggregate = aggregateInBoxHelper( root->left().get(), box );
+    aggregate += aggregateInBoxHelper( root->right().get(), box );
+
+    return aggregate;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDAggregate
+KDTree< T, SplitPolicy, Metric >::aggregateInRadiusHelper(
+        const KDNode< T >*       root,
+        const Types::Point< T >& pointOfInterest,
+        const double             maxRank ) const
+{
+    if ( nullptr == root ||
+         Metric::rankToBox( pointOfInterest, root->bounds() ) > maxRank )
+    {
+        return KDAggregate();
+    }
+
+    if ( Metric::maxRankToBox( pointOfInterest, root->bounds() ) <= maxRank )
+    {
+        return KDAggregate( root->count(), root->sum() );
+    }
+
+    KDAggregate aggregate = aggregateInRadiusHelper( root->left().get(),
+                                                     pointOfInterest,
+                                                     maxRank );
+    aggregate += aggregateInRadiusHelper( root->right().get(),
+                                          pointOfInterest,
+                                          maxRank );
+
+    return aggregate;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+double
+KDTree< T, SplitPolicy, Metric >::kernelDensityHelper(
+        const KDNode< T >*       root,
+        const Types::Point< T >& pointOfInterest,
+        const double             scale,
+        const double             maxKernelError )
+                                             const
+{
+    if ( nullptr == root )
+    {
+        return 0.0L;
+    }
+
+    if ( root->isLeaf() )
+    {
+        return std::exp( -scale * Utils::squaredDistance< T >(
+                m_points[ root->leafPointIndex() ], pointOfInterest ) );
+    }
+
+    // Whole subtree underflows, skip the expensive exp() calls
+    const double minExponent = scale *
+            Utils::squaredDistanceToBox< T >( pointOfInterest,
+                                              root->bounds() );
+    if ( minExponent > Constants::KDTREE_KERNEL_UNDERFLOW_EXPONENT )
+    {
+        return 0.0L;
+    }
+
+    if ( maxKernelError > 0.0L )
+    {
+        const double maxKernel = std::exp( -minExponent );
+        const double minKernel = std::exp( -scale *
+                Utils::maxSquaredDistanceToBox< T >( pointOfInterest,
+                                                     root->bounds() ) );
+
+        if ( maxKernel - minKernel <= maxKernelError )
+        {
+            return 0.5L * root->count() * ( maxKernel + minKernel );
+        }
+    }
+
+    return kernelDensityHelper( root->left().get(), pointOfInterest,
+                                scale, maxKernelError ) +
+           kernelDensityHelper( root->right().get(), pointOfInterest,
+                                scale, maxKernelError );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::kernelDensitiesHelper(
+        const KDNode< T >*     queryRoot,
+        const KDTree&          queryTree,
+        const KDNode< T >*     referenceRoot,
+        const double           scale,
+        const double           maxKernelError,
+        std::vector< double >& sums ) const
+{
+    if ( nullptr == queryRoot || nullptr == referenceRoot )
+    {
+        return;
+    }
+
+    if ( queryRoot->isLeaf() && referenceRoot->isLeaf() )
+    {
+        sums[ queryRoot->leafPointIndex() ] += std::exp( -scale *
+                Utils::squaredDistance< T >(
+                        m_points[ referenceRoot->leafPointIndex() ],
+                        queryTree.m_points[ queryRoot->leafPointIndex() ] ) );
+        return;
+    }
+
+    const double minExponent = scale *
+            Utils::squaredDistanceBetweenBoxes< T >( queryRoot->bounds(),
+                                                     referenceRoot->bounds() );
+    if ( minExponent > Constants::KDTREE_KERNEL_UNDERFLOW_EXPONENT )
+    {
+        return;
+    }
+
+    if ( maxKernelError > 0.0L )
+    {
+        const double maxKernel = std::exp( -minExponent );
+        const double minKernel = std::exp( -scale *
+                Utils::maxSquaredDistanceBetweenBoxes< T >(
+                        queryRoot->bounds(), referenceRoot->bounds() ) );
+
+        if ( maxKernel - minKernel <= maxKernelError )
+        {
+            addToLeaves( queryRoot,
+                         0.5L * referenceRoot->count() *
+                         ( maxKernel + minKernel ),
+                         sums );
+            return;
+        }
+    }
+
+    // Split the bigger of the two nodes
+    if ( referenceRoot->isLeaf() ||
+         ( !queryRoot->isLeaf() &&
+           queryRoot->count() >= referenceRoot->count() ) )
+    {
+        kernelDensitiesHelper( queryRoot->left().get(), queryTree,
+                               referenceRoot, scale, maxKernelError, sums );
+        kernelDensitiesHelper( queryRoot->right().get(), queryTree,
+                               referenceRoot, scale, maxKernelError, sums );
+        return;
+    }
+
+    kernelDensitiesHelper( queryRoot, queryTree, referenceRoot->left().get(),
+                           scale, maxKernelError, sums );
+    kernelDensitiesHelper( queryRoot, queryTree, referenceRoot->right().get(),
+                           scale, maxKernelError, sums );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::addToLeaves( const KDNode< T >*     root,
+                                               const double           value,
+                                               std::vector< double >& sums )
+{
+    if ( nullptr == root )
+    {
+        return;
+    }
+
+    if ( root->isLeaf() )
+    {
+        sums[ root->leafPointIndex() ] += value;
+        return;
+    }
+
+    addToLeaves( root->left().get(),  value, sums );
+    addToLeaves( root->right().get(), value, sums );
 }
 
 //============================================================================
 //                  MANIPULATORS
 //============================================================================
 
-template< typename T >
+template< typename T, typename SplitPolicy, typename Metric >
 void
-KDTree< T >::copy( const KDTree< T >& other )
+KDTree< T, SplitPolicy, Metric >::copy(
+        const KDTree& other )
 {
-    m_points = other.points();
+    m_points      = other.points();
+    m_values      = other.values();
+    m_permutation = other.permutation();
     buildWrapper();
+
+    if ( !other.lookupGrid().empty() )
+    {
+        buildLookupGrid( other.lookupGrid().cellsPerAxis() );
+    }
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDStatus
+KDTree< T, SplitPolicy, Metric >::reorder()
+{
+    // Sanity
+    if ( m_points.size() > std::numeric_limits< uint32_t >::max() )
+    {
+        return KDStatus( KDStatus::Code::SIZE_LIMIT,
+                         "reorder() supports at most 2^32 points" );
+    }
+
+    Types::Indexes order;
+    order.reserve( m_points.size() );
+    leafOrderHelper( m_root.get(), order );
+
+    // Copies rather than moves, so that the coordinates themselves are
+    // allocated in leaf order as well
+    Types::Points< T > points;
+    points.reserve( order.size() );
+    std::vector< double > values;
+    values.reserve( m_values.size() );
+    std::vector< uint32_t > permutation;
+    permutation.reserve( order.size() );
+
+    for ( size_t i = 0; i < order.size(); ++i )
+    {
+        points.push_back( m_points[ order[ i ] ] );
+        if ( !m_values.empty() )
+        {
+            values.push_back( m_values[ order[ i ] ] );
+        }
+        permutation.push_back( static_cast< uint32_t >(
+                originalIndex( order[ i ] ) ) );
+    }
+
+    m_points.swap( points );
+    m_values.swap( values );
+    m_permutation.swap( permutation );
+
+    size_t next = 0;
+    renumberLeavesHelper( m_root.get(), next );
+    m_parents.clear();
+
+    return KDStatus();
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDStatus
+KDTree< T, SplitPolicy, Metric >::merge( const KDTree& other )
+{
+    // Merging a tree into itself reads from a copy
+    if ( &other == this )
+    {
+        const KDTree copy( other );
+        return merge( copy );
+    }
+
+    // Sanity
+    if ( !m_points.empty() && !other.m_points.empty() &&
+         m_points[ 0 ].size() != other.m_points[ 0 ].size() )
+    {
+        return KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                         "merge() expects trees of the same dimension" );
+    }
+
+    const size_t offset = m_points.size();
+    const bool reordered = !m_permutation.empty() ||
+                           !other.m_permutation.empty();
+    if ( reordered &&
+         offset + other.m_points.size() >
+                 std::numeric_limits< uint32_t >::max() )
+    {
+        return KDStatus( KDStatus::Code::SIZE_LIMIT,
+                         "merge() supports at most 2^32 reordered points" );
+    }
+
+    // Points of a tree without values count 0, the sums of its nodes are
+    // 0 already
+    if ( !m_values.empty() || !other.m_values.empty() )
+    {
+        m_values.resize( offset, 0.0L );
+        if ( other.m_values.empty() )
+        {
+            m_values.resize( offset + other.m_points.size(), 0.0L );
+        }
+        else
+        {
+            m_values.insert( m_values.end(), other.m_values.begin(),
+                                             other.m_values.end() );
+        }
+    }
+
+    if ( reordered )
+    {
+        std::vector< uint32_t > permutation;
+        permutation.reserve( offset + other.m_points.size() );
+        for ( size_t i = 0; i < offset; ++i )
+        {
+            permutation.push_back( static_cast< uint32_t >(
+                    originalIndex( i ) ) );
+        }
+        for ( size_t i = 0; i < other.m_points.size(); ++i )
+        {
+            permutation.push_back( static_cast< uint32_t >(
+                    offset + other.originalIndex( i ) ) );
+        }
+        m_permutation.swap( permutation );
+    }
+
+    m_points.insert( m_points.end(), other.m_points.begin(),
+                                     other.m_points.end() );
+    m_root = mergeHelper( m_root, cloneHelper( other.m_root.get(), offset ) );
+    m_grid.clear();
+    m_parents.clear();
+
+    return KDStatus();
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+size_t
+KDTree< T, SplitPolicy, Metric >::eraseIf( const Types::AxisMinMax< T >& box )
+{
+    // Sanity
+    if ( m_points.empty() || m_points[ 0 ].size() != box.size() )
+    {
+        return 0u;
+    }
+
+    std::vector< char > erased( m_points.size(), 0 );
+    bool any = false;
+    for ( size_t i = 0; i < m_points.size(); ++i )
+    {
+        erased[ i ] = Utils::boxContainsPoint( box, m_points[ i ] ) ? 1 : 0;
+        any = any || erased[ i ];
+    }
+
+    if ( !any )
+    {
+        return 0u;
+    }
+
+    return eraseWrapper( erased,
+        [ & ]( const KDNode< T >* root )
+        {
+            if ( Utils::boxContainsBox( box, root->bounds() ) )
+            {
+                return Coverage::ALL;
+            }
+
+            return Utils::boxesIntersect( box, root->bounds() ) ?
+                   Coverage::PARTIAL : Coverage::NONE;
+        } );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDStatus
+KDTree< T, SplitPolicy, Metric >::update( const size_t             index,
+                                          const Types::Point< T >& newPoint )
+{
+    // Sanity
+    if ( index >= m_points.size() )
+    {
+        return KDStatus( KDStatus::Code::NOT_FOUND,
+                         "update() index out of range" );
+    }
+
+    if ( newPoint.size() != m_points[ index ].size() )
+    {
+        return KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                         "update() expects a point of the tree dimension" );
+    }
+
+    // Loose cells reach past the points on every side
+    if ( m_parents.empty() )
+    {
+        Types::AxisMinMax< T > region = Utils::minMaxPerAxis( m_points );
+        for ( size_t i = 0; i < region.size(); ++i )
+        {
+            const double margin = Constants::KDTREE_LOOSE_CELL_MARGIN *
+                    ( static_cast< double >( region[ i ].second ) -
+                      region[ i ].first );
+            region[ i ].first = static_cast< T >( std::max(
+                    static_cast< double >( std::numeric_limits< T >::lowest() ),
+                    region[ i ].first - margin ) );
+            region[ i ].second = static_cast< T >( std::min(
+                    static_cast< double >( std::numeric_limits< T >::max() ),
+                    region[ i ].second + margin ) );
+        }
+
+        m_parents.resize( m_points.size() );
+        loosenHelper( m_root.get(), region, nullptr );
+        m_grid.clear();
+    }
+
+    // Moves within the cell of the parent leave the structure as it is
+    KDNode< T >* parent = m_parents[ index ];
+    if ( nullptr == parent )
+    {
+        m_points[ index ] = newPoint;
+        summarizeHelper( m_root.get() );
+        return KDStatus();
+    }
+
+    const bool   isLeft = nullptr != parent->left() &&
+                          parent->left()->isLeaf() &&
+                          parent->left()->leafPointIndex() == index;
+    const size_t axis   = parent->hyperplane().hyperplaneIndex();
+    const T      value  = parent->hyperplane().value();
+    if ( Utils::boxContainsPoint( parent->bounds(), newPoint ) &&
+         ( isLeft ? newPoint[ axis ] <= value : newPoint[ axis ] >= value ) )
+    {
+        m_points[ index ] = newPoint;
+        summarizeHelper( isLeft ? parent->left().get() :
+                                  parent->right().get() );
+        return KDStatus();
+    }
+
+    bool found = false;
+    m_root = removeHelper( m_root, index, found );
+    m_points[ index ] = newPoint;
+
+    if ( m_root->isLeaf() )
+    {
+        m_parents[ m_root->leafPointIndex() ] = nullptr;
+    }
+
+    Types::AxisMinMax< T > region = m_root->bounds();
+    for ( size_t i = 0; i < region.size(); ++i )
+    {
+        region[ i ].first  = std::min( region[ i ].first,  newPoint[ i ] );
+        region[ i ].second = std::max( region[ i ].second, newPoint[ i ] );
+    }
+    m_root = insertHelper( m_root, region, index );
+    m_grid.clear();
+
+    if ( ++m_reinserted > Constants::KDTREE_UPDATE_REBUILD_SHARE *
+                          m_points.size() )
+    {
+        buildWrapper();
+    }
+
+    return KDStatus();
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+template< typename Predicate >
+size_t
+KDTree< T, SplitPolicy, Metric >::eraseIf( Predicate predicate )
+{
+    // Every point is tested before the tree changes
+    std::vector< char > erased( m_points.size(), 0 );
+    bool any = false;
+    for ( size_t i = 0; i < m_points.size(); ++i )
+    {
+        erased[ i ] = predicate( i ) ? 1 : 0;
+        any = any || erased[ i ];
+    }
+
+    if ( !any )
+    {
+        return 0u;
+    }
+
+    return eraseWrapper( erased,
+        [ & ]( const KDNode< T >* root )
+        {
+            if ( !root->isLeaf() )
+            {
+                return Coverage::PARTIAL;
+            }
+
+            return erased[ root->leafPointIndex() ] ?
+                   Coverage::ALL : Coverage::NONE;
+        } );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+size_t
+KDTree< T, SplitPolicy, Metric >::collapseDuplicates()
+{
+    std::vector< char > duplicate( m_points.size(), 0 );
+    const std::vector< Types::Indexes > groups = duplicates();
+    for ( size_t i = 0; i < groups.size(); ++i )
+    {
+        for ( size_t j = 1; j < groups[ i ].size(); ++j )
+        {
+            duplicate[ groups[ i ][ j ] ] = 1;
+        }
+    }
+
+    return eraseIf( [ & ]( const size_t index )
+                    {
+                        return 0 != duplicate[ index ];
+                    } );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::buildLookupGrid( const size_t cellsPerAxis,
+                                                   const size_t numThreads )
+{
+    if ( m_points.empty() )
+    {
+        m_grid.clear();
+        return;
+    }
+
+    m_grid.build( m_root,
+                  cellsPerAxis ? cellsPerAxis :
+                          KDLookupGrid< T >::defaultCellsPerAxis(
+                                  m_points.size(), m_points[ 0 ].size() ),
+                  numThreads );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDTree< T, SplitPolicy, Metric >::clearLookupGrid()
+{
+    m_grid.clear();
 }
 
 //============================================================================
 //                  ACCESSORS
 //============================================================================
 
-template< typename T >
+template< typename T, typename SplitPolicy, typename Metric >
 bool
-KDTree< T >::equals( const KDTree< T >& other ) const
+KDTree< T, SplitPolicy, Metric >::equals(
+        const KDTree& other ) const
 {
-    return ( ( other.type()    == m_type   ) &&
-             ( other.points()  == m_points ) );
+    return ( ( other.type()        == m_type        ) &&
+             ( other.points()      == m_points      ) &&
+             ( other.values()      == m_values      ) &&
+             ( other.permutation() == m_permutation ) );
 }
 
-template< typename T >
+template< typename T, typename SplitPolicy, typename Metric >
 std::ostream&
-KDTree< T >::print( std::ostream& out ) const
+KDTree< T, SplitPolicy, Metric >::print( std::ostream& out ) const
 {
     out << "KDTree:[ "
         << "implementation type = '" << m_type          << "', "
@@ -747,8 +3952,9 @@ KDTree< T >::print( std::ostream& out ) const
 //============================================================================
 //                  INDEPENDENT OPERATORS
 //============================================================================
-template< typename T >
-std::ostream& operator<<( std::ostream& lhs, const KDTree< T >& rhs )
+template< typename T, typename SplitPolicy, typename Metric >
+std::ostream& operator<<( std::ostream&                            lhs,
+                          const KDTree< T, SplitPolicy, Metric >& rhs )
 {
     return rhs.print( lhs );
 }
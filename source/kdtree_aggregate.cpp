@@ -0,0 +1,99 @@
+#include "kdtree_aggregate.h"
+
+namespace datastructures {
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+KDAggregate::KDAggregate()
+: m_count( 0u )
+, m_sum(   0.0L )
+{
+    // nothing to do here
+}
+
+KDAggregate::KDAggregate( const size_t count, const double sum )
+: m_count( count )
+, m_sum(   sum )
+{
+    // nothing to do here
+}
+
+//============================================================================
+//                  OPERATORS
+//============================================================================
+
+KDAggregate&
+KDAggregate::operator+=( const KDAggregate& other )
+{
+    m_count += other.count();
+    m_sum   += other.sum();
+    return *this;
+}
+
+bool
+KDAggregate::operator==( const KDAggregate& other ) const
+{
+    return equals( other );
+}
+
+bool
+KDAggregate::operator!=( const KDAggregate& other ) const
+{
+    return !equals( other );
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+size_t
+KDAggregate::count() const
+{
+    return m_count;
+}
+
+double
+KDAggregate::sum() const
+{
+    return m_sum;
+}
+
+double
+KDAggregate::mean() const
+{
+    return m_count ? m_sum / m_count : 0.0L;
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+bool
+KDAggregate::equals( const KDAggregate& other ) const
+{
+    return ( ( other.count() == m_count ) &&
+             ( other.sum()   == m_sum   ) );
+}
+
+std::ostream&
+KDAggregate::print( std::ostream& out ) const
+{
+    out << "KDAggregate:[ "
+        << "count = " << std::dec << m_count << ", "
+        << "sum = "   << m_sum               << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+std::ostream& operator<<( std::ostream& lhs, const KDAggregate& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
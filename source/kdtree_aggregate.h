@@ -0,0 +1,64 @@
+#ifndef KDTREE_AGGREGATE_H
+#define KDTREE_AGGREGATE_H
+
+#include <cstddef>
+#include <iostream>
+
+namespace datastructures {
+
+// PURPOSE:
+//
+// A class that holds the result of a range aggregation query : the number
+// of points found and the sum of their values.
+//
+class KDAggregate {
+public:
+    // CREATORS
+    KDAggregate();
+        // Default constructor, empty aggregate
+
+    KDAggregate( const size_t count, const double sum );
+        // Constructor
+
+    // OPERATORS
+    KDAggregate& operator+=( const KDAggregate& other );
+        // Accumulates other into this
+
+    bool operator==( const KDAggregate& other ) const;
+        // Equality. Calls equals.
+
+    bool operator!=( const KDAggregate& other ) const;
+        // Non-equality. Calls equals.
+
+    // PRIMARY INTERFACE
+    size_t count() const;
+        // Returns number of aggregated points
+
+    double sum() const;
+        // Returns sum of values of aggregated points
+
+    double mean() const;
+        // Returns mean value of aggregated points, 0 for an empty aggregate
+
+    // ACCESSORS
+    bool equals( const KDAggregate& other ) const;
+        // Worker for equality
+
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the contents of the KDAggregate object in a easy to read
+        // format
+
+private:
+    size_t  m_count;
+        // Number of aggregated points
+
+    double  m_sum;
+        // Sum of values of aggregated points
+};
+
+// INDEPENDENT OPERATORS
+std::ostream& operator<<( std::ostream& lhs, const KDAggregate& rhs );
+
+} // close namespace datastructures
+
+#endif // KDTREE_AGGREGATE_H
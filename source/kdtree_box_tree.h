@@ -0,0 +1,854 @@
+#ifndef KDTREE_BOX_TREE_H
+#define KDTREE_BOX_TREE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "kdtree_types.h"
+#include "kdtree_utils.h"
+#include "kdtree_constants.h"
+#include "kdtree_loader.h"
+#include "kdtree_morton.h"
+#include "kdtree_parallel.h"
+#include "kdtree_status.h"
+#include "kdtree_text.h"
+
+namespace datastructures {
+
+// PURPOSE:
+//
+// A packed bounding volume tree over axis aligned boxes, such as the
+// bounding boxes of meshes or parcels, answering nearest box, box overlap
+// and point in box queries. Distances are Euclidean, the distance of a
+// point to a box it lies in is 0.
+//
+// The tree is bulk loaded: boxes are sorted by the Morton code of their
+// centres, every Constants::KDTREE_BOX_TREE_FANOUT consecutive boxes form
+// a leaf and every Constants::KDTREE_BOX_TREE_FANOUT consecutive nodes of
+// a level form a node of the level above, up to a single root. Children
+// of a node are therefore implied by its position and no links are
+// stored; every node keeps the bounding box of its boxes. Sorting and the
+// bounds of every level are processed by several threads.
+//
+// The structure only depends on the boxes, so serialize() writes the
+// boxes and deserialize() rebuilds the tree from them.
+//
+template< typename T >
+class KDBoxTree {
+public:
+    // CREATORS
+    KDBoxTree();
+        // Default constructor, creates an empty tree
+
+    KDBoxTree( const Types::Boxes< T >& boxes,
+               const size_t             numThreads = 0u );
+        // Constructor, builds the tree over boxes. Boxes of different
+        // dimensions or with a low bound above the high bound leave the
+        // tree empty.
+        // numThreads of 0 uses all hardware threads.
+
+    // OPERATORS
+    bool operator==( const KDBoxTree& other ) const;
+        // Equality. Calls equals.
+
+    bool operator!=( const KDBoxTree& other ) const;
+        // Non-equality. Calls equals.
+
+    // PRIMARY INTERFACE
+    KDStatus serialize( const std::string& filename,
+                        const size_t       numThreads = 0u ) const;
+        // Writes the boxes of the tree to the provided file location, a
+        // line of low and high bound of every axis in turn per box, in
+        // their shortest exact form, formatted by several threads.
+        // numThreads of 0 uses all hardware threads.
+        // Returns successful status or the reason of the failure.
+
+    KDStatus deserialize( const std::string& filename,
+                          const size_t       numThreads = 0u );
+        // Loads the boxes from a file produced by serialize() and rebuilds
+        // the tree, the tree is left untouched on failure.
+        // numThreads of 0 uses all hardware threads.
+        // Returns successful status or the reason of the failure, with
+        // the line of the file it was detected on.
+
+    size_t nearestBoxIndex( const Types::Point< T >& pointOfInterest ) const;
+        // Returns index of the box closest to the point of interest, ties
+        // broken by the smaller index. In case the tree is empty or there
+        // is a cardinality mismatch - KDTREE_ERROR_INDEX is returned
+
+    Types::Indexes nearestBoxIndexes( const Types::Point< T >& pointOfInterest,
+                                      const size_t             k ) const;
+        // Returns indexes of the k boxes closest to the point of interest
+        // sorted by increasing distance, ties broken by the smaller index.
+        // Fewer than k indexes are returned when the tree holds fewer than
+        // k boxes. In case the tree is empty or there is a cardinality
+        // mismatch - empty container is returned.
+
+    Types::Neighbours nearestBoxes(
+            const Types::Points< T >& pointsOfInterest,
+            const size_t              numThreads = 0u ) const;
+        // Batched nearest box search. Returns, for every point of
+        // interest, the squared distance to and the index of its nearest
+        // box, ties broken by the smaller index. Points are split into
+        // contiguous chunks searched by separate threads.
+        // numThreads of 0 uses all hardware threads.
+        // In case the tree is empty or there is a cardinality mismatch -
+        // empty container is returned.
+
+    Types::Indexes boxIndexesOverlapping(
+            const Types::AxisMinMax< T >& box ) const;
+        // Returns indexes of all boxes sharing at least one point with
+        // box, boundary included, in no particular order. In case the tree
+        // is empty or there is a cardinality mismatch - empty container is
+        // returned.
+
+    Types::Indexes boxIndexesContaining(
+            const Types::Point< T >& pointOfInterest ) const;
+        // Returns indexes of all boxes the point of interest lies in,
+        // boundary included, in no particular order. In case the tree is
+        // empty or there is a cardinality mismatch - empty container is
+        // returned.
+
+    size_t size() const;
+        // Returns number of boxes stored in the tree
+
+    size_t numNodes() const;
+        // Returns number of nodes of the tree
+
+    const Types::AxisMinMax< T >& box( const size_t index ) const;
+        // Returns const ref to the box stored under index. Behaviour is
+        // undefined for index >= size()
+
+    const Types::Boxes< T >& boxes() const;
+        // Returns the boxes of the tree in their original order
+
+    // ACCESSORS
+    bool equals( const KDBoxTree& other ) const;
+        // Worker for equality, trees are equal if they hold the same boxes
+        // in the same order
+
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the summary of the KDBoxTree object in a easy to read
+        // format
+
+private:
+    void build( const size_t numThreads );
+        // Sorts the boxes and builds the levels of nodes over them
+
+    Types::Neighbour nearestBoxHelper(
+            const Types::Point< T >& pointOfInterest ) const;
+        // Returns squared distance to and index of the nearest box.
+        // Expects a non-empty tree and cardinality of the point of
+        // interest to be validated by the caller.
+
+    size_t childrenEnd( const size_t level, const size_t node ) const;
+        // Returns position past the last child of node of level, a sorted
+        // box position for level 0 and a node of the level below otherwise
+
+    template< typename Visit, typename Report >
+    void traverse( Visit visit, Report report ) const;
+        // Depth-first traversal of the nodes for which visit( bounds )
+        // holds, calling report( index ) for every box of a visited leaf
+
+    static bool valid( const Types::AxisMinMax< T >& box );
+        // Returns true if no low bound of box exceeds its high bound
+
+    Types::Boxes< T >                       m_boxes;
+        // Boxes in their original order
+
+    Types::Indexes                          m_indexes;
+        // Original index of every box in Morton order of the centres
+
+    std::vector< Types::AxisMinMax< T > >   m_nodes;
+        // Bounds of all the nodes, level by level from the leaves up
+
+    std::vector< size_t >                   m_levels;
+        // Position of the first node of every level in m_nodes, followed
+        // by the number of nodes
+};
+
+// INDEPENDENT OPERATORS
+template< typename T >
+std::ostream& operator<<( std::ostream& lhs, const KDBoxTree< T >& rhs );
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+template< typename T >
+KDBoxTree< T >::KDBoxTree()
+{
+    // nothing to do here
+}
+
+template< typename T >
+KDBoxTree< T >::KDBoxTree( const Types::Boxes< T >& boxes,
+                           const size_t             numThreads )
+: m_boxes( boxes )
+{
+    bool boxesValid = true;
+    for ( size_t i = 0; boxesValid && i < m_boxes.size(); ++i )
+    {
+        boxesValid = m_boxes[ i ].size() == m_boxes[ 0 ].size() &&
+                     valid( m_boxes[ i ] );
+    }
+
+    if ( !boxesValid )
+    {
+        std::cerr << "KDBoxTree::KDBoxTree() expects boxes of the same "
+                  << "dimension with low bounds not above high bounds, "
+                  << "num boxes = " << m_boxes.size() << ", boxes dropped"
+                  << std::endl;
+        m_boxes.clear();
+    }
+
+    build( numThreads );
+}
+
+//============================================================================
+//                  OPERATORS
+//============================================================================
+
+template< typename T >
+bool
+KDBoxTree< T >::operator==( const KDBoxTree& other ) const
+{
+    return equals( other );
+}
+
+template< typename T >
+bool
+KDBoxTree< T >::operator!=( const KDBoxTree& other ) const
+{
+    return !equals( other );
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+KDStatus
+KDBoxTree< T >::serialize( const std::string& filename,
+                           const size_t       numThreads ) const
+{
+    const size_t threads = Parallel::numThreads( numThreads );
+    std::vector< std::string > pieces( 1u );
+
+    // First serialize tree type
+    pieces.back() += Constants::KDTREE_BOX_TREE_VARIETY;
+    pieces.back() += '\n';
+
+    // Second number of boxes
+    Text::appendNumber( pieces.back(), m_boxes.size() );
+    pieces.back() += '\n';
+
+    // Third all the boxes, a piece per thread
+    const size_t boxPieces = pieces.size();
+    pieces.resize( pieces.size() + threads );
+    Parallel::forEachRange( m_boxes.size(), threads,
+        [ & ]( const size_t begin, const size_t end, const size_t chunk )
+        {
+            std::string& out = pieces[ boxPieces + chunk ];
+            Types::Point< T > bounds;
+            for ( size_t i = begin; i < end; ++i )
+            {
+                bounds.clear();
+                for ( size_t j = 0; j < m_boxes[ i ].size(); ++j )
+                {
+                    bounds.push_back( m_boxes[ i ][ j ].first );
+                    bounds.push_back( m_boxes[ i ][ j ].second );
+                }
+                Text::appendPoint( out, bounds );
+            }
+        } );
+
+    return Text::writeFile( filename, pieces );
+}
+
+template< typename T >
+KDStatus
+KDBoxTree< T >::deserialize( const std::string& filename,
+                             const size_t       numThreads )
+{
+    const size_t threads = Parallel::numThreads( numThreads );
+
+    std::string contents;
+    const KDStatus read = Text::readFile( filename, contents );
+    if ( !read )
+    {
+        return read;
+    }
+
+    std::vector< const char* > lines;
+    Text::splitLines( contents, lines, threads );
+    const size_t numLines = lines.size() - 1u;
+
+    // First check tree type
+    if ( numLines < 1u ||
+         !Text::lineEquals( lines, 0u, Constants::KDTREE_BOX_TREE_VARIETY ) )
+    {
+        return KDStatus( KDStatus::Code::TYPE_MISMATCH,
+                         "unexpected tree type",
+                         1u );
+    }
+
+    // Then number of boxes
+    size_t numOfBoxes;
+    const char* cursor = numLines < 2u ? nullptr : lines[ 1 ];
+    if ( nullptr == cursor ||
+         !Loader::parseIndex( cursor, Text::lineEnd( lines, 1u ), numOfBoxes ) ||
+         cursor != Text::lineEnd( lines, 1u ) )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "malformed number of boxes",
+                         2u );
+    }
+
+    if ( numLines - 2u < numOfBoxes )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "fewer boxes than declared",
+                         numLines + 1u );
+    }
+
+    // Then all the boxes, parsed in place by several threads. Every
+    // thread stops at its first failure, the earliest one is reported
+    Types::Boxes< T > boxes( numOfBoxes );
+    std::vector< KDStatus > failures( threads );
+    Parallel::forEachRange( numOfBoxes, threads,
+        [ & ]( const size_t begin, const size_t end, const size_t chunk )
+        {
+            Types::Point< T > bounds;
+            for ( size_t i = begin; i < end; ++i )
+            {
+                KDStatus status = Loader::parsePoint(
+                        lines[ 2u + i ], Text::lineEnd( lines, 2u + i ),
+                        bounds, 3u + i );
+                if ( status && bounds.size() % 2u )
+                {
+                    status = KDStatus( KDStatus::Code::PARSE_ERROR,
+                                       "box without a high bound",
+                                       3u + i );
+                }
+                if ( !status )
+                {
+                    failures[ chunk ] = status;
+                    return;
+                }
+
+                boxes[ i ].resize( bounds.size() / 2u );
+                for ( size_t j = 0; j < boxes[ i ].size(); ++j )
+                {
+                    boxes[ i ][ j ] = std::make_pair( bounds[ 2u * j ],
+                                                      bounds[ 2u * j + 1u ] );
+                }
+
+                if ( !valid( boxes[ i ] ) )
+                {
+                    failures[ chunk ] =
+                            KDStatus( KDStatus::Code::PARSE_ERROR,
+                                      "low bound above high bound",
+                                      3u + i );
+                    return;
+                }
+            }
+        } );
+
+    for ( size_t chunk = 0; chunk < failures.size(); ++chunk )
+    {
+        if ( !failures[ chunk ] )
+        {
+            return failures[ chunk ];
+        }
+    }
+
+    for ( size_t i = 1; i < boxes.size(); ++i )
+    {
+        if ( boxes[ 0 ].size() != boxes[ i ].size() )
+        {
+            return KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                             "box dimension differs from the first box",
+                             3u + i );
+        }
+    }
+
+    m_boxes.swap( boxes );
+    build( threads );
+
+    return KDStatus();
+}
+
+template< typename T >
+size_t
+KDBoxTree< T >::nearestBoxIndex( const Types::Point< T >& pointOfInterest ) const
+{
+    // Sanity
+    if ( m_boxes.empty() || m_boxes[ 0 ].size() != pointOfInterest.size() )
+    {
+        return Constants::KDTREE_ERROR_INDEX;
+    }
+
+    return nearestBoxHelper( pointOfInterest ).second;
+}
+
+template< typename T >
+Types::Indexes
+KDBoxTree< T >::nearestBoxIndexes( const Types::Point< T >& pointOfInterest,
+                                   const size_t             k ) const
+{
+    Types::Indexes result;
+
+    // Sanity
+    if ( m_boxes.empty() ||
+         m_boxes[ 0 ].size() != pointOfInterest.size() ||
+         !k )
+    {
+        return result;
+    }
+
+    // Max heap of the best candidates found so far, the worst on top
+    std::priority_queue< Types::Neighbour > best;
+
+    // Best first over the nodes, nearest node on top
+    typedef std::pair< double, std::pair< size_t, size_t > > Entry;
+    std::priority_queue< Entry, std::vector< Entry >, std::greater< Entry > >
+            pending;
+    const size_t root = m_levels.size() - 2u;
+    pending.push( Entry( Utils::squaredDistanceToBox(
+                                 pointOfInterest, m_nodes.back() ),
+                         std::make_pair( root, 0u ) ) );
+
+    while ( !pending.empty() )
+    {
+        const Entry top = pending.top();
+        pending.pop();
+
+        if ( best.size() == k && top.first > best.top().first )
+        {
+            break;
+        }
+
+        const size_t level = top.second.first;
+        const size_t node  = top.second.second;
+        for ( size_t child = node * Constants::KDTREE_BOX_TREE_FANOUT;
+              child < childrenEnd( level, node ); ++child )
+        {
+            if ( !level )
+            {
+                const Types::Neighbour candidate(
+                        Utils::squaredDistanceToBox(
+                                pointOfInterest,
+                                m_boxes[ m_indexes[ child ] ] ),
+                        m_indexes[ child ] );
+                if ( best.size() < k )
+                {
+                    best.push( candidate );
+                }
+                else if ( candidate < best.top() )
+                {
+                    best.pop();
+                    best.push( candidate );
+                }
+                continue;
+            }
+
+            const double bound = Utils::squaredDistanceToBox(
+                    pointOfInterest,
+                    m_nodes[ m_levels[ level - 1u ] + child ] );
+            if ( best.size() < k || bound <= best.top().first )
+            {
+                pending.push( Entry( bound,
+                                     std::make_pair( level - 1u, child ) ) );
+            }
+        }
+    }
+
+    result.resize( best.size() );
+    for ( size_t i = result.size(); i > 0u; --i )
+    {
+        result[ i - 1u ] = best.top().second;
+        best.pop();
+    }
+
+    return result;
+}
+
+template< typename T >
+Types::Neighbours
+KDBoxTree< T >::nearestBoxes( const Types::Points< T >& pointsOfInterest,
+                              const size_t              numThreads ) const
+{
+    Types::Neighbours result;
+
+    // Sanity
+    if ( m_boxes.empty() )
+    {
+        return result;
+    }
+
+    for ( size_t i = 0; i < pointsOfInterest.size(); ++i )
+    {
+        if ( pointsOfInterest[ i ].size() != m_boxes[ 0 ].size() )
+        {
+            return result;
+        }
+    }
+
+    result.resize( pointsOfInterest.size() );
+    Parallel::forEachRange( pointsOfInterest.size(), numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                result[ i ] = nearestBoxHelper( pointsOfInterest[ i ] );
+            }
+        } );
+
+    return result;
+}
+
+template< typename T >
+Types::Indexes
+KDBoxTree< T >::boxIndexesOverlapping( const Types::AxisMinMax< T >& box ) const
+{
+    Types::Indexes result;
+
+    // Sanity
+    if ( m_boxes.empty() || m_boxes[ 0 ].size() != box.size() )
+    {
+        return result;
+    }
+
+    traverse(
+        [ & ]( const Types::AxisMinMax< T >& bounds )
+        {
+            return Utils::boxesIntersect( bounds, box );
+        },
+        [ & ]( const size_t index )
+        {
+            if ( Utils::boxesIntersect( m_boxes[ index ], box ) )
+            {
+                result.push_back( index );
+            }
+        } );
+
+    return result;
+}
+
+template< typename T >
+Types::Indexes
+KDBoxTree< T >::boxIndexesContaining(
+        const Types::Point< T >& pointOfInterest ) const
+{
+    Types::Indexes result;
+
+    // Sanity
+    if ( m_boxes.empty() || m_boxes[ 0 ].size() != pointOfInterest.size() )
+    {
+        return result;
+    }
+
+    traverse(
+        [ & ]( const Types::AxisMinMax< T >& bounds )
+        {
+            return Utils::boxContainsPoint( bounds, pointOfInterest );
+        },
+        [ & ]( const size_t index )
+        {
+            if ( Utils::boxContainsPoint( m_boxes[ index ], pointOfInterest ) )
+            {
+                result.push_back( index );
+            }
+        } );
+
+    return result;
+}
+
+template< typename T >
+size_t
+KDBoxTree< T >::size() const
+{
+    return m_boxes.size();
+}
+
+template< typename T >
+size_t
+KDBoxTree< T >::numNodes() const
+{
+    return m_nodes.size();
+}
+
+template< typename T >
+const Types::AxisMinMax< T >&
+KDBoxTree< T >::box( const size_t index ) const
+{
+    return m_boxes[ index ];
+}
+
+template< typename T >
+const Types::Boxes< T >&
+KDBoxTree< T >::boxes() const
+{
+    return m_boxes;
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+template< typename T >
+bool
+KDBoxTree< T >::equals( const KDBoxTree& other ) const
+{
+    return other.m_boxes == m_boxes;
+}
+
+template< typename T >
+std::ostream&
+KDBoxTree< T >::print( std::ostream& out ) const
+{
+    out << "KDBoxTree:[ "
+        << "size = "   << std::dec << size()     << ", "
+        << "nodes = "  << std::dec << numNodes() << ", "
+        << "levels = " << std::dec
+        << ( m_levels.empty() ? 0u : m_levels.size() - 1u ) << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  PRIVATE METHODS
+//============================================================================
+
+template< typename T >
+void
+KDBoxTree< T >::build( const size_t numThreads )
+{
+    m_indexes.clear();
+    m_nodes.clear();
+    m_levels.clear();
+
+    const size_t size = m_boxes.size();
+    if ( !size )
+    {
+        return;
+    }
+
+    const size_t threads   = Parallel::numThreads( numThreads );
+    const size_t dimension = m_boxes[ 0 ].size();
+    const size_t fanout    = Constants::KDTREE_BOX_TREE_FANOUT;
+
+    // Sort the boxes by Morton code of their centres
+    Types::Points< T > centres( size, Types::Point< T >( dimension ) );
+    Parallel::forEachRange( size, threads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                for ( size_t j = 0; j < dimension; ++j )
+                {
+                    centres[ i ][ j ] = static_cast< T >(
+                            m_boxes[ i ][ j ].first +
+                            ( static_cast< double >( m_boxes[ i ][ j ].second ) -
+                              m_boxes[ i ][ j ].first ) / 2.0L );
+                }
+            }
+        } );
+
+    std::vector< uint64_t > codes =
+            Morton::encode( centres, Utils::minMaxPerAxis( centres ), threads );
+    m_indexes.resize( size );
+    std::iota( m_indexes.begin(), m_indexes.end(), 0u );
+    Morton::radixSort( codes, m_indexes, threads );
+
+    // Group every fanout consecutive boxes, then nodes, up to the root
+    m_levels.push_back( 0u );
+    size_t children = size;
+    do
+    {
+        const size_t level    = m_levels.size() - 1u;
+        const size_t first    = m_levels.back();
+        const size_t numNodes = ( children + fanout - 1u ) / fanout;
+        m_nodes.resize( first + numNodes );
+        m_levels.push_back( first + numNodes );
+
+        Parallel::forEachRange( numNodes, threads,
+            [ & ]( const size_t begin, const size_t end, const size_t )
+            {
+                for ( size_t node = begin; node < end; ++node )
+                {
+                    Types::AxisMinMax< T >& bounds = m_nodes[ first + node ];
+                    const size_t childBegin = node * fanout;
+                    const size_t childEnd   = childrenEnd( level, node );
+                    for ( size_t child = childBegin; child < childEnd; ++child )
+                    {
+                        const Types::AxisMinMax< T >& other = level ?
+                                m_nodes[ m_levels[ level - 1u ] + child ] :
+                                m_boxes[ m_indexes[ child ] ];
+                        if ( child == childBegin )
+                        {
+                            bounds = other;
+                            continue;
+                        }
+                        for ( size_t j = 0; j < dimension; ++j )
+                        {
+                            bounds[ j ].first  = std::min( bounds[ j ].first,
+                                                           other[ j ].first );
+                            bounds[ j ].second = std::max( bounds[ j ].second,
+                                                           other[ j ].second );
+                        }
+                    }
+                }
+            } );
+
+        children = numNodes;
+    }
+    while ( children > 1u );
+}
+
+template< typename T >
+Types::Neighbour
+KDBoxTree< T >::nearestBoxHelper( const Types::Point< T >& pointOfInterest ) const
+{
+    Types::Neighbour best( std::numeric_limits< double >::infinity(),
+                           Constants::KDTREE_ERROR_INDEX );
+
+    // Depth-first, children sorted so the nearest is searched first.
+    // Every level leaves at most fanout - 1 siblings pending
+    std::vector< std::pair< double, std::pair< size_t, size_t > > > stack;
+    stack.push_back( std::make_pair(
+            Utils::squaredDistanceToBox( pointOfInterest, m_nodes.back() ),
+            std::make_pair( m_levels.size() - 2u, static_cast< size_t >( 0u ) ) ) );
+
+    while ( !stack.empty() )
+    {
+        const std::pair< double, std::pair< size_t, size_t > > top =
+                stack.back();
+        stack.pop_back();
+
+        // Equally distant nodes may still hold a smaller index
+        if ( top.first > best.first )
+        {
+            continue;
+        }
+
+        const size_t level = top.second.first;
+        const size_t node  = top.second.second;
+        const size_t first = stack.size();
+        for ( size_t child = node * Constants::KDTREE_BOX_TREE_FANOUT;
+              child < childrenEnd( level, node ); ++child )
+        {
+            if ( !level )
+            {
+                const Types::Neighbour candidate(
+                        Utils::squaredDistanceToBox(
+                                pointOfInterest,
+                                m_boxes[ m_indexes[ child ] ] ),
+                        m_indexes[ child ] );
+                best = std::min( best, candidate );
+                continue;
+            }
+
+            const double bound = Utils::squaredDistanceToBox(
+                    pointOfInterest,
+                    m_nodes[ m_levels[ level - 1u ] + child ] );
+            if ( bound <= best.first )
+            {
+                stack.push_back( std::make_pair(
+                        bound, std::make_pair( level - 1u, child ) ) );
+            }
+        }
+
+        std::sort( stack.begin() + first, stack.end(),
+                   []( const std::pair< double, std::pair< size_t, size_t > >& lhs,
+                       const std::pair< double, std::pair< size_t, size_t > >& rhs )
+                   {
+                       return lhs.first > rhs.first;
+                   } );
+    }
+
+    return best;
+}
+
+template< typename T >
+size_t
+KDBoxTree< T >::childrenEnd( const size_t level, const size_t node ) const
+{
+    const size_t numChildren = level ?
+            m_levels[ level ] - m_levels[ level - 1u ] :
+            m_boxes.size();
+
+    return std::min( numChildren,
+                     ( node + 1u ) * Constants::KDTREE_BOX_TREE_FANOUT );
+}
+
+template< typename T >
+template< typename Visit, typename Report >
+void
+KDBoxTree< T >::traverse( Visit visit, Report report ) const
+{
+    if ( !visit( m_nodes.back() ) )
+    {
+        return;
+    }
+
+    std::vector< std::pair< size_t, size_t > > stack;
+    stack.push_back( std::make_pair( m_levels.size() - 2u,
+                                     static_cast< size_t >( 0u ) ) );
+
+    while ( !stack.empty() )
+    {
+        const size_t level = stack.back().first;
+        const size_t node  = stack.back().second;
+        stack.pop_back();
+
+        for ( size_t child = node * Constants::KDTREE_BOX_TREE_FANOUT;
+              child < childrenEnd( level, node ); ++child )
+        {
+            if ( !level )
+            {
+                report( m_indexes[ child ] );
+            }
+            else if ( visit( m_nodes[ m_levels[ level - 1u ] + child ] ) )
+            {
+                stack.push_back( std::make_pair( level - 1u, child ) );
+            }
+        }
+    }
+}
+
+template< typename T >
+bool
+KDBoxTree< T >::valid( const Types::AxisMinMax< T >& box )
+{
+    for ( size_t i = 0; i < box.size(); ++i )
+    {
+        if ( !( box[ i ].first <= box[ i ].second ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+template< typename T >
+std::ostream& operator<<( std::ostream& lhs, const KDBoxTree< T >& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
+
+#endif // KDTREE_BOX_TREE_H
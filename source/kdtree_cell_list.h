@@ -0,0 +1,747 @@
+#ifndef KDTREE_CELL_LIST_H
+#define KDTREE_CELL_LIST_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "kdtree_types.h"
+#include "kdtree_utils.h"
+#include "kdtree_status.h"
+#include "kdtree_constants.h"
+#include "kdtree_parallel.h"
+#include "kdtree_knn_graph.h"
+
+namespace datastructures {
+
+// PURPOSE:
+//
+// A uniform cell list for fixed radius neighbour searches under the
+// Euclidean metric, the usual structure of particle simulations with a
+// known cutoff. Space is cut into cubic cells of a given side, normally
+// the cutoff, and the points are counting sorted by cell, so the points
+// of a cell are contiguous and a search with a radius of one cell side
+// only scans 3^D cells around the query.
+//
+// Cells are addressed densely while the bounding box of the points holds
+// at most Constants::KDTREE_CELL_LIST_CELLS_PER_POINT cells per point.
+// Sparser data is hashed into a table of about one bucket per point;
+// cells sharing a bucket only cost extra distance checks.
+//
+// Whether the cell list or a KDTree is the better choice for a given
+// radius can be asked from gridRecommended().
+//
+template< typename T >
+class CellListIndex {
+public:
+    // CREATORS
+    CellListIndex();
+        // Default constructor, creates an empty index
+
+    // PRIMARY INTERFACE
+    KDStatus build( const Types::Points< T >& points,
+                    const double              cellSize,
+                    const size_t              numThreads = 0u );
+        // Indexes points in cells of side cellSize. Cells of the points
+        // are computed by several threads, the counting sort itself is
+        // sequential and stable, so points of a cell keep their order.
+        // numThreads of 0 uses all hardware threads.
+        // Returns KDStatus::Code::CARDINALITY_MISMATCH for points of
+        // different dimensions and KDStatus::Code::SIZE_LIMIT for more
+        // than 2^32 - 1 points or a cell size that is not positive and
+        // finite, leaving the index empty.
+
+    void clear();
+        // Empties the index
+
+    Types::Indexes pointIndexesInRadius(
+            const Types::Point< T >& pointOfInterest,
+            const double             radius ) const;
+        // Returns indexes of all points whose distance to the point of
+        // interest is less or equal to radius, in no particular order. In
+        // case the index is empty, radius is negative or there is a
+        // cardinality mismatch - empty container is returned.
+        // Safe to call concurrently from several threads.
+
+    KDKnnGraph neighbourLists( const double radius,
+                               const size_t numThreads = 0u ) const;
+        // Builds the neighbour lists of all the points: the points within
+        // radius of every point, excluding the point itself, sorted by
+        // increasing distance and then index. Points are processed in cell
+        // order by several threads, so neighbouring searches share cells.
+        // numThreads of 0 uses all hardware threads.
+        // Returns empty graph for a negative radius.
+
+    static bool gridRecommended( const Types::Points< T >& points,
+                                 const double              radius );
+        // Returns true if a cell list with cells of side radius is
+        // expected to answer searches of that radius faster than a
+        // KDTree, judged from the density of the points in their bounding
+        // box. Dense enough points, whose cells are addressed densely,
+        // favour the cell list up to
+        // Constants::KDTREE_CELL_LIST_MAX_DIMENSION. Sparser points make
+        // every search probe 3^D mostly empty hashed cells, which only
+        // pays off while 3^D stays within twice the depth of the tree.
+
+    size_t size() const;
+        // Returns number of indexed points
+
+    size_t dimension() const;
+        // Returns dimension of the indexed points
+
+    double cellSize() const;
+        // Returns side of the cells
+
+    size_t numBuckets() const;
+        // Returns number of cells, or of hash buckets of a hashed index
+
+    bool hashed() const;
+        // Returns true if cells are hashed rather than addressed densely
+
+    // ACCESSORS
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the summary of the CellListIndex object in a easy to
+        // read format
+
+private:
+    size_t cellOf( const double coordinate, const size_t axis ) const;
+        // Returns cell of coordinate along axis, clamped to the grid
+
+    size_t bucketOf( const size_t* cell ) const;
+        // Returns bucket of the cell with the provided cell coordinates
+
+    template< typename Func >
+    void forEachCandidateRange( const T*               point,
+                                const double           radius,
+                                std::vector< size_t >& scratch,
+                                Func                   func ) const;
+        // Invokes func( begin, end ) for ranges of sorted positions
+        // covering every point within radius of point, each position at
+        // most once. scratch holds the cell ranges and the buckets of a
+        // hashed index, it is reused between calls.
+
+    size_t                    m_dimension;
+        // Dimension of the points
+
+    double                    m_cellSize;
+        // Side of the cells, 0 for an empty index
+
+    double                    m_inverseCellSize;
+        // Cells per unit length
+
+    std::vector< double >     m_origin;
+        // Low corner of the bounding box of the points
+
+    std::vector< size_t >     m_cellsPerAxis;
+        // Cells covering the bounding box along every axis
+
+    std::vector< size_t >     m_strides;
+        // Bucket distance of neighbouring cells along every axis of a
+        // dense index, axis 0 varying fastest
+
+    bool                      m_hashed;
+        // True if cells are hashed into buckets
+
+    std::vector< uint32_t >   m_offsets;
+        // Sorted position of the first point of every bucket, followed
+        // by the number of points
+
+    std::vector< uint32_t >   m_indexes;
+        // Original index of every sorted point
+
+    std::vector< T >          m_coordinates;
+        // Coordinates of the sorted points, m_dimension values each
+};
+
+// INDEPENDENT OPERATORS
+template< typename T >
+std::ostream& operator<<( std::ostream& lhs, const CellListIndex< T >& rhs );
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+template< typename T >
+CellListIndex< T >::CellListIndex()
+: m_dimension( 0u )
+, m_cellSize( 0.0L )
+, m_inverseCellSize( 0.0L )
+, m_hashed( false )
+{
+    // nothing to do here
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+KDStatus
+CellListIndex< T >::build( const Types::Points< T >& points,
+                           const double              cellSize,
+                           const size_t              numThreads )
+{
+    clear();
+
+    const size_t size = points.size();
+
+    // Sanity
+    if ( size > std::numeric_limits< uint32_t >::max() )
+    {
+        return KDStatus( KDStatus::Code::SIZE_LIMIT,
+                         "cell list supports at most 2^32 - 1 points" );
+    }
+
+    if ( !( cellSize > 0.0L ) || !std::isfinite( cellSize ) )
+    {
+        return KDStatus( KDStatus::Code::SIZE_LIMIT,
+                         "cell size must be positive and finite" );
+    }
+
+    if ( !size )
+    {
+        return KDStatus();
+    }
+
+    const size_t dimension = points[ 0 ].size();
+    for ( size_t i = 1; i < size; ++i )
+    {
+        if ( points[ i ].size() != dimension )
+        {
+            return KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                             "points of different dimensions", i + 1u );
+        }
+    }
+
+    const Types::AxisMinMax< T > bounds = Utils::minMaxPerAxis( points );
+
+    m_dimension       = dimension;
+    m_cellSize        = cellSize;
+    m_inverseCellSize = 1.0L / cellSize;
+    m_origin.resize( dimension );
+    m_cellsPerAxis.resize( dimension );
+    m_strides.resize( dimension );
+
+    // Cells per axis are capped well below overflow of the cell
+    // coordinates, such axes are only ever hashed
+    double numCells = 1.0L;
+    for ( size_t i = 0; i < dimension; ++i )
+    {
+        const double extent = static_cast< double >( bounds[ i ].second ) -
+                              bounds[ i ].first;
+        const double cells  = std::min( std::floor( extent * m_inverseCellSize ),
+                                        static_cast< double >( 1ull << 48 ) );
+
+        m_origin[ i ]       = bounds[ i ].first;
+        m_cellsPerAxis[ i ] = static_cast< size_t >( cells ) + 1u;
+        m_strides[ i ]      = i ? m_strides[ i - 1u ] * m_cellsPerAxis[ i - 1u ]
+                                : 1u;
+        numCells *= m_cellsPerAxis[ i ];
+    }
+
+    size_t numBuckets = 0u;
+    if ( numCells <= static_cast< double >( size ) *
+                     Constants::KDTREE_CELL_LIST_CELLS_PER_POINT &&
+         numCells <= std::numeric_limits< uint32_t >::max() )
+    {
+        numBuckets = static_cast< size_t >( numCells );
+    }
+    else
+    {
+        m_hashed   = true;
+        numBuckets = 1u;
+        while ( numBuckets < size )
+        {
+            numBuckets <<= 1;
+        }
+    }
+
+    // Bucket masks of hashed cells derive from the offsets
+    m_offsets.assign( numBuckets + 1u, 0u );
+
+    std::vector< uint32_t > buckets( size );
+    Parallel::forEachRange( size, numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            std::vector< size_t > cell( dimension );
+            for ( size_t i = begin; i < end; ++i )
+            {
+                for ( size_t j = 0; j < dimension; ++j )
+                {
+                    cell[ j ] = cellOf( points[ i ][ j ], j );
+                }
+                buckets[ i ] = static_cast< uint32_t >( bucketOf( cell.data() ) );
+            }
+        } );
+
+    // Counting sort by bucket
+    for ( size_t i = 0; i < size; ++i )
+    {
+        ++m_offsets[ buckets[ i ] + 1u ];
+    }
+    for ( size_t bucket = 0; bucket < numBuckets; ++bucket )
+    {
+        m_offsets[ bucket + 1u ] += m_offsets[ bucket ];
+    }
+
+    m_indexes.resize( size );
+    {
+        std::vector< uint32_t > next( m_offsets.begin(), m_offsets.end() - 1 );
+        for ( size_t i = 0; i < size; ++i )
+        {
+            m_indexes[ next[ buckets[ i ] ]++ ] = static_cast< uint32_t >( i );
+        }
+    }
+
+    m_coordinates.resize( size * dimension );
+    Parallel::forEachRange( size, numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                std::copy( points[ m_indexes[ i ] ].begin(),
+                           points[ m_indexes[ i ] ].end(),
+                           m_coordinates.begin() + i * dimension );
+            }
+        } );
+
+    return KDStatus();
+}
+
+template< typename T >
+void
+CellListIndex< T >::clear()
+{
+    m_dimension       = 0u;
+    m_cellSize        = 0.0L;
+    m_inverseCellSize = 0.0L;
+    m_hashed          = false;
+    m_origin.clear();
+    m_cellsPerAxis.clear();
+    m_strides.clear();
+    m_offsets.clear();
+    m_indexes.clear();
+    m_coordinates.clear();
+}
+
+template< typename T >
+Types::Indexes
+CellListIndex< T >::pointIndexesInRadius(
+        const Types::Point< T >& pointOfInterest,
+        const double             radius ) const
+{
+    Types::Indexes result;
+
+    // Sanity
+    if ( m_indexes.empty() ||
+         m_dimension != pointOfInterest.size() ||
+         radius < 0.0L )
+    {
+        return result;
+    }
+
+    const double maxRank = radius * radius;
+    std::vector< size_t > scratch;
+
+    forEachCandidateRange( pointOfInterest.data(), radius, scratch,
+        [ & ]( const size_t begin, const size_t end )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                const T* candidate = &m_coordinates[ i * m_dimension ];
+
+                double rank = 0.0L;
+                for ( size_t j = 0; j < m_dimension; ++j )
+                {
+                    const double temp =
+                            static_cast< double >( candidate[ j ] ) -
+                            pointOfInterest[ j ];
+                    rank += temp * temp;
+                }
+
+                if ( rank <= maxRank )
+                {
+                    result.push_back( m_indexes[ i ] );
+                }
+            }
+        } );
+
+    return result;
+}
+
+template< typename T >
+KDKnnGraph
+CellListIndex< T >::neighbourLists( const double radius,
+                                    const size_t numThreads ) const
+{
+    const size_t size = m_indexes.size();
+
+    // Sanity
+    if ( radius < 0.0L )
+    {
+        return KDKnnGraph();
+    }
+
+    if ( !size )
+    {
+        return KDKnnGraph( std::vector< uint64_t >( 1u, 0u ) );
+    }
+
+    // Rows of every chunk, in processing order
+    struct Rows {
+        std::vector< uint32_t > vertices;
+        std::vector< uint32_t > degrees;
+        std::vector< uint32_t > neighbours;
+        std::vector< float >    distances;
+    };
+
+    const double maxRank = radius * radius;
+    std::vector< Rows > rows( std::min( Parallel::numThreads( numThreads ),
+                                        size ) );
+
+    Parallel::forEachRange( size, rows.size(),
+        [ & ]( const size_t begin, const size_t end, const size_t chunk )
+        {
+            Rows& local = rows[ chunk ];
+            std::vector< size_t > scratch;
+            std::vector< std::pair< double, uint32_t > > found;
+
+            for ( size_t i = begin; i < end; ++i )
+            {
+                const T* point = &m_coordinates[ i * m_dimension ];
+                found.clear();
+
+                forEachCandidateRange( point, radius, scratch,
+                    [ & ]( const size_t rangeBegin, const size_t rangeEnd )
+                    {
+                        for ( size_t c = rangeBegin; c < rangeEnd; ++c )
+                        {
+                            const T* candidate = &m_coordinates[ c * m_dimension ];
+
+                            double rank = 0.0L;
+                            for ( size_t j = 0; j < m_dimension; ++j )
+                            {
+                                const double temp =
+                                        static_cast< double >( candidate[ j ] ) -
+                                        point[ j ];
+                                rank += temp * temp;
+                            }
+
+                            if ( rank <= maxRank && c != i )
+                            {
+                                found.push_back( std::make_pair(
+                                        rank, m_indexes[ c ] ) );
+                            }
+                        }
+                    } );
+
+                std::sort( found.begin(), found.end() );
+
+                local.vertices.push_back( m_indexes[ i ] );
+                local.degrees.push_back(
+                        static_cast< uint32_t >( found.size() ) );
+                for ( size_t k = 0; k < found.size(); ++k )
+                {
+                    local.neighbours.push_back( found[ k ].second );
+                    local.distances.push_back(
+                            static_cast< float >(
+                                    std::sqrt( found[ k ].first ) ) );
+                }
+            }
+        } );
+
+    std::vector< uint64_t > offsets( size + 1u, 0u );
+    for ( size_t chunk = 0; chunk < rows.size(); ++chunk )
+    {
+        for ( size_t row = 0; row < rows[ chunk ].vertices.size(); ++row )
+        {
+            offsets[ rows[ chunk ].vertices[ row ] + 1u ] =
+                    rows[ chunk ].degrees[ row ];
+        }
+    }
+    for ( size_t i = 0; i < size; ++i )
+    {
+        offsets[ i + 1u ] += offsets[ i ];
+    }
+
+    KDKnnGraph graph( offsets );
+
+    Parallel::forEachRange( rows.size(), rows.size(),
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t chunk = begin; chunk < end; ++chunk )
+            {
+                const Rows& local = rows[ chunk ];
+                size_t position = 0u;
+                for ( size_t row = 0; row < local.vertices.size(); ++row )
+                {
+                    const size_t degree = local.degrees[ row ];
+                    std::copy( local.neighbours.begin() + position,
+                               local.neighbours.begin() + position + degree,
+                               graph.neighbours( local.vertices[ row ] ) );
+                    std::copy( local.distances.begin() + position,
+                               local.distances.begin() + position + degree,
+                               graph.distances( local.vertices[ row ] ) );
+                    position += degree;
+                }
+            }
+        } );
+
+    return graph;
+}
+
+template< typename T >
+bool
+CellListIndex< T >::gridRecommended( const Types::Points< T >& points,
+                                     const double              radius )
+{
+    const size_t dimension = points.empty() ? 0u : points[ 0 ].size();
+
+    if ( !dimension ||
+         dimension > Constants::KDTREE_CELL_LIST_MAX_DIMENSION ||
+         !( radius > 0.0L ) )
+    {
+        return false;
+    }
+
+    const Types::AxisMinMax< T > bounds = Utils::minMaxPerAxis( points );
+    const double size = static_cast< double >( points.size() );
+
+    double numCells = 1.0L;
+    for ( size_t i = 0; i < dimension; ++i )
+    {
+        const double extent = static_cast< double >( bounds[ i ].second ) -
+                              bounds[ i ].first;
+        numCells *= std::floor( extent / radius ) + 1.0L;
+    }
+
+    if ( numCells <= size * Constants::KDTREE_CELL_LIST_CELLS_PER_POINT )
+    {
+        return true;
+    }
+
+    return std::pow( 3.0L, static_cast< double >( dimension ) ) <=
+           2.0L * std::log2( size );
+}
+
+template< typename T >
+size_t
+CellListIndex< T >::size() const
+{
+    return m_indexes.size();
+}
+
+template< typename T >
+size_t
+CellListIndex< T >::dimension() const
+{
+    return m_dimension;
+}
+
+template< typename T >
+double
+CellListIndex< T >::cellSize() const
+{
+    return m_cellSize;
+}
+
+template< typename T >
+size_t
+CellListIndex< T >::numBuckets() const
+{
+    return m_offsets.empty() ? 0u : m_offsets.size() - 1u;
+}
+
+template< typename T >
+bool
+CellListIndex< T >::hashed() const
+{
+    return m_hashed;
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+template< typename T >
+std::ostream&
+CellListIndex< T >::print( std::ostream& out ) const
+{
+    out << "CellListIndex:[ "
+        << "size = "      << std::dec << size()       << ", "
+        << "dimension = " << std::dec << m_dimension  << ", "
+        << "cell size = " << m_cellSize               << ", "
+        << "buckets = "   << std::dec << numBuckets() << ", "
+        << "hashed = "    << ( m_hashed ? "yes" : "no" ) << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  PRIVATE METHODS
+//============================================================================
+
+template< typename T >
+size_t
+CellListIndex< T >::cellOf( const double coordinate, const size_t axis ) const
+{
+    const double cell = std::floor( ( coordinate - m_origin[ axis ] ) *
+                                    m_inverseCellSize );
+
+    if ( !( cell > 0.0L ) )
+    {
+        return 0u;
+    }
+
+    if ( cell >= static_cast< double >( m_cellsPerAxis[ axis ] - 1u ) )
+    {
+        return m_cellsPerAxis[ axis ] - 1u;
+    }
+
+    return static_cast< size_t >( cell );
+}
+
+template< typename T >
+size_t
+CellListIndex< T >::bucketOf( const size_t* cell ) const
+{
+    if ( !m_hashed )
+    {
+        size_t bucket = 0u;
+        for ( size_t i = 0; i < m_dimension; ++i )
+        {
+            bucket += cell[ i ] * m_strides[ i ];
+        }
+        return bucket;
+    }
+
+    uint64_t hash = 0u;
+    for ( size_t i = 0; i < m_dimension; ++i )
+    {
+        hash = ( hash ^ static_cast< uint64_t >( cell[ i ] ) ) *
+               0x9E3779B97F4A7C15ull;
+    }
+    hash ^= hash >> 32;
+
+    return static_cast< size_t >( hash & ( m_offsets.size() - 2u ) );
+}
+
+template< typename T >
+template< typename Func >
+void
+CellListIndex< T >::forEachCandidateRange( const T*               point,
+                                           const double           radius,
+                                           std::vector< size_t >& scratch,
+                                           Func                   func ) const
+{
+    // Cell ranges are widened by a relative margin so that rounding of
+    // point +/- radius never drops a point at exactly radius. Queries
+    // away from the grid are clamped to its border cells.
+    const double reach = radius * ( 1.0L + 1e-9 );
+
+    scratch.resize( 3u * m_dimension );
+    size_t* lows  = scratch.data();
+    size_t* highs = lows + m_dimension;
+    size_t* cells = highs + m_dimension;
+
+    double numCells = 1.0L;
+    for ( size_t i = 0; i < m_dimension; ++i )
+    {
+        lows[ i ]  = cellOf( static_cast< double >( point[ i ] ) - reach, i );
+        highs[ i ] = cellOf( static_cast< double >( point[ i ] ) + reach, i );
+        cells[ i ] = lows[ i ];
+        numCells *= highs[ i ] - lows[ i ] + 1u;
+    }
+
+    const size_t numBuckets = m_offsets.size() - 1u;
+
+    if ( !m_hashed )
+    {
+        // Cells along axis 0 are consecutive buckets, every row of them
+        // is a single range of positions
+        if ( !m_dimension )
+        {
+            func( static_cast< size_t >( 0u ),
+                  static_cast< size_t >( m_offsets.back() ) );
+            return;
+        }
+
+        while ( true )
+        {
+            const size_t first = bucketOf( cells );
+            func( static_cast< size_t >( m_offsets[ first ] ),
+                  static_cast< size_t >(
+                          m_offsets[ first + highs[ 0 ] - lows[ 0 ] + 1u ] ) );
+
+            size_t axis = 1u;
+            while ( axis < m_dimension && cells[ axis ] == highs[ axis ] )
+            {
+                cells[ axis ] = lows[ axis ];
+                ++axis;
+            }
+            if ( axis >= m_dimension )
+            {
+                return;
+            }
+            ++cells[ axis ];
+        }
+    }
+
+    // Scanning every point beats visiting more cells than buckets
+    if ( numCells >= static_cast< double >( numBuckets ) )
+    {
+        func( static_cast< size_t >( 0u ),
+              static_cast< size_t >( m_offsets.back() ) );
+        return;
+    }
+
+    // Buckets are collected behind the cell ranges
+    const size_t first = scratch.size();
+    while ( true )
+    {
+        scratch.push_back( bucketOf( scratch.data() + 2u * m_dimension ) );
+        lows  = scratch.data();
+        highs = lows + m_dimension;
+        cells = highs + m_dimension;
+
+        size_t axis = 0u;
+        while ( axis < m_dimension && cells[ axis ] == highs[ axis ] )
+        {
+            cells[ axis ] = lows[ axis ];
+            ++axis;
+        }
+        if ( axis >= m_dimension )
+        {
+            break;
+        }
+        ++cells[ axis ];
+    }
+
+    // Cells sharing a bucket are scanned once
+    std::sort( scratch.begin() + first, scratch.end() );
+    scratch.erase( std::unique( scratch.begin() + first, scratch.end() ),
+                   scratch.end() );
+
+    for ( size_t i = first; i < scratch.size(); ++i )
+    {
+        func( static_cast< size_t >( m_offsets[ scratch[ i ] ] ),
+              static_cast< size_t >( m_offsets[ scratch[ i ] + 1u ] ) );
+    }
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+template< typename T >
+std::ostream& operator<<( std::ostream& lhs, const CellListIndex< T >& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
+
+#endif // KDTREE_CELL_LIST_H
@@ -0,0 +1,5 @@
+#include "kdtree_clustering.h"
+
+namespace datastructures {
+
+} // namespace datastructures
@@ -0,0 +1,251 @@
+#ifndef KDTREE_CLUSTERING_H
+#define KDTREE_CLUSTERING_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "kdtree.h"
+#include "kdtree_types.h"
+#include "kdtree_constants.h"
+#include "kdtree_parallel.h"
+#include "kdtree_union_find.h"
+
+// @Purpose
+//
+// This struct provides clustering algorithms that run directly on top of an
+// already built KDTree. Both algorithms only use the radius search and point
+// storage of the tree, issue their region queries from several threads and
+// merge neighbourhoods with a concurrent KDUnionFind.
+//
+// Results do not depend on the number of threads used.
+
+namespace datastructures {
+
+struct Clustering {
+    // PRIMARY INTERFACE
+    template< typename T, typename SplitPolicy, typename Metric >
+    static Types::Indexes dbscan(
+            const KDTree< T, SplitPolicy, Metric >& tree,
+            const double                            epsilon,
+            const size_t                            minPoints,
+            const size_t                            numThreads = 0u );
+        // Runs DBSCAN over all the points stored in the tree. A point is a
+        // core point if at least minPoints points (itself included) lie
+        // within epsilon of it. Returns a label per point index: clusters
+        // are numbered from 0 in the order of their smallest core point,
+        // noise is labeled with Constants::KDTREE_NOISE_LABEL. A border
+        // point reachable from several clusters joins the one of its
+        // smallest core neighbour.
+        // numThreads of 0 uses all hardware threads.
+
+    template< typename T, typename SplitPolicy, typename Metric >
+    static Types::Clusters euclideanClusters(
+            const KDTree< T, SplitPolicy, Metric >& tree,
+            const double                            tolerance,
+            const size_t                            minSize,
+            const size_t                            maxSize,
+            const size_t                            numThreads = 0u );
+        // Single-linkage Euclidean cluster extraction: two points belong to
+        // the same cluster if they are connected by a chain of points with
+        // consecutive distances of at most tolerance. Only clusters with
+        // size in [ minSize, maxSize ] are returned, each as a sorted list
+        // of point indexes. Clusters are ordered by decreasing size, ties
+        // are broken by smallest point index. Distances follow the metric
+        // of the tree, Euclidean by default.
+        // numThreads of 0 uses all hardware threads.
+};
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T, typename SplitPolicy, typename Metric >
+Types::Indexes
+Clustering::dbscan( const KDTree< T, SplitPolicy, Metric >& tree,
+                    const double                            epsilon,
+                    const size_t                            minPoints,
+                    const size_t                            numThreads )
+{
+    const size_t size = tree.size();
+
+    Types::Indexes labels( size, Constants::KDTREE_NOISE_LABEL );
+
+    // Sanity
+    if ( !size || epsilon < 0.0L )
+    {
+        return labels;
+    }
+
+    // First find core points
+    std::vector< char > isCore( size, 0 );
+
+    Parallel::forEachRange( size, numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                isCore[ i ] = tree.pointIndexesInRadius(
+                        tree.point( i ), epsilon ).size() >= minPoints;
+            }
+        } );
+
+    // Second connect core points and attach border points to the
+    // smallest core point that reaches them
+    KDUnionFind unionFind( size );
+    std::unique_ptr< std::atomic< size_t >[] > owners(
+            new std::atomic< size_t >[ size ] );
+    for ( size_t i = 0; i < size; ++i )
+    {
+        owners[ i ].store( Constants::KDTREE_ERROR_INDEX,
+                           std::memory_order_relaxed );
+    }
+
+    Parallel::forEachRange( size, numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                if ( !isCore[ i ] )
+                {
+                    continue;
+                }
+
+                const Types::Indexes neighbours =
+                        tree.pointIndexesInRadius( tree.point( i ), epsilon );
+
+                for ( typename Types::Indexes::const_iterator it =
+                              neighbours.cbegin();
+                      it != neighbours.cend(); ++it )
+                {
+                    if ( isCore[ *it ] )
+                    {
+                        if ( *it > i )
+                        {
+                            unionFind.unite( i, *it );
+                        }
+                        continue;
+                    }
+
+                    size_t owner = owners[ *it ].load(
+                            std::memory_order_relaxed );
+                    while ( i < owner &&
+                            !owners[ *it ].compare_exchange_weak( owner, i ) )
+                    {
+                        // owner is reloaded by the failed exchange
+                    }
+                }
+            }
+        } );
+
+    // Third number clusters by their smallest core point
+    Types::Indexes clusterIds( size, Constants::KDTREE_NOISE_LABEL );
+    size_t numClusters = 0;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        if ( isCore[ i ] && unionFind.find( i ) == i )
+        {
+            clusterIds[ i ] = numClusters++;
+        }
+    }
+
+    for ( size_t i = 0; i < size; ++i )
+    {
+        if ( isCore[ i ] )
+        {
+            labels[ i ] = clusterIds[ unionFind.find( i ) ];
+            continue;
+        }
+
+        const size_t owner = owners[ i ].load( std::memory_order_relaxed );
+        if ( Constants::KDTREE_ERROR_INDEX != owner )
+        {
+            labels[ i ] = clusterIds[ unionFind.find( owner ) ];
+        }
+    }
+
+    return labels;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+Types::Clusters
+Clustering::euclideanClusters(
+        const KDTree< T, SplitPolicy, Metric >& tree,
+        const double                            tolerance,
+        const size_t                            minSize,
+        const size_t                            maxSize,
+        const size_t                            numThreads )
+{
+    const size_t size = tree.size();
+
+    Types::Clusters clusters;
+
+    // Sanity
+    if ( !size || tolerance < 0.0L || minSize > maxSize )
+    {
+        return clusters;
+    }
+
+    KDUnionFind unionFind( size );
+
+    Parallel::forEachRange( size, numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                const Types::Indexes neighbours =
+                        tree.pointIndexesInRadius( tree.point( i ),
+                                                   tolerance );
+
+                for ( typename Types::Indexes::const_iterator it =
+                              neighbours.cbegin();
+                      it != neighbours.cend(); ++it )
+                {
+                    if ( *it > i )
+                    {
+                        unionFind.unite( i, *it );
+                    }
+                }
+            }
+        } );
+
+    // Gather members per representative, representatives are the smallest
+    // members so clusters come out ordered by their smallest index
+    Types::Indexes clusterIds( size, Constants::KDTREE_ERROR_INDEX );
+    for ( size_t i = 0; i < size; ++i )
+    {
+        const size_t root = unionFind.find( i );
+
+        if ( Constants::KDTREE_ERROR_INDEX == clusterIds[ root ] )
+        {
+            clusterIds[ root ] = clusters.size();
+            clusters.push_back( Types::Indexes() );
+        }
+
+        clusters[ clusterIds[ root ] ].push_back( i );
+    }
+
+    Types::Clusters result;
+    for ( typename Types::Clusters::iterator it = clusters.begin();
+          it != clusters.end(); ++it )
+    {
+        if ( it->size() >= minSize && it->size() <= maxSize )
+        {
+            result.push_back( Types::Indexes() );
+            result.back().swap( *it );
+        }
+    }
+
+    std::stable_sort( result.begin(), result.end(),
+                      []( const Types::Indexes& lhs,
+                          const Types::Indexes& rhs )
+                      {
+                          return lhs.size() > rhs.size();
+                      } );
+
+    return result;
+}
+
+} // namespace datastructures
+
+#endif //KDTREE_CLUSTERING_H
@@ -25,9 +25,21 @@ const double Constants::KDTREE_INVALID_DISTANCE
 const double Constants::KDTREE_MAX_DISTANCE
     = std::numeric_limits< double >::max();
 
+const double Constants::KDTREE_INVALID_DENSITY
+    = -1.0L;
+
+const double Constants::KDTREE_KERNEL_UNDERFLOW_EXPONENT
+    = 745.2L;
+
 const size_t Constants::KDTREE_ERROR_INDEX
     = std::numeric_limits< size_t >::max() - 2;
 
+const size_t Constants::KDTREE_NOISE_LABEL
+    = std::numeric_limits< size_t >::max() - 3;
+
+const std::string Constants::KDTREE_KNN_GRAPH_MAGIC
+    = "KDKNNG01";
+
 const std::string Constants::KDTREE_HYPERPLANE_MARKER
     = "HYPERPLANE";
 
@@ -37,4 +49,91 @@ const std::string Constants::KDTREE_LEAF_MARKER
 const std::string Constants::KDTREE_EMPTY_MARKER
     = "EMPTY TREE";
 
+const std::string Constants::KDTREE_PERMUTATION_MARKER
+    = "PERMUTATION";
+
+const size_t Constants::KDTREE_IO_BLOCK_SIZE
+    = 1u << 20;
+
+const size_t Constants::KDTREE_IO_QUEUE_DEPTH
+    = 32u;
+
+const size_t Constants::KDTREE_IO_ALIGNMENT
+    = 4096u;
+
+const std::string Constants::KDTREE_LOG_SUFFIX
+    = ".log";
+
+const std::string Constants::KDTREE_COMPACTION_SUFFIX
+    = ".compacting";
+
+const std::string Constants::KDTREE_LOG_MARKER
+    = "KDLOG";
+
+const std::string Constants::KDTREE_LOG_INSERT_MARKER
+    = "INSERT";
+
+const std::string Constants::KDTREE_LOG_ERASE_MARKER
+    = "ERASE";
+
+const size_t Constants::KDTREE_LOG_COMPACTION_THRESHOLD
+    = 1u << 16;
+
+const size_t Constants::KDTREE_CACHE_CAPACITY
+    = 1u << 20;
+
+const size_t Constants::KDTREE_CACHE_SHARDS
+    = 16u;
+
+const double Constants::KDTREE_CACHE_RELATIVE_MARGIN
+    = 1e-9;
+
+const size_t Constants::KDTREE_GRID_POINTS_PER_CELL
+    = 8u;
+
+const size_t Constants::KDTREE_GRID_MAX_CELLS
+    = 1u << 20;
+
+const size_t Constants::KDTREE_GRID_MAX_DIMENSION
+    = 4u;
+
+const double Constants::KDTREE_CELL_LIST_CELLS_PER_POINT
+    = 8.0L;
+
+const size_t Constants::KDTREE_CELL_LIST_MAX_DIMENSION
+    = 6u;
+
+const std::string Constants::KDTREE_OCTREE_VARIETY
+    = "Octree Implementation";
+
+const size_t Constants::KDTREE_OCTREE_BUCKET_SIZE
+    = 16u;
+
+const std::string Constants::KDTREE_BOX_TREE_VARIETY
+    = "KDBoxTree Implementation";
+
+const size_t Constants::KDTREE_BOX_TREE_FANOUT
+    = 16u;
+
+const double Constants::KDTREE_MAX_CHILD_SHARE
+    = 0.75L;
+
+const double Constants::KDTREE_LOOSE_CELL_MARGIN
+    = 0.25L;
+
+const double Constants::KDTREE_UPDATE_REBUILD_SHARE
+    = 0.25L;
+
+const size_t Constants::KDTREE_BLOCKED_SEARCH_MIN_DIMENSION
+    = 32u;
+
+const size_t Constants::KDTREE_BLOCKED_SEARCH_MAX_POINTS
+    = 65536u;
+
+const size_t Constants::KDTREE_BLOCKED_SEARCH_QUERIES
+    = 32u;
+
+const size_t Constants::KDTREE_BLOCKED_SEARCH_BLOCK_BYTES
+    = 262144u;
+
 } // namespace datastructures
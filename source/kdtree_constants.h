@@ -34,11 +34,29 @@ struct Constants {
         // calculate distance between points of different
         // cardinality
 
+    static const double KDTREE_INVALID_DENSITY;
+        // Denotes an error output resulting from an attempt to estimate
+        // density with a non-positive bandwidth or at a point of
+        // mismatching cardinality
+
+    static const double KDTREE_KERNEL_UNDERFLOW_EXPONENT;
+        // Denotes the exponent x beyond which exp( -x ) underflows to zero
+        // in double precision, used to skip subtrees that cannot
+        // contribute to a kernel sum
+
     static const size_t KDTREE_ERROR_INDEX;
         // Denotes an error output resulting from an attempt to
         // search for a point either on an empty tree on in case of
         // cardinality mismatch
 
+    static const size_t KDTREE_NOISE_LABEL;
+        // Denotes a point that does not belong to any cluster in the
+        // output of density based clustering
+
+    static const std::string KDTREE_KNN_GRAPH_MAGIC;
+        // Denotes the 8 byte header of a binary k-nearest-neighbour
+        // graph file
+
     static const std::string KDTREE_HYPERPLANE_MARKER;
         // Denotes an upcoming hyperplane node line in a serialized
         // file stream
@@ -50,6 +68,119 @@ struct Constants {
     static const std::string KDTREE_EMPTY_MARKER;
         // Denotes a special-case empty node line in a serialized
         // file stream
+
+    static const std::string KDTREE_PERMUTATION_MARKER;
+        // Denotes the optional section following the tree structure in a
+        // serialized file stream, which maps every stored point back to
+        // its original index
+
+    static const size_t KDTREE_IO_BLOCK_SIZE;
+        // Denotes the default number of bytes requested by a single
+        // asynchronous file read
+
+    static const size_t KDTREE_IO_QUEUE_DEPTH;
+        // Denotes the default number of asynchronous file reads kept in
+        // flight
+
+    static const size_t KDTREE_IO_ALIGNMENT;
+        // Denotes the alignment of buffers, offsets and sizes of direct
+        // (O_DIRECT) file reads
+
+    static const std::string KDTREE_LOG_SUFFIX;
+        // Denotes the suffix appended to the name of a base tree file to
+        // name its write-ahead log
+
+    static const std::string KDTREE_COMPACTION_SUFFIX;
+        // Denotes the suffix of the temporary files written by a
+        // compaction before they replace the base tree and its log
+
+    static const std::string KDTREE_LOG_MARKER;
+        // Denotes the first line of a write-ahead log
+
+    static const std::string KDTREE_LOG_INSERT_MARKER;
+        // Denotes a point insertion record in a write-ahead log
+
+    static const std::string KDTREE_LOG_ERASE_MARKER;
+        // Denotes a point deletion record in a write-ahead log
+
+    static const size_t KDTREE_LOG_COMPACTION_THRESHOLD;
+        // Denotes the default number of write-ahead log records that
+        // trigger a background compaction
+
+    static const size_t KDTREE_CACHE_CAPACITY;
+        // Denotes the default number of entries of a query cache
+
+    static const size_t KDTREE_CACHE_SHARDS;
+        // Denotes the number of independently locked parts of a query
+        // cache
+
+    static const double KDTREE_CACHE_RELATIVE_MARGIN;
+        // Denotes the relative margin by which a cell entry of a query
+        // cache must be proven exact, covering rounding of distances
+
+    static const size_t KDTREE_GRID_POINTS_PER_CELL;
+        // Denotes the average number of points per cell aimed at by the
+        // default lookup grid of a KDTree
+
+    static const size_t KDTREE_GRID_MAX_CELLS;
+        // Denotes the largest number of cells of a lookup grid
+
+    static const size_t KDTREE_GRID_MAX_DIMENSION;
+        // Denotes the largest dimension a lookup grid is built for by
+        // default
+
+    static const double KDTREE_CELL_LIST_CELLS_PER_POINT;
+        // Denotes the largest number of cells per point a cell list
+        // addresses densely before hashing its cells
+
+    static const size_t KDTREE_CELL_LIST_MAX_DIMENSION;
+        // Denotes the largest dimension a cell list is recommended for
+        // over a KDTree
+
+    static const std::string KDTREE_OCTREE_VARIETY;
+        // Denotes the type of a serialized Octree
+
+    static const size_t KDTREE_OCTREE_BUCKET_SIZE;
+        // Denotes the largest number of points of an Octree leaf, unless
+        // they share their Morton code
+
+    static const std::string KDTREE_BOX_TREE_VARIETY;
+        // Denotes the type of a serialized KDBoxTree
+
+    static const size_t KDTREE_BOX_TREE_FANOUT;
+        // Denotes the number of boxes of a KDBoxTree leaf and the number of
+        // children of its inner nodes, the last node of a level may have
+        // fewer
+
+    static const double KDTREE_MAX_CHILD_SHARE;
+        // Denotes the largest share of the points of a node KDTree::merge()
+        // and KDTree::eraseIf() let one of its children hold before
+        // rebuilding the node
+
+    static const double KDTREE_LOOSE_CELL_MARGIN;
+        // Denotes the share of the extent of the points per axis the loose
+        // cells of KDTree::update() reach beyond the points on either side
+
+    static const double KDTREE_UPDATE_REBUILD_SHARE;
+        // Denotes the share of the points KDTree::update() moves to another
+        // leaf before rebuilding the tree
+
+    static const size_t KDTREE_BLOCKED_SEARCH_MIN_DIMENSION;
+        // Denotes the dimension from which KDTree::correspondences() of
+        // float and double Euclidean trees compares blocks of queries
+        // against blocks of points instead of searching the tree
+
+    static const size_t KDTREE_BLOCKED_SEARCH_MAX_POINTS;
+        // Denotes the largest number of points of a tree that
+        // KDTree::correspondences() scans by blocks, larger trees are
+        // searched
+
+    static const size_t KDTREE_BLOCKED_SEARCH_QUERIES;
+        // Denotes the number of queries of a block of the blocked search
+
+    static const size_t KDTREE_BLOCKED_SEARCH_BLOCK_BYTES;
+        // Denotes the size in bytes of the coordinates of a block of
+        // points of the blocked search, meant to stay in the L2 cache
 };
 
 } // namespace datastructures
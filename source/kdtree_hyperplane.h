@@ -2,11 +2,13 @@
 #define KDTREE_HYPERPLANE_H
 
 #include <iostream>
-#include <sstream>
 #include <string>
 
 #include "kdtree_types.h"
 #include "kdtree_constants.h"
+#include "kdtree_loader.h"
+#include "kdtree_status.h"
+#include "kdtree_text.h"
 
 namespace datastructures {
 
@@ -25,17 +27,14 @@ public:
                   const T      value );
     // Constructor
 
-    KDHyperplane( const KDHyperplane& other );
-        // Copy constructor, calls copy().
-
-    virtual ~KDHyperplane();
-        // Destructor
+    KDHyperplane( const KDHyperplane& other ) = default;
+    ~KDHyperplane() = default;
+        // Compiler generated copy constructor and destructor, which keep
+        // the hyperplane trivially copyable
 
     // OPERATORS
-    KDHyperplane& operator=( const KDHyperplane& other );
-        // Assignment operator. Calls copy.
-        // Note that this operator performs a shallow copy as its
-        // use is targeted at containers.
+    KDHyperplane& operator=( const KDHyperplane& other ) = default;
+        // Compiler generated assignment operator
 
     bool operator==( const KDHyperplane& other ) const;
         // Equality. Calls equals.
@@ -56,10 +55,17 @@ public:
     const std::string serialize() const;
         // Returns the serialized hyperplane as a string
 
-    bool deserialize( const std::string& serialized );
+    void serialize( std::string& out ) const;
+        // Appends the serialized hyperplane to out. The value is written
+        // in its shortest exact form, see Text::appendNumber()
+
+    KDStatus deserialize( const std::string& serialized );
+    KDStatus deserialize( const char* begin, const char* end );
         // Loads the contents of the hyperplane from the serialized
-        // representation
-        // Returns true on success and false otherwise.
+        // representation. Trailing blanks and a carriage return are
+        // accepted, any other trailing characters are not. The hyperplane
+        // is left untouched on failure.
+        // Returns successful status or the reason of the failure.
 
     // MANIPULATORS
     void copy( const KDHyperplane& other );
@@ -110,30 +116,10 @@ KDHyperplane< T >::KDHyperplane( const size_t hyperplaneIndex,
     // nothing to do here
 }
 
-template< typename T >
-KDHyperplane< T >::KDHyperplane( const KDHyperplane& other )
-{
-    copy( other );
-}
-
-template< typename T >
-KDHyperplane< T >::~KDHyperplane()
-{
-    // nothing to do here
-}
-
 //============================================================================
 //                  OPERATORS
 //============================================================================
 
-template< typename T >
-KDHyperplane< T >&
-KDHyperplane< T >::operator=( const KDHyperplane< T >& other )
-{
-    copy( other );
-    return *this;
-}
-
 template< typename T >
 bool
 KDHyperplane< T >::operator==( const KDHyperplane< T >& other ) const
@@ -168,95 +154,60 @@ template< typename T >
 const std::string
 KDHyperplane< T >::serialize() const
 {
-    std::ostringstream serialized;
-    serialized << m_hyperplaneIndex << " " << m_value;
-    return serialized.str();
+    std::string serialized;
+    serialize( serialized );
+    return serialized;
 }
 
 template< typename T >
-bool
-KDHyperplane< T >::deserialize( const std::string& serialized )
+void
+KDHyperplane< T >::serialize( std::string& out ) const
 {
-    if ( serialized.empty() )
-    {
-        std::cerr << "Empty string passed to KDHyperplane::deserialize()"
-                  << std::endl;
-        return false;
-    }
+    Text::appendNumber( out, m_hyperplaneIndex );
+    out += ' ';
+    Text::appendNumber( out, m_value );
+}
 
-    size_t pos = 0;
-    int val1;
+template< typename T >
+KDStatus
+KDHyperplane< T >::deserialize( const std::string& serialized )
+{
+    return deserialize( serialized.data(),
+                        serialized.data() + serialized.size() );
+}
 
-    try
-    {
-        val1 = std::stoi( serialized , &pos );
-    }
-    catch ( std::exception e )
-    {
-        std::cerr << "Exception encountered during first val parsing in"
-                  << "KDHyperplane::deserialize()"
-                  << "serialized : '" << serialized << "', "
-                  << "what : '" << e.what() << "'"
-                  << std::endl;
-                  return false;
-    }
-    catch ( ... )
-    {
-        std::cerr << "Unknown exception encountered during first val parsing "
-                  << "in KDHyperplane::deserialize()"
-                  << "serialized : '" << serialized << "', "
-                  << std::endl;
-        return false;
-    }
+template< typename T >
+KDStatus
+KDHyperplane< T >::deserialize( const char* begin, const char* end )
+{
+    const char* cursor = begin;
+    size_t hyperplaneIndex;
+    T value;
 
-    if ( val1 < 0 )
+    if ( !Loader::parseIndex( cursor, end, hyperplaneIndex ) ||
+         !Loader::parseCoordinate( cursor, end, value ) )
     {
-        std::cerr << "Negative hyperplane index passed to "
-                  << "KDHyperplane::deserialize(), positive index value"
-                  << "expected"
-                  << "serialized : '" << serialized << "'"
-                  << std::endl;
-        return false;
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "malformed hyperplane, non-negative index and "
+                         "value expected" );
     }
 
-    if ( serialized.length() == pos )
+    while ( cursor < end &&
+            ( ' ' == *cursor || '\t' == *cursor || '\r' == *cursor ) )
     {
-        std::cerr << "Negative hyperplane index passed to "
-                  << "KDHyperplane::deserialize(), two values expected"
-                  << "serialized : '" << serialized << "'"
-                  << std::endl;
-        return false;
+        ++cursor;
     }
 
-    const std::string second = serialized.substr( pos );
-    double val2;
-
-    try
-    {
-        val2 = std::stof( second , &pos );
-    }
-    catch ( std::exception e )
-    {
-        std::cerr << "Exception encountered during second val parsing in"
-                  << "KDHyperplane::deserialize()"
-                  << "serialized : '" << serialized << "', "
-                  << "what : '" << e.what() << "'"
-                  << std::endl;
-                  return false;
-    }
-    catch ( ... )
+    if ( cursor != end )
     {
-        std::cerr << "Unknown exception encountered during second val parsing "
-                  << "in KDHyperplane::deserialize()"
-                  << "serialized : '" << serialized << "', "
-                  << std::endl;
-                  return false;
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "unexpected characters after hyperplane" );
     }
 
-    m_hyperplaneIndex = static_cast< size_t >( val1 );
-    m_value           = static_cast< T >( val2 );
+    m_hyperplaneIndex = hyperplaneIndex;
+    m_value           = value;
 
-    return true;
+    return KDStatus();
 }
 
 //============================================================================
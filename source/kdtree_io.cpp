@@ -0,0 +1,703 @@
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "kdtree_io.h"
+#include "kdtree_constants.h"
+
+namespace datastructures {
+
+namespace {
+
+size_t roundUp( const size_t value, const size_t alignment )
+{
+    return ( value + alignment - 1u ) / alignment * alignment;
+}
+
+// Reads length bytes at offset unless the end of the file comes first,
+// returns the number of bytes read or -errno
+ssize_t readFully( const int    fd,
+                   char*        buffer,
+                   const size_t length,
+                   const off_t  offset )
+{
+    size_t done = 0u;
+    while ( done < length )
+    {
+        const ssize_t result = pread( fd, buffer + done, length - done,
+                                      offset + static_cast< off_t >( done ) );
+        if ( result < 0 )
+        {
+            if ( EINTR == errno )
+            {
+                continue;
+            }
+            return -errno;
+        }
+        if ( !result )
+        {
+            break;
+        }
+        done += static_cast< size_t >( result );
+    }
+
+    return static_cast< ssize_t >( done );
+}
+
+class FileDescriptor {
+public:
+    explicit FileDescriptor( const int fd ) : m_fd( fd ) {}
+    ~FileDescriptor() { if ( m_fd >= 0 ) { close( m_fd ); } }
+
+    int get() const { return m_fd; }
+
+    void reset( const int fd )
+    {
+        if ( m_fd >= 0 )
+        {
+            close( m_fd );
+        }
+        m_fd = fd;
+    }
+
+private:
+    FileDescriptor( const FileDescriptor& );
+    FileDescriptor& operator=( const FileDescriptor& );
+
+    int m_fd;
+};
+
+// Issues reads of blocks into caller provided buffers, at most one read
+// per buffer slot in flight
+class BlockReader {
+public:
+    virtual ~BlockReader() {}
+
+    virtual bool submit( const size_t block,
+                         char*        buffer,
+                         const size_t length,
+                         const off_t  offset ) = 0;
+        // Starts reading block, returns false if the read could not be
+        // queued, no read into buffer is in flight then
+
+    virtual ssize_t wait( const size_t block ) = 0;
+        // Blocks until the read of block completes, returns the number of
+        // bytes read or -errno
+};
+
+class ThreadBlockReader : public BlockReader {
+public:
+    ThreadBlockReader( const int fd, const size_t queueDepth )
+    : m_fd( fd )
+    , m_results( queueDepth, Result() )
+    , m_stop( false )
+    {
+        const size_t hardware = std::thread::hardware_concurrency();
+        const size_t workers  = std::max< size_t >(
+                1u, std::min( queueDepth, std::max< size_t >( hardware, 4u ) ) );
+
+        for ( size_t i = 0; i < workers; ++i )
+        {
+            m_workers.push_back( std::thread( &ThreadBlockReader::run, this ) );
+        }
+    }
+
+    ~ThreadBlockReader()
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_stop = true;
+        }
+        m_requested.notify_all();
+
+        for ( size_t i = 0; i < m_workers.size(); ++i )
+        {
+            m_workers[ i ].join();
+        }
+    }
+
+    bool submit( const size_t block,
+                 char*        buffer,
+                 const size_t length,
+                 const off_t  offset )
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            Result& result = m_results[ block % m_results.size() ];
+            result.block = block;
+            result.done  = false;
+            m_requests.push_back( Request( block, buffer, length, offset ) );
+        }
+        m_requested.notify_one();
+
+        return true;
+    }
+
+    ssize_t wait( const size_t block )
+    {
+        std::unique_lock< std::mutex > lock( m_mutex );
+        const Result& result = m_results[ block % m_results.size() ];
+        m_completed.wait( lock, [ & ]()
+            {
+                return result.block == block && result.done;
+            } );
+
+        return result.bytes;
+    }
+
+private:
+    struct Request {
+        Request( const size_t block_,
+                 char*        buffer_,
+                 const size_t length_,
+                 const off_t  offset_ )
+        : block( block_ ), buffer( buffer_ ), length( length_ ), offset( offset_ )
+        {
+        }
+
+        size_t  block;
+        char*   buffer;
+        size_t  length;
+        off_t   offset;
+    };
+
+    struct Result {
+        Result() : block( 0u ), done( false ), bytes( 0 ) {}
+
+        size_t   block;
+        bool     done;
+        ssize_t  bytes;
+    };
+
+    void run()
+    {
+        while ( true )
+        {
+            std::unique_lock< std::mutex > lock( m_mutex );
+            m_requested.wait( lock, [ & ]()
+                {
+                    return m_stop || !m_requests.empty();
+                } );
+            if ( m_requests.empty() )
+            {
+                return;
+            }
+            const Request request = m_requests.front();
+            m_requests.pop_front();
+            lock.unlock();
+
+            const ssize_t bytes = readFully( m_fd, request.buffer,
+                                             request.length, request.offset );
+
+            lock.lock();
+            Result& result = m_results[ request.block % m_results.size() ];
+            result.bytes = bytes;
+            result.done  = true;
+            lock.unlock();
+            m_completed.notify_all();
+        }
+    }
+
+    int                           m_fd;
+    std::vector< Result >         m_results;
+    std::deque< Request >         m_requests;
+    std::vector< std::thread >    m_workers;
+    std::mutex                    m_mutex;
+    std::condition_variable       m_requested;
+    std::condition_variable       m_completed;
+    bool                          m_stop;
+};
+
+#ifdef __linux__
+
+class UringBlockReader : public BlockReader {
+public:
+    UringBlockReader( const int fd, const size_t queueDepth )
+    : m_fd( fd )
+    , m_ringFd( -1 )
+    , m_sqRing( MAP_FAILED )
+    , m_cqRing( MAP_FAILED )
+    , m_sqes( MAP_FAILED )
+    , m_results( queueDepth, Result() )
+    {
+        io_uring_params params;
+        std::memset( &params, 0, sizeof( params ) );
+
+        m_ringFd = static_cast< int >( syscall( __NR_io_uring_setup,
+                                                queueDepth, &params ) );
+        if ( m_ringFd < 0 )
+        {
+            return;
+        }
+
+        // Plain reads and a single mapping of both rings came with 5.6
+        if ( !( params.features & IORING_FEAT_SINGLE_MMAP ) ||
+             !( params.features & IORING_FEAT_RW_CUR_POS ) )
+        {
+            close( m_ringFd );
+            m_ringFd = -1;
+            return;
+        }
+
+        m_sqRingSize = std::max(
+                params.sq_off.array + params.sq_entries * sizeof( unsigned ),
+                params.cq_off.cqes +
+                        params.cq_entries * sizeof( io_uring_cqe ) );
+        m_sqRing = mmap( nullptr, m_sqRingSize, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, m_ringFd,
+                         IORING_OFF_SQ_RING );
+        m_cqRing = m_sqRing;
+
+        m_sqesSize = params.sq_entries * sizeof( io_uring_sqe );
+        m_sqes = mmap( nullptr, m_sqesSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, m_ringFd,
+                       IORING_OFF_SQES );
+
+        if ( MAP_FAILED == m_sqRing || MAP_FAILED == m_sqes )
+        {
+            release();
+            return;
+        }
+
+        char* sq = static_cast< char* >( m_sqRing );
+        m_sqHead  = reinterpret_cast< unsigned* >( sq + params.sq_off.head );
+        m_sqTail  = reinterpret_cast< unsigned* >( sq + params.sq_off.tail );
+        m_sqMask  = *reinterpret_cast< unsigned* >( sq + params.sq_off.ring_mask );
+        m_sqArray = reinterpret_cast< unsigned* >( sq + params.sq_off.array );
+
+        char* cq = static_cast< char* >( m_cqRing );
+        m_cqHead = reinterpret_cast< unsigned* >( cq + params.cq_off.head );
+        m_cqTail = reinterpret_cast< unsigned* >( cq + params.cq_off.tail );
+        m_cqMask = *reinterpret_cast< unsigned* >( cq + params.cq_off.ring_mask );
+        m_cqes   = reinterpret_cast< io_uring_cqe* >( cq + params.cq_off.cqes );
+    }
+
+    ~UringBlockReader()
+    {
+        release();
+    }
+
+    bool valid() const
+    {
+        return m_ringFd >= 0;
+    }
+
+    bool submit( const size_t block,
+                 char*        buffer,
+                 const size_t length,
+                 const off_t  offset )
+    {
+        m_results[ block % m_results.size() ].block = block;
+        m_results[ block % m_results.size() ].done  = false;
+
+        // This thread is the only producer, the kernel only reads the tail
+        const unsigned tail  = *m_sqTail;
+        const unsigned index = tail & m_sqMask;
+
+        io_uring_sqe* sqe = static_cast< io_uring_sqe* >( m_sqes ) + index;
+        std::memset( sqe, 0, sizeof( *sqe ) );
+        sqe->opcode    = IORING_OP_READ;
+        sqe->fd        = m_fd;
+        sqe->addr      = reinterpret_cast< uint64_t >( buffer );
+        sqe->len       = static_cast< uint32_t >( length );
+        sqe->off       = static_cast< uint64_t >( offset );
+        sqe->user_data = block;
+
+        m_sqArray[ index ] = index;
+        __atomic_store_n( m_sqTail, tail + 1u, __ATOMIC_RELEASE );
+
+        long submitted;
+        do
+        {
+            submitted = syscall( __NR_io_uring_enter, m_ringFd,
+                                 1u, 0u, 0u, nullptr, 0u );
+        }
+        while ( submitted < 0 && EINTR == errno );
+
+        if ( 1 == submitted )
+        {
+            return true;
+        }
+
+        // The caller does not wait for a failed submission, so the read
+        // must not reach the buffer later. Without SQ polling the kernel
+        // only consumes entries inside io_uring_enter(), an entry it left
+        // is taken back, one it took is waited for.
+        if ( __atomic_load_n( m_sqHead, __ATOMIC_ACQUIRE ) == tail )
+        {
+            __atomic_store_n( m_sqTail, tail, __ATOMIC_RELEASE );
+        }
+        else
+        {
+            wait( block );
+        }
+
+        return false;
+    }
+
+    ssize_t wait( const size_t block )
+    {
+        Result& result = m_results[ block % m_results.size() ];
+
+        while ( !( result.block == block && result.done ) )
+        {
+            reap();
+            if ( result.block == block && result.done )
+            {
+                break;
+            }
+
+            const long entered = syscall( __NR_io_uring_enter, m_ringFd,
+                                          0u, 1u, IORING_ENTER_GETEVENTS,
+                                          nullptr, 0u );
+            if ( entered < 0 && EINTR != errno )
+            {
+                return -errno;
+            }
+        }
+
+        return result.bytes;
+    }
+
+private:
+    struct Result {
+        Result() : block( 0u ), done( false ), bytes( 0 ) {}
+
+        size_t   block;
+        bool     done;
+        ssize_t  bytes;
+    };
+
+    void reap()
+    {
+        unsigned head = *m_cqHead;
+        const unsigned tail = __atomic_load_n( m_cqTail, __ATOMIC_ACQUIRE );
+
+        while ( head != tail )
+        {
+            const io_uring_cqe& cqe = m_cqes[ head & m_cqMask ];
+            Result& result = m_results[ cqe.user_data % m_results.size() ];
+            result.block = cqe.user_data;
+            result.bytes = cqe.res;
+            result.done  = true;
+            ++head;
+        }
+
+        __atomic_store_n( m_cqHead, head, __ATOMIC_RELEASE );
+    }
+
+    void release()
+    {
+        if ( MAP_FAILED != m_sqes )
+        {
+            munmap( m_sqes, m_sqesSize );
+            m_sqes = MAP_FAILED;
+        }
+        if ( MAP_FAILED != m_sqRing )
+        {
+            munmap( m_sqRing, m_sqRingSize );
+            m_sqRing = MAP_FAILED;
+        }
+        if ( m_ringFd >= 0 )
+        {
+            close( m_ringFd );
+            m_ringFd = -1;
+        }
+    }
+
+    int                     m_fd;
+    int                     m_ringFd;
+    void*                   m_sqRing;
+    void*                   m_cqRing;
+    void*                   m_sqes;
+    size_t                  m_sqRingSize;
+    size_t                  m_sqesSize;
+    unsigned*               m_sqHead;
+    unsigned*               m_sqTail;
+    unsigned                m_sqMask;
+    unsigned*               m_sqArray;
+    unsigned*               m_cqHead;
+    unsigned*               m_cqTail;
+    unsigned                m_cqMask;
+    io_uring_cqe*           m_cqes;
+    std::vector< Result >   m_results;
+};
+
+#endif
+
+std::unique_ptr< BlockReader > makeReader( const int                fd,
+                                           const size_t             queueDepth,
+                                           const AsyncIO::Backend   backend )
+{
+#ifdef __linux__
+    if ( AsyncIO::Backend::THREADS != backend )
+    {
+        std::unique_ptr< UringBlockReader > reader(
+                new UringBlockReader( fd, queueDepth ) );
+        if ( reader->valid() )
+        {
+            return std::unique_ptr< BlockReader >( reader.release() );
+        }
+    }
+#endif
+
+    if ( AsyncIO::Backend::IO_URING == backend )
+    {
+        return std::unique_ptr< BlockReader >();
+    }
+
+    return std::unique_ptr< BlockReader >(
+            new ThreadBlockReader( fd, queueDepth ) );
+}
+
+// Reads the whole file through reader, returns 0 or errno of the failed
+// read. Every queued read is completed before returning, so that no read
+// outlives the buffers
+int readAllBlocks( const int                     fd,
+                   const size_t                  fileSize,
+                   BlockReader&                  reader,
+                   char*                         buffers,
+                   const size_t                  blockSize,
+                   const size_t                  queueDepth,
+                   const size_t                  alignment,
+                   const AsyncIO::BlockConsumer& consumer,
+                   KDStatus&                     consumerStatus )
+{
+    const size_t numBlocks = ( fileSize + blockSize - 1u ) / blockSize;
+    size_t submitted = 0u;
+    int    error     = 0;
+
+    while ( submitted < numBlocks && submitted < queueDepth )
+    {
+        const size_t offset = submitted * blockSize;
+        const size_t length = std::min( blockSize, fileSize - offset );
+        if ( !reader.submit( submitted,
+                             buffers + ( submitted % queueDepth ) * blockSize,
+                             roundUp( length, alignment ),
+                             static_cast< off_t >( offset ) ) )
+        {
+            error = EIO;
+            break;
+        }
+        ++submitted;
+    }
+
+    size_t block = 0u;
+    for ( ; block < submitted; ++block )
+    {
+        char*        buffer = buffers + ( block % queueDepth ) * blockSize;
+        const size_t offset = block * blockSize;
+        const size_t length = std::min( blockSize, fileSize - offset );
+
+        ssize_t bytes = reader.wait( block );
+        if ( error || !consumerStatus )
+        {
+            continue;
+        }
+
+        if ( bytes >= 0 && static_cast< size_t >( bytes ) < length )
+        {
+            // Short reads only happen at the end of the file or on
+            // interruption, complete the block synchronously
+            const ssize_t rest = readFully(
+                    fd, buffer + bytes, length - bytes,
+                    static_cast< off_t >( offset + bytes ) );
+            bytes = rest < 0 ? rest : bytes + rest;
+        }
+
+        if ( bytes < 0 )
+        {
+            error = static_cast< int >( -bytes );
+            continue;
+        }
+
+        if ( static_cast< size_t >( bytes ) < length )
+        {
+            error = EIO;
+            continue;
+        }
+
+        consumerStatus = consumer( buffer, length );
+        if ( !consumerStatus )
+        {
+            continue;
+        }
+
+        if ( submitted < numBlocks )
+        {
+            const size_t nextOffset = submitted * blockSize;
+            const size_t nextLength = std::min( blockSize,
+                                                fileSize - nextOffset );
+            if ( !reader.submit( submitted, buffer,
+                                 roundUp( nextLength, alignment ),
+                                 static_cast< off_t >( nextOffset ) ) )
+            {
+                error = EIO;
+                continue;
+            }
+            ++submitted;
+        }
+    }
+
+    return error;
+}
+
+struct FreeDeleter {
+    void operator()( char* pointer ) const { std::free( pointer ); }
+};
+
+} // anonymous namespace
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+AsyncIO::Options::Options()
+: blockSize(  Constants::KDTREE_IO_BLOCK_SIZE )
+, queueDepth( Constants::KDTREE_IO_QUEUE_DEPTH )
+, direct(     false )
+, backend(    Backend::AUTO )
+{
+    // nothing to do here
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+bool
+AsyncIO::ioUringAvailable()
+{
+#ifdef __linux__
+    return UringBlockReader( -1, 1u ).valid();
+#else
+    return false;
+#endif
+}
+
+KDStatus
+AsyncIO::readBlocks( const std::string&   filename,
+                     const BlockConsumer& consumer,
+                     const Options&       options )
+{
+    bool direct = options.direct;
+    int  flags  = O_RDONLY;
+#ifdef O_DIRECT
+    if ( direct )
+    {
+        flags |= O_DIRECT;
+    }
+#else
+    direct = false;
+#endif
+
+    FileDescriptor file( open( filename.c_str(), flags ) );
+    if ( file.get() < 0 && direct && EINVAL == errno )
+    {
+        // The file system does not support direct reads
+        direct = false;
+        file.reset( open( filename.c_str(), O_RDONLY ) );
+    }
+
+    if ( file.get() < 0 )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR,
+                         "unable to open file for reading" );
+    }
+
+    struct stat info;
+    if ( fstat( file.get(), &info ) < 0 )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "failed reading file" );
+    }
+    const size_t fileSize = static_cast< size_t >( info.st_size );
+
+    const size_t alignment  = direct ? Constants::KDTREE_IO_ALIGNMENT : 1u;
+    const size_t queueDepth = std::max< size_t >( options.queueDepth, 1u );
+    const size_t blockSize  = roundUp( std::max< size_t >( options.blockSize,
+                                                           1u ),
+                                       Constants::KDTREE_IO_ALIGNMENT );
+
+    if ( !fileSize )
+    {
+        return KDStatus();
+    }
+
+    void* memory = nullptr;
+    if ( posix_memalign( &memory, Constants::KDTREE_IO_ALIGNMENT,
+                         queueDepth * blockSize ) )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR,
+                         "unable to allocate read buffers" );
+    }
+    std::unique_ptr< char, FreeDeleter > buffers(
+            static_cast< char* >( memory ) );
+
+    // Declared after the buffers, so that the reader and its reads are
+    // gone before the buffers are freed
+    std::unique_ptr< BlockReader > reader =
+            makeReader( file.get(), queueDepth, options.backend );
+    if ( !reader )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR,
+                         "io_uring is not available" );
+    }
+
+    KDStatus consumerStatus;
+    const int error = readAllBlocks( file.get(), fileSize, *reader,
+                                     buffers.get(), blockSize, queueDepth,
+                                     alignment, consumer, consumerStatus );
+
+    if ( !consumerStatus )
+    {
+        return consumerStatus;
+    }
+
+    if ( error )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "failed reading file" );
+    }
+
+    return KDStatus();
+}
+
+KDStatus
+AsyncIO::readFile( const std::string& filename,
+                   std::string&       contents,
+                   const Options&     options )
+{
+    contents.clear();
+
+    struct stat info;
+    if ( 0 == stat( filename.c_str(), &info ) )
+    {
+        contents.reserve( static_cast< size_t >( info.st_size ) );
+    }
+
+    return readBlocks( filename,
+                       [ & ]( const char* data, const size_t size )
+                       {
+                           contents.append( data, size );
+                           return KDStatus();
+                       },
+                       options );
+}
+
+} // namespace datastructures
@@ -0,0 +1,87 @@
+#ifndef KDTREE_IO_H
+#define KDTREE_IO_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include "kdtree_status.h"
+
+// @Purpose
+//
+// This struct provides the file input layer of the loaders : a file is
+// read in fixed size blocks with many reads in flight at once, and the
+// blocks are handed to a consumer in file order while the following reads
+// proceed, so parsing overlaps with I/O.
+//
+// Two backends are available. On Linux io_uring queues all of the reads
+// through a single ring without any helper thread. Where io_uring is not
+// available, e.g. older kernels or sandboxes that forbid it, a pool of
+// threads issues blocking pread() calls, one read in flight per thread.
+//
+// Reads may bypass the page cache with O_DIRECT. Buffers, offsets and
+// sizes are then aligned to Constants::KDTREE_IO_ALIGNMENT; file systems
+// refusing O_DIRECT are read through the page cache instead.
+
+namespace datastructures {
+
+struct AsyncIO {
+    enum class Backend {
+        AUTO,
+            // io_uring where available, pread() threads otherwise
+
+        IO_URING,
+            // io_uring only, fails where it is not available
+
+        THREADS
+            // pread() threads only
+    };
+
+    struct Options {
+        Options();
+            // Default options : Constants::KDTREE_IO_BLOCK_SIZE blocks,
+            // Constants::KDTREE_IO_QUEUE_DEPTH reads in flight, page
+            // cache reads, AUTO backend
+
+        size_t   blockSize;
+            // Bytes per read, rounded up to the alignment for direct reads
+
+        size_t   queueDepth;
+            // Reads kept in flight, also the number of block buffers
+
+        bool     direct;
+            // Bypass the page cache with O_DIRECT
+
+        Backend  backend;
+            // Backend issuing the reads
+    };
+
+    typedef std::function< KDStatus( const char*  data,
+                                     const size_t size ) > BlockConsumer;
+        // Receives the next block of a file. A failed status stops the
+        // read and is returned to the caller.
+
+    // PRIMARY INTERFACE
+    static bool ioUringAvailable();
+        // Returns true if the kernel accepts io_uring reads
+
+    static KDStatus readBlocks( const std::string&   filename,
+                                const BlockConsumer& consumer,
+                                const Options&       options = Options() );
+        // Reads the file with options.queueDepth reads in flight and
+        // passes consecutive blocks to consumer from the calling thread,
+        // in file order. Blocks are at most options.blockSize bytes and
+        // only valid during the call.
+        // Returns successful status, the first failure of consumer or the
+        // reason of the I/O failure.
+
+    static KDStatus readFile( const std::string& filename,
+                              std::string&       contents,
+                              const Options&     options = Options() );
+        // Reads the whole file into contents through readBlocks().
+        // Returns successful status or the reason of the failure.
+};
+
+} // namespace datastructures
+
+#endif //KDTREE_IO_H
@@ -0,0 +1,277 @@
+#include <fstream>
+#include <limits>
+
+#include "kdtree_knn_graph.h"
+#include "kdtree_constants.h"
+
+namespace datastructures {
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+KDKnnGraph::KDKnnGraph()
+{
+    // nothing to do here
+}
+
+KDKnnGraph::KDKnnGraph( const size_t numVertices, const size_t degree )
+: m_offsets(    numVertices + 1u )
+, m_neighbours( numVertices * degree )
+, m_distances(  numVertices * degree )
+{
+    for ( size_t i = 0; i <= numVertices; ++i )
+    {
+        m_offsets[ i ] = i * degree;
+    }
+}
+
+KDKnnGraph::KDKnnGraph( const std::vector< uint64_t >& offsets )
+: m_offsets(    offsets )
+, m_neighbours( offsets.empty() ? 0u : offsets.back() )
+, m_distances(  offsets.empty() ? 0u : offsets.back() )
+{
+    // nothing to do here
+}
+
+//============================================================================
+//                  OPERATORS
+//============================================================================
+
+bool
+KDKnnGraph::operator==( const KDKnnGraph& other ) const
+{
+    return equals( other );
+}
+
+bool
+KDKnnGraph::operator!=( const KDKnnGraph& other ) const
+{
+    return !equals( other );
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+KDStatus
+KDKnnGraph::serialize( const std::string& filename ) const
+{
+    std::ofstream graphData( filename.c_str(),
+                             std::ofstream::out |
+                             std::ofstream::binary |
+                             std::ofstream::trunc );
+
+    if ( !graphData.is_open() )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR,
+                         "unable to open file for writing" );
+    }
+
+    const uint64_t numVertices = this->numVertices();
+    const uint64_t numEdges    = this->numEdges();
+
+    graphData.write( Constants::KDTREE_KNN_GRAPH_MAGIC.data(),
+                     Constants::KDTREE_KNN_GRAPH_MAGIC.size() );
+    graphData.write( reinterpret_cast< const char* >( &numVertices ),
+                     sizeof( numVertices ) );
+    graphData.write( reinterpret_cast< const char* >( &numEdges ),
+                     sizeof( numEdges ) );
+
+    if ( numVertices )
+    {
+        graphData.write( reinterpret_cast< const char* >( &m_offsets[ 0 ] ),
+                         m_offsets.size() * sizeof( uint64_t ) );
+    }
+
+    if ( numEdges )
+    {
+        graphData.write(
+                reinterpret_cast< const char* >( &m_neighbours[ 0 ] ),
+                m_neighbours.size() * sizeof( uint32_t ) );
+        graphData.write(
+                reinterpret_cast< const char* >( &m_distances[ 0 ] ),
+                m_distances.size() * sizeof( float ) );
+    }
+
+    if ( !graphData.good() )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "failed writing file" );
+    }
+
+    return KDStatus();
+}
+
+KDStatus
+KDKnnGraph::deserialize( const std::string& filename )
+{
+    std::ifstream graphData( filename.c_str(),
+                             std::ifstream::in | std::ifstream::binary );
+
+    if ( !graphData.is_open() )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR,
+                         "unable to open file for reading" );
+    }
+
+    std::string magic( Constants::KDTREE_KNN_GRAPH_MAGIC.size(), '\0' );
+    uint64_t numVertices = 0;
+    uint64_t numEdges    = 0;
+
+    graphData.read( &magic[ 0 ], magic.size() );
+    graphData.read( reinterpret_cast< char* >( &numVertices ),
+                    sizeof( numVertices ) );
+    graphData.read( reinterpret_cast< char* >( &numEdges ),
+                    sizeof( numEdges ) );
+
+    if ( !graphData.good() || magic != Constants::KDTREE_KNN_GRAPH_MAGIC )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR, "malformed header" );
+    }
+
+    // The header must describe no more data than the file holds before
+    // anything is sized after it
+    const std::streamoff headerEnd = graphData.tellg();
+    graphData.seekg( 0, std::ifstream::end );
+    const uint64_t available =
+            static_cast< uint64_t >( graphData.tellg() - headerEnd );
+    graphData.seekg( headerEnd );
+
+    const uint64_t offsetBytes = numVertices ?
+                                 ( numVertices + 1u ) * sizeof( uint64_t ) :
+                                 0u;
+    const uint64_t edgeBytes   = sizeof( uint32_t ) + sizeof( float );
+    if ( !graphData.good() ||
+         numVertices > std::numeric_limits< uint32_t >::max() ||
+         ( !numVertices && numEdges ) ||
+         offsetBytes > available ||
+         numEdges > ( available - offsetBytes ) / edgeBytes )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "truncated or inconsistent graph" );
+    }
+
+    std::vector< uint64_t > offsets( numVertices ? numVertices + 1u : 0u );
+    std::vector< uint32_t > neighbours( numEdges );
+    std::vector< float >    distances( numEdges );
+
+    if ( numVertices )
+    {
+        graphData.read( reinterpret_cast< char* >( &offsets[ 0 ] ),
+                        offsets.size() * sizeof( uint64_t ) );
+    }
+
+    if ( numEdges )
+    {
+        graphData.read( reinterpret_cast< char* >( &neighbours[ 0 ] ),
+                        neighbours.size() * sizeof( uint32_t ) );
+        graphData.read( reinterpret_cast< char* >( &distances[ 0 ] ),
+                        distances.size() * sizeof( float ) );
+    }
+
+    bool consistent = graphData.good() &&
+                      ( !numVertices ||
+                        ( 0u == offsets.front() &&
+                          numEdges == offsets.back() ) );
+    for ( size_t i = 1; consistent && i < offsets.size(); ++i )
+    {
+        consistent = offsets[ i - 1u ] <= offsets[ i ];
+    }
+    for ( size_t i = 0; consistent && i < neighbours.size(); ++i )
+    {
+        consistent = neighbours[ i ] < numVertices;
+    }
+
+    if ( !consistent )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "truncated or inconsistent graph" );
+    }
+
+    m_offsets.swap( offsets );
+    m_neighbours.swap( neighbours );
+    m_distances.swap( distances );
+
+    return KDStatus();
+}
+
+size_t
+KDKnnGraph::numVertices() const
+{
+    return m_offsets.empty() ? 0u : m_offsets.size() - 1u;
+}
+
+size_t
+KDKnnGraph::numEdges() const
+{
+    return m_neighbours.size();
+}
+
+size_t
+KDKnnGraph::degree( const size_t vertex ) const
+{
+    return m_offsets[ vertex + 1u ] - m_offsets[ vertex ];
+}
+
+const uint32_t*
+KDKnnGraph::neighbours( const size_t vertex ) const
+{
+    return m_neighbours.data() + m_offsets[ vertex ];
+}
+
+uint32_t*
+KDKnnGraph::neighbours( const size_t vertex )
+{
+    return m_neighbours.data() + m_offsets[ vertex ];
+}
+
+const float*
+KDKnnGraph::distances( const size_t vertex ) const
+{
+    return m_distances.data() + m_offsets[ vertex ];
+}
+
+float*
+KDKnnGraph::distances( const size_t vertex )
+{
+    return m_distances.data() + m_offsets[ vertex ];
+}
+
+const std::vector< uint64_t >&
+KDKnnGraph::offsets() const
+{
+    return m_offsets;
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+bool
+KDKnnGraph::equals( const KDKnnGraph& other ) const
+{
+    return ( ( other.m_offsets    == m_offsets    ) &&
+             ( other.m_neighbours == m_neighbours ) &&
+             ( other.m_distances  == m_distances  ) );
+}
+
+std::ostream&
+KDKnnGraph::print( std::ostream& out ) const
+{
+    out << "KDKnnGraph:[ "
+        << "num vertices = " << std::dec << numVertices() << ", "
+        << "num edges = "    << std::dec << numEdges()    << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+std::ostream& operator<<( std::ostream& lhs, const KDKnnGraph& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
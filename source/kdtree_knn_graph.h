@@ -0,0 +1,110 @@
+#ifndef KDTREE_KNN_GRAPH_H
+#define KDTREE_KNN_GRAPH_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "kdtree_status.h"
+
+namespace datastructures {
+
+// PURPOSE:
+//
+// A k-nearest-neighbour graph, or any other neighbour graph such as the
+// fixed radius neighbour lists of a CellListIndex, stored in compressed
+// sparse row (CSR) form. Neighbours of vertex v are stored at positions
+// [ offsets[ v ], offsets[ v + 1 ] ) of the neighbour and distance arrays,
+// sorted by increasing distance.
+//
+// Neighbour indexes are stored as 32 bit values and distances as floats,
+// which keeps a 10M point graph with k = 10 within 800MB.
+//
+// The binary file format is:
+//     8 bytes   - Constants::KDTREE_KNN_GRAPH_MAGIC
+//     uint64_t  - number of vertices
+//     uint64_t  - number of edges
+//     uint64_t  - offsets, number of vertices + 1 values
+//     uint32_t  - neighbours, number of edges values
+//     float     - distances, number of edges values
+// All values are written in native byte order.
+//
+class KDKnnGraph {
+public:
+    // CREATORS
+    KDKnnGraph();
+        // Default constructor, creates an empty graph
+
+    KDKnnGraph( const size_t numVertices, const size_t degree );
+        // Creates a graph where every vertex has exactly degree neighbour
+        // slots, to be filled in through the non-const accessors
+
+    explicit KDKnnGraph( const std::vector< uint64_t >& offsets );
+        // Creates a graph with the provided CSR row offsets, numVertices + 1
+        // non-decreasing values starting at 0, neighbour slots to be filled
+        // in through the non-const accessors
+
+    // OPERATORS
+    bool operator==( const KDKnnGraph& other ) const;
+        // Equality. Calls equals.
+
+    bool operator!=( const KDKnnGraph& other ) const;
+        // Non-equality. Calls equals.
+
+    // PRIMARY INTERFACE
+    KDStatus serialize( const std::string& filename ) const;
+        // Writes the graph to the provided file location in binary form.
+        // Returns successful status or the reason of the failure.
+
+    KDStatus deserialize( const std::string& filename );
+        // Loads the graph from a file produced by serialize(), the graph
+        // is left untouched on failure.
+        // Returns successful status or the reason of the failure.
+
+    size_t numVertices() const;
+        // Returns number of vertices in the graph
+
+    size_t numEdges() const;
+        // Returns number of directed edges in the graph
+
+    size_t degree( const size_t vertex ) const;
+        // Returns number of neighbours of vertex
+
+    const uint32_t* neighbours( const size_t vertex ) const;
+    uint32_t* neighbours( const size_t vertex );
+        // Returns pointer to the first neighbour index of vertex
+
+    const float* distances( const size_t vertex ) const;
+    float* distances( const size_t vertex );
+        // Returns pointer to the distance to the first neighbour of vertex
+
+    const std::vector< uint64_t >& offsets() const;
+        // Returns the CSR row offsets, numVertices() + 1 values for a
+        // non-empty graph
+
+    // ACCESSORS
+    bool equals( const KDKnnGraph& other ) const;
+        // Worker for equality
+
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the summary of the KDKnnGraph object in a easy to read
+        // format
+
+private:
+    std::vector< uint64_t >   m_offsets;
+        // Row offsets
+
+    std::vector< uint32_t >   m_neighbours;
+        // Neighbour indexes of all the vertices, row after row
+
+    std::vector< float >      m_distances;
+        // Distances to the neighbours of all the vertices, row after row
+};
+
+// INDEPENDENT OPERATORS
+std::ostream& operator<<( std::ostream& lhs, const KDKnnGraph& rhs );
+
+} // close namespace datastructures
+
+#endif // KDTREE_KNN_GRAPH_H
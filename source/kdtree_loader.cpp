@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <charconv>
+
+#include "kdtree_loader.h"
+
+namespace datastructures {
+
+namespace {
+
+const char* skipBlanks( const char* cursor, const char* end )
+{
+    while ( cursor < end && ( ' ' == *cursor || '\t' == *cursor ) )
+    {
+        ++cursor;
+    }
+
+    return cursor;
+}
+
+// Returns true if the decimal number in [ begin, end ) matched by
+// std::from_chars() has a magnitude below one, which tells an underflow
+// from an overflow when both are reported as std::errc::result_out_of_range
+bool isBelowOne( const char* begin, const char* end )
+{
+    const char* cursor = begin;
+    if ( cursor < end && '-' == *cursor )
+    {
+        ++cursor;
+    }
+
+    // Position of the leading significant digit relative to the point
+    long exponent     = 0;
+    bool significant  = false;
+    for ( ; cursor < end && '0' <= *cursor && *cursor <= '9'; ++cursor )
+    {
+        significant = significant || '0' != *cursor;
+        exponent   += significant ? 1 : 0;
+    }
+    if ( cursor < end && '.' == *cursor )
+    {
+        for ( ++cursor; cursor < end && '0' <= *cursor && *cursor <= '9';
+              ++cursor )
+        {
+            significant = significant || '0' != *cursor;
+            exponent   -= significant ? 0 : 1;
+        }
+    }
+
+    if ( cursor < end && ( 'e' == *cursor || 'E' == *cursor ) )
+    {
+        ++cursor;
+        const bool negative = cursor < end && '-' == *cursor;
+        if ( cursor < end && ( '-' == *cursor || '+' == *cursor ) )
+        {
+            ++cursor;
+        }
+
+        // Saturate, the mantissa cannot outweigh this
+        long power = 0;
+        for ( ; cursor < end && '0' <= *cursor && *cursor <= '9'; ++cursor )
+        {
+            power = std::min( 10 * power + ( *cursor - '0' ), 1000000L );
+        }
+        exponent += negative ? -power : power;
+    }
+
+    return exponent < 0;
+}
+
+template< typename T >
+bool parseFloatingPoint( const char*& cursor, const char* end, T& value )
+{
+    const char* begin = skipBlanks( cursor, end );
+
+    // std::from_chars() does not accept an explicit plus sign
+    if ( begin < end && '+' == *begin )
+    {
+        ++begin;
+    }
+
+    T parsed;
+    const std::from_chars_result result =
+            std::from_chars( begin, end, parsed );
+
+    if ( std::errc::result_out_of_range == result.ec &&
+         isBelowOne( begin, result.ptr ) )
+    {
+        parsed = '-' == *begin ? -static_cast< T >( 0 ) :
+                                  static_cast< T >( 0 );
+    }
+    else if ( std::errc() != result.ec )
+    {
+        return false;
+    }
+
+    value  = parsed;
+    cursor = result.ptr;
+
+    return true;
+}
+
+} // anonymous namespace
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+bool
+Loader::parseIndex( const char*& cursor, const char* end, size_t& value )
+{
+    const char* begin = skipBlanks( cursor, end );
+
+    size_t parsed;
+    const std::from_chars_result result =
+            std::from_chars( begin, end, parsed );
+
+    if ( std::errc() != result.ec )
+    {
+        return false;
+    }
+
+    value  = parsed;
+    cursor = result.ptr;
+
+    return true;
+}
+
+bool
+Loader::parseIndex( const std::string& text, size_t& value )
+{
+    const char* cursor = text.data();
+    const char* end    = cursor + text.size();
+    size_t parsed;
+
+    if ( !parseIndex( cursor, end, parsed ) )
+    {
+        return false;
+    }
+
+    cursor = skipBlanks( cursor, end );
+    if ( cursor < end && '\r' == *cursor )
+    {
+        ++cursor;
+    }
+
+    if ( cursor != end )
+    {
+        return false;
+    }
+
+    value = parsed;
+
+    return true;
+}
+
+bool
+Loader::parseReal( const char*& cursor, const char* end, double& value )
+{
+    return parseFloatingPoint( cursor, end, value );
+}
+
+bool
+Loader::parseReal( const char*& cursor, const char* end, float& value )
+{
+    return parseFloatingPoint( cursor, end, value );
+}
+
+} // namespace datastructures
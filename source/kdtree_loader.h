@@ -0,0 +1,273 @@
+#ifndef KDTREE_LOADER_H
+#define KDTREE_LOADER_H
+
+#include <cstring>
+#include <string>
+
+#include "kdtree_types.h"
+#include "kdtree_status.h"
+#include "kdtree_io.h"
+
+// @Purpose
+//
+// This struct provides the number and point parsers shared by the tree
+// deserialization and the loaders of the command line tools, and a loader
+// of CSV point files. Parsers work on [ begin, end ) ranges, so lines of a
+// file read as a whole can be parsed in place.
+//
+// Parsers report failures through their return value and KDStatus only :
+// they neither throw nor write to any stream, and a successful parse of a
+// number does not allocate.
+
+namespace datastructures {
+
+struct Loader {
+    // PRIMARY INTERFACE
+    static bool parseIndex( const char*& cursor,
+                            const char*  end,
+                            size_t&      value );
+        // Parses a non-negative decimal integer in [ cursor, end ),
+        // leading blanks skipped. Advances cursor past the number and
+        // returns true on success, leaves both arguments untouched
+        // otherwise.
+
+    static bool parseIndex( const std::string& text, size_t& value );
+        // Parses text holding nothing but a non-negative decimal integer,
+        // surrounding blanks and a trailing carriage return accepted.
+        // Returns true on success, leaves value untouched otherwise.
+
+    static bool parseReal( const char*& cursor,
+                           const char*  end,
+                           double&      value );
+    static bool parseReal( const char*& cursor,
+                           const char*  end,
+                           float&       value );
+        // Parses a floating point number in [ cursor, end ) with
+        // std::from_chars, leading blanks and plus sign skipped. Values
+        // too large for the type are rejected, values too small for it
+        // flush to zero of their sign. Advances cursor past
+        // the number and returns true on success, leaves both arguments
+        // untouched otherwise.
+
+    template< typename T >
+    static bool parseCoordinate( const char*& cursor,
+                                 const char*  end,
+                                 T&           value );
+        // Parses a coordinate of type T. Floating point types are parsed
+        // directly, so that the output of Text::appendNumber() reads back
+        // exactly, other types are parsed as double and converted.
+
+    template< typename T >
+    static KDStatus parsePoint( const char*        begin,
+                                const char*        end,
+                                Types::Point< T >& point,
+                                const size_t       lineNumber = 0u );
+    template< typename T >
+    static KDStatus parsePoint( const std::string& line,
+                                Types::Point< T >& point,
+                                const size_t       lineNumber = 0u );
+        // Parses a line of comma separated coordinates into point, which
+        // is cleared first. Trailing blanks and a carriage return are
+        // accepted. lineNumber is reported in the status on failure.
+
+    template< typename T >
+    static KDStatus readCsv(
+            const std::string&      filename,
+            Types::Points< T >&     points,
+            const AsyncIO::Options& options = AsyncIO::Options() );
+        // Loads one point per line of the CSV file into points, empty
+        // lines skipped. Points must share their dimension. The file is
+        // read through AsyncIO::readBlocks() with options and every block
+        // is parsed while the following ones are read. points is only
+        // modified on success.
+};
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+bool
+Loader::parseCoordinate( const char*& cursor, const char* end, T& value )
+{
+    double parsed;
+    if ( !parseReal( cursor, end, parsed ) )
+    {
+        return false;
+    }
+
+    value = static_cast< T >( parsed );
+
+    return true;
+}
+
+template<>
+inline bool
+Loader::parseCoordinate( const char*& cursor, const char* end, double& value )
+{
+    return parseReal( cursor, end, value );
+}
+
+template<>
+inline bool
+Loader::parseCoordinate( const char*& cursor, const char* end, float& value )
+{
+    return parseReal( cursor, end, value );
+}
+
+template< typename T >
+KDStatus
+Loader::parsePoint( const char*        begin,
+                    const char*        end,
+                    Types::Point< T >& point,
+                    const size_t       lineNumber )
+{
+    point.clear();
+
+    const char* cursor = begin;
+    while ( true )
+    {
+        T value;
+        if ( !parseCoordinate( cursor, end, value ) )
+        {
+            return KDStatus( KDStatus::Code::PARSE_ERROR,
+                             "malformed coordinate",
+                             lineNumber );
+        }
+        point.push_back( value );
+
+        while ( cursor < end &&
+                ( ' ' == *cursor || '\t' == *cursor || '\r' == *cursor ) )
+        {
+            ++cursor;
+        }
+
+        if ( cursor == end || ',' != *cursor )
+        {
+            break;
+        }
+        ++cursor;
+    }
+
+    if ( cursor != end )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "unexpected characters after coordinates",
+                         lineNumber );
+    }
+
+    return KDStatus();
+}
+
+template< typename T >
+KDStatus
+Loader::parsePoint( const std::string& line,
+                    Types::Point< T >& point,
+                    const size_t       lineNumber )
+{
+    return parsePoint( line.data(), line.data() + line.size(),
+                       point, lineNumber );
+}
+
+template< typename T >
+KDStatus
+Loader::readCsv( const std::string&      filename,
+                 Types::Points< T >&     points,
+                 const AsyncIO::Options& options )
+{
+    Types::Points< T > loaded;
+    size_t lineNumber = 0u;
+
+    auto parseLine = [ & ]( const char* begin, const char* end )
+    {
+        ++lineNumber;
+        if ( begin == end || ( begin + 1 == end && '\r' == *begin ) )
+        {
+            return KDStatus();
+        }
+
+        Types::Point< T > point;
+        const KDStatus status = parsePoint( begin, end, point, lineNumber );
+        if ( !status )
+        {
+            return status;
+        }
+
+        if ( !loaded.empty() && loaded[ 0 ].size() != point.size() )
+        {
+            return KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                             "point dimension differs from the first point",
+                             lineNumber );
+        }
+
+        loaded.push_back( std::move( point ) );
+
+        return KDStatus();
+    };
+
+    // Lines spanning a block boundary are gathered in partial
+    std::string partial;
+
+    const KDStatus read = AsyncIO::readBlocks( filename,
+        [ & ]( const char* data, const size_t size )
+        {
+            const char* cursor = data;
+            const char* end    = data + size;
+
+            while ( cursor < end )
+            {
+                const char* newline = static_cast< const char* >(
+                        std::memchr( cursor, '\n', end - cursor ) );
+                if ( !newline )
+                {
+                    partial.append( cursor, end );
+                    break;
+                }
+
+                KDStatus status;
+                if ( partial.empty() )
+                {
+                    status = parseLine( cursor, newline );
+                }
+                else
+                {
+                    partial.append( cursor, newline );
+                    status = parseLine( partial.data(),
+                                        partial.data() + partial.size() );
+                    partial.clear();
+                }
+
+                if ( !status )
+                {
+                    return status;
+                }
+                cursor = newline + 1;
+            }
+
+            return KDStatus();
+        },
+        options );
+
+    if ( !read )
+    {
+        return read;
+    }
+
+    if ( !partial.empty() )
+    {
+        const KDStatus status = parseLine( partial.data(),
+                                           partial.data() + partial.size() );
+        if ( !status )
+        {
+            return status;
+        }
+    }
+
+    points.swap( loaded );
+
+    return KDStatus();
+}
+
+} // namespace datastructures
+
+#endif //KDTREE_LOADER_H
@@ -0,0 +1,222 @@
+#include <cerrno>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "kdtree_log_file.h"
+
+namespace datastructures {
+
+namespace {
+
+std::string directoryOf( const std::string& filename )
+{
+    const size_t slash = filename.rfind( '/' );
+
+    if ( std::string::npos == slash )
+    {
+        return ".";
+    }
+
+    return slash ? filename.substr( 0u, slash ) : "/";
+}
+
+} // anonymous namespace
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+KDLogFile::KDLogFile()
+: m_fd( -1 )
+, m_size( 0u )
+{
+    // nothing to do here
+}
+
+KDLogFile::~KDLogFile()
+{
+    close();
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+KDStatus
+KDLogFile::open( const std::string& filename )
+{
+    close();
+
+    m_fd = ::open( filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644 );
+    if ( m_fd < 0 )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR,
+                         "unable to open file for writing" );
+    }
+
+    struct stat info;
+    if ( fstat( m_fd, &info ) < 0 )
+    {
+        close();
+        return KDStatus( KDStatus::Code::IO_ERROR,
+                         "unable to open file for writing" );
+    }
+    m_size     = static_cast< size_t >( info.st_size );
+    m_filename = filename;
+
+    return KDStatus();
+}
+
+KDStatus
+KDLogFile::append( const std::string& data, const bool sync )
+{
+    size_t written = 0u;
+    while ( written < data.size() )
+    {
+        const ssize_t result = ::write( m_fd, data.data() + written,
+                                        data.size() - written );
+        if ( result < 0 )
+        {
+            if ( EINTR == errno )
+            {
+                continue;
+            }
+            return KDStatus( KDStatus::Code::IO_ERROR,
+                             "failed writing file" );
+        }
+        written += static_cast< size_t >( result );
+        m_size  += static_cast< size_t >( result );
+    }
+
+    if ( sync && fdatasync( m_fd ) < 0 )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "failed writing file" );
+    }
+
+    return KDStatus();
+}
+
+KDStatus
+KDLogFile::truncate( const size_t size )
+{
+    if ( ftruncate( m_fd, static_cast< off_t >( size ) ) < 0 )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "failed writing file" );
+    }
+    m_size = size;
+
+    if ( fdatasync( m_fd ) < 0 )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "failed writing file" );
+    }
+
+    return KDStatus();
+}
+
+void
+KDLogFile::close()
+{
+    if ( m_fd >= 0 )
+    {
+        ::close( m_fd );
+        m_fd = -1;
+    }
+    m_size = 0u;
+    m_filename.clear();
+}
+
+bool
+KDLogFile::isOpen() const
+{
+    return m_fd >= 0;
+}
+
+size_t
+KDLogFile::size() const
+{
+    return m_size;
+}
+
+bool
+KDLogFile::exists( const std::string& filename )
+{
+    struct stat info;
+
+    return 0 == stat( filename.c_str(), &info );
+}
+
+KDStatus
+KDLogFile::syncFile( const std::string& filename )
+{
+    const int fd = ::open( filename.c_str(), O_RDONLY );
+    if ( fd < 0 )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR,
+                         "unable to open file for reading" );
+    }
+
+    const int result = fsync( fd );
+    ::close( fd );
+
+    if ( result < 0 )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "failed writing file" );
+    }
+
+    return KDStatus();
+}
+
+KDStatus
+KDLogFile::replaceFile( const std::string& from, const std::string& to )
+{
+    if ( std::rename( from.c_str(), to.c_str() ) )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "failed renaming file" );
+    }
+
+    // The rename is only durable once the directory is flushed
+    const int fd = ::open( directoryOf( to ).c_str(), O_RDONLY );
+    if ( fd < 0 )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR,
+                         "unable to open directory for reading" );
+    }
+
+    const int result = fsync( fd );
+    ::close( fd );
+
+    if ( result < 0 )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "failed writing file" );
+    }
+
+    return KDStatus();
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+std::ostream&
+KDLogFile::print( std::ostream& out ) const
+{
+    out << "KDLogFile:[ "
+        << "filename = '" << m_filename           << "', "
+        << "open = "      << std::boolalpha << isOpen() << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+std::ostream& operator<<( std::ostream& lhs, const KDLogFile& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
@@ -0,0 +1,94 @@
+#ifndef KDTREE_LOG_FILE_H
+#define KDTREE_LOG_FILE_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "kdtree_status.h"
+
+namespace datastructures {
+
+// PURPOSE:
+//
+// An append-only file handle for write-ahead logs. Every append is a
+// single write() to a file opened with O_APPEND, optionally followed by
+// fdatasync(), so a record is either durable once append() returns or,
+// after a crash, at most the last record is cut short.
+//
+// The static helpers cover the rest of crash safe file replacement :
+// flushing a file written by other means, atomically renaming it over
+// the previous version and flushing the directory entry.
+//
+class KDLogFile {
+public:
+    // CREATORS
+    KDLogFile();
+        // Default constructor, creates a closed log
+
+    ~KDLogFile();
+        // Closes the log
+
+    // PRIMARY INTERFACE
+    KDStatus open( const std::string& filename );
+        // Opens filename for appending, creating it if needed. A log that
+        // is already open is closed first.
+        // Returns successful status or the reason of the failure.
+
+    KDStatus append( const std::string& data, const bool sync = true );
+        // Appends data with a single write, followed by fdatasync() if
+        // sync is true.
+        // Returns successful status or the reason of the failure.
+
+    KDStatus truncate( const size_t size );
+        // Cuts the log down to size bytes, dropping a torn last record.
+        // Returns successful status or the reason of the failure.
+
+    void close();
+        // Closes the log, does nothing if it is not open
+
+    bool isOpen() const;
+        // Returns true if the log is open
+
+    size_t size() const;
+        // Returns size in bytes of the log, including the bytes of a
+        // failed append, 0 if it is not open
+
+    static bool exists( const std::string& filename );
+        // Returns true if filename exists
+
+    static KDStatus syncFile( const std::string& filename );
+        // Flushes contents of filename to stable storage.
+        // Returns successful status or the reason of the failure.
+
+    static KDStatus replaceFile( const std::string& from,
+                                 const std::string& to );
+        // Atomically renames from over to and flushes the directory entry.
+        // Returns successful status or the reason of the failure.
+
+    // ACCESSORS
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the contents of the KDLogFile object in a easy to read
+        // format
+
+private:
+    KDLogFile( const KDLogFile& );
+    KDLogFile& operator=( const KDLogFile& );
+        // Not copyable, the log owns its file descriptor
+
+    int           m_fd;
+        // File descriptor, negative while closed
+
+    size_t        m_size;
+        // Size of the open log
+
+    std::string   m_filename;
+        // Name of the open log
+};
+
+// INDEPENDENT OPERATORS
+std::ostream& operator<<( std::ostream& lhs, const KDLogFile& rhs );
+
+} // close namespace datastructures
+
+#endif // KDTREE_LOG_FILE_H
@@ -0,0 +1,1180 @@
+#ifndef KDTREE_LOGGED_TREE_H
+#define KDTREE_LOGGED_TREE_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "kdtree.h"
+#include "kdtree_log_file.h"
+
+// @Purpose
+//
+// This is a KDTree that accepts point insertions and deletions durably at
+// the cost of the change, not of the whole point set.
+//
+// The points live in two files : a base tree written by KDTree::serialize()
+// and, next to it, a write-ahead log with the suffix
+// Constants::KDTREE_LOG_SUFFIX. Every update appends one record to the log
+// before it is applied in memory. Inserted points are kept in a small
+// overlay that is scanned alongside the base tree, deleted base points are
+// masked out of the base tree results.
+//
+// Compaction folds the log into a new base snapshot on a background thread
+// while updates and queries go on. Points are identified by ids that stay
+// the same across compactions and reloads.
+//
+// The log is a text file :
+//     KDTREE_LOG_MARKER
+//     next id
+//     number of base points
+//     id of every base point, one per line, in the order of the base tree
+//     INSERT id comma separated coordinates
+//     ERASE id
+// with one record per line. A crash during an append may leave the last
+// record incomplete, such a record is dropped on open().
+//
+// A compaction writes the new base and log to temporary files with the
+// suffix Constants::KDTREE_COMPACTION_SUFFIX and renames the base before
+// the log. open() rolls back a compaction interrupted before the first
+// rename and completes one interrupted after it.
+//
+
+namespace datastructures {
+
+template< typename T >
+class KDLoggedTree {
+public:
+    // CREATORS
+    KDLoggedTree();
+        // Default constructor, creates an empty tree with no files attached
+
+    ~KDLoggedTree();
+        // Waits for a running compaction and closes the log
+
+    // PRIMARY INTERFACE
+    KDStatus open( const std::string& filename,
+                   const size_t       numThreads = 0u );
+        // Loads the base tree stored at filename, if any, and replays its
+        // log, creating the log if there is none. A plain tree file is
+        // adopted with ids equal to the original indexes of its points.
+        // numThreads is passed to KDTree::deserialize(), 0 uses all
+        // hardware threads.
+        // The tree is left untouched on failure.
+        // Returns successful status or the reason of the failure, with the
+        // line of the log it was detected on.
+
+    KDStatus insert( const Types::Point< T >& point, size_t& id );
+        // Logs and inserts point, storing its new id in id. Points must
+        // share their dimension.
+        // Returns successful status or the reason of the failure.
+
+    KDStatus erase( const size_t id );
+        // Logs and deletes the point with id.
+        // Returns KDStatus::Code::NOT_FOUND for an unknown id, successful
+        // status or the reason of the failure otherwise.
+
+    bool startCompaction();
+        // Starts folding the log into a new base snapshot on a background
+        // thread. Returns false if a compaction is already running or no
+        // file is open.
+
+    KDStatus waitForCompaction();
+        // Waits for a running compaction. Returns the status of the last
+        // compaction, successful if there was none.
+
+    KDStatus compact();
+        // Compacts synchronously. Calls startCompaction() and
+        // waitForCompaction()
+
+    size_t nearestPointId( const Types::Point< T >& pointOfInterest ) const;
+        // Returns id of the closest point to the point of interest, ties
+        // broken by the smaller id. In case the tree is empty or there is
+        // a cardinality mismatch - KDTREE_ERROR_INDEX is returned
+
+    Types::Indexes pointIdsInRadius( const Types::Point< T >& pointOfInterest,
+                                     const double             radius ) const;
+        // Returns ids of all points whose distance to the point of interest
+        // is less or equal to radius, in no particular order. In case of a
+        // cardinality mismatch - empty container is returned.
+
+    bool contains( const size_t id ) const;
+        // Returns true if a point with id is stored
+
+    Types::Point< T > point( const size_t id ) const;
+        // Returns the point with id, empty point for an unknown id
+
+    size_t size() const;
+        // Returns number of points stored
+
+    size_t pendingRecords() const;
+        // Returns number of log records not yet folded into the base
+
+    // MANIPULATORS
+    void setSync( const bool sync );
+        // Selects whether every append is flushed to stable storage before
+        // the update returns, true by default
+
+    void setCompactionThreshold( const size_t records );
+        // Starts a compaction automatically once the log holds records
+        // records. 0 disables automatic compaction. Defaults to
+        // Constants::KDTREE_LOG_COMPACTION_THRESHOLD
+
+    // ACCESSORS
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the summary of the KDLoggedTree object in a easy to read
+        // format
+
+private:
+    KDLoggedTree( const KDLoggedTree& );
+    KDLoggedTree& operator=( const KDLoggedTree& );
+        // Not copyable, the tree owns its log
+
+    struct Record {
+        Record() : insert( false ), id( 0u ) {}
+        Record( const bool insert_, const size_t id_ )
+        : insert( insert_ ), id( id_ ) {}
+
+        bool                insert;
+            // INSERT or ERASE record
+
+        size_t              id;
+            // Id of the point
+
+        Types::Point< T >   point;
+            // Inserted point, empty for ERASE
+    };
+
+    struct State {
+        State();
+
+        std::shared_ptr< const KDTree< T > >   base;
+            // Base snapshot
+
+        std::vector< size_t >                  baseIds;
+            // Id of every point of the base, by base index
+
+        std::vector< char >                    baseErased;
+            // Deletion mark of every point of the base, by base index
+
+        size_t                                 numBaseErased;
+            // Number of deleted base points
+
+        std::unordered_map< size_t, size_t >   baseIndexes;
+            // Base index of every live base point, by id
+
+        Types::Points< T >                     overlayPoints;
+            // Points inserted since the base snapshot
+
+        std::vector< size_t >                  overlayIds;
+            // Id of every overlay point
+
+        std::unordered_map< size_t, size_t >   overlayIndexes;
+            // Overlay index of every overlay point, by id
+
+        std::vector< Record >                  pending;
+            // Records logged since the base snapshot
+
+        size_t                                 nextId;
+            // Id of the next inserted point
+
+        size_t                                 dimension;
+            // Dimension of the points, 0 until the first point
+    };
+
+    static void initializeBase( State&                               state,
+                                std::shared_ptr< const KDTree< T > > base,
+                                std::vector< size_t >&               ids );
+        // Installs base with ids, clearing deletions and the overlay
+
+    static bool apply( State& state, const Record& record );
+        // Applies record to state. Returns false, leaving state untouched,
+        // if the record conflicts with it
+
+    static void appendRecord( std::string& out, const Record& record );
+        // Appends record as a log line
+
+    static void appendHeader( std::string&                 out,
+                              const size_t                 nextId,
+                              const std::vector< size_t >& ids );
+        // Appends the log header of a base snapshot
+
+    static KDStatus parseLog( const std::vector< const char* >& lines,
+                              State&                            state );
+        // Parses the header and replays the records of a log into state
+        // holding the base tree
+
+    static KDStatus writeLog( const std::string& filename,
+                              const std::string& contents );
+        // Writes a complete log into filename and flushes it
+
+    KDStatus appendLocked( const Record& record );
+        // Appends record to the log, m_mutex held exclusively. A failed
+        // append is cut back off the log, so that neither a record the
+        // tree did not apply nor a torn one stays in it. The log is closed
+        // if that fails as well, failing all later updates.
+
+    bool startCompactionLocked();
+        // Worker for startCompaction(), m_mutex held exclusively
+
+    void compactHelper();
+        // Body of the compaction thread
+
+    State                          m_state;
+        // Points of the tree
+
+    KDLogFile                      m_log;
+        // Open write-ahead log
+
+    std::string                    m_filename;
+        // Name of the base tree file, empty if none is open
+
+    bool                           m_sync;
+        // Flush every append
+
+    size_t                         m_compactionThreshold;
+        // Log records that trigger a compaction, 0 to disable
+
+    bool                           m_compacting;
+        // A compaction is running
+
+    KDStatus                       m_compactionStatus;
+        // Outcome of the last compaction
+
+    std::thread                    m_compaction;
+        // Compaction thread
+
+    mutable std::shared_mutex      m_mutex;
+        // Guards all of the above, queries take it shared
+
+    std::condition_variable_any    m_compacted;
+        // Signalled when a compaction ends
+};
+
+// INDEPENDENT OPERATORS
+template< typename T >
+std::ostream& operator<<( std::ostream& lhs, const KDLoggedTree< T >& rhs );
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+template< typename T >
+KDLoggedTree< T >::State::State()
+: base( new KDTree< T >() )
+, numBaseErased( 0u )
+, nextId( 0u )
+, dimension( 0u )
+{
+    // nothing to do here
+}
+
+template< typename T >
+KDLoggedTree< T >::KDLoggedTree()
+: m_sync( true )
+, m_compactionThreshold( Constants::KDTREE_LOG_COMPACTION_THRESHOLD )
+, m_compacting( false )
+{
+    // nothing to do here
+}
+
+template< typename T >
+KDLoggedTree< T >::~KDLoggedTree()
+{
+    waitForCompaction();
+
+    if ( m_compaction.joinable() )
+    {
+        m_compaction.join();
+    }
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+KDStatus
+KDLoggedTree< T >::open( const std::string& filename,
+                         const size_t       numThreads )
+{
+    waitForCompaction();
+
+    const std::string logFilename = filename + Constants::KDTREE_LOG_SUFFIX;
+    const std::string baseTemporary =
+            filename + Constants::KDTREE_COMPACTION_SUFFIX;
+    const std::string logTemporary =
+            logFilename + Constants::KDTREE_COMPACTION_SUFFIX;
+
+    // The base is renamed before the log, so a remaining temporary base
+    // means the previous pair is complete and a remaining temporary log
+    // alone means it is the log of the new base
+    if ( KDLogFile::exists( baseTemporary ) )
+    {
+        std::remove( baseTemporary.c_str() );
+        std::remove( logTemporary.c_str() );
+    }
+    else if ( KDLogFile::exists( logTemporary ) )
+    {
+        const KDStatus renamed =
+                KDLogFile::replaceFile( logTemporary, logFilename );
+        if ( !renamed )
+        {
+            return renamed;
+        }
+    }
+
+    std::shared_ptr< KDTree< T > > base( new KDTree< T >() );
+    if ( KDLogFile::exists( filename ) )
+    {
+        const KDStatus loaded = base->deserialize( filename, numThreads );
+        if ( !loaded )
+        {
+            return loaded;
+        }
+    }
+
+    State state;
+    std::vector< size_t > ids( base->size() );
+    for ( size_t i = 0; i < ids.size(); ++i )
+    {
+        ids[ i ] = base->originalIndex( i );
+    }
+    initializeBase( state, base, ids );
+
+    if ( KDLogFile::exists( logFilename ) )
+    {
+        std::string contents;
+        const KDStatus read = Text::readFile( logFilename, contents );
+        if ( !read )
+        {
+            return read;
+        }
+
+        // Drop a record cut short by a crash during its append
+        const size_t complete = contents.empty() || '\n' == contents.back() ?
+                                contents.size() :
+                                contents.rfind( '\n' ) + 1u;
+        const bool torn = complete != contents.size();
+        contents.resize( complete );
+
+        std::vector< const char* > lines;
+        Text::splitLines( contents, lines, numThreads );
+
+        const KDStatus parsed = parseLog( lines, state );
+        if ( !parsed )
+        {
+            return parsed;
+        }
+
+        if ( torn )
+        {
+            KDLogFile log;
+            KDStatus truncated = log.open( logFilename );
+            if ( truncated )
+            {
+                truncated = log.truncate( complete );
+            }
+            if ( !truncated )
+            {
+                return truncated;
+            }
+        }
+    }
+    else
+    {
+        std::string contents;
+        appendHeader( contents, state.nextId, state.baseIds );
+        const KDStatus written = writeLog( logTemporary, contents );
+        if ( !written )
+        {
+            return written;
+        }
+
+        const KDStatus renamed =
+                KDLogFile::replaceFile( logTemporary, logFilename );
+        if ( !renamed )
+        {
+            return renamed;
+        }
+    }
+
+    std::unique_lock< std::shared_mutex > lock( m_mutex );
+
+    const KDStatus opened = m_log.open( logFilename );
+    if ( !opened )
+    {
+        return opened;
+    }
+
+    std::swap( m_state, state );
+    m_filename         = filename;
+    m_compactionStatus = KDStatus();
+
+    return KDStatus();
+}
+
+template< typename T >
+KDStatus
+KDLoggedTree< T >::insert( const Types::Point< T >& point, size_t& id )
+{
+    std::unique_lock< std::shared_mutex > lock( m_mutex );
+
+    if ( !m_log.isOpen() )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "log is not open" );
+    }
+
+    if ( point.empty() ||
+         ( m_state.dimension && m_state.dimension != point.size() ) )
+    {
+        return KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                         "point dimension differs from the stored points" );
+    }
+
+    Record record( true, m_state.nextId );
+    record.point = point;
+
+    const KDStatus appended = appendLocked( record );
+    if ( !appended )
+    {
+        return appended;
+    }
+
+    apply( m_state, record );
+    m_state.pending.push_back( record );
+    id = record.id;
+
+    if ( m_compactionThreshold &&
+         m_state.pending.size() >= m_compactionThreshold )
+    {
+        startCompactionLocked();
+    }
+
+    return KDStatus();
+}
+
+template< typename T >
+KDStatus
+KDLoggedTree< T >::erase( const size_t id )
+{
+    std::unique_lock< std::shared_mutex > lock( m_mutex );
+
+    if ( !m_log.isOpen() )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "log is not open" );
+    }
+
+    if ( !m_state.baseIndexes.count( id ) &&
+         !m_state.overlayIndexes.count( id ) )
+    {
+        return KDStatus( KDStatus::Code::NOT_FOUND, "unknown point id" );
+    }
+
+    const Record record( false, id );
+
+    const KDStatus appended = appendLocked( record );
+    if ( !appended )
+    {
+        return appended;
+    }
+
+    apply( m_state, record );
+    m_state.pending.push_back( record );
+
+    if ( m_compactionThreshold &&
+         m_state.pending.size() >= m_compactionThreshold )
+    {
+        startCompactionLocked();
+    }
+
+    return KDStatus();
+}
+
+template< typename T >
+bool
+KDLoggedTree< T >::startCompaction()
+{
+    std::unique_lock< std::shared_mutex > lock( m_mutex );
+
+    return startCompactionLocked();
+}
+
+template< typename T >
+KDStatus
+KDLoggedTree< T >::waitForCompaction()
+{
+    std::unique_lock< std::shared_mutex > lock( m_mutex );
+
+    m_compacted.wait( lock, [ & ]() { return !m_compacting; } );
+
+    return m_compactionStatus;
+}
+
+template< typename T >
+KDStatus
+KDLoggedTree< T >::compact()
+{
+    if ( !startCompaction() )
+    {
+        std::shared_lock< std::shared_mutex > lock( m_mutex );
+        if ( !m_log.isOpen() )
+        {
+            return KDStatus( KDStatus::Code::IO_ERROR, "log is not open" );
+        }
+    }
+
+    return waitForCompaction();
+}
+
+template< typename T >
+size_t
+KDLoggedTree< T >::nearestPointId( const Types::Point< T >& pointOfInterest ) const
+{
+    std::shared_lock< std::shared_mutex > lock( m_mutex );
+
+    const State& state = m_state;
+    if ( !state.dimension || pointOfInterest.size() != state.dimension )
+    {
+        return Constants::KDTREE_ERROR_INDEX;
+    }
+
+    double bestDistance = Constants::KDTREE_MAX_DISTANCE;
+    size_t bestId       = Constants::KDTREE_ERROR_INDEX;
+
+    // Widen the base search until a point that is not deleted shows up
+    // followed by a farther one. Base indexes follow ids only until a
+    // compaction reorders the base, so equidistant points compare ids.
+    const size_t baseSize = state.base->size();
+    if ( baseSize > state.numBaseErased )
+    {
+        for ( size_t k = 1u; ; k = std::min( 2u * k, baseSize ) )
+        {
+            const Types::Indexes found =
+                    state.base->nearestPointIndexes( pointOfInterest, k );
+
+            bestId = Constants::KDTREE_ERROR_INDEX;
+            double distance = Constants::KDTREE_MAX_DISTANCE;
+            for ( size_t i = 0; i < found.size(); ++i )
+            {
+                distance = Utils::squaredDistance(
+                        pointOfInterest, state.base->point( found[ i ] ) );
+                if ( Constants::KDTREE_ERROR_INDEX != bestId &&
+                     distance > bestDistance )
+                {
+                    break;
+                }
+
+                if ( !state.baseErased[ found[ i ] ] &&
+                     state.baseIds[ found[ i ] ] < bestId )
+                {
+                    bestDistance = distance;
+                    bestId       = state.baseIds[ found[ i ] ];
+                }
+            }
+
+            if ( ( Constants::KDTREE_ERROR_INDEX != bestId &&
+                   distance > bestDistance ) || k == baseSize )
+            {
+                break;
+            }
+        }
+    }
+
+    for ( size_t i = 0; i < state.overlayPoints.size(); ++i )
+    {
+        const double distance = Utils::squaredDistance(
+                pointOfInterest, state.overlayPoints[ i ] );
+        if ( distance < bestDistance ||
+             ( distance == bestDistance && state.overlayIds[ i ] < bestId ) )
+        {
+            bestDistance = distance;
+            bestId       = state.overlayIds[ i ];
+        }
+    }
+
+    return bestId;
+}
+
+template< typename T >
+Types::Indexes
+KDLoggedTree< T >::pointIdsInRadius( const Types::Point< T >& pointOfInterest,
+                                     const double             radius ) const
+{
+    std::shared_lock< std::shared_mutex > lock( m_mutex );
+
+    const State& state = m_state;
+    Types::Indexes result;
+    if ( !state.dimension || pointOfInterest.size() != state.dimension )
+    {
+        return result;
+    }
+
+    const Types::Indexes found =
+            state.base->pointIndexesInRadius( pointOfInterest, radius );
+    for ( size_t i = 0; i < found.size(); ++i )
+    {
+        if ( !state.baseErased[ found[ i ] ] )
+        {
+            result.push_back( state.baseIds[ found[ i ] ] );
+        }
+    }
+
+    for ( size_t i = 0; i < state.overlayPoints.size(); ++i )
+    {
+        if ( Utils::squaredDistance( pointOfInterest,
+                                     state.overlayPoints[ i ] ) <=
+             radius * radius )
+        {
+            result.push_back( state.overlayIds[ i ] );
+        }
+    }
+
+    return result;
+}
+
+template< typename T >
+bool
+KDLoggedTree< T >::contains( const size_t id ) const
+{
+    std::shared_lock< std::shared_mutex > lock( m_mutex );
+
+    return m_state.baseIndexes.count( id ) ||
+           m_state.overlayIndexes.count( id );
+}
+
+template< typename T >
+Types::Point< T >
+KDLoggedTree< T >::point( const size_t id ) const
+{
+    std::shared_lock< std::shared_mutex > lock( m_mutex );
+
+    const auto base = m_state.baseIndexes.find( id );
+    if ( m_state.baseIndexes.end() != base )
+    {
+        return m_state.base->point( base->second );
+    }
+
+    const auto overlay = m_state.overlayIndexes.find( id );
+    if ( m_state.overlayIndexes.end() != overlay )
+    {
+        return m_state.overlayPoints[ overlay->second ];
+    }
+
+    return Types::Point< T >();
+}
+
+template< typename T >
+size_t
+KDLoggedTree< T >::size() const
+{
+    std::shared_lock< std::shared_mutex > lock( m_mutex );
+
+    return m_state.base->size() - m_state.numBaseErased +
+           m_state.overlayPoints.size();
+}
+
+template< typename T >
+size_t
+KDLoggedTree< T >::pendingRecords() const
+{
+    std::shared_lock< std::shared_mutex > lock( m_mutex );
+
+    return m_state.pending.size();
+}
+
+//============================================================================
+//                  MANIPULATORS
+//============================================================================
+
+template< typename T >
+void
+KDLoggedTree< T >::setSync( const bool sync )
+{
+    std::unique_lock< std::shared_mutex > lock( m_mutex );
+
+    m_sync = sync;
+}
+
+template< typename T >
+void
+KDLoggedTree< T >::setCompactionThreshold( const size_t records )
+{
+    std::unique_lock< std::shared_mutex > lock( m_mutex );
+
+    m_compactionThreshold = records;
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+template< typename T >
+std::ostream&
+KDLoggedTree< T >::print( std::ostream& out ) const
+{
+    std::shared_lock< std::shared_mutex > lock( m_mutex );
+
+    out << "KDLoggedTree:[ "
+        << "filename = '"        << m_filename                        << "', "
+        << "base size = "        << std::dec << m_state.base->size()  << ", "
+        << "overlay size = "     << std::dec
+                                 << m_state.overlayPoints.size()      << ", "
+        << "pending records = "  << std::dec << m_state.pending.size() << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  PRIVATE METHODS
+//============================================================================
+
+template< typename T >
+void
+KDLoggedTree< T >::initializeBase( State&                               state,
+                                   std::shared_ptr< const KDTree< T > > base,
+                                   std::vector< size_t >&               ids )
+{
+    state.base = base;
+    state.baseIds.swap( ids );
+    state.baseErased.assign( state.baseIds.size(), 0 );
+    state.numBaseErased = 0u;
+
+    state.baseIndexes.clear();
+    state.baseIndexes.reserve( state.baseIds.size() );
+    for ( size_t i = 0; i < state.baseIds.size(); ++i )
+    {
+        state.baseIndexes[ state.baseIds[ i ] ] = i;
+        state.nextId = std::max( state.nextId, state.baseIds[ i ] + 1u );
+    }
+
+    state.overlayPoints.clear();
+    state.overlayIds.clear();
+    state.overlayIndexes.clear();
+    state.pending.clear();
+
+    if ( base->size() )
+    {
+        state.dimension = base->point( 0u ).size();
+    }
+}
+
+template< typename T >
+bool
+KDLoggedTree< T >::apply( State& state, const Record& record )
+{
+    if ( record.insert )
+    {
+        if ( state.baseIndexes.count( record.id ) ||
+             state.overlayIndexes.count( record.id ) ||
+             record.point.empty() ||
+             ( state.dimension && state.dimension != record.point.size() ) )
+        {
+            return false;
+        }
+
+        state.dimension = record.point.size();
+        state.overlayIndexes[ record.id ] = state.overlayPoints.size();
+        state.overlayPoints.push_back( record.point );
+        state.overlayIds.push_back( record.id );
+        state.nextId = std::max( state.nextId, record.id + 1u );
+
+        return true;
+    }
+
+    const auto base = state.baseIndexes.find( record.id );
+    if ( state.baseIndexes.end() != base )
+    {
+        state.baseErased[ base->second ] = 1;
+        ++state.numBaseErased;
+        state.baseIndexes.erase( base );
+
+        return true;
+    }
+
+    const auto overlay = state.overlayIndexes.find( record.id );
+    if ( state.overlayIndexes.end() == overlay )
+    {
+        return false;
+    }
+
+    // Move the last overlay point into the hole
+    const size_t index = overlay->second;
+    state.overlayIndexes.erase( overlay );
+
+    const size_t last = state.overlayPoints.size() - 1u;
+    if ( index != last )
+    {
+        state.overlayPoints[ index ].swap( state.overlayPoints[ last ] );
+        state.overlayIds[ index ] = state.overlayIds[ last ];
+        state.overlayIndexes[ state.overlayIds[ index ] ] = index;
+    }
+    state.overlayPoints.pop_back();
+    state.overlayIds.pop_back();
+
+    return true;
+}
+
+template< typename T >
+void
+KDLoggedTree< T >::appendRecord( std::string& out, const Record& record )
+{
+    if ( record.insert )
+    {
+        out += Constants::KDTREE_LOG_INSERT_MARKER;
+        out += ' ';
+        Text::appendNumber( out, record.id );
+        out += ' ';
+        Text::appendPoint( out, record.point );
+    }
+    else
+    {
+        out += Constants::KDTREE_LOG_ERASE_MARKER;
+        out += ' ';
+        Text::appendNumber( out, record.id );
+        out += '\n';
+    }
+}
+
+template< typename T >
+void
+KDLoggedTree< T >::appendHeader( std::string&                 out,
+                                 const size_t                 nextId,
+                                 const std::vector< size_t >& ids )
+{
+    out += Constants::KDTREE_LOG_MARKER;
+    out += '\n';
+    Text::appendNumber( out, nextId );
+    out += '\n';
+    Text::appendNumber( out, ids.size() );
+    out += '\n';
+
+    for ( size_t i = 0; i < ids.size(); ++i )
+    {
+        Text::appendNumber( out, ids[ i ] );
+        out += '\n';
+    }
+}
+
+template< typename T >
+KDStatus
+KDLoggedTree< T >::parseLog( const std::vector< const char* >& lines,
+                             State&                            state )
+{
+    const size_t numLines = lines.size() - 1u;
+
+    if ( !numLines ||
+         !Text::lineEquals( lines, 0u, Constants::KDTREE_LOG_MARKER ) )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "missing log marker", 1u );
+    }
+
+    // Parses line position holding nothing but an index
+    auto parseIndexLine = [ & ]( const size_t position, size_t& value )
+    {
+        const char* cursor = lines[ position ];
+        const char* end    = Text::lineEnd( lines, position );
+
+        return position < numLines &&
+               Loader::parseIndex( cursor, end, value ) &&
+               cursor == end;
+    };
+
+    size_t nextId   = 0u;
+    size_t numIds   = 0u;
+    if ( !parseIndexLine( 1u, nextId ) )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "malformed next id", 2u );
+    }
+
+    if ( !parseIndexLine( 2u, numIds ) )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "malformed number of base points", 3u );
+    }
+
+    if ( numIds != state.base->size() )
+    {
+        return KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                         "log does not match the base tree", 3u );
+    }
+
+    std::vector< size_t > ids( numIds );
+    for ( size_t i = 0; i < numIds; ++i )
+    {
+        if ( !parseIndexLine( 3u + i, ids[ i ] ) )
+        {
+            return KDStatus( KDStatus::Code::PARSE_ERROR,
+                             "malformed base point id", 4u + i );
+        }
+    }
+
+    initializeBase( state, state.base, ids );
+    if ( state.baseIndexes.size() != numIds )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "duplicate base point id", 3u );
+    }
+    state.nextId = std::max( state.nextId, nextId );
+
+    const std::string insertMarker = Constants::KDTREE_LOG_INSERT_MARKER + ' ';
+    const std::string eraseMarker  = Constants::KDTREE_LOG_ERASE_MARKER + ' ';
+
+    for ( size_t position = 3u + numIds; position < numLines; ++position )
+    {
+        const char* cursor = lines[ position ];
+        const char* end    = Text::lineEnd( lines, position );
+        const size_t length = static_cast< size_t >( end - cursor );
+
+        Record record;
+        bool parsed = false;
+        if ( length > insertMarker.size() &&
+             0 == insertMarker.compare( 0u, insertMarker.size(),
+                                        cursor, insertMarker.size() ) )
+        {
+            cursor += insertMarker.size();
+            record.insert = true;
+            parsed = Loader::parseIndex( cursor, end, record.id ) &&
+                     Loader::parsePoint( cursor, end, record.point );
+        }
+        else if ( length > eraseMarker.size() &&
+                  0 == eraseMarker.compare( 0u, eraseMarker.size(),
+                                            cursor, eraseMarker.size() ) )
+        {
+            cursor += eraseMarker.size();
+            parsed = Loader::parseIndex( cursor, end, record.id ) &&
+                     cursor == end;
+        }
+
+        if ( !parsed )
+        {
+            return KDStatus( KDStatus::Code::PARSE_ERROR,
+                             "malformed log record", position + 1u );
+        }
+
+        if ( !apply( state, record ) )
+        {
+            return KDStatus( KDStatus::Code::PARSE_ERROR,
+                             "log record conflicts with the points",
+                             position + 1u );
+        }
+        state.pending.push_back( record );
+    }
+
+    return KDStatus();
+}
+
+template< typename T >
+KDStatus
+KDLoggedTree< T >::writeLog( const std::string& filename,
+                             const std::string& contents )
+{
+    const KDStatus written =
+            Text::writeFile( filename, std::vector< std::string >( 1u, contents ) );
+    if ( !written )
+    {
+        return written;
+    }
+
+    return KDLogFile::syncFile( filename );
+}
+
+template< typename T >
+KDStatus
+KDLoggedTree< T >::appendLocked( const Record& record )
+{
+    std::string out;
+    appendRecord( out, record );
+
+    const size_t   logSize  = m_log.size();
+    const KDStatus appended = m_log.append( out, m_sync );
+    if ( !appended )
+    {
+        // The record may be in the log, in part or whole, even though
+        // the update fails
+        if ( !m_log.truncate( logSize ) )
+        {
+            m_log.close();
+        }
+    }
+
+    return appended;
+}
+
+template< typename T >
+bool
+KDLoggedTree< T >::startCompactionLocked()
+{
+    if ( m_compacting || !m_log.isOpen() )
+    {
+        return false;
+    }
+
+    // A previous compaction has already signalled its end
+    if ( m_compaction.joinable() )
+    {
+        m_compaction.join();
+    }
+
+    m_compacting       = true;
+    m_compactionStatus = KDStatus();
+    m_compaction       = std::thread( &KDLoggedTree::compactHelper, this );
+
+    return true;
+}
+
+template< typename T >
+void
+KDLoggedTree< T >::compactHelper()
+{
+    // Snapshot the live points, updates go on while the new base is built
+    Types::Points< T >    points;
+    std::vector< size_t > ids;
+    size_t                snapshot = 0u;
+    size_t                nextId   = 0u;
+    std::string           filename;
+    {
+        std::shared_lock< std::shared_mutex > lock( m_mutex );
+
+        const State& state = m_state;
+        points.reserve( state.base->size() - state.numBaseErased +
+                        state.overlayPoints.size() );
+        ids.reserve( points.capacity() );
+
+        for ( size_t i = 0; i < state.base->size(); ++i )
+        {
+            if ( !state.baseErased[ i ] )
+            {
+                points.push_back( state.base->point( i ) );
+                ids.push_back( state.baseIds[ i ] );
+            }
+        }
+        points.insert( points.end(), state.overlayPoints.begin(),
+                       state.overlayPoints.end() );
+        ids.insert( ids.end(), state.overlayIds.begin(),
+                    state.overlayIds.end() );
+
+        snapshot = state.pending.size();
+        nextId   = state.nextId;
+        filename = m_filename;
+    }
+
+    const std::string logFilename = filename + Constants::KDTREE_LOG_SUFFIX;
+    const std::string baseTemporary =
+            filename + Constants::KDTREE_COMPACTION_SUFFIX;
+    const std::string logTemporary =
+            logFilename + Constants::KDTREE_COMPACTION_SUFFIX;
+
+    std::shared_ptr< KDTree< T > > base(
+            new KDTree< T >( points, Types::BuildMethod::PRESORTED ) );
+    base->reorder();
+
+    std::vector< size_t > baseIds( base->size() );
+    for ( size_t i = 0; i < baseIds.size(); ++i )
+    {
+        baseIds[ i ] = ids[ base->originalIndex( i ) ];
+    }
+
+    KDStatus status = base->serialize( baseTemporary );
+    if ( status )
+    {
+        status = KDLogFile::syncFile( baseTemporary );
+    }
+
+    if ( status )
+    {
+        std::vector< std::string > contents( 1u );
+        appendHeader( contents[ 0 ], nextId, baseIds );
+        status = Text::writeFile( logTemporary, contents );
+    }
+
+    std::unique_lock< std::shared_mutex > lock( m_mutex );
+
+    // Records logged since the snapshot move on to the new log, the
+    // append flushes the whole file
+    if ( status )
+    {
+        std::string tail;
+        for ( size_t i = snapshot; i < m_state.pending.size(); ++i )
+        {
+            appendRecord( tail, m_state.pending[ i ] );
+        }
+
+        KDLogFile log;
+        status = log.open( logTemporary );
+        if ( status )
+        {
+            status = log.append( tail );
+        }
+    }
+
+    if ( status )
+    {
+        status = KDLogFile::replaceFile( baseTemporary, filename );
+    }
+
+    if ( KDLogFile::exists( baseTemporary ) )
+    {
+        // The previous base and log are still in place
+        std::remove( baseTemporary.c_str() );
+        std::remove( logTemporary.c_str() );
+    }
+    else
+    {
+        // The new base is in place and only matches the new log, open()
+        // completes the rename if it fails here. Appending to the previous
+        // log would lose updates, so it is closed on failure.
+        const KDStatus renamed =
+                KDLogFile::replaceFile( logTemporary, logFilename );
+        if ( status )
+        {
+            status = renamed;
+        }
+
+        if ( status )
+        {
+            status = m_log.open( logFilename );
+        }
+        else
+        {
+            m_log.close();
+        }
+
+        State state;
+        state.dimension = m_state.dimension;
+        state.nextId    = nextId;
+        initializeBase( state, base, baseIds );
+
+        for ( size_t i = snapshot; i < m_state.pending.size(); ++i )
+        {
+            apply( state, m_state.pending[ i ] );
+            state.pending.push_back( m_state.pending[ i ] );
+        }
+
+        std::swap( m_state, state );
+    }
+
+    m_compactionStatus = status;
+    m_compacting       = false;
+    m_compacted.notify_all();
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+template< typename T >
+std::ostream& operator<<( std::ostream& lhs, const KDLoggedTree< T >& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
+
+#endif //KDTREE_LOGGED_TREE_H
@@ -0,0 +1,443 @@
+#ifndef KDTREE_LOOKUP_GRID_H
+#define KDTREE_LOOKUP_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "kdtree_types.h"
+#include "kdtree_node.h"
+#include "kdtree_constants.h"
+#include "kdtree_parallel.h"
+
+namespace datastructures {
+
+// PURPOSE:
+//
+// An acceleration table of a KDTree for low dimensional data. A uniform
+// grid is laid over the bounding box of the tree and every cell points at
+// the deepest node whose region, the part of space its subtree is
+// responsible for, contains the whole cell.
+//
+// A nearest point search starts at the node of the cell of the query
+// instead of the root. The answer found there is final as soon as the
+// ball around the query reaching it lies inside the region of the node,
+// which containsBall() decides; otherwise the search continues from the
+// root seeded with it. Starting nodes are shared by many cells, their
+// regions are stored once.
+//
+// The grid refers to the nodes of the tree, it has to be rebuilt whenever
+// the tree structure changes.
+//
+template< typename T >
+class KDLookupGrid {
+public:
+    // CREATORS
+    KDLookupGrid();
+        // Default constructor, creates an empty grid
+
+    // PRIMARY INTERFACE
+    void build( const std::shared_ptr< KDNode< T > >& root,
+                const size_t                          cellsPerAxis,
+                const size_t                          numThreads = 0u );
+        // Lays cellsPerAxis cells per axis over the bounding box of root
+        // and finds the starting node of every cell, cells processed by
+        // several threads. Leaves the grid empty for an empty tree, for
+        // fewer than 2 cells per axis or for more than
+        // Constants::KDTREE_GRID_MAX_CELLS cells.
+        // numThreads of 0 uses all hardware threads.
+
+    void clear();
+        // Empties the grid
+
+    bool empty() const;
+        // Returns true if the grid holds no cells
+
+    const std::shared_ptr< KDNode< T > >* find(
+            const Types::Point< T >& point,
+            const double*&           region ) const;
+        // Returns the starting node of the cell of point and stores in
+        // region the bounds of the region of the node, low and high bound
+        // of every axis in turn, infinite where unbounded. Returns nullptr
+        // for points outside of the grid. Cardinality is not checked.
+
+    template< typename Metric >
+    static bool containsBall( const double*            region,
+                              const Types::Point< T >& point,
+                              const double             rank );
+        // Returns true if every point at a distance of rank or less from
+        // point lies strictly inside of region
+
+    size_t cellsPerAxis() const;
+        // Returns number of cells per axis, 0 for an empty grid
+
+    size_t numCells() const;
+        // Returns number of cells
+
+    size_t numStartNodes() const;
+        // Returns number of distinct starting nodes
+
+    static size_t defaultCellsPerAxis( const size_t numPoints,
+                                       const size_t dimension );
+        // Returns number of cells per axis giving about
+        // Constants::KDTREE_GRID_POINTS_PER_CELL points per cell, within
+        // Constants::KDTREE_GRID_MAX_CELLS cells. Returns 0 for dimensions
+        // beyond Constants::KDTREE_GRID_MAX_DIMENSION, where the grid
+        // does not pay off.
+
+    // ACCESSORS
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the summary of the KDLookupGrid object in a easy to read
+        // format
+
+private:
+    const std::shared_ptr< KDNode< T > >* descend(
+            const std::shared_ptr< KDNode< T > >& root,
+            size_t                                cell,
+            double*                               region ) const;
+        // Returns the deepest node below root whose region contains cell.
+        // Stores the bounds of that region in region unless it is nullptr.
+
+    size_t                                           m_dimension;
+        // Dimension of the points
+
+    size_t                                           m_cellsPerAxis;
+        // Cells per axis, 0 for an empty grid
+
+    std::vector< double >                            m_origin;
+        // Low corner of the grid
+
+    std::vector< double >                            m_scale;
+        // Cells per unit length of every axis, 0 for an axis of no extent
+
+    std::vector< uint32_t >                          m_cells;
+        // Starting node of every cell, axis 0 varying fastest
+
+    std::vector< std::shared_ptr< KDNode< T > > >    m_nodes;
+        // Distinct starting nodes
+
+    std::vector< double >                            m_regions;
+        // Regions of the starting nodes, 2 * m_dimension bounds each
+};
+
+// INDEPENDENT OPERATORS
+template< typename T >
+std::ostream& operator<<( std::ostream& lhs, const KDLookupGrid< T >& rhs );
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+template< typename T >
+KDLookupGrid< T >::KDLookupGrid()
+: m_dimension( 0u )
+, m_cellsPerAxis( 0u )
+{
+    // nothing to do here
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+void
+KDLookupGrid< T >::build( const std::shared_ptr< KDNode< T > >& root,
+                          const size_t                          cellsPerAxis,
+                          const size_t                          numThreads )
+{
+    clear();
+
+    if ( nullptr == root || cellsPerAxis < 2u )
+    {
+        return;
+    }
+
+    const Types::AxisMinMax< T >& bounds = root->bounds();
+    const size_t dimension = bounds.size();
+
+    size_t numCells = 1u;
+    for ( size_t i = 0; i < dimension; ++i )
+    {
+        if ( numCells > Constants::KDTREE_GRID_MAX_CELLS / cellsPerAxis )
+        {
+            return;
+        }
+        numCells *= cellsPerAxis;
+    }
+
+    m_dimension    = dimension;
+    m_cellsPerAxis = cellsPerAxis;
+    m_origin.resize( dimension );
+    m_scale.resize( dimension );
+    for ( size_t i = 0; i < dimension; ++i )
+    {
+        const double extent = static_cast< double >( bounds[ i ].second ) -
+                              bounds[ i ].first;
+        m_origin[ i ] = bounds[ i ].first;
+        m_scale[ i ]  = extent > 0.0L ? cellsPerAxis / extent : 0.0L;
+    }
+
+    std::vector< const std::shared_ptr< KDNode< T > >* > starts( numCells );
+    Parallel::forEachRange( numCells, numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t cell = begin; cell < end; ++cell )
+            {
+                starts[ cell ] = descend( root, cell, nullptr );
+            }
+        } );
+
+    // Number the distinct starting nodes, storing every region once
+    std::unordered_map< const KDNode< T >*, uint32_t > numbers;
+    m_cells.resize( numCells );
+    for ( size_t cell = 0; cell < numCells; ++cell )
+    {
+        const KDNode< T >* node = starts[ cell ]->get();
+
+        const auto found = numbers.find( node );
+        if ( numbers.end() != found )
+        {
+            m_cells[ cell ] = found->second;
+            continue;
+        }
+
+        const uint32_t number = static_cast< uint32_t >( m_nodes.size() );
+        numbers[ node ] = number;
+        m_cells[ cell ] = number;
+        m_nodes.push_back( *starts[ cell ] );
+
+        m_regions.resize( m_regions.size() + 2u * dimension );
+        descend( root, cell, &m_regions[ m_regions.size() - 2u * dimension ] );
+    }
+}
+
+template< typename T >
+void
+KDLookupGrid< T >::clear()
+{
+    m_dimension    = 0u;
+    m_cellsPerAxis = 0u;
+    m_origin.clear();
+    m_scale.clear();
+    m_cells.clear();
+    m_nodes.clear();
+    m_regions.clear();
+}
+
+template< typename T >
+bool
+KDLookupGrid< T >::empty() const
+{
+    return m_cells.empty();
+}
+
+template< typename T >
+const std::shared_ptr< KDNode< T > >*
+KDLookupGrid< T >::find( const Types::Point< T >& point,
+                         const double*&           region ) const
+{
+    if ( m_cells.empty() )
+    {
+        return nullptr;
+    }
+
+    size_t cell   = 0u;
+    size_t stride = 1u;
+    for ( size_t i = 0; i < m_dimension; ++i )
+    {
+        const double offset = ( static_cast< double >( point[ i ] ) -
+                                m_origin[ i ] ) * m_scale[ i ];
+
+        // Also rejects NaN
+        if ( !( offset >= 0.0L && offset <= m_cellsPerAxis ) )
+        {
+            return nullptr;
+        }
+
+        const size_t index = std::min( static_cast< size_t >( offset ),
+                                       m_cellsPerAxis - 1u );
+        cell   += index * stride;
+        stride *= m_cellsPerAxis;
+    }
+
+    const uint32_t number = m_cells[ cell ];
+    region = &m_regions[ number * 2u * m_dimension ];
+
+    return &m_nodes[ number ];
+}
+
+template< typename T >
+template< typename Metric >
+bool
+KDLookupGrid< T >::containsBall( const double*            region,
+                                 const Types::Point< T >& point,
+                                 const double             rank )
+{
+    const size_t dimension = point.size();
+    for ( size_t i = 0; i < dimension; ++i )
+    {
+        const double below = static_cast< double >( point[ i ] ) -
+                             region[ 2u * i ];
+        const double above = region[ 2u * i + 1u ] -
+                             static_cast< double >( point[ i ] );
+
+        // A point outside of the region has a negative offset
+        if ( !( below > 0.0L ) || Metric::axisRank( below ) <= rank ||
+             !( above > 0.0L ) || Metric::axisRank( above ) <= rank )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template< typename T >
+size_t
+KDLookupGrid< T >::cellsPerAxis() const
+{
+    return m_cellsPerAxis;
+}
+
+template< typename T >
+size_t
+KDLookupGrid< T >::numCells() const
+{
+    return m_cells.size();
+}
+
+template< typename T >
+size_t
+KDLookupGrid< T >::numStartNodes() const
+{
+    return m_nodes.size();
+}
+
+template< typename T >
+size_t
+KDLookupGrid< T >::defaultCellsPerAxis( const size_t numPoints,
+                                        const size_t dimension )
+{
+    if ( !dimension || dimension > Constants::KDTREE_GRID_MAX_DIMENSION )
+    {
+        return 0u;
+    }
+
+    const double cells = std::min(
+            static_cast< double >( numPoints ) /
+                    Constants::KDTREE_GRID_POINTS_PER_CELL,
+            static_cast< double >( Constants::KDTREE_GRID_MAX_CELLS ) );
+
+    // Guard the root against rounding just below an integer
+    return static_cast< size_t >(
+            std::pow( cells, 1.0L / dimension ) + 1e-9 );
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+template< typename T >
+std::ostream&
+KDLookupGrid< T >::print( std::ostream& out ) const
+{
+    out << "KDLookupGrid:[ "
+        << "cells per axis = "  << std::dec << m_cellsPerAxis   << ", "
+        << "cells = "           << std::dec << m_cells.size()   << ", "
+        << "start nodes = "     << std::dec << m_nodes.size()   << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  PRIVATE METHODS
+//============================================================================
+
+template< typename T >
+const std::shared_ptr< KDNode< T > >*
+KDLookupGrid< T >::descend( const std::shared_ptr< KDNode< T > >& root,
+                            size_t                                cell,
+                            double*                               region ) const
+{
+    std::vector< double > low( m_dimension );
+    std::vector< double > high( m_dimension );
+    for ( size_t i = 0; i < m_dimension; ++i )
+    {
+        const size_t index = cell % m_cellsPerAxis;
+        cell /= m_cellsPerAxis;
+
+        // An axis of no extent has a single coordinate, all in cell 0
+        if ( m_scale[ i ] > 0.0L )
+        {
+            low[ i ]  = m_origin[ i ] + index / m_scale[ i ];
+            high[ i ] = m_origin[ i ] + ( index + 1u ) / m_scale[ i ];
+        }
+        else
+        {
+            low[ i ]  = m_origin[ i ];
+            high[ i ] = std::numeric_limits< double >::infinity();
+        }
+
+        if ( nullptr != region )
+        {
+            region[ 2u * i ]      = -std::numeric_limits< double >::infinity();
+            region[ 2u * i + 1u ] =  std::numeric_limits< double >::infinity();
+        }
+    }
+
+    // Queries below the hyperplane value go left, the rest right
+    const std::shared_ptr< KDNode< T > >* node = &root;
+    while ( !( *node )->isLeaf() )
+    {
+        const KDHyperplane< T >& hyperplane = ( *node )->hyperplane();
+        const size_t axis  = hyperplane.hyperplaneIndex();
+        const double value = hyperplane.value();
+
+        const std::shared_ptr< KDNode< T > >* next = nullptr;
+        if ( high[ axis ] <= value )
+        {
+            next = &( *node )->left();
+            if ( nullptr != region && nullptr != *next )
+            {
+                region[ 2u * axis + 1u ] =
+                        std::min( region[ 2u * axis + 1u ], value );
+            }
+        }
+        else if ( low[ axis ] >= value )
+        {
+            next = &( *node )->right();
+            if ( nullptr != region && nullptr != *next )
+            {
+                region[ 2u * axis ] = std::max( region[ 2u * axis ], value );
+            }
+        }
+
+        if ( nullptr == next || nullptr == *next )
+        {
+            break;
+        }
+        node = next;
+    }
+
+    return node;
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+template< typename T >
+std::ostream& operator<<( std::ostream& lhs, const KDLookupGrid< T >& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
+
+#endif // KDTREE_LOOKUP_GRID_H
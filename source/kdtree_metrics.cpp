@@ -0,0 +1,5 @@
+#include "kdtree_metrics.h"
+
+namespace datastructures {
+
+} // namespace datastructures
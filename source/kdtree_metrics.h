@@ -0,0 +1,211 @@
+#ifndef KDTREE_METRICS_H
+#define KDTREE_METRICS_H
+
+#include <cmath>
+
+#include "kdtree_types.h"
+#include "kdtree_utils.h"
+
+// @Purpose
+//
+// This file provides the distance metrics KDTree is parameterized with.
+// A metric is a struct of static functions resolved at compile time.
+//
+// Searches never compare distances directly but their ranks, a monotone
+// transform of the distance that is cheaper to compute, e.g. the squared
+// distance for the Euclidean metric. A metric must provide
+//
+//     double rank( p1, p2 )          - rank of the distance of two points
+//     double axisRank( offset )      - rank of the distance to a point that
+//                                      differs by offset on a single axis,
+//                                      which never exceeds the rank of any
+//                                      point beyond a hyperplane at offset
+//     double rankToBox( p, box )     - smallest rank of any point of box
+//     double maxRankToBox( p, box )  - largest rank of any point of box
+//     double toRank( distance )
+//     double fromRank( rank )
+//
+// and its rank must scale as toRank( c ) * rank for points scaled by c.
+
+namespace datastructures {
+
+struct KDEuclideanMetric {
+    // PRIMARY INTERFACE
+    template< typename T >
+    static double rank( const Types::Point< T >& p1,
+                        const Types::Point< T >& p2 );
+        // Returns the squared Euclidean distance. Cardinality is not
+        // checked.
+
+    static double axisRank( const double offset );
+        // Returns offset squared
+
+    template< typename T >
+    static double rankToBox( const Types::Point< T >&      p,
+                             const Types::AxisMinMax< T >& box );
+        // Returns the smallest squared distance to the box
+
+    template< typename T >
+    static double maxRankToBox( const Types::Point< T >&      p,
+                                const Types::AxisMinMax< T >& box );
+        // Returns the largest squared distance to the box
+
+    static double toRank( const double distance );
+        // Returns distance squared
+
+    static double fromRank( const double rank );
+        // Returns square root of rank
+};
+
+struct KDManhattanMetric {
+    // PRIMARY INTERFACE
+    template< typename T >
+    static double rank( const Types::Point< T >& p1,
+                        const Types::Point< T >& p2 );
+        // Returns the sum of absolute coordinate differences. Cardinality
+        // is not checked.
+
+    static double axisRank( const double offset );
+        // Returns absolute value of offset
+
+    template< typename T >
+    static double rankToBox( const Types::Point< T >&      p,
+                             const Types::AxisMinMax< T >& box );
+        // Returns the smallest Manhattan distance to the box
+
+    template< typename T >
+    static double maxRankToBox( const Types::Point< T >&      p,
+                                const Types::AxisMinMax< T >& box );
+        // Returns the largest Manhattan distance to the box
+
+    static double toRank( const double distance );
+        // Returns distance, ranks are distances
+
+    static double fromRank( const double rank );
+        // Returns rank, ranks are distances
+};
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+inline double
+KDEuclideanMetric::rank( const Types::Point< T >& p1,
+                         const Types::Point< T >& p2 )
+{
+    return Utils::squaredDistance< T >( p1, p2 );
+}
+
+inline double
+KDEuclideanMetric::axisRank( const double offset )
+{
+    return offset * offset;
+}
+
+template< typename T >
+inline double
+KDEuclideanMetric::rankToBox( const Types::Point< T >&      p,
+                              const Types::AxisMinMax< T >& box )
+{
+    return Utils::squaredDistanceToBox< T >( p, box );
+}
+
+template< typename T >
+inline double
+KDEuclideanMetric::maxRankToBox( const Types::Point< T >&      p,
+                                 const Types::AxisMinMax< T >& box )
+{
+    return Utils::maxSquaredDistanceToBox< T >( p, box );
+}
+
+inline double
+KDEuclideanMetric::toRank( const double distance )
+{
+    return distance * distance;
+}
+
+inline double
+KDEuclideanMetric::fromRank( const double rank )
+{
+    return std::sqrt( rank );
+}
+
+template< typename T >
+inline double
+KDManhattanMetric::rank( const Types::Point< T >& p1,
+                         const Types::Point< T >& p2 )
+{
+    double dist = 0.0L;
+
+    const size_t size = p1.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        dist += std::abs( static_cast< double >( p1[ i ] ) - p2[ i ] );
+    }
+
+    return dist;
+}
+
+inline double
+KDManhattanMetric::axisRank( const double offset )
+{
+    return std::abs( offset );
+}
+
+template< typename T >
+inline double
+KDManhattanMetric::rankToBox( const Types::Point< T >&      p,
+                              const Types::AxisMinMax< T >& box )
+{
+    double dist = 0.0L;
+
+    const size_t size = box.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        if ( p[ i ] < box[ i ].first )
+        {
+            dist += static_cast< double >( box[ i ].first ) - p[ i ];
+        }
+        else if ( p[ i ] > box[ i ].second )
+        {
+            dist += static_cast< double >( p[ i ] ) - box[ i ].second;
+        }
+    }
+
+    return dist;
+}
+
+template< typename T >
+inline double
+KDManhattanMetric::maxRankToBox( const Types::Point< T >&      p,
+                                 const Types::AxisMinMax< T >& box )
+{
+    double dist = 0.0L;
+
+    const size_t size = box.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        dist += std::max(
+                std::abs( static_cast< double >( p[ i ] ) - box[ i ].first ),
+                std::abs( static_cast< double >( p[ i ] ) - box[ i ].second ) );
+    }
+
+    return dist;
+}
+
+inline double
+KDManhattanMetric::toRank( const double distance )
+{
+    return distance;
+}
+
+inline double
+KDManhattanMetric::fromRank( const double rank )
+{
+    return rank;
+}
+
+} // namespace datastructures
+
+#endif //KDTREE_METRICS_H
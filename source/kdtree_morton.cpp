@@ -0,0 +1,171 @@
+#include <algorithm>
+
+#include "kdtree_morton.h"
+
+namespace datastructures {
+
+namespace {
+
+uint64_t spreadBy1( uint64_t value )
+{
+    value &= 0x00000000FFFFFFFFull;
+    value = ( value | ( value << 16 ) ) & 0x0000FFFF0000FFFFull;
+    value = ( value | ( value <<  8 ) ) & 0x00FF00FF00FF00FFull;
+    value = ( value | ( value <<  4 ) ) & 0x0F0F0F0F0F0F0F0Full;
+    value = ( value | ( value <<  2 ) ) & 0x3333333333333333ull;
+    value = ( value | ( value <<  1 ) ) & 0x5555555555555555ull;
+    return value;
+}
+
+uint64_t spreadBy2( uint64_t value )
+{
+    value &= 0x00000000001FFFFFull;
+    value = ( value | ( value << 32 ) ) & 0x001F00000000FFFFull;
+    value = ( value | ( value << 16 ) ) & 0x001F0000FF0000FFull;
+    value = ( value | ( value <<  8 ) ) & 0x100F00F00F00F00Full;
+    value = ( value | ( value <<  4 ) ) & 0x10C30C30C30C30C3ull;
+    value = ( value | ( value <<  2 ) ) & 0x1249249249249249ull;
+    return value;
+}
+
+const size_t RADIX_BITS    = 8u;
+const size_t RADIX_BUCKETS = 1u << RADIX_BITS;
+
+} // anonymous namespace
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+size_t
+Morton::bitsPerAxis( const size_t dimension )
+{
+    if ( !dimension || dimension > 64u )
+    {
+        return 0u;
+    }
+
+    const size_t bits = 64u / dimension;
+
+    return bits > 32u ? 32u : bits;
+}
+
+uint64_t
+Morton::interleave( const std::vector< uint32_t >& quantized,
+                    const size_t                   bits )
+{
+    const size_t dimension = quantized.size();
+
+    // Bit tricks for the common low dimensional cases
+    if ( 2u == dimension && 32u == bits )
+    {
+        return spreadBy1( quantized[ 0 ] ) | ( spreadBy1( quantized[ 1 ] ) << 1 );
+    }
+
+    if ( 3u == dimension && 21u == bits )
+    {
+        return spreadBy2( quantized[ 0 ] )        |
+               ( spreadBy2( quantized[ 1 ] ) << 1 ) |
+               ( spreadBy2( quantized[ 2 ] ) << 2 );
+    }
+
+    uint64_t code = 0u;
+    for ( size_t bit = 0; bit < bits; ++bit )
+    {
+        for ( size_t axis = 0; axis < dimension; ++axis )
+        {
+            code |= static_cast< uint64_t >( ( quantized[ axis ] >> bit ) & 1u )
+                    << ( bit * dimension + axis );
+        }
+    }
+
+    return code;
+}
+
+void
+Morton::radixSort( std::vector< uint64_t >& codes,
+                   Types::Indexes&          indexes,
+                   const size_t             numThreads )
+{
+    const size_t size = codes.size();
+    if ( size < 2u )
+    {
+        return;
+    }
+
+    size_t chunks = Parallel::numThreads( numThreads );
+    if ( chunks > size )
+    {
+        chunks = size;
+    }
+    const size_t chunkSize = ( size + chunks - 1u ) / chunks;
+    chunks = ( size + chunkSize - 1u ) / chunkSize;
+
+    std::vector< uint64_t > codesBuffer( size );
+    Types::Indexes          indexesBuffer( size );
+    std::vector< size_t >   histograms( chunks * RADIX_BUCKETS );
+
+    for ( size_t shift = 0; shift < 64u; shift += RADIX_BITS )
+    {
+        // Histogram every chunk
+        Parallel::forEachRange( size, chunks,
+            [ & ]( const size_t begin, const size_t end, const size_t chunk )
+            {
+                size_t* histogram = &histograms[ chunk * RADIX_BUCKETS ];
+                std::fill( histogram, histogram + RADIX_BUCKETS, 0u );
+
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    ++histogram[ ( codes[ i ] >> shift ) &
+                                 ( RADIX_BUCKETS - 1u ) ];
+                }
+            } );
+
+        // Skip passes where every code shares the digit
+        const size_t firstDigit = ( codes[ 0 ] >> shift ) &
+                                  ( RADIX_BUCKETS - 1u );
+        size_t sameDigit = 0;
+        for ( size_t chunk = 0; chunk < chunks; ++chunk )
+        {
+            sameDigit += histograms[ chunk * RADIX_BUCKETS + firstDigit ];
+        }
+        if ( sameDigit == size )
+        {
+            continue;
+        }
+
+        // Turn counts into scatter offsets, bucket major and chunk minor
+        // so that the scatter stays stable
+        size_t offset = 0;
+        for ( size_t bucket = 0; bucket < RADIX_BUCKETS; ++bucket )
+        {
+            for ( size_t chunk = 0; chunk < chunks; ++chunk )
+            {
+                const size_t count =
+                        histograms[ chunk * RADIX_BUCKETS + bucket ];
+                histograms[ chunk * RADIX_BUCKETS + bucket ] = offset;
+                offset += count;
+            }
+        }
+
+        Parallel::forEachRange( size, chunks,
+            [ & ]( const size_t begin, const size_t end, const size_t chunk )
+            {
+                size_t* offsets = &histograms[ chunk * RADIX_BUCKETS ];
+
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    const size_t target =
+                            offsets[ ( codes[ i ] >> shift ) &
+                                     ( RADIX_BUCKETS - 1u ) ]++;
+                    codesBuffer[ target ]   = codes[ i ];
+                    indexesBuffer[ target ] = indexes[ i ];
+                }
+            } );
+
+        codes.swap( codesBuffer );
+        indexes.swap( indexesBuffer );
+    }
+}
+
+} // namespace datastructures
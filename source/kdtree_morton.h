@@ -0,0 +1,111 @@
+#ifndef KDTREE_MORTON_H
+#define KDTREE_MORTON_H
+
+#include <cstdint>
+#include <vector>
+
+#include "kdtree_types.h"
+#include "kdtree_parallel.h"
+
+// @Purpose
+//
+// This struct provides Morton (Z-order) encoding of points and a parallel
+// radix sort of the resulting codes, the two building blocks of the linear
+// time bulk loader of KDTree.
+//
+// A code interleaves the quantized coordinates of a point bit by bit : bit
+// b of axis a ends up at position b * dimension + a of the code. Points
+// sorted by code are therefore grouped by the highest differing bit, which
+// always corresponds to a single axis aligned split.
+
+namespace datastructures {
+
+struct Morton {
+    // PRIMARY INTERFACE
+    static size_t bitsPerAxis( const size_t dimension );
+        // Returns the number of quantization bits per axis that fit into a
+        // 64 bit code, at most 32. Returns 0 for dimension 0 or dimension
+        // larger than 64.
+
+    static uint64_t interleave( const std::vector< uint32_t >& quantized,
+                                const size_t                   bits );
+        // Interleaves the lowest bits of every quantized coordinate into a
+        // single code
+
+    template< typename T >
+    static std::vector< uint64_t > encode(
+            const Types::Points< T >&     points,
+            const Types::AxisMinMax< T >& bounds,
+            const size_t                  numThreads = 0u );
+        // Quantizes every point onto a grid of 2^bitsPerAxis() cells per
+        // axis spanning bounds and returns its code. Quantization is
+        // monotone per axis, so a point with a smaller coordinate never
+        // gets a larger quantized value.
+        // numThreads of 0 uses all hardware threads.
+
+    static void radixSort( std::vector< uint64_t >& codes,
+                           Types::Indexes&          indexes,
+                           const size_t             numThreads = 0u );
+        // Stable LSD radix sort of codes, applying the same permutation to
+        // indexes. Every pass histograms and scatters contiguous chunks in
+        // parallel, passes over a constant digit are skipped.
+        // numThreads of 0 uses all hardware threads.
+};
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+std::vector< uint64_t >
+Morton::encode( const Types::Points< T >&     points,
+                const Types::AxisMinMax< T >& bounds,
+                const size_t                  numThreads )
+{
+    std::vector< uint64_t > codes( points.size(), 0u );
+
+    const size_t dimension = bounds.size();
+    const size_t bits      = bitsPerAxis( dimension );
+
+    if ( !bits )
+    {
+        return codes;
+    }
+
+    const double cells = static_cast< double >(
+            ( static_cast< uint64_t >( 1u ) << bits ) - 1u );
+
+    std::vector< double > scales;
+    scales.reserve( dimension );
+    for ( size_t i = 0; i < dimension; ++i )
+    {
+        const double extent = static_cast< double >( bounds[ i ].second ) -
+                              bounds[ i ].first;
+        scales.push_back( extent > 0.0L ? cells / extent : 0.0L );
+    }
+
+    Parallel::forEachRange( points.size(), numThreads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            std::vector< uint32_t > quantized( dimension );
+
+            for ( size_t i = begin; i < end; ++i )
+            {
+                for ( size_t j = 0; j < dimension; ++j )
+                {
+                    double cell = ( static_cast< double >( points[ i ][ j ] ) -
+                                    bounds[ j ].first ) * scales[ j ];
+                    cell = cell < 0.0L ? 0.0L : ( cell > cells ? cells : cell );
+                    quantized[ j ] = static_cast< uint32_t >( cell );
+                }
+
+                codes[ i ] = interleave( quantized, bits );
+            }
+        } );
+
+    return codes;
+}
+
+} // namespace datastructures
+
+#endif //KDTREE_MORTON_H
@@ -34,8 +34,8 @@ public:
     KDNode( const KDNode& other );
         // Copy constructor, calls copy().
 
-    virtual ~KDNode();
-        // Destructor
+    ~KDNode();
+        // Destructor, non-virtual as nodes are never used polymorphically
 
     // OPERATORS
     KDNode& operator=( const KDNode& other );
@@ -53,11 +53,13 @@ public:
     const KDHyperplane< T >& hyperplane() const;
         // Returns diving hyperplane represented by this node
 
-    std::shared_ptr< KDNode< T > > left() const;
-        // Return shared pointer to the left subtree
+    const std::shared_ptr< KDNode< T > >& left() const;
+        // Return shared pointer to the left subtree. Returned by reference
+        // so that concurrent traversals do not contend on the ref count
 
-    std::shared_ptr< KDNode< T > > right() const;
-        // Return shared pointer to the right subtree
+    const std::shared_ptr< KDNode< T > >& right() const;
+        // Return shared pointer to the right subtree. Returned by reference
+        // so that concurrent traversals do not contend on the ref count
 
     size_t leafPointIndex() const;
         // Return index point stored in KDTree that this node
@@ -67,10 +69,39 @@ public:
     bool isLeaf() const;
         // Returns true if a node is leaf and false otherwise
 
+    size_t count() const;
+        // Returns number of points stored in the subtree rooted at this
+        // node. Leaves count 1, non-leaf nodes count their children at
+        // construction time.
+
+    const Types::AxisMinMax< T >& bounds() const;
+        // Returns per axis min/max values of the points stored in the
+        // subtree rooted at this node. Empty until setBounds() is called,
+        // KDTree sets it for every node once the tree is assembled.
+
+    double sum() const;
+        // Returns sum of values attached to the points stored in the
+        // subtree rooted at this node. 0 until setSum() is called, KDTree
+        // sets it for every node once the tree is assembled.
+
     // MANIPULATORS
     void copy( const KDNode& other );
         // Copies the value of other into this
 
+    void setBounds( const Types::AxisMinMax< T >& bounds );
+        // Sets per axis min/max values of the points in this subtree
+
+    void setSum( const double sum );
+        // Sets sum of values attached to the points in this subtree
+
+    void setLeafPointIndex( const size_t leafPointIndex );
+        // Sets index of the point represented by this leaf, used when the
+        // points of the tree are renumbered
+
+    void setHyperplane( const KDHyperplane< T >& hyperplane );
+        // Sets dividing hyperplane of this non-leaf node, used when the
+        // hyperplane is moved within the gap between the subtrees
+
     // ACCESSORS
     bool equals( const KDNode& other ) const;
         // Worker for equality - call this in child classes when overloading
@@ -92,6 +123,15 @@ private:
 
     size_t                             m_leafPointIndex;
         // Index of leaf point in the KDTree
+
+    size_t                             m_count;
+        // Number of points in this subtree
+
+    Types::AxisMinMax< T >             m_bounds;
+        // Bounding box of the points in this subtree
+
+    double                             m_sum;
+        // Sum of values attached to the points in this subtree
 };
 
 // INDEPENDENT OPERATORS
@@ -108,6 +148,8 @@ KDNode< T >::KDNode()
 : m_left(           nullptr )
 , m_right(          nullptr )
 , m_leafPointIndex( Constants::KDTREE_ERROR_INDEX )
+, m_count(          0u )
+, m_sum(            0.0L )
 {
     // nothing to do here
 }
@@ -120,6 +162,9 @@ KDNode< T >::KDNode( const KDHyperplane< T >&               hyperplane,
 , m_left(           left )
 , m_right(          right )
 , m_leafPointIndex( Constants::KDTREE_ERROR_INDEX )
+, m_count( ( left  ? left->count()  : 0u ) +
+           ( right ? right->count() : 0u ) )
+, m_sum(            0.0L )
 {
     // nothing to do here
 }
@@ -129,6 +174,8 @@ KDNode< T >::KDNode( const size_t leafPointIndex )
 : m_left(           nullptr )
 , m_right(          nullptr )
 , m_leafPointIndex( leafPointIndex )
+, m_count(          1u )
+, m_sum(            0.0L )
 {
     // nothing to do here
 }
@@ -182,14 +229,14 @@ KDNode< T >::hyperplane() const
 }
 
 template< typename T >
-std::shared_ptr< KDNode< T > >
+const std::shared_ptr< KDNode< T > >&
 KDNode< T >::left() const
 {
     return m_left;
 }
 
 template< typename T >
-std::shared_ptr< KDNode< T > >
+const std::shared_ptr< KDNode< T > >&
 KDNode< T >::right() const
 {
     return m_right;
@@ -210,6 +257,27 @@ KDNode< T >::isLeaf() const
     return ( m_leafPointIndex != Constants::KDTREE_ERROR_INDEX );
 }
 
+template< typename T >
+size_t
+KDNode< T >::count() const
+{
+    return m_count;
+}
+
+template< typename T >
+const Types::AxisMinMax< T >&
+KDNode< T >::bounds() const
+{
+    return m_bounds;
+}
+
+template< typename T >
+double
+KDNode< T >::sum() const
+{
+    return m_sum;
+}
+
 //============================================================================
 //                  MANIPULATORS
 //============================================================================
@@ -222,6 +290,37 @@ KDNode< T >::copy( const KDNode< T >& other )
     m_left            = other.left();
     m_right           = other.right();
     m_leafPointIndex  = other.leafPointIndex();
+    m_count           = other.count();
+    m_bounds          = other.bounds();
+    m_sum             = other.sum();
+}
+
+template< typename T >
+void
+KDNode< T >::setBounds( const Types::AxisMinMax< T >& bounds )
+{
+    m_bounds = bounds;
+}
+
+template< typename T >
+void
+KDNode< T >::setSum( const double sum )
+{
+    m_sum = sum;
+}
+
+template< typename T >
+void
+KDNode< T >::setLeafPointIndex( const size_t leafPointIndex )
+{
+    m_leafPointIndex = leafPointIndex;
+}
+
+template< typename T >
+void
+KDNode< T >::setHyperplane( const KDHyperplane< T >& hyperplane )
+{
+    m_hyperplane = hyperplane;
 }
 
 //============================================================================
@@ -247,7 +346,8 @@ KDNode< T >::print( std::ostream& out ) const
         << "hyperplane = "       << m_hyperplane                 << ", "
         << "left ptr = '"        << std::hex << m_left           << "', "
         << "right ptr = '"       << std::hex << m_right          << "', "
-        << "leaf point index = " << std::dec << m_leafPointIndex << " ]";
+        << "leaf point index = " << std::dec << m_leafPointIndex << ", "
+        << "count = "            << std::dec << m_count          << " ]";
 
     return out;
 }
@@ -0,0 +1,895 @@
+#ifndef KDTREE_OCTREE_H
+#define KDTREE_OCTREE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "kdtree_types.h"
+#include "kdtree_utils.h"
+#include "kdtree_constants.h"
+#include "kdtree_loader.h"
+#include "kdtree_morton.h"
+#include "kdtree_parallel.h"
+#include "kdtree_status.h"
+#include "kdtree_text.h"
+
+namespace datastructures {
+
+// PURPOSE:
+//
+// An octree over 3-D points offering the nearest point, k nearest points,
+// radius and serialization interface of KDTree< T > under the Euclidean
+// metric.
+//
+// Points are Morton (Z-order) encoded and radix sorted, so every octant
+// of every node is a contiguous range of the sorted points. Nodes are
+// stored breadth first in a single array, the children of a node next to
+// each other in Morton order, and refer to each other and to the points
+// by position only: the tree holds no pointers and copies as plain data.
+// A node is split at the first octree level at which its points differ,
+// so chains of single children are never stored, and becomes a leaf
+// bucket of at most Constants::KDTREE_OCTREE_BUCKET_SIZE points or of
+// points sharing a code. Every node keeps the tight bounding box of its
+// points for pruning.
+//
+// Encoding, sorting and every level of the tree are processed by several
+// threads. The structure only depends on the points, so serialize() writes
+// the points and deserialize() rebuilds the tree from them.
+//
+template< typename T >
+class Octree {
+public:
+    // CREATORS
+    Octree();
+        // Default constructor, creates an empty tree
+
+    Octree( const Types::Points< T >& points,
+            const size_t              numThreads = 0u );
+        // Constructor, builds the tree over points. Points that are not
+        // all 3-D, or more than 2^32 - 1 of them, leave the tree empty.
+        // numThreads of 0 uses all hardware threads.
+
+    // OPERATORS
+    bool operator==( const Octree& other ) const;
+        // Equality. Calls equals.
+
+    bool operator!=( const Octree& other ) const;
+        // Non-equality. Calls equals.
+
+    // PRIMARY INTERFACE
+    KDStatus serialize( const std::string& filename,
+                        const size_t       numThreads = 0u ) const;
+        // Writes the points of the tree to the provided file location in
+        // their shortest exact form, formatted by several threads.
+        // numThreads of 0 uses all hardware threads.
+        // Returns successful status or the reason of the failure.
+
+    KDStatus deserialize( const std::string& filename,
+                          const size_t       numThreads = 0u );
+        // Loads the points from a file produced by serialize() and
+        // rebuilds the tree, the tree is left untouched on failure.
+        // numThreads of 0 uses all hardware threads.
+        // Returns successful status or the reason of the failure, with
+        // the line of the file it was detected on.
+
+    const Types::Point< T > nearestPoint(
+            const Types::Point< T >& pointOfInterest ) const;
+        // Returns the closest point in the tree to the point of interest.
+        // In case the tree is empty or there is a cardinality mismatch -
+        // empty point is returned
+
+    size_t nearestPointIndex( const Types::Point< T >& pointOfInterest ) const;
+        // Returns index of the closest point in the tree to the point of
+        // interest, ties broken by the smaller index. In case the tree is
+        // empty or there is a cardinality mismatch - KDTREE_ERROR_INDEX is
+        // returned
+
+    Types::Indexes pointIndexesInRadius(
+            const Types::Point< T >& pointOfInterest,
+            const double             radius ) const;
+        // Returns indexes of all points whose distance to the point of
+        // interest is less or equal to radius, in no particular order.
+        // Nodes whose bounding box lies inside of the ball are reported
+        // without testing their points. In case the tree is empty or there
+        // is a cardinality mismatch - empty container is returned.
+
+    Types::Indexes nearestPointIndexes(
+            const Types::Point< T >& pointOfInterest,
+            const size_t             k ) const;
+        // Returns indexes of the k closest points to the point of interest
+        // sorted by increasing distance, ties broken by the smaller index.
+        // Fewer than k indexes are returned when the tree holds fewer than
+        // k points. In case the tree is empty or there is a cardinality
+        // mismatch - empty container is returned.
+
+    size_t size() const;
+        // Returns number of points stored in the tree
+
+    size_t numNodes() const;
+        // Returns number of nodes of the tree
+
+    const Types::Point< T >& point( const size_t index ) const;
+        // Returns const ref to the point stored under index. Behaviour is
+        // undefined for index >= size()
+
+    const Types::Points< T >& points() const;
+        // Returns the points of the tree in their original order
+
+    // ACCESSORS
+    bool equals( const Octree& other ) const;
+        // Worker for equality, trees are equal if they hold the same points
+        // in the same order
+
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the summary of the Octree object in a easy to read format
+
+private:
+    struct Node {
+        T          m_low[ 3 ];
+            // Low corner of the bounding box of the points of the node
+
+        T          m_high[ 3 ];
+            // High corner of the bounding box of the points of the node
+
+        uint32_t   m_begin;
+            // Sorted position of the first point of the node
+
+        uint32_t   m_end;
+            // Sorted position past the last point of the node
+
+        uint32_t   m_firstChild;
+            // Position of the first child in the node array
+
+        uint32_t   m_numChildren;
+            // Number of children, 0 for a leaf
+    };
+
+    void build( const size_t numThreads );
+        // Builds the nodes over m_points, level by level
+
+    double minRank( const Node& node, const T* point ) const;
+        // Returns squared distance from point to the bounding box of node
+
+    double maxRank( const Node& node, const T* point ) const;
+        // Returns squared distance from point to the farthest corner of
+        // the bounding box of node
+
+    double rank( const size_t position, const T* point ) const;
+        // Returns squared distance from point to the sorted point at
+        // position
+
+    Types::Points< T >        m_points;
+        // Points in their original order
+
+    std::vector< T >          m_coordinates;
+        // Coordinates of the points in Morton order, 3 values each
+
+    std::vector< uint32_t >   m_indexes;
+        // Original index of every sorted point
+
+    std::vector< Node >       m_nodes;
+        // Nodes breadth first, the root first
+};
+
+// INDEPENDENT OPERATORS
+template< typename T >
+std::ostream& operator<<( std::ostream& lhs, const Octree< T >& rhs );
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+template< typename T >
+Octree< T >::Octree()
+{
+    // nothing to do here
+}
+
+template< typename T >
+Octree< T >::Octree( const Types::Points< T >& points,
+                     const size_t              numThreads )
+: m_points( points )
+{
+    bool valid = m_points.size() <= std::numeric_limits< uint32_t >::max();
+    for ( size_t i = 0; valid && i < m_points.size(); ++i )
+    {
+        valid = 3u == m_points[ i ].size();
+    }
+
+    if ( !valid )
+    {
+        std::cerr << "Octree::Octree() expects at most 2^32 - 1 points "
+                  << "of dimension 3, num points = " << m_points.size()
+                  << ", points dropped" << std::endl;
+        m_points.clear();
+    }
+
+    build( numThreads );
+}
+
+//============================================================================
+//                  OPERATORS
+//============================================================================
+
+template< typename T >
+bool
+Octree< T >::operator==( const Octree& other ) const
+{
+    return equals( other );
+}
+
+template< typename T >
+bool
+Octree< T >::operator!=( const Octree& other ) const
+{
+    return !equals( other );
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+KDStatus
+Octree< T >::serialize( const std::string& filename,
+                        const size_t       numThreads ) const
+{
+    const size_t threads = Parallel::numThreads( numThreads );
+    std::vector< std::string > pieces( 1u );
+
+    // First serialize tree type
+    pieces.back() += Constants::KDTREE_OCTREE_VARIETY;
+    pieces.back() += '\n';
+
+    // Second number of points
+    Text::appendNumber( pieces.back(), m_points.size() );
+    pieces.back() += '\n';
+
+    // Third all the points, a piece per thread
+    const size_t pointPieces = pieces.size();
+    pieces.resize( pieces.size() + threads );
+    Parallel::forEachRange( m_points.size(), threads,
+        [ & ]( const size_t begin, const size_t end, const size_t chunk )
+        {
+            std::string& out = pieces[ pointPieces + chunk ];
+            out.reserve( ( end - begin ) * 3u * 24u );
+            for ( size_t i = begin; i < end; ++i )
+            {
+                Text::appendPoint( out, m_points[ i ] );
+            }
+        } );
+
+    return Text::writeFile( filename, pieces );
+}
+
+template< typename T >
+KDStatus
+Octree< T >::deserialize( const std::string& filename,
+                          const size_t       numThreads )
+{
+    const size_t threads = Parallel::numThreads( numThreads );
+
+    std::string contents;
+    const KDStatus read = Text::readFile( filename, contents );
+    if ( !read )
+    {
+        return read;
+    }
+
+    std::vector< const char* > lines;
+    Text::splitLines( contents, lines, threads );
+    const size_t numLines = lines.size() - 1u;
+
+    // First check tree type
+    if ( numLines < 1u ||
+         !Text::lineEquals( lines, 0u, Constants::KDTREE_OCTREE_VARIETY ) )
+    {
+        return KDStatus( KDStatus::Code::TYPE_MISMATCH,
+                         "unexpected tree type",
+                         1u );
+    }
+
+    // Then number of points
+    size_t numOfPoints;
+    const char* cursor = numLines < 2u ? nullptr : lines[ 1 ];
+    if ( nullptr == cursor ||
+         !Loader::parseIndex( cursor, Text::lineEnd( lines, 1u ), numOfPoints ) ||
+         cursor != Text::lineEnd( lines, 1u ) )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "malformed number of points",
+                         2u );
+    }
+
+    if ( numLines - 2u < numOfPoints )
+    {
+        return KDStatus( KDStatus::Code::PARSE_ERROR,
+                         "fewer points than declared",
+                         numLines + 1u );
+    }
+
+    if ( numOfPoints > std::numeric_limits< uint32_t >::max() )
+    {
+        return KDStatus( KDStatus::Code::SIZE_LIMIT,
+                         "octree supports at most 2^32 - 1 points",
+                         2u );
+    }
+
+    // Then all the points, parsed in place by several threads. Every
+    // thread stops at its first failure, the earliest one is reported
+    Types::Points< T > points( numOfPoints );
+    std::vector< KDStatus > failures( threads );
+    Parallel::forEachRange( numOfPoints, threads,
+        [ & ]( const size_t begin, const size_t end, const size_t chunk )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                KDStatus status = Loader::parsePoint(
+                        lines[ 2u + i ], Text::lineEnd( lines, 2u + i ),
+                        points[ i ], 3u + i );
+                if ( status && 3u != points[ i ].size() )
+                {
+                    status = KDStatus( KDStatus::Code::CARDINALITY_MISMATCH,
+                                       "octree points must be 3-D",
+                                       3u + i );
+                }
+                if ( !status )
+                {
+                    failures[ chunk ] = status;
+                    return;
+                }
+            }
+        } );
+
+    for ( size_t chunk = 0; chunk < failures.size(); ++chunk )
+    {
+        if ( !failures[ chunk ] )
+        {
+            return failures[ chunk ];
+        }
+    }
+
+    m_points.swap( points );
+    build( threads );
+
+    return KDStatus();
+}
+
+template< typename T >
+const Types::Point< T >
+Octree< T >::nearestPoint( const Types::Point< T >& pointOfInterest ) const
+{
+    const size_t index = nearestPointIndex( pointOfInterest );
+
+    if ( Constants::KDTREE_ERROR_INDEX == index )
+    {
+        return Types::Point< T >();
+    }
+
+    return m_points[ index ];
+}
+
+template< typename T >
+size_t
+Octree< T >::nearestPointIndex( const Types::Point< T >& pointOfInterest ) const
+{
+    // Sanity
+    if ( m_nodes.empty() || 3u != pointOfInterest.size() )
+    {
+        return Constants::KDTREE_ERROR_INDEX;
+    }
+
+    const T* point = pointOfInterest.data();
+
+    double bestRank  = std::numeric_limits< double >::infinity();
+    size_t bestIndex = Constants::KDTREE_ERROR_INDEX;
+
+    // Every level pushes at most 8 children, the octree is at most
+    // 64 / 3 + 1 levels deep
+    std::pair< double, uint32_t > stack[ 8u * 23u ];
+    size_t depth = 0u;
+    stack[ depth++ ] = std::make_pair( minRank( m_nodes[ 0 ], point ), 0u );
+
+    while ( depth )
+    {
+        const std::pair< double, uint32_t > top = stack[ --depth ];
+
+        // Equally distant boxes may still hold a smaller index
+        if ( top.first > bestRank )
+        {
+            continue;
+        }
+
+        const Node& node = m_nodes[ top.second ];
+        if ( !node.m_numChildren )
+        {
+            for ( uint32_t i = node.m_begin; i < node.m_end; ++i )
+            {
+                const double candidate = rank( i, point );
+                if ( candidate < bestRank ||
+                     ( candidate == bestRank && m_indexes[ i ] < bestIndex ) )
+                {
+                    bestRank  = candidate;
+                    bestIndex = m_indexes[ i ];
+                }
+            }
+            continue;
+        }
+
+        // Children are pushed farthest first, so the nearest is searched
+        // first
+        const size_t first = depth;
+        for ( uint32_t i = 0; i < node.m_numChildren; ++i )
+        {
+            const uint32_t child = node.m_firstChild + i;
+            const double   bound = minRank( m_nodes[ child ], point );
+            if ( bound <= bestRank )
+            {
+                stack[ depth++ ] = std::make_pair( bound, child );
+            }
+        }
+        std::sort( stack + first, stack + depth,
+                   []( const std::pair< double, uint32_t >& lhs,
+                       const std::pair< double, uint32_t >& rhs )
+                   {
+                       return lhs.first > rhs.first;
+                   } );
+    }
+
+    return bestIndex;
+}
+
+template< typename T >
+Types::Indexes
+Octree< T >::pointIndexesInRadius( const Types::Point< T >& pointOfInterest,
+                                   const double             radius ) const
+{
+    Types::Indexes result;
+
+    // Sanity
+    if ( m_nodes.empty() || 3u != pointOfInterest.size() || radius < 0.0L )
+    {
+        return result;
+    }
+
+    const T*     point   = pointOfInterest.data();
+    const double maxRank = radius * radius;
+
+    uint32_t stack[ 8u * 23u ];
+    size_t depth = 0u;
+    stack[ depth++ ] = 0u;
+
+    while ( depth )
+    {
+        const Node& node = m_nodes[ stack[ --depth ] ];
+
+        if ( minRank( node, point ) > maxRank )
+        {
+            continue;
+        }
+
+        if ( this->maxRank( node, point ) <= maxRank )
+        {
+            result.insert( result.end(),
+                           m_indexes.begin() + node.m_begin,
+                           m_indexes.begin() + node.m_end );
+            continue;
+        }
+
+        if ( !node.m_numChildren )
+        {
+            for ( uint32_t i = node.m_begin; i < node.m_end; ++i )
+            {
+                if ( rank( i, point ) <= maxRank )
+                {
+                    result.push_back( m_indexes[ i ] );
+                }
+            }
+            continue;
+        }
+
+        for ( uint32_t i = 0; i < node.m_numChildren; ++i )
+        {
+            stack[ depth++ ] = node.m_firstChild + i;
+        }
+    }
+
+    return result;
+}
+
+template< typename T >
+Types::Indexes
+Octree< T >::nearestPointIndexes( const Types::Point< T >& pointOfInterest,
+                                  const size_t             k ) const
+{
+    Types::Indexes result;
+
+    // Sanity
+    if ( m_nodes.empty() || 3u != pointOfInterest.size() || !k )
+    {
+        return result;
+    }
+
+    const T* point = pointOfInterest.data();
+
+    // Max heap of the best candidates found so far, the worst on top
+    std::priority_queue< std::pair< double, size_t > > best;
+
+    std::pair< double, uint32_t > stack[ 8u * 23u ];
+    size_t depth = 0u;
+    stack[ depth++ ] = std::make_pair( minRank( m_nodes[ 0 ], point ), 0u );
+
+    while ( depth )
+    {
+        const std::pair< double, uint32_t > top = stack[ --depth ];
+
+        if ( best.size() == k && top.first > best.top().first )
+        {
+            continue;
+        }
+
+        const Node& node = m_nodes[ top.second ];
+        if ( !node.m_numChildren )
+        {
+            for ( uint32_t i = node.m_begin; i < node.m_end; ++i )
+            {
+                const std::pair< double, size_t > candidate(
+                        rank( i, point ), m_indexes[ i ] );
+                if ( best.size() < k )
+                {
+                    best.push( candidate );
+                }
+                else if ( candidate < best.top() )
+                {
+                    best.pop();
+                    best.push( candidate );
+                }
+            }
+            continue;
+        }
+
+        const size_t first = depth;
+        for ( uint32_t i = 0; i < node.m_numChildren; ++i )
+        {
+            const uint32_t child = node.m_firstChild + i;
+            const double   bound = minRank( m_nodes[ child ], point );
+            if ( best.size() < k || bound <= best.top().first )
+            {
+                stack[ depth++ ] = std::make_pair( bound, child );
+            }
+        }
+        std::sort( stack + first, stack + depth,
+                   []( const std::pair< double, uint32_t >& lhs,
+                       const std::pair< double, uint32_t >& rhs )
+                   {
+                       return lhs.first > rhs.first;
+                   } );
+    }
+
+    result.resize( best.size() );
+    for ( size_t i = result.size(); i > 0u; --i )
+    {
+        result[ i - 1u ] = best.top().second;
+        best.pop();
+    }
+
+    return result;
+}
+
+template< typename T >
+size_t
+Octree< T >::size() const
+{
+    return m_points.size();
+}
+
+template< typename T >
+size_t
+Octree< T >::numNodes() const
+{
+    return m_nodes.size();
+}
+
+template< typename T >
+const Types::Point< T >&
+Octree< T >::point( const size_t index ) const
+{
+    return m_points[ index ];
+}
+
+template< typename T >
+const Types::Points< T >&
+Octree< T >::points() const
+{
+    return m_points;
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+template< typename T >
+bool
+Octree< T >::equals( const Octree& other ) const
+{
+    return other.m_points == m_points;
+}
+
+template< typename T >
+std::ostream&
+Octree< T >::print( std::ostream& out ) const
+{
+    out << "Octree:[ "
+        << "size = "  << std::dec << size()     << ", "
+        << "nodes = " << std::dec << numNodes() << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  PRIVATE METHODS
+//============================================================================
+
+template< typename T >
+void
+Octree< T >::build( const size_t numThreads )
+{
+    m_coordinates.clear();
+    m_indexes.clear();
+    m_nodes.clear();
+
+    const size_t size = m_points.size();
+    if ( !size )
+    {
+        return;
+    }
+
+    const size_t threads = Parallel::numThreads( numThreads );
+
+    // Sort the points by Morton code of their position in the bounding box
+    std::vector< uint64_t > codes =
+            Morton::encode( m_points, Utils::minMaxPerAxis( m_points ),
+                            threads );
+    Types::Indexes order( size );
+    std::iota( order.begin(), order.end(), 0u );
+    Morton::radixSort( codes, order, threads );
+
+    m_indexes.resize( size );
+    m_coordinates.resize( 3u * size );
+    Parallel::forEachRange( size, threads,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                m_indexes[ i ] = static_cast< uint32_t >( order[ i ] );
+                std::copy( m_points[ order[ i ] ].begin(),
+                           m_points[ order[ i ] ].end(),
+                           m_coordinates.begin() + 3u * i );
+            }
+        } );
+
+    // Split every level of nodes in parallel. Octant boundaries are found
+    // by binary search, codes of a node share every digit above the first
+    // one they differ in
+    Node root;
+    root.m_begin       = 0u;
+    root.m_end         = static_cast< uint32_t >( size );
+    root.m_firstChild  = 0u;
+    root.m_numChildren = 0u;
+    m_nodes.push_back( root );
+
+    std::vector< size_t > levels( 1u, 0u );
+    std::vector< uint32_t > splits;
+    size_t levelBegin = 0u;
+    while ( levelBegin < m_nodes.size() )
+    {
+        const size_t levelEnd = m_nodes.size();
+        levels.push_back( levelEnd );
+
+        // Up to 9 boundaries per node, the number of children in front
+        splits.assign( 10u * ( levelEnd - levelBegin ), 0u );
+        Parallel::forEachRange( levelEnd - levelBegin, threads,
+            [ & ]( const size_t begin, const size_t end, const size_t )
+            {
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    const Node& node = m_nodes[ levelBegin + i ];
+                    uint32_t* split  = &splits[ 10u * i ];
+                    const uint64_t difference = codes[ node.m_begin ] ^
+                                                codes[ node.m_end - 1u ];
+
+                    if ( node.m_end - node.m_begin <=
+                         Constants::KDTREE_OCTREE_BUCKET_SIZE ||
+                         !difference )
+                    {
+                        continue;
+                    }
+
+                    size_t highest = 63u;
+                    while ( !( ( difference >> highest ) & 1u ) )
+                    {
+                        --highest;
+                    }
+                    const size_t shift = highest - highest % 3u;
+
+                    uint32_t position = node.m_begin;
+                    for ( uint64_t octant = 0; octant < 8u; ++octant )
+                    {
+                        const uint32_t next = static_cast< uint32_t >(
+                                std::partition_point(
+                                        codes.begin() + position,
+                                        codes.begin() + node.m_end,
+                                        [ & ]( const uint64_t code )
+                                        {
+                                            return ( ( code >> shift ) & 7u ) <=
+                                                   octant;
+                                        } ) - codes.begin() );
+                        if ( next > position )
+                        {
+                            split[ 1u + split[ 0 ] ] = position;
+                            ++split[ 0 ];
+                            position = next;
+                        }
+                    }
+                    split[ 1u + split[ 0 ] ] = node.m_end;
+                }
+            } );
+
+        size_t next = levelEnd;
+        for ( size_t i = 0; i < levelEnd - levelBegin; ++i )
+        {
+            Node& node = m_nodes[ levelBegin + i ];
+            node.m_firstChild  = static_cast< uint32_t >( next );
+            node.m_numChildren = splits[ 10u * i ];
+            next += node.m_numChildren;
+        }
+
+        m_nodes.resize( next );
+        Parallel::forEachRange( levelEnd - levelBegin, threads,
+            [ & ]( const size_t begin, const size_t end, const size_t )
+            {
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    const Node&     node  = m_nodes[ levelBegin + i ];
+                    const uint32_t* split = &splits[ 10u * i ];
+                    for ( uint32_t j = 0; j < node.m_numChildren; ++j )
+                    {
+                        Node& child = m_nodes[ node.m_firstChild + j ];
+                        child.m_begin       = split[ 1u + j ];
+                        child.m_end         = split[ 2u + j ];
+                        child.m_firstChild  = 0u;
+                        child.m_numChildren = 0u;
+                    }
+                }
+            } );
+
+        levelBegin = levelEnd;
+    }
+
+    // Bounding boxes bottom up, every level from its points or children
+    for ( size_t level = levels.size() - 1u; level > 0u; --level )
+    {
+        const size_t begin = levels[ level - 1u ];
+        const size_t end   = levels[ level ];
+        Parallel::forEachRange( end - begin, threads,
+            [ & ]( const size_t chunkBegin, const size_t chunkEnd,
+                   const size_t )
+            {
+                for ( size_t i = begin + chunkBegin; i < begin + chunkEnd; ++i )
+                {
+                    Node& node = m_nodes[ i ];
+                    for ( size_t axis = 0; axis < 3u; ++axis )
+                    {
+                        node.m_low[ axis ]  = std::numeric_limits< T >::max();
+                        node.m_high[ axis ] = std::numeric_limits< T >::lowest();
+                    }
+
+                    if ( !node.m_numChildren )
+                    {
+                        for ( uint32_t j = node.m_begin; j < node.m_end; ++j )
+                        {
+                            const T* coordinates = &m_coordinates[ 3u * j ];
+                            for ( size_t axis = 0; axis < 3u; ++axis )
+                            {
+                                node.m_low[ axis ] = std::min(
+                                        node.m_low[ axis ], coordinates[ axis ] );
+                                node.m_high[ axis ] = std::max(
+                                        node.m_high[ axis ], coordinates[ axis ] );
+                            }
+                        }
+                        continue;
+                    }
+
+                    for ( uint32_t j = 0; j < node.m_numChildren; ++j )
+                    {
+                        const Node& child = m_nodes[ node.m_firstChild + j ];
+                        for ( size_t axis = 0; axis < 3u; ++axis )
+                        {
+                            node.m_low[ axis ] = std::min(
+                                    node.m_low[ axis ], child.m_low[ axis ] );
+                            node.m_high[ axis ] = std::max(
+                                    node.m_high[ axis ], child.m_high[ axis ] );
+                        }
+                    }
+                }
+            } );
+    }
+}
+
+template< typename T >
+double
+Octree< T >::minRank( const Node& node, const T* point ) const
+{
+    double result = 0.0L;
+    for ( size_t axis = 0; axis < 3u; ++axis )
+    {
+        double temp = 0.0L;
+        if ( point[ axis ] < node.m_low[ axis ] )
+        {
+            temp = static_cast< double >( node.m_low[ axis ] ) - point[ axis ];
+        }
+        else if ( point[ axis ] > node.m_high[ axis ] )
+        {
+            temp = static_cast< double >( point[ axis ] ) - node.m_high[ axis ];
+        }
+        result += temp * temp;
+    }
+
+    return result;
+}
+
+template< typename T >
+double
+Octree< T >::maxRank( const Node& node, const T* point ) const
+{
+    double result = 0.0L;
+    for ( size_t axis = 0; axis < 3u; ++axis )
+    {
+        const double temp = std::max(
+                std::abs( static_cast< double >( point[ axis ] ) -
+                          node.m_low[ axis ] ),
+                std::abs( static_cast< double >( point[ axis ] ) -
+                          node.m_high[ axis ] ) );
+        result += temp * temp;
+    }
+
+    return result;
+}
+
+template< typename T >
+double
+Octree< T >::rank( const size_t position, const T* point ) const
+{
+    const T* coordinates = &m_coordinates[ 3u * position ];
+
+    double result = 0.0L;
+    for ( size_t axis = 0; axis < 3u; ++axis )
+    {
+        const double temp = static_cast< double >( coordinates[ axis ] ) -
+                            point[ axis ];
+        result += temp * temp;
+    }
+
+    return result;
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+template< typename T >
+std::ostream& operator<<( std::ostream& lhs, const Octree< T >& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
+
+#endif // KDTREE_OCTREE_H
@@ -0,0 +1,18 @@
+#include "kdtree_parallel.h"
+
+namespace datastructures {
+
+size_t
+Parallel::numThreads( const size_t requested )
+{
+    if ( requested )
+    {
+        return requested;
+    }
+
+    const size_t hardware = std::thread::hardware_concurrency();
+
+    return hardware ? hardware : 1u;
+}
+
+} // namespace datastructures
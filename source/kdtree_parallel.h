@@ -0,0 +1,84 @@
+#ifndef KDTREE_PARALLEL_H
+#define KDTREE_PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// @Purpose
+//
+// This struct provides a minimal set of helpers for splitting work over
+// std::thread workers. Every helper blocks until all of the work is done,
+// so callers never need to manage thread lifetimes themselves.
+
+namespace datastructures {
+
+struct Parallel {
+    // PRIMARY INTERFACE
+    static size_t numThreads( const size_t requested );
+        // Returns requested number of threads if it is non-zero, otherwise
+        // returns the number of hardware threads (at least 1)
+
+    template< typename Func >
+    static void forEachRange( const size_t size,
+                              const size_t numThreads,
+                              Func         func );
+        // Splits [ 0, size ) into at most numThreads contiguous chunks and
+        // invokes func( begin, end, chunkIndex ) for each of them, one
+        // chunk per thread. The calling thread processes the first chunk.
+        // Chunk boundaries depend only on size and numThreads.
+};
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename Func >
+void
+Parallel::forEachRange( const size_t size,
+                        const size_t numThreads,
+                        Func         func )
+{
+    if ( !size )
+    {
+        return;
+    }
+
+    size_t chunks = Parallel::numThreads( numThreads );
+    if ( chunks > size )
+    {
+        chunks = size;
+    }
+
+    const size_t chunkSize = ( size + chunks - 1u ) / chunks;
+
+    std::vector< std::thread > workers;
+    workers.reserve( chunks - 1u );
+
+    for ( size_t chunk = 1u; chunk < chunks; ++chunk )
+    {
+        const size_t begin = chunk * chunkSize;
+        const size_t end   = std::min( size, begin + chunkSize );
+
+        if ( begin >= end )
+        {
+            break;
+        }
+
+        workers.push_back( std::thread( func, begin, end, chunk ) );
+    }
+
+    func( static_cast< size_t >( 0u ), std::min( size, chunkSize ),
+          static_cast< size_t >( 0u ) );
+
+    for ( std::vector< std::thread >::iterator it = workers.begin();
+          it != workers.end(); ++it )
+    {
+        it->join();
+    }
+}
+
+} // namespace datastructures
+
+#endif //KDTREE_PARALLEL_H
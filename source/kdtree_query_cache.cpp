@@ -0,0 +1,57 @@
+#include "kdtree_query_cache.h"
+
+namespace datastructures {
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+KDCacheStatistics::KDCacheStatistics()
+: exactHits(      0u )
+, cellHits(       0u )
+, cellRejections( 0u )
+, misses(         0u )
+{
+    // nothing to do here
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+double
+KDCacheStatistics::hitRate() const
+{
+    const uint64_t hits    = exactHits + cellHits;
+    const uint64_t lookups = hits + misses;
+
+    return lookups ? static_cast< double >( hits ) / lookups : 0.0;
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+std::ostream&
+KDCacheStatistics::print( std::ostream& out ) const
+{
+    out << "KDCacheStatistics:[ "
+        << "exact hits = "      << std::dec << exactHits      << ", "
+        << "cell hits = "       << std::dec << cellHits       << ", "
+        << "cell rejections = " << std::dec << cellRejections << ", "
+        << "misses = "          << std::dec << misses         << ", "
+        << "hit rate = "        << hitRate()                  << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+std::ostream& operator<<( std::ostream& lhs, const KDCacheStatistics& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
@@ -0,0 +1,526 @@
+#ifndef KDTREE_QUERY_CACHE_H
+#define KDTREE_QUERY_CACHE_H
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kdtree.h"
+
+// @Purpose
+//
+// This is a concurrent cache of nearest point lookups in front of a
+// shared KDTree, for traffic that repeats the same query coordinates.
+//
+// Every answer is cached under the exact bit pattern of the query
+// coordinates. Optionally, queries are also mapped onto a grid of cubic
+// cells of a given size : the first query of a cell searches the two
+// points closest to the cell center c, p1 and p2, and later queries q of
+// the cell reuse p1 when
+//
+//     d( q, p1 ) + d( q, c ) < d( c, p2 ),
+//
+// which by the triangle inequality proves that every other point is
+// farther from q than p1. Cached answers are therefore always exact, a
+// query failing the test is searched in the tree.
+//
+// Entries are spread over independently locked shards, each evicting its
+// least recently used entries beyond its share of the capacity. An entry
+// takes about 100 bytes plus the size of the query coordinates.
+// Replacing the tree drops all of the entries.
+//
+
+namespace datastructures {
+
+struct KDCacheStatistics {
+    // CREATORS
+    KDCacheStatistics();
+        // Default constructor, all counters 0
+
+    // PRIMARY INTERFACE
+    double hitRate() const;
+        // Returns the fraction of lookups answered from the cache, 0 if
+        // there were none
+
+    // ACCESSORS
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the counters in a easy to read format
+
+    uint64_t   exactHits;
+        // Lookups answered by an entry of the same coordinates
+
+    uint64_t   cellHits;
+        // Lookups answered by an entry of their cell
+
+    uint64_t   cellRejections;
+        // Lookups whose cell entry could not be proven exact
+
+    uint64_t   misses;
+        // Lookups searched in the tree
+};
+
+template< typename T,
+          typename SplitPolicy = KDMedianSplit< T >,
+          typename Metric      = KDEuclideanMetric >
+class KDQueryCache {
+public:
+    typedef KDTree< T, SplitPolicy, Metric > Tree;
+
+    // CREATORS
+    explicit KDQueryCache(
+            const size_t maxEntries = Constants::KDTREE_CACHE_CAPACITY,
+            const double cellSize   = 0.0 );
+        // Constructor, creates a cache of at most maxEntries entries with
+        // no tree attached. maxEntries of 0 disables caching. cellSize
+        // greater than 0 enables cell entries of that edge length.
+
+    KDQueryCache( const std::shared_ptr< const Tree >& tree,
+                  const size_t maxEntries = Constants::KDTREE_CACHE_CAPACITY,
+                  const double cellSize   = 0.0 );
+        // Constructor, creates a cache in front of tree
+
+    // PRIMARY INTERFACE
+    size_t nearestPointIndex( const Types::Point< T >& pointOfInterest );
+        // Returns the same index as Tree::nearestPointIndex(), from the
+        // cache where possible. Errors are not cached.
+        // Safe to call concurrently from several threads.
+
+    void setTree( const std::shared_ptr< const Tree >& tree );
+        // Replaces the tree and drops all of the entries. Waits for the
+        // lookups in progress.
+
+    std::shared_ptr< const Tree > tree() const;
+        // Returns the tree in use
+
+    void clear();
+        // Drops all of the entries, statistics are kept
+
+    size_t size() const;
+        // Returns number of entries
+
+    KDCacheStatistics statistics() const;
+        // Returns counters since the creation or the last
+        // resetStatistics()
+
+    void resetStatistics();
+        // Sets all of the counters to 0
+
+    // ACCESSORS
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the summary of the KDQueryCache object in a easy to read
+        // format
+
+private:
+    KDQueryCache( const KDQueryCache& );
+    KDQueryCache& operator=( const KDQueryCache& );
+        // Not copyable, shards own their locks
+
+    struct Entry {
+        std::string   key;
+            // Tagged bit pattern of the coordinates or of the cell
+
+        size_t        index;
+            // Nearest point of the coordinates or of the cell center
+
+        double        clearance;
+            // Distance from the cell center to the second nearest point,
+            // unused by exact entries
+    };
+
+    struct Shard {
+        std::mutex                                  mutex;
+            // Guards the shard
+
+        std::list< Entry >                          entries;
+            // Entries, most recently used first
+
+        std::unordered_map< std::string,
+                            typename std::list< Entry >::iterator >
+                                                    lookup;
+            // Entries by key
+    };
+
+    void initializeShards( const size_t maxEntries );
+        // Creates the shards sharing maxEntries
+
+    Shard& shardOf( const std::string& key );
+        // Returns the shard holding key
+
+    bool find( const std::string& key, Entry& entry );
+        // Copies the entry of key into entry and marks it most recently
+        // used. Returns false if there is none
+
+    void insert( const Entry& entry );
+        // Stores entry, evicting the least recently used entry of a full
+        // shard
+
+    static void exactKey( const Types::Point< T >& point, std::string& key );
+        // Stores the tagged bit pattern of point in key
+
+    bool cellKey( const Types::Point< T >& point,
+                  std::string&             key,
+                  Types::Point< T >&       center ) const;
+        // Stores the tagged cell of point in key and its center in center.
+        // Returns false for coordinates beyond the range of the grid
+
+    std::shared_ptr< const Tree >   m_tree;
+        // Tree in use
+
+    mutable std::shared_mutex       m_treeMutex;
+        // Held shared by lookups and exclusively by setTree()
+
+    std::vector< std::unique_ptr< Shard > >   m_shards;
+        // Shards of the entries
+
+    size_t                          m_shardCapacity;
+        // Entries per shard
+
+    double                          m_cellSize;
+        // Edge length of the cells, 0 if cells are disabled
+
+    std::atomic< uint64_t >         m_exactHits;
+    std::atomic< uint64_t >         m_cellHits;
+    std::atomic< uint64_t >         m_cellRejections;
+    std::atomic< uint64_t >         m_misses;
+        // Statistics counters
+};
+
+// INDEPENDENT OPERATORS
+std::ostream& operator<<( std::ostream& lhs, const KDCacheStatistics& rhs );
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::ostream& operator<<( std::ostream&                                lhs,
+                          const KDQueryCache< T, SplitPolicy, Metric >& rhs );
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDQueryCache< T, SplitPolicy, Metric >::KDQueryCache( const size_t maxEntries,
+                                                      const double cellSize )
+: m_shardCapacity( 0u )
+, m_cellSize( cellSize > 0.0 ? cellSize : 0.0 )
+, m_exactHits( 0u )
+, m_cellHits( 0u )
+, m_cellRejections( 0u )
+, m_misses( 0u )
+{
+    initializeShards( maxEntries );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDQueryCache< T, SplitPolicy, Metric >::KDQueryCache(
+        const std::shared_ptr< const Tree >& tree,
+        const size_t                         maxEntries,
+        const double                         cellSize )
+: m_tree( tree )
+, m_shardCapacity( 0u )
+, m_cellSize( cellSize > 0.0 ? cellSize : 0.0 )
+, m_exactHits( 0u )
+, m_cellHits( 0u )
+, m_cellRejections( 0u )
+, m_misses( 0u )
+{
+    initializeShards( maxEntries );
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T, typename SplitPolicy, typename Metric >
+size_t
+KDQueryCache< T, SplitPolicy, Metric >::nearestPointIndex(
+        const Types::Point< T >& pointOfInterest )
+{
+    std::shared_lock< std::shared_mutex > lock( m_treeMutex );
+
+    if ( !m_tree )
+    {
+        return Constants::KDTREE_ERROR_INDEX;
+    }
+
+    const Tree& tree = *m_tree;
+    if ( m_shards.empty() || !tree.size() ||
+         tree.point( 0u ).size() != pointOfInterest.size() )
+    {
+        return tree.nearestPointIndex( pointOfInterest );
+    }
+
+    Entry entry;
+    exactKey( pointOfInterest, entry.key );
+    if ( find( entry.key, entry ) )
+    {
+        ++m_exactHits;
+        return entry.index;
+    }
+
+    Entry cell;
+    Types::Point< T > center;
+    if ( m_cellSize > 0.0 && cellKey( pointOfInterest, cell.key, center ) )
+    {
+        if ( !find( cell.key, cell ) )
+        {
+            const Types::Indexes nearest =
+                    tree.nearestPointIndexes( center, 2u );
+            cell.index     = nearest[ 0 ];
+            cell.clearance = nearest.size() > 1u ?
+                    Metric::fromRank( Metric::rank(
+                            center, tree.point( nearest[ 1 ] ) ) ) :
+                    Constants::KDTREE_MAX_DISTANCE;
+            insert( cell );
+        }
+
+        // The relative margin absorbs rounding of the three distances
+        const double distance = Metric::fromRank( Metric::rank(
+                pointOfInterest, tree.point( cell.index ) ) );
+        const double offset   = Metric::fromRank( Metric::rank(
+                pointOfInterest, center ) );
+        if ( ( distance + offset ) *
+                     ( 1.0 + Constants::KDTREE_CACHE_RELATIVE_MARGIN ) <
+             cell.clearance )
+        {
+            ++m_cellHits;
+            return cell.index;
+        }
+        ++m_cellRejections;
+    }
+
+    ++m_misses;
+    entry.index     = tree.nearestPointIndex( pointOfInterest );
+    entry.clearance = 0.0;
+    insert( entry );
+
+    return entry.index;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDQueryCache< T, SplitPolicy, Metric >::setTree(
+        const std::shared_ptr< const Tree >& tree )
+{
+    std::unique_lock< std::shared_mutex > lock( m_treeMutex );
+
+    m_tree = tree;
+    clear();
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::shared_ptr< const typename KDQueryCache< T, SplitPolicy, Metric >::Tree >
+KDQueryCache< T, SplitPolicy, Metric >::tree() const
+{
+    std::shared_lock< std::shared_mutex > lock( m_treeMutex );
+
+    return m_tree;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDQueryCache< T, SplitPolicy, Metric >::clear()
+{
+    for ( size_t i = 0; i < m_shards.size(); ++i )
+    {
+        Shard& shard = *m_shards[ i ];
+        std::lock_guard< std::mutex > lock( shard.mutex );
+        shard.entries.clear();
+        shard.lookup.clear();
+    }
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+size_t
+KDQueryCache< T, SplitPolicy, Metric >::size() const
+{
+    size_t result = 0u;
+    for ( size_t i = 0; i < m_shards.size(); ++i )
+    {
+        Shard& shard = *m_shards[ i ];
+        std::lock_guard< std::mutex > lock( shard.mutex );
+        result += shard.lookup.size();
+    }
+
+    return result;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+KDCacheStatistics
+KDQueryCache< T, SplitPolicy, Metric >::statistics() const
+{
+    KDCacheStatistics result;
+    result.exactHits      = m_exactHits;
+    result.cellHits       = m_cellHits;
+    result.cellRejections = m_cellRejections;
+    result.misses         = m_misses;
+
+    return result;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDQueryCache< T, SplitPolicy, Metric >::resetStatistics()
+{
+    m_exactHits      = 0u;
+    m_cellHits       = 0u;
+    m_cellRejections = 0u;
+    m_misses         = 0u;
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::ostream&
+KDQueryCache< T, SplitPolicy, Metric >::print( std::ostream& out ) const
+{
+    out << "KDQueryCache:[ "
+        << "entries = "    << std::dec << size()                        << ", "
+        << "capacity = "   << std::dec << m_shardCapacity * m_shards.size()
+                                                                        << ", "
+        << "cell size = "  << m_cellSize                                << ", "
+        << "statistics = " << statistics()                              << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  PRIVATE METHODS
+//============================================================================
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDQueryCache< T, SplitPolicy, Metric >::initializeShards(
+        const size_t maxEntries )
+{
+    const size_t numShards = std::min( Constants::KDTREE_CACHE_SHARDS,
+                                       maxEntries );
+    if ( !numShards )
+    {
+        return;
+    }
+
+    m_shardCapacity = maxEntries / numShards;
+    for ( size_t i = 0; i < numShards; ++i )
+    {
+        m_shards.push_back( std::unique_ptr< Shard >( new Shard() ) );
+    }
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+typename KDQueryCache< T, SplitPolicy, Metric >::Shard&
+KDQueryCache< T, SplitPolicy, Metric >::shardOf( const std::string& key )
+{
+    return *m_shards[ std::hash< std::string >()( key ) % m_shards.size() ];
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+bool
+KDQueryCache< T, SplitPolicy, Metric >::find( const std::string& key,
+                                              Entry&             entry )
+{
+    Shard& shard = shardOf( key );
+    std::lock_guard< std::mutex > lock( shard.mutex );
+
+    const auto found = shard.lookup.find( key );
+    if ( shard.lookup.end() == found )
+    {
+        return false;
+    }
+
+    shard.entries.splice( shard.entries.begin(), shard.entries,
+                          found->second );
+    entry.index     = found->second->index;
+    entry.clearance = found->second->clearance;
+
+    return true;
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDQueryCache< T, SplitPolicy, Metric >::insert( const Entry& entry )
+{
+    Shard& shard = shardOf( entry.key );
+    std::lock_guard< std::mutex > lock( shard.mutex );
+
+    // Another thread may have stored the same answer meanwhile
+    if ( shard.lookup.count( entry.key ) )
+    {
+        return;
+    }
+
+    if ( shard.lookup.size() >= m_shardCapacity )
+    {
+        shard.lookup.erase( shard.entries.back().key );
+        shard.entries.pop_back();
+    }
+
+    shard.entries.push_front( entry );
+    shard.lookup[ entry.key ] = shard.entries.begin();
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+void
+KDQueryCache< T, SplitPolicy, Metric >::exactKey(
+        const Types::Point< T >& point,
+        std::string&             key )
+{
+    key.assign( 1u, 'e' );
+    key.append( reinterpret_cast< const char* >( point.data() ),
+                point.size() * sizeof( T ) );
+}
+
+template< typename T, typename SplitPolicy, typename Metric >
+bool
+KDQueryCache< T, SplitPolicy, Metric >::cellKey(
+        const Types::Point< T >& point,
+        std::string&             key,
+        Types::Point< T >&       center ) const
+{
+    // Cells stay exactly representable as 64 bit integers
+    const double limit = 4611686018427387904.0;
+
+    key.assign( 1u, 'c' );
+    center.resize( point.size() );
+
+    for ( size_t i = 0; i < point.size(); ++i )
+    {
+        const double cell = std::floor( static_cast< double >( point[ i ] ) /
+                                        m_cellSize );
+        if ( !( std::abs( cell ) < limit ) )
+        {
+            return false;
+        }
+
+        const int64_t index = static_cast< int64_t >( cell );
+        key.append( reinterpret_cast< const char* >( &index ),
+                    sizeof( index ) );
+        center[ i ] = static_cast< T >( ( cell + 0.5 ) * m_cellSize );
+    }
+
+    return true;
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+template< typename T, typename SplitPolicy, typename Metric >
+std::ostream& operator<<( std::ostream&                                lhs,
+                          const KDQueryCache< T, SplitPolicy, Metric >& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
+
+#endif //KDTREE_QUERY_CACHE_H
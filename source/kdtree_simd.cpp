@@ -0,0 +1,989 @@
+#include <cstdint>
+
+#include "kdtree_simd.h"
+
+#if defined( __x86_64__ ) && defined( __GNUC__ )
+#define KDTREE_SIMD_X86_64
+#include <immintrin.h>
+#endif
+
+namespace datastructures {
+
+namespace {
+
+#ifdef KDTREE_SIMD_X86_64
+
+struct CompressTable {
+    int32_t lanes[ 16 ][ 8 ];
+        // For every 4 bit mask, 32 bit lane permutation moving the selected
+        // 64 bit lanes of a 256 bit register to the front
+
+    CompressTable()
+    {
+        for ( int mask = 0; mask < 16; ++mask )
+        {
+            int selected = 0;
+            for ( int lane = 0; lane < 4; ++lane )
+            {
+                if ( ( mask >> lane ) & 1 )
+                {
+                    lanes[ mask ][ 2 * selected ]      = 2 * lane;
+                    lanes[ mask ][ 2 * selected + 1 ]  = 2 * lane + 1;
+                    ++selected;
+                }
+            }
+            for ( ; selected < 4; ++selected )
+            {
+                lanes[ mask ][ 2 * selected ]     = 0;
+                lanes[ mask ][ 2 * selected + 1 ] = 1;
+            }
+        }
+    }
+};
+
+const CompressTable& compressTable()
+{
+    static const CompressTable table;
+    return table;
+}
+
+Simd::Level detectLevel()
+{
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports( "avx512f" ) )
+    {
+        return Simd::Level::AVX512;
+    }
+
+    if ( __builtin_cpu_supports( "avx2" ) )
+    {
+        return Simd::Level::AVX2;
+    }
+
+    return Simd::Level::SCALAR;
+}
+
+double expandDistance( const double queryNorm,
+                       const double pointNorm,
+                       const double dot )
+{
+    const double distance = queryNorm + pointNorm - 2.0 * dot;
+    return distance > 0.0 ? distance : 0.0;
+}
+
+// Covers the queries and points with ROWS by COLUMNS tiles of TILE, the
+// rows and columns left over go through DOT one pair at a time
+template< typename T,
+          size_t ROWS,
+          size_t COLUMNS,
+          void ( *TILE )( const T* const*, const T* const*, size_t, double* ),
+          double ( *DOT )( const T*, const T*, size_t ) >
+void squaredDistancesTiled( const T* const* queries,
+                            const size_t    numQueries,
+                            const T* const* points,
+                            const size_t    numPoints,
+                            const size_t    dimension,
+                            const double*   queryNorms,
+                            const double*   pointNorms,
+                            double*         distances )
+{
+    double dots[ ROWS * COLUMNS ];
+
+    size_t i = 0;
+    for ( ; i + ROWS <= numQueries; i += ROWS )
+    {
+        size_t j = 0;
+        for ( ; j + COLUMNS <= numPoints; j += COLUMNS )
+        {
+            TILE( queries + i, points + j, dimension, dots );
+            for ( size_t r = 0; r < ROWS; ++r )
+            {
+                for ( size_t c = 0; c < COLUMNS; ++c )
+                {
+                    distances[ ( i + r ) * numPoints + j + c ] =
+                            expandDistance( queryNorms[ i + r ],
+                                            pointNorms[ j + c ],
+                                            dots[ r * COLUMNS + c ] );
+                }
+            }
+        }
+
+        for ( ; j < numPoints; ++j )
+        {
+            for ( size_t r = 0; r < ROWS; ++r )
+            {
+                distances[ ( i + r ) * numPoints + j ] =
+                        expandDistance( queryNorms[ i + r ], pointNorms[ j ],
+                                        DOT( queries[ i + r ], points[ j ],
+                                             dimension ) );
+            }
+        }
+    }
+
+    for ( ; i < numQueries; ++i )
+    {
+        for ( size_t j = 0; j < numPoints; ++j )
+        {
+            distances[ i * numPoints + j ] =
+                    expandDistance( queryNorms[ i ], pointNorms[ j ],
+                                    DOT( queries[ i ], points[ j ],
+                                         dimension ) );
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+//                  AVX2
+//----------------------------------------------------------------------------
+
+__attribute__(( target( "avx2" ) ))
+void minMaxAvx2( const double* values,
+                 const size_t  size,
+                 double&       min,
+                 double&       max )
+{
+    size_t i = 0;
+    min = values[ 0 ];
+    max = values[ 0 ];
+
+    if ( size >= 4u )
+    {
+        __m256d lows  = _mm256_loadu_pd( values );
+        __m256d highs = lows;
+        for ( i = 4u; i + 4u <= size; i += 4u )
+        {
+            const __m256d current = _mm256_loadu_pd( values + i );
+            lows  = _mm256_min_pd( lows,  current );
+            highs = _mm256_max_pd( highs, current );
+        }
+
+        double lanes[ 4 ];
+        _mm256_storeu_pd( lanes, lows );
+        min = lanes[ 0 ];
+        for ( size_t j = 1u; j < 4u; ++j )
+        {
+            min = lanes[ j ] < min ? lanes[ j ] : min;
+        }
+        _mm256_storeu_pd( lanes, highs );
+        max = lanes[ 0 ];
+        for ( size_t j = 1u; j < 4u; ++j )
+        {
+            max = max < lanes[ j ] ? lanes[ j ] : max;
+        }
+    }
+
+    for ( ; i < size; ++i )
+    {
+        min = values[ i ] < min ? values[ i ] : min;
+        max = max < values[ i ] ? values[ i ] : max;
+    }
+}
+
+__attribute__(( target( "avx2" ) ))
+void minMaxAvx2( const float* values,
+                 const size_t size,
+                 float&       min,
+                 float&       max )
+{
+    size_t i = 0;
+    min = values[ 0 ];
+    max = values[ 0 ];
+
+    if ( size >= 8u )
+    {
+        __m256 lows  = _mm256_loadu_ps( values );
+        __m256 highs = lows;
+        for ( i = 8u; i + 8u <= size; i += 8u )
+        {
+            const __m256 current = _mm256_loadu_ps( values + i );
+            lows  = _mm256_min_ps( lows,  current );
+            highs = _mm256_max_ps( highs, current );
+        }
+
+        float lanes[ 8 ];
+        _mm256_storeu_ps( lanes, lows );
+        min = lanes[ 0 ];
+        for ( size_t j = 1u; j < 8u; ++j )
+        {
+            min = lanes[ j ] < min ? lanes[ j ] : min;
+        }
+        _mm256_storeu_ps( lanes, highs );
+        max = lanes[ 0 ];
+        for ( size_t j = 1u; j < 8u; ++j )
+        {
+            max = max < lanes[ j ] ? lanes[ j ] : max;
+        }
+    }
+
+    for ( ; i < size; ++i )
+    {
+        min = values[ i ] < min ? values[ i ] : min;
+        max = max < values[ i ] ? values[ i ] : max;
+    }
+}
+
+__attribute__(( target( "avx2" ) ))
+inline void compressStoreAvx2( const __m256i indexes,
+                               const int     mask,
+                               size_t*       left,
+                               size_t*       right )
+{
+    const CompressTable& table = compressTable();
+
+    const __m256i leftLanes = _mm256_permutevar8x32_epi32(
+            indexes,
+            _mm256_loadu_si256(
+                    reinterpret_cast< const __m256i* >( table.lanes[ mask ] ) ) );
+    const __m256i rightLanes = _mm256_permutevar8x32_epi32(
+            indexes,
+            _mm256_loadu_si256(
+                    reinterpret_cast< const __m256i* >(
+                            table.lanes[ ~mask & 15 ] ) ) );
+
+    _mm256_storeu_si256( reinterpret_cast< __m256i* >( left ),  leftLanes );
+    _mm256_storeu_si256( reinterpret_cast< __m256i* >( right ), rightLanes );
+}
+
+__attribute__(( target( "avx2" ) ))
+size_t partitionAvx2( const double* values,
+                      const size_t* indexes,
+                      const size_t  size,
+                      const double  pivot,
+                      size_t*       left,
+                      size_t*       right )
+{
+    const __m256d pivots = _mm256_set1_pd( pivot );
+
+    size_t numLeft  = 0;
+    size_t numRight = 0;
+    size_t i        = 0;
+
+    // Every full store ends at most at i + 4 <= size
+    for ( ; i + 4u <= size; i += 4u )
+    {
+        const int mask = _mm256_movemask_pd(
+                _mm256_cmp_pd( _mm256_loadu_pd( values + i ), pivots,
+                               _CMP_LT_OQ ) );
+        compressStoreAvx2(
+                _mm256_loadu_si256(
+                        reinterpret_cast< const __m256i* >( indexes + i ) ),
+                mask, left + numLeft, right + numRight );
+
+        const size_t selected = __builtin_popcount( mask );
+        numLeft  += selected;
+        numRight += 4u - selected;
+    }
+
+    return numLeft + Simd::partition< double >( values + i, indexes + i,
+                                                size - i, pivot,
+                                                left + numLeft,
+                                                right + numRight );
+}
+
+__attribute__(( target( "avx2" ) ))
+size_t partitionAvx2( const float*  values,
+                      const size_t* indexes,
+                      const size_t  size,
+                      const float   pivot,
+                      size_t*       left,
+                      size_t*       right )
+{
+    const __m256 pivots = _mm256_set1_ps( pivot );
+
+    size_t numLeft  = 0;
+    size_t numRight = 0;
+    size_t i        = 0;
+
+    // Eight floats cover two registers of 64 bit indexes
+    for ( ; i + 8u <= size; i += 8u )
+    {
+        const int mask = _mm256_movemask_ps(
+                _mm256_cmp_ps( _mm256_loadu_ps( values + i ), pivots,
+                               _CMP_LT_OQ ) );
+
+        for ( size_t half = 0; half < 2u; ++half )
+        {
+            const int halfMask = ( mask >> ( 4u * half ) ) & 15;
+            compressStoreAvx2(
+                    _mm256_loadu_si256( reinterpret_cast< const __m256i* >(
+                            indexes + i + 4u * half ) ),
+                    halfMask, left + numLeft, right + numRight );
+
+            const size_t selected = __builtin_popcount( halfMask );
+            numLeft  += selected;
+            numRight += 4u - selected;
+        }
+    }
+
+    return numLeft + Simd::partition< float >( values + i, indexes + i,
+                                               size - i, pivot,
+                                               left + numLeft,
+                                               right + numRight );
+}
+
+__attribute__(( target( "avx2" ) ))
+inline double sumLanesAvx2( const __m256d sums )
+{
+    double lanes[ 4 ];
+    _mm256_storeu_pd( lanes, sums );
+    return ( lanes[ 0 ] + lanes[ 1 ] ) + ( lanes[ 2 ] + lanes[ 3 ] );
+}
+
+__attribute__(( target( "avx2" ) ))
+inline float sumLanesAvx2( const __m256 sums )
+{
+    float lanes[ 8 ];
+    _mm256_storeu_ps( lanes, sums );
+    return ( ( lanes[ 0 ] + lanes[ 1 ] ) + ( lanes[ 2 ] + lanes[ 3 ] ) ) +
+           ( ( lanes[ 4 ] + lanes[ 5 ] ) + ( lanes[ 6 ] + lanes[ 7 ] ) );
+}
+
+__attribute__(( target( "avx2" ) ))
+double dotAvx2( const double* lhs, const double* rhs, const size_t size )
+{
+    __m256d sums = _mm256_setzero_pd();
+    size_t k = 0;
+    for ( ; k + 4u <= size; k += 4u )
+    {
+        sums = _mm256_add_pd( sums, _mm256_mul_pd( _mm256_loadu_pd( lhs + k ),
+                                                   _mm256_loadu_pd( rhs + k ) ) );
+    }
+
+    double dot = sumLanesAvx2( sums );
+    for ( ; k < size; ++k )
+    {
+        dot += lhs[ k ] * rhs[ k ];
+    }
+
+    return dot;
+}
+
+__attribute__(( target( "avx2" ) ))
+double dotAvx2( const float* lhs, const float* rhs, const size_t size )
+{
+    __m256 sums = _mm256_setzero_ps();
+    size_t k = 0;
+    for ( ; k + 8u <= size; k += 8u )
+    {
+        sums = _mm256_add_ps( sums, _mm256_mul_ps( _mm256_loadu_ps( lhs + k ),
+                                                   _mm256_loadu_ps( rhs + k ) ) );
+    }
+
+    float dot = sumLanesAvx2( sums );
+    for ( ; k < size; ++k )
+    {
+        dot += lhs[ k ] * rhs[ k ];
+    }
+
+    return dot;
+}
+
+// 8 accumulators and 6 loads fit the 16 registers
+__attribute__(( target( "avx2" ) ))
+void dotTileAvx2( const double* const* lhs,
+                  const double* const* rhs,
+                  const size_t         size,
+                  double*              dots )
+{
+    __m256d sums[ 4 ][ 2 ];
+    for ( size_t r = 0; r < 4u; ++r )
+    {
+        sums[ r ][ 0 ] = _mm256_setzero_pd();
+        sums[ r ][ 1 ] = _mm256_setzero_pd();
+    }
+
+    size_t k = 0;
+    for ( ; k + 4u <= size; k += 4u )
+    {
+        const __m256d right0 = _mm256_loadu_pd( rhs[ 0 ] + k );
+        const __m256d right1 = _mm256_loadu_pd( rhs[ 1 ] + k );
+        #pragma GCC unroll 4
+        for ( size_t r = 0; r < 4u; ++r )
+        {
+            const __m256d left = _mm256_loadu_pd( lhs[ r ] + k );
+            sums[ r ][ 0 ] = _mm256_add_pd( sums[ r ][ 0 ],
+                                            _mm256_mul_pd( left, right0 ) );
+            sums[ r ][ 1 ] = _mm256_add_pd( sums[ r ][ 1 ],
+                                            _mm256_mul_pd( left, right1 ) );
+        }
+    }
+
+    for ( size_t r = 0; r < 4u; ++r )
+    {
+        for ( size_t c = 0; c < 2u; ++c )
+        {
+            double dot = sumLanesAvx2( sums[ r ][ c ] );
+            for ( size_t tail = k; tail < size; ++tail )
+            {
+                dot += lhs[ r ][ tail ] * rhs[ c ][ tail ];
+            }
+            dots[ r * 2u + c ] = dot;
+        }
+    }
+}
+
+__attribute__(( target( "avx2" ) ))
+void dotTileAvx2( const float* const* lhs,
+                  const float* const* rhs,
+                  const size_t        size,
+                  double*             dots )
+{
+    __m256 sums[ 4 ][ 2 ];
+    for ( size_t r = 0; r < 4u; ++r )
+    {
+        sums[ r ][ 0 ] = _mm256_setzero_ps();
+        sums[ r ][ 1 ] = _mm256_setzero_ps();
+    }
+
+    size_t k = 0;
+    for ( ; k + 8u <= size; k += 8u )
+    {
+        const __m256 right0 = _mm256_loadu_ps( rhs[ 0 ] + k );
+        const __m256 right1 = _mm256_loadu_ps( rhs[ 1 ] + k );
+        #pragma GCC unroll 4
+        for ( size_t r = 0; r < 4u; ++r )
+        {
+            const __m256 left = _mm256_loadu_ps( lhs[ r ] + k );
+            sums[ r ][ 0 ] = _mm256_add_ps( sums[ r ][ 0 ],
+                                            _mm256_mul_ps( left, right0 ) );
+            sums[ r ][ 1 ] = _mm256_add_ps( sums[ r ][ 1 ],
+                                            _mm256_mul_ps( left, right1 ) );
+        }
+    }
+
+    for ( size_t r = 0; r < 4u; ++r )
+    {
+        for ( size_t c = 0; c < 2u; ++c )
+        {
+            float dot = sumLanesAvx2( sums[ r ][ c ] );
+            for ( size_t tail = k; tail < size; ++tail )
+            {
+                dot += lhs[ r ][ tail ] * rhs[ c ][ tail ];
+            }
+            dots[ r * 2u + c ] = dot;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+//                  AVX-512
+//----------------------------------------------------------------------------
+
+// The unmasked AVX-512 min, max and reduce intrinsics pass undefined
+// registers that GCC reports as uninitialized at -O2. The kernels use the
+// zero-masking forms with a full mask and store accumulators to be folded
+// in halves, in the same order as the _mm512_reduce_* intrinsics
+template< size_t Lanes, typename T, typename Op >
+T reduceLanes( T* lanes, Op op )
+{
+    for ( size_t width = Lanes / 2u; width > 0u; width /= 2u )
+    {
+        for ( size_t i = 0; i < width; ++i )
+        {
+            lanes[ i ] = op( lanes[ i ], lanes[ i + width ] );
+        }
+    }
+
+    return lanes[ 0 ];
+}
+
+template< typename T >
+T minOf( const T lhs, const T rhs )
+{
+    return rhs < lhs ? rhs : lhs;
+}
+
+template< typename T >
+T maxOf( const T lhs, const T rhs )
+{
+    return lhs < rhs ? rhs : lhs;
+}
+
+template< typename T >
+T addOf( const T lhs, const T rhs )
+{
+    return lhs + rhs;
+}
+
+__attribute__(( target( "avx512f" ) ))
+void minMaxAvx512( const double* values,
+                   const size_t  size,
+                   double&       min,
+                   double&       max )
+{
+    size_t i = 0;
+    min = values[ 0 ];
+    max = values[ 0 ];
+
+    if ( size >= 8u )
+    {
+        __m512d lows  = _mm512_loadu_pd( values );
+        __m512d highs = lows;
+        for ( i = 8u; i + 8u <= size; i += 8u )
+        {
+            const __m512d current = _mm512_loadu_pd( values + i );
+            lows  = _mm512_maskz_min_pd( 0xFFu, lows,  current );
+            highs = _mm512_maskz_max_pd( 0xFFu, highs, current );
+        }
+
+        alignas( 64 ) double lanes[ 8 ];
+        _mm512_store_pd( lanes, lows );
+        min = reduceLanes< 8u >( lanes, minOf< double > );
+        _mm512_store_pd( lanes, highs );
+        max = reduceLanes< 8u >( lanes, maxOf< double > );
+    }
+
+    for ( ; i < size; ++i )
+    {
+        min = values[ i ] < min ? values[ i ] : min;
+        max = max < values[ i ] ? values[ i ] : max;
+    }
+}
+
+__attribute__(( target( "avx512f" ) ))
+void minMaxAvx512( const float* values,
+                   const size_t size,
+                   float&       min,
+                   float&       max )
+{
+    size_t i = 0;
+    min = values[ 0 ];
+    max = values[ 0 ];
+
+    if ( size >= 16u )
+    {
+        __m512 lows  = _mm512_loadu_ps( values );
+        __m512 highs = lows;
+        for ( i = 16u; i + 16u <= size; i += 16u )
+        {
+            const __m512 current = _mm512_loadu_ps( values + i );
+            lows  = _mm512_maskz_min_ps( 0xFFFFu, lows,  current );
+            highs = _mm512_maskz_max_ps( 0xFFFFu, highs, current );
+        }
+
+        alignas( 64 ) float lanes[ 16 ];
+        _mm512_store_ps( lanes, lows );
+        min = reduceLanes< 16u >( lanes, minOf< float > );
+        _mm512_store_ps( lanes, highs );
+        max = reduceLanes< 16u >( lanes, maxOf< float > );
+    }
+
+    for ( ; i < size; ++i )
+    {
+        min = values[ i ] < min ? values[ i ] : min;
+        max = max < values[ i ] ? values[ i ] : max;
+    }
+}
+
+__attribute__(( target( "avx512f" ) ))
+size_t partitionAvx512( const double* values,
+                        const size_t* indexes,
+                        const size_t  size,
+                        const double  pivot,
+                        size_t*       left,
+                        size_t*       right )
+{
+    const __m512d pivots = _mm512_set1_pd( pivot );
+
+    size_t numLeft  = 0;
+    size_t numRight = 0;
+    size_t i        = 0;
+
+    for ( ; i + 8u <= size; i += 8u )
+    {
+        const __mmask8 mask = _mm512_cmp_pd_mask(
+                _mm512_loadu_pd( values + i ), pivots, _CMP_LT_OQ );
+        const __m512i lanes = _mm512_loadu_si512( indexes + i );
+
+        _mm512_mask_compressstoreu_epi64( left + numLeft, mask, lanes );
+        _mm512_mask_compressstoreu_epi64( right + numRight,
+                                          static_cast< __mmask8 >( ~mask ),
+                                          lanes );
+
+        const size_t selected = __builtin_popcount( mask );
+        numLeft  += selected;
+        numRight += 8u - selected;
+    }
+
+    return numLeft + Simd::partition< double >( values + i, indexes + i,
+                                                size - i, pivot,
+                                                left + numLeft,
+                                                right + numRight );
+}
+
+__attribute__(( target( "avx512f" ) ))
+size_t partitionAvx512( const float*  values,
+                        const size_t* indexes,
+                        const size_t  size,
+                        const float   pivot,
+                        size_t*       left,
+                        size_t*       right )
+{
+    const __m512 pivots = _mm512_set1_ps( pivot );
+
+    size_t numLeft  = 0;
+    size_t numRight = 0;
+    size_t i        = 0;
+
+    // Sixteen floats cover two registers of 64 bit indexes
+    for ( ; i + 16u <= size; i += 16u )
+    {
+        const __mmask16 mask = _mm512_cmp_ps_mask(
+                _mm512_loadu_ps( values + i ), pivots, _CMP_LT_OQ );
+
+        for ( size_t half = 0; half < 2u; ++half )
+        {
+            const __mmask8 halfMask =
+                    static_cast< __mmask8 >( mask >> ( 8u * half ) );
+            const __m512i lanes =
+                    _mm512_loadu_si512( indexes + i + 8u * half );
+
+            _mm512_mask_compressstoreu_epi64( left + numLeft,
+                                              halfMask, lanes );
+            _mm512_mask_compressstoreu_epi64(
+                    right + numRight,
+                    static_cast< __mmask8 >( ~halfMask ), lanes );
+
+            const size_t selected = __builtin_popcount( halfMask );
+            numLeft  += selected;
+            numRight += 8u - selected;
+        }
+    }
+
+    return numLeft + Simd::partition< float >( values + i, indexes + i,
+                                               size - i, pivot,
+                                               left + numLeft,
+                                               right + numRight );
+}
+
+__attribute__(( target( "avx512f" ) ))
+double dotAvx512( const double* lhs, const double* rhs, const size_t size )
+{
+    __m512d sums = _mm512_setzero_pd();
+    size_t k = 0;
+    for ( ; k + 8u <= size; k += 8u )
+    {
+        sums = _mm512_fmadd_pd( _mm512_loadu_pd( lhs + k ),
+                                _mm512_loadu_pd( rhs + k ), sums );
+    }
+
+    alignas( 64 ) double lanes[ 8 ];
+    _mm512_store_pd( lanes, sums );
+    double dot = reduceLanes< 8u >( lanes, addOf< double > );
+    for ( ; k < size; ++k )
+    {
+        dot += lhs[ k ] * rhs[ k ];
+    }
+
+    return dot;
+}
+
+__attribute__(( target( "avx512f" ) ))
+double dotAvx512( const float* lhs, const float* rhs, const size_t size )
+{
+    __m512 sums = _mm512_setzero_ps();
+    size_t k = 0;
+    for ( ; k + 16u <= size; k += 16u )
+    {
+        sums = _mm512_fmadd_ps( _mm512_loadu_ps( lhs + k ),
+                                _mm512_loadu_ps( rhs + k ), sums );
+    }
+
+    alignas( 64 ) float lanes[ 16 ];
+    _mm512_store_ps( lanes, sums );
+    float dot = reduceLanes< 16u >( lanes, addOf< float > );
+    for ( ; k < size; ++k )
+    {
+        dot += lhs[ k ] * rhs[ k ];
+    }
+
+    return dot;
+}
+
+// 16 accumulators and 8 loads fit the 32 registers
+__attribute__(( target( "avx512f" ) ))
+void dotTileAvx512( const double* const* lhs,
+                    const double* const* rhs,
+                    const size_t         size,
+                    double*              dots )
+{
+    __m512d sums[ 4 ][ 4 ];
+    for ( size_t r = 0; r < 4u; ++r )
+    {
+        for ( size_t c = 0; c < 4u; ++c )
+        {
+            sums[ r ][ c ] = _mm512_setzero_pd();
+        }
+    }
+
+    size_t k = 0;
+    for ( ; k + 8u <= size; k += 8u )
+    {
+        __m512d right[ 4 ];
+        #pragma GCC unroll 4
+        for ( size_t c = 0; c < 4u; ++c )
+        {
+            right[ c ] = _mm512_loadu_pd( rhs[ c ] + k );
+        }
+        #pragma GCC unroll 4
+        for ( size_t r = 0; r < 4u; ++r )
+        {
+            const __m512d left = _mm512_loadu_pd( lhs[ r ] + k );
+            #pragma GCC unroll 4
+            for ( size_t c = 0; c < 4u; ++c )
+            {
+                sums[ r ][ c ] = _mm512_fmadd_pd( left, right[ c ],
+                                                  sums[ r ][ c ] );
+            }
+        }
+    }
+
+    for ( size_t r = 0; r < 4u; ++r )
+    {
+        for ( size_t c = 0; c < 4u; ++c )
+        {
+            alignas( 64 ) double lanes[ 8 ];
+            _mm512_store_pd( lanes, sums[ r ][ c ] );
+            double dot = reduceLanes< 8u >( lanes, addOf< double > );
+            for ( size_t tail = k; tail < size; ++tail )
+            {
+                dot += lhs[ r ][ tail ] * rhs[ c ][ tail ];
+            }
+            dots[ r * 4u + c ] = dot;
+        }
+    }
+}
+
+__attribute__(( target( "avx512f" ) ))
+void dotTileAvx512( const float* const* lhs,
+                    const float* const* rhs,
+                    const size_t        size,
+                    double*             dots )
+{
+    __m512 sums[ 4 ][ 4 ];
+    for ( size_t r = 0; r < 4u; ++r )
+    {
+        for ( size_t c = 0; c < 4u; ++c )
+        {
+            sums[ r ][ c ] = _mm512_setzero_ps();
+        }
+    }
+
+    size_t k = 0;
+    for ( ; k + 16u <= size; k += 16u )
+    {
+        __m512 right[ 4 ];
+        #pragma GCC unroll 4
+        for ( size_t c = 0; c < 4u; ++c )
+        {
+            right[ c ] = _mm512_loadu_ps( rhs[ c ] + k );
+        }
+        #pragma GCC unroll 4
+        for ( size_t r = 0; r < 4u; ++r )
+        {
+            const __m512 left = _mm512_loadu_ps( lhs[ r ] + k );
+            #pragma GCC unroll 4
+            for ( size_t c = 0; c < 4u; ++c )
+            {
+                sums[ r ][ c ] = _mm512_fmadd_ps( left, right[ c ],
+                                                  sums[ r ][ c ] );
+            }
+        }
+    }
+
+    for ( size_t r = 0; r < 4u; ++r )
+    {
+        for ( size_t c = 0; c < 4u; ++c )
+        {
+            alignas( 64 ) float lanes[ 16 ];
+            _mm512_store_ps( lanes, sums[ r ][ c ] );
+            float dot = reduceLanes< 16u >( lanes, addOf< float > );
+            for ( size_t tail = k; tail < size; ++tail )
+            {
+                dot += lhs[ r ][ tail ] * rhs[ c ][ tail ];
+            }
+            dots[ r * 4u + c ] = dot;
+        }
+    }
+}
+
+#endif // KDTREE_SIMD_X86_64
+
+Simd::Level clamp( const Simd::Level level )
+{
+    return level < Simd::supportedLevel() ? level : Simd::supportedLevel();
+}
+
+} // anonymous namespace
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+Simd::Level
+Simd::supportedLevel()
+{
+#ifdef KDTREE_SIMD_X86_64
+    static const Level level = detectLevel();
+    return level;
+#else
+    return Level::SCALAR;
+#endif
+}
+
+void
+Simd::minMax( const float* values,
+              const size_t size,
+              float&       min,
+              float&       max,
+              const Level  level )
+{
+    switch ( clamp( level ) )
+    {
+#ifdef KDTREE_SIMD_X86_64
+    case Level::AVX512:
+        minMaxAvx512( values, size, min, max );
+        return;
+    case Level::AVX2:
+        minMaxAvx2( values, size, min, max );
+        return;
+#endif
+    default:
+        minMax< float >( values, size, min, max );
+    }
+}
+
+void
+Simd::minMax( const double* values,
+              const size_t  size,
+              double&       min,
+              double&       max,
+              const Level   level )
+{
+    switch ( clamp( level ) )
+    {
+#ifdef KDTREE_SIMD_X86_64
+    case Level::AVX512:
+        minMaxAvx512( values, size, min, max );
+        return;
+    case Level::AVX2:
+        minMaxAvx2( values, size, min, max );
+        return;
+#endif
+    default:
+        minMax< double >( values, size, min, max );
+    }
+}
+
+size_t
+Simd::partition( const float*  values,
+                 const size_t* indexes,
+                 const size_t  size,
+                 const float&  pivot,
+                 size_t*       left,
+                 size_t*       right,
+                 const Level   level )
+{
+    switch ( clamp( level ) )
+    {
+#ifdef KDTREE_SIMD_X86_64
+    case Level::AVX512:
+        return partitionAvx512( values, indexes, size, pivot, left, right );
+    case Level::AVX2:
+        return partitionAvx2( values, indexes, size, pivot, left, right );
+#endif
+    default:
+        return partition< float >( values, indexes, size, pivot,
+                                   left, right );
+    }
+}
+
+size_t
+Simd::partition( const double* values,
+                 const size_t* indexes,
+                 const size_t  size,
+                 const double& pivot,
+                 size_t*       left,
+                 size_t*       right,
+                 const Level   level )
+{
+    switch ( clamp( level ) )
+    {
+#ifdef KDTREE_SIMD_X86_64
+    case Level::AVX512:
+        return partitionAvx512( values, indexes, size, pivot, left, right );
+    case Level::AVX2:
+        return partitionAvx2( values, indexes, size, pivot, left, right );
+#endif
+    default:
+        return partition< double >( values, indexes, size, pivot,
+                                    left, right );
+    }
+}
+
+void
+Simd::squaredDistances( const float* const* queries,
+                        const size_t        numQueries,
+                        const float* const* points,
+                        const size_t        numPoints,
+                        const size_t        dimension,
+                        const double*       queryNorms,
+                        const double*       pointNorms,
+                        double*             distances,
+                        const Level         level )
+{
+    switch ( clamp( level ) )
+    {
+#ifdef KDTREE_SIMD_X86_64
+    case Level::AVX512:
+        squaredDistancesTiled< float, 4u, 4u, dotTileAvx512, dotAvx512 >(
+                queries, numQueries, points, numPoints, dimension,
+                queryNorms, pointNorms, distances );
+        return;
+    case Level::AVX2:
+        squaredDistancesTiled< float, 4u, 2u, dotTileAvx2, dotAvx2 >(
+                queries, numQueries, points, numPoints, dimension,
+                queryNorms, pointNorms, distances );
+        return;
+#endif
+    default:
+        squaredDistances< float >( queries, numQueries, points, numPoints,
+                                   dimension, queryNorms, pointNorms,
+                                   distances );
+    }
+}
+
+void
+Simd::squaredDistances( const double* const* queries,
+                        const size_t         numQueries,
+                        const double* const* points,
+                        const size_t         numPoints,
+                        const size_t         dimension,
+                        const double*        queryNorms,
+                        const double*        pointNorms,
+                        double*              distances,
+                        const Level          level )
+{
+    switch ( clamp( level ) )
+    {
+#ifdef KDTREE_SIMD_X86_64
+    case Level::AVX512:
+        squaredDistancesTiled< double, 4u, 4u, dotTileAvx512, dotAvx512 >(
+                queries, numQueries, points, numPoints, dimension,
+                queryNorms, pointNorms, distances );
+        return;
+    case Level::AVX2:
+        squaredDistancesTiled< double, 4u, 2u, dotTileAvx2, dotAvx2 >(
+                queries, numQueries, points, numPoints, dimension,
+                queryNorms, pointNorms, distances );
+        return;
+#endif
+    default:
+        squaredDistances< double >( queries, numQueries, points, numPoints,
+                                    dimension, queryNorms, pointNorms,
+                                    distances );
+    }
+}
+
+} // namespace datastructures
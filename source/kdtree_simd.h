@@ -0,0 +1,206 @@
+#ifndef KDTREE_SIMD_H
+#define KDTREE_SIMD_H
+
+#include <cstddef>
+
+// @Purpose
+//
+// This struct provides the vectorized kernels of the tree build : min/max
+// reduction and branch-free stable partitioning over contiguous coordinate
+// arrays, and the norm expansion distance kernel of blocked brute force
+// searches. The float and double overloads dispatch at runtime to AVX-512
+// or AVX2 code when the CPU supports it, every other type uses the scalar
+// loops of the templates below. All the levels of the build kernels produce
+// identical results, the distance kernel sums in a different order at every
+// level.
+
+namespace datastructures {
+
+struct Simd {
+    enum class Level {
+        SCALAR,
+        AVX2,
+        AVX512
+    };
+
+    // PRIMARY INTERFACE
+    static Level supportedLevel();
+        // Returns the widest instruction set supported by both the CPU and
+        // the build, detected once
+
+    template< typename T >
+    static void minMax( const T*     values,
+                        const size_t size,
+                        T&           min,
+                        T&           max,
+                        const Level  level = Level::SCALAR );
+    static void minMax( const float* values,
+                        const size_t size,
+                        float&       min,
+                        float&       max,
+                        const Level  level = supportedLevel() );
+    static void minMax( const double* values,
+                        const size_t  size,
+                        double&       min,
+                        double&       max,
+                        const Level   level = supportedLevel() );
+        // Stores the smallest and the largest of size > 0 values in min
+        // and max. Levels beyond supportedLevel() fall back to it.
+
+    template< typename T >
+    static size_t partition( const T*      values,
+                             const size_t* indexes,
+                             const size_t  size,
+                             const T&      pivot,
+                             size_t*       left,
+                             size_t*       right,
+                             const Level   level = Level::SCALAR );
+    static size_t partition( const float*  values,
+                             const size_t* indexes,
+                             const size_t  size,
+                             const float&  pivot,
+                             size_t*       left,
+                             size_t*       right,
+                             const Level   level = supportedLevel() );
+    static size_t partition( const double* values,
+                             const size_t* indexes,
+                             const size_t  size,
+                             const double& pivot,
+                             size_t*       left,
+                             size_t*       right,
+                             const Level   level = supportedLevel() );
+        // Copies indexes[ i ] to left if values[ i ] < pivot and to right
+        // otherwise, preserving their order, and returns the number copied
+        // to left. Both left and right must have room for size indexes,
+        // vector stores may write past the final counts.
+        // Levels beyond supportedLevel() fall back to it.
+
+    template< typename T >
+    static void squaredDistances( const T* const* queries,
+                                  const size_t    numQueries,
+                                  const T* const* points,
+                                  const size_t    numPoints,
+                                  const size_t    dimension,
+                                  const double*   queryNorms,
+                                  const double*   pointNorms,
+                                  double*         distances,
+                                  const Level     level = Level::SCALAR );
+    static void squaredDistances( const float* const* queries,
+                                  const size_t        numQueries,
+                                  const float* const* points,
+                                  const size_t        numPoints,
+                                  const size_t        dimension,
+                                  const double*       queryNorms,
+                                  const double*       pointNorms,
+                                  double*             distances,
+                                  const Level         level =
+                                                      supportedLevel() );
+    static void squaredDistances( const double* const* queries,
+                                  const size_t         numQueries,
+                                  const double* const* points,
+                                  const size_t         numPoints,
+                                  const size_t         dimension,
+                                  const double*        queryNorms,
+                                  const double*        pointNorms,
+                                  double*              distances,
+                                  const Level          level =
+                                                       supportedLevel() );
+        // Stores in distances[ i * numPoints + j ] the squared distance
+        // between the rows of dimension coordinates queries[ i ] and
+        // points[ j ], expanded as
+        // queryNorms[ i ] + pointNorms[ j ] - 2 * queries[ i ] . points[ j ]
+        // from their squared norms and clamped at 0. The dot products form
+        // a small matrix multiply, vector levels compute them in register
+        // tiles of 4 queries by 2 (AVX2) or 4 (AVX-512) points, each
+        // coordinate load feeding several products. Products are summed in
+        // T, a result may be off by about dimension times the epsilon of T
+        // times the sum of the two norms.
+        // Levels beyond supportedLevel() fall back to it.
+};
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+void
+Simd::minMax( const T*     values,
+              const size_t size,
+              T&           min,
+              T&           max,
+              const Level )
+{
+    min = values[ 0 ];
+    max = values[ 0 ];
+
+    for ( size_t i = 1; i < size; ++i )
+    {
+        if ( values[ i ] < min )
+        {
+            min = values[ i ];
+        }
+        if ( max < values[ i ] )
+        {
+            max = values[ i ];
+        }
+    }
+}
+
+template< typename T >
+size_t
+Simd::partition( const T*      values,
+                 const size_t* indexes,
+                 const size_t  size,
+                 const T&      pivot,
+                 size_t*       left,
+                 size_t*       right,
+                 const Level )
+{
+    size_t numLeft  = 0;
+    size_t numRight = 0;
+
+    // Both stores happen, only the counts depend on the comparison
+    for ( size_t i = 0; i < size; ++i )
+    {
+        const bool isLeft = values[ i ] < pivot;
+        left[ numLeft ]   = indexes[ i ];
+        right[ numRight ] = indexes[ i ];
+        numLeft  += isLeft;
+        numRight += !isLeft;
+    }
+
+    return numLeft;
+}
+
+template< typename T >
+void
+Simd::squaredDistances( const T* const* queries,
+                        const size_t    numQueries,
+                        const T* const* points,
+                        const size_t    numPoints,
+                        const size_t    dimension,
+                        const double*   queryNorms,
+                        const double*   pointNorms,
+                        double*         distances,
+                        const Level )
+{
+    for ( size_t i = 0; i < numQueries; ++i )
+    {
+        for ( size_t j = 0; j < numPoints; ++j )
+        {
+            T dot = 0;
+            for ( size_t k = 0; k < dimension; ++k )
+            {
+                dot += queries[ i ][ k ] * points[ j ][ k ];
+            }
+
+            const double distance = queryNorms[ i ] + pointNorms[ j ] -
+                                    2.0 * static_cast< double >( dot );
+            distances[ i * numPoints + j ] = distance > 0.0 ? distance : 0.0;
+        }
+    }
+}
+
+} // namespace datastructures
+
+#endif //KDTREE_SIMD_H
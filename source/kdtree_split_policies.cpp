@@ -0,0 +1,5 @@
+#include "kdtree_split_policies.h"
+
+namespace datastructures {
+
+} // namespace datastructures
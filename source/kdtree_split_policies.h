@@ -0,0 +1,135 @@
+#ifndef KDTREE_SPLIT_POLICIES_H
+#define KDTREE_SPLIT_POLICIES_H
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "kdtree_types.h"
+#include "kdtree_hyperplane.h"
+#include "kdtree_simd.h"
+#include "kdtree_utils.h"
+
+// @Purpose
+//
+// This file provides the split policies KDTree is parameterized with. A
+// split policy is a struct with a single static function
+//
+//     KDHyperplane< T > chooseBestSplit( points, indexes )
+//
+// that picks the hyperplane splitting the points referenced by indexes,
+// which always hold at least two points. It is resolved at compile time
+// and called once per internal node while building the tree.
+//
+// The hyperplane does not have to separate the points, build() handles
+// hyperplanes with no point strictly below them.
+
+namespace datastructures {
+
+template< typename T >
+struct KDMedianSplit {
+    // PRIMARY INTERFACE
+    static KDHyperplane< T > chooseBestSplit(
+            const Types::Points< T >& points,
+            const Types::Indexes&     indexes );
+        // Splits at the median of the axis with the largest extent, ties
+        // go to the lowest axis and, between medians, to the lowest point
+        // index. This is the original KDTree heuristic, equivalent to
+        // Utils::axisOfHighestVariance() followed by
+        // Utils::medianValueInAxis().
+};
+
+template< typename T >
+struct KDMidpointSplit {
+    // PRIMARY INTERFACE
+    static KDHyperplane< T > chooseBestSplit(
+            const Types::Points< T >& points,
+            const Types::Indexes&     indexes );
+        // Splits at the middle of the extent of the axis with the largest
+        // extent, ties go to the lowest axis. Cheaper than the median and
+        // keeps cells square, at the cost of unbalanced subtrees on skewed
+        // data.
+};
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+KDHyperplane< T >
+KDMedianSplit< T >::chooseBestSplit( const Types::Points< T >& points,
+                                     const Types::Indexes&     indexes )
+{
+    // One contiguous coordinate column at a time, so that the reductions
+    // vectorize
+    std::vector< T > column( indexes.size() );
+
+    size_t axis = 0;
+    T largestExtent = 0;
+    for ( size_t i = 0; i < points[ indexes[ 0 ] ].size(); ++i )
+    {
+        for ( size_t j = 0; j < indexes.size(); ++j )
+        {
+            column[ j ] = points[ indexes[ j ] ][ i ];
+        }
+
+        T min;
+        T max;
+        Simd::minMax( column.data(), column.size(), min, max );
+
+        const T extent = std::abs( max - min );
+        if ( !i || extent > largestExtent )
+        {
+            largestExtent = extent;
+            axis = i;
+        }
+    }
+
+    for ( size_t j = 0; j < indexes.size(); ++j )
+    {
+        column[ j ] = points[ indexes[ j ] ][ axis ];
+    }
+
+    // A zero median takes the sign of the zero the presorted build picks,
+    // whatever order the indexes come in
+    return KDHyperplane< T >( axis, Utils::medianOfColumn( points, indexes,
+                                                           axis, column ) );
+}
+
+template< typename T >
+KDHyperplane< T >
+KDMidpointSplit< T >::chooseBestSplit( const Types::Points< T >& points,
+                                       const Types::Indexes&     indexes )
+{
+    std::vector< T > column( indexes.size() );
+
+    size_t axis = 0;
+    T largestExtent = 0;
+    T value = 0;
+    for ( size_t i = 0; i < points[ indexes[ 0 ] ].size(); ++i )
+    {
+        for ( size_t j = 0; j < indexes.size(); ++j )
+        {
+            column[ j ] = points[ indexes[ j ] ][ i ];
+        }
+
+        T min;
+        T max;
+        Simd::minMax( column.data(), column.size(), min, max );
+
+        const T extent = std::abs( max - min );
+        if ( !i || extent > largestExtent )
+        {
+            largestExtent = extent;
+            axis = i;
+            value = static_cast< T >( min + extent / 2 );
+        }
+    }
+
+    return KDHyperplane< T >( axis, value );
+}
+
+} // namespace datastructures
+
+#endif //KDTREE_SPLIT_POLICIES_H
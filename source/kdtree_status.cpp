@@ -0,0 +1,99 @@
+#include "kdtree_status.h"
+
+namespace datastructures {
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+KDStatus::KDStatus()
+: m_code(    Code::OK )
+, m_message( "" )
+, m_line(    0u )
+{
+    // nothing to do here
+}
+
+KDStatus::KDStatus( const Code code, const char* message, const size_t line )
+: m_code(    code )
+, m_message( message )
+, m_line(    line )
+{
+    // nothing to do here
+}
+
+//============================================================================
+//                  OPERATORS
+//============================================================================
+
+KDStatus::operator bool() const
+{
+    return Code::OK == m_code;
+}
+
+bool
+KDStatus::operator==( const KDStatus& other ) const
+{
+    return equals( other );
+}
+
+bool
+KDStatus::operator!=( const KDStatus& other ) const
+{
+    return !equals( other );
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+KDStatus::Code
+KDStatus::code() const
+{
+    return m_code;
+}
+
+const char*
+KDStatus::message() const
+{
+    return m_message;
+}
+
+size_t
+KDStatus::line() const
+{
+    return m_line;
+}
+
+//============================================================================
+//                  ACCESSORS
+//============================================================================
+
+bool
+KDStatus::equals( const KDStatus& other ) const
+{
+    return ( ( other.code() == m_code ) &&
+             ( other.line() == m_line ) );
+}
+
+std::ostream&
+KDStatus::print( std::ostream& out ) const
+{
+    out << "KDStatus:[ "
+        << "code = "     << std::dec << static_cast< int >( m_code ) << ", "
+        << "message = '" << m_message                                << "', "
+        << "line = "     << std::dec << m_line                       << " ]";
+
+    return out;
+}
+
+//============================================================================
+//                  INDEPENDENT OPERATORS
+//============================================================================
+
+std::ostream& operator<<( std::ostream& lhs, const KDStatus& rhs )
+{
+    return rhs.print( lhs );
+}
+
+} // namespace datastructures
@@ -0,0 +1,98 @@
+#ifndef KDTREE_STATUS_H
+#define KDTREE_STATUS_H
+
+#include <cstddef>
+#include <iostream>
+
+namespace datastructures {
+
+// PURPOSE:
+//
+// A class that reports the outcome of an operation which may fail : tree
+// and graph serialization, deserialization and the point loaders. A status
+// carries a machine readable code, a static description and the 1-based
+// line of the input the failure was detected on, 0 where not applicable.
+//
+// Creating, copying and testing a status never allocates nor touches any
+// stream, so it can be returned from parsing loops freely. Failures are
+// only printed by the caller that decides to, through print().
+//
+class KDStatus {
+public:
+    enum class Code {
+        OK,
+            // Operation succeeded
+
+        IO_ERROR,
+            // File could not be opened, read or written
+
+        TYPE_MISMATCH,
+            // Serialized tree type differs from the type of the tree
+
+        PARSE_ERROR,
+            // Malformed number, marker or section in the input
+
+        CARDINALITY_MISMATCH,
+            // Points of different dimensions, or an index out of range of
+            // the points
+
+        SIZE_LIMIT,
+            // Number of points exceeds what the operation supports
+
+        NOT_FOUND
+            // No point with the requested id
+    };
+
+    // CREATORS
+    KDStatus();
+        // Default constructor, successful status
+
+    KDStatus( const Code code, const char* message, const size_t line = 0u );
+        // Constructor, message must outlive the status, usually a string
+        // literal
+
+    // OPERATORS
+    explicit operator bool() const;
+        // Returns true if the status is successful
+
+    bool operator==( const KDStatus& other ) const;
+        // Equality. Calls equals.
+
+    bool operator!=( const KDStatus& other ) const;
+        // Non-equality. Calls equals.
+
+    // PRIMARY INTERFACE
+    Code code() const;
+        // Returns code of the status
+
+    const char* message() const;
+        // Returns description of the failure, empty for a successful status
+
+    size_t line() const;
+        // Returns 1-based input line of the failure, 0 if not applicable
+
+    // ACCESSORS
+    bool equals( const KDStatus& other ) const;
+        // Worker for equality, compares codes and lines only
+
+    std::ostream& print( std::ostream& out ) const;
+        // Prints the contents of the KDStatus object in a easy to read
+        // format
+
+private:
+    Code         m_code;
+        // Outcome of the operation
+
+    const char*  m_message;
+        // Static description of the failure
+
+    size_t       m_line;
+        // Input line of the failure
+};
+
+// INDEPENDENT OPERATORS
+std::ostream& operator<<( std::ostream& lhs, const KDStatus& rhs );
+
+} // close namespace datastructures
+
+#endif // KDTREE_STATUS_H
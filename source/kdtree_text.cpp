@@ -0,0 +1,143 @@
+#include <cstring>
+#include <fstream>
+
+#include "kdtree_text.h"
+#include "kdtree_parallel.h"
+#include "kdtree_io.h"
+
+namespace datastructures {
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+KDStatus
+Text::readFile( const std::string& filename, std::string& contents )
+{
+    return AsyncIO::readFile( filename, contents );
+}
+
+KDStatus
+Text::writeFile( const std::string&                filename,
+                 const std::vector< std::string >& pieces )
+{
+    std::ofstream file( filename.c_str(),
+                        std::ofstream::out |
+                        std::ofstream::binary |
+                        std::ofstream::trunc );
+
+    if ( !file.is_open() )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR,
+                         "unable to open file for writing" );
+    }
+
+    for ( size_t i = 0; i < pieces.size(); ++i )
+    {
+        file.write( pieces[ i ].data(), pieces[ i ].size() );
+    }
+
+    file.close();
+
+    if ( file.fail() )
+    {
+        return KDStatus( KDStatus::Code::IO_ERROR, "failed writing file" );
+    }
+
+    return KDStatus();
+}
+
+void
+Text::splitLines( const std::string&          contents,
+                  std::vector< const char* >& lines,
+                  const size_t                numThreads )
+{
+    lines.clear();
+
+    const char*  data = contents.data();
+    const size_t size = contents.size();
+
+    if ( !size )
+    {
+        lines.push_back( data + 1u );
+        return;
+    }
+
+    // Every chunk collects the starts of the lines following its new lines
+    size_t chunks = Parallel::numThreads( numThreads );
+    if ( chunks > size )
+    {
+        chunks = size;
+    }
+    std::vector< std::vector< const char* > > starts( chunks );
+
+    Parallel::forEachRange( size, chunks,
+        [ & ]( const size_t begin, const size_t end, const size_t chunk )
+        {
+            std::vector< const char* >& chunkStarts = starts[ chunk ];
+            const char* cursor = data + begin;
+            const char* last   = data + end;
+
+            while ( cursor < last )
+            {
+                const char* newLine = static_cast< const char* >(
+                        std::memchr( cursor, '\n', last - cursor ) );
+                if ( nullptr == newLine )
+                {
+                    break;
+                }
+                chunkStarts.push_back( newLine + 1 );
+                cursor = newLine + 1;
+            }
+        } );
+
+    size_t total = 1u;
+    for ( size_t chunk = 0; chunk < starts.size(); ++chunk )
+    {
+        total += starts[ chunk ].size();
+    }
+
+    lines.reserve( total + 1u );
+    lines.push_back( data );
+    for ( size_t chunk = 0; chunk < starts.size(); ++chunk )
+    {
+        lines.insert( lines.end(),
+                      starts[ chunk ].begin(),
+                      starts[ chunk ].end() );
+    }
+
+    // The start following a trailing new line already serves as the
+    // sentinel, a final line without one needs a sentinel of its own
+    if ( data[ size - 1u ] != '\n' )
+    {
+        lines.push_back( data + size + 1u );
+    }
+}
+
+const char*
+Text::lineEnd( const std::vector< const char* >& lines, const size_t index )
+{
+    const char* begin = lines[ index ];
+    const char* end   = lines[ index + 1u ] - 1;
+
+    if ( end > begin && '\r' == *( end - 1 ) )
+    {
+        --end;
+    }
+
+    return end;
+}
+
+bool
+Text::lineEquals( const std::vector< const char* >& lines,
+                  const size_t                      index,
+                  const std::string&                text )
+{
+    const char* begin = lines[ index ];
+    const char* end   = lineEnd( lines, index );
+
+    return static_cast< size_t >( end - begin ) == text.size() &&
+           0 == std::memcmp( begin, text.data(), text.size() );
+}
+
+} // namespace datastructures
@@ -0,0 +1,98 @@
+#ifndef KDTREE_TEXT_H
+#define KDTREE_TEXT_H
+
+#include <charconv>
+#include <string>
+#include <vector>
+
+#include "kdtree_types.h"
+#include "kdtree_status.h"
+
+// @Purpose
+//
+// This struct provides the building blocks of the text file formats :
+// exact number formatting, whole file reads and writes, and splitting of
+// a file into lines that can be parsed by several threads at once.
+//
+// Numbers are formatted with std::to_chars, which produces the shortest
+// representation that reads back to exactly the same value, so floating
+// point trees survive a serialization round trip bit for bit.
+
+namespace datastructures {
+
+struct Text {
+    // PRIMARY INTERFACE
+    template< typename T >
+    static void appendNumber( std::string& out, const T value );
+        // Appends the shortest decimal representation of value that parses
+        // back to the same value of type T
+
+    template< typename T >
+    static void appendPoint( std::string& out, const Types::Point< T >& point );
+        // Appends the comma separated coordinates of point and a new line
+
+    static KDStatus readFile( const std::string& filename,
+                              std::string&       contents );
+        // Reads the whole file into contents through AsyncIO::readFile(),
+        // many block reads in flight at once.
+        // Returns successful status or the reason of the failure.
+
+    static KDStatus writeFile( const std::string&                filename,
+                               const std::vector< std::string >& pieces );
+        // Truncates the file and writes pieces one after another, every
+        // piece with a single write.
+        // Returns successful status or the reason of the failure.
+
+    static void splitLines( const std::string&          contents,
+                            std::vector< const char* >& lines,
+                            const size_t                numThreads = 0u );
+        // Stores the start of every line of contents in lines, followed by
+        // a sentinel, so that line i spans [ lines[ i ], lines[ i + 1 ] - 1 )
+        // and lines.size() - 1 lines are found. A final line without a new
+        // line is included. Chunks of contents are scanned in parallel.
+        // numThreads of 0 uses all hardware threads.
+
+    static const char* lineEnd( const std::vector< const char* >& lines,
+                                const size_t                      index );
+        // Returns end of line index of lines produced by splitLines(),
+        // excluding the new line and a preceding carriage return
+
+    static bool lineEquals( const std::vector< const char* >& lines,
+                            const size_t                      index,
+                            const std::string&                text );
+        // Returns true if line index of lines produced by splitLines()
+        // holds exactly text
+};
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+template< typename T >
+void
+Text::appendNumber( std::string& out, const T value )
+{
+    char buffer[ 64 ];
+    const std::to_chars_result result =
+            std::to_chars( buffer, buffer + sizeof( buffer ), value );
+    out.append( buffer, result.ptr );
+}
+
+template< typename T >
+void
+Text::appendPoint( std::string& out, const Types::Point< T >& point )
+{
+    for ( size_t i = 0; i < point.size(); ++i )
+    {
+        if ( i )
+        {
+            out += ',';
+        }
+        appendNumber( out, point[ i ] );
+    }
+    out += '\n';
+}
+
+} // namespace datastructures
+
+#endif //KDTREE_TEXT_H
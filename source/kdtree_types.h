@@ -9,6 +9,18 @@ namespace datastructures {
 
 struct Types {
 
+    enum class BuildMethod {
+        MEDIAN,
+            // Recursive median split along the axis of highest spread,
+            // selecting every median from scratch
+        PRESORTED,
+            // Same splits as MEDIAN, read from index lists sorted once per
+            // axis and kept sorted through every split, O(D N log N)
+        MORTON
+            // Bulk load from Morton (Z-order) codes, O(N) after a radix
+            // sort, intended for 2-D/3-D points
+    };
+
     template< typename T >
     using Point = std::vector< T >;
 
@@ -17,9 +29,21 @@ struct Types {
 
     using Indexes = std::vector< size_t >;
 
+    using Clusters = std::vector< Indexes >;
+
+    using Neighbour = std::pair< double, size_t >;
+        // Distance rank of a point, the squared distance for the default
+        // Euclidean metric, and index of that point
+
+    using Neighbours = std::vector< Neighbour >;
+
     template< typename T >
     using AxisMinMax = std::vector< std::pair< T, T > >;
 
+    template< typename T >
+    using Boxes = std::vector< AxisMinMax< T > >;
+        // Axis aligned boxes, low and high bound per axis
+
 };
 
 // INDEPENDENT OPERATORS
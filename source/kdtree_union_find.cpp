@@ -0,0 +1,86 @@
+#include <utility>
+
+#include "kdtree_union_find.h"
+
+namespace datastructures {
+
+//============================================================================
+//                  CREATORS
+//============================================================================
+
+KDUnionFind::KDUnionFind( const size_t size )
+: m_parents( new std::atomic< size_t >[ size ] )
+, m_size( size )
+{
+    for ( size_t i = 0; i < m_size; ++i )
+    {
+        m_parents[ i ].store( i, std::memory_order_relaxed );
+    }
+}
+
+//============================================================================
+//                  PRIMARY INTERFACE
+//============================================================================
+
+size_t
+KDUnionFind::find( const size_t index ) const
+{
+    size_t current = index;
+
+    while ( true )
+    {
+        size_t parent = m_parents[ current ].load( std::memory_order_acquire );
+
+        if ( parent == current )
+        {
+            return current;
+        }
+
+        // Path halving, losing the race here only costs a longer walk
+        const size_t grandParent =
+                m_parents[ parent ].load( std::memory_order_acquire );
+        m_parents[ current ].compare_exchange_weak( parent,
+                                                    grandParent,
+                                                    std::memory_order_release,
+                                                    std::memory_order_relaxed );
+        current = grandParent;
+    }
+}
+
+bool
+KDUnionFind::unite( const size_t first, const size_t second )
+{
+    while ( true )
+    {
+        size_t root1 = find( first );
+        size_t root2 = find( second );
+
+        if ( root1 == root2 )
+        {
+            return false;
+        }
+
+        // Always hang the larger root under the smaller one
+        if ( root1 < root2 )
+        {
+            std::swap( root1, root2 );
+        }
+
+        size_t expected = root1;
+        if ( m_parents[ root1 ].compare_exchange_strong(
+                     expected, root2,
+                     std::memory_order_acq_rel,
+                     std::memory_order_relaxed ) )
+        {
+            return true;
+        }
+    }
+}
+
+size_t
+KDUnionFind::size() const
+{
+    return m_size;
+}
+
+} // namespace datastructures
@@ -0,0 +1,49 @@
+#ifndef KDTREE_UNION_FIND_H
+#define KDTREE_UNION_FIND_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace datastructures {
+
+// PURPOSE:
+//
+// A disjoint set forest over indexes [ 0, size ) that may be merged
+// concurrently from several threads. Sets are always linked towards the
+// smaller index, so the representative of a set is its smallest member
+// regardless of the order in which unite() calls were made.
+//
+class KDUnionFind {
+public:
+    // CREATORS
+    explicit KDUnionFind( const size_t size );
+        // Constructor, every index starts in a set of its own
+
+    // PRIMARY INTERFACE
+    size_t find( const size_t index ) const;
+        // Returns the representative (smallest member) of the set that
+        // contains index. Safe to call concurrently with unite().
+
+    bool unite( const size_t first, const size_t second );
+        // Merges sets containing first and second. Returns true if the sets
+        // were different and false otherwise. Safe to call concurrently.
+
+    size_t size() const;
+        // Returns the number of indexes managed by this object
+
+private:
+    KDUnionFind( const KDUnionFind& other );
+    KDUnionFind& operator=( const KDUnionFind& other );
+        // Not implemented, atomics are not copyable
+
+    std::unique_ptr< std::atomic< size_t >[] > m_parents;
+        // Parent link per index, roots point to themselves
+
+    size_t                                     m_size;
+        // Number of indexes
+};
+
+} // close namespace datastructures
+
+#endif // KDTREE_UNION_FIND_H
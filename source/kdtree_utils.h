@@ -6,6 +6,7 @@
 #include <numeric>
 #include <cmath>
 #include <cstdlib>
+#include <type_traits>
 
 #include "kdtree_types.h"
 #include "kdtree_constants.h"
@@ -29,7 +30,21 @@ struct Utils {
     static T medianValueInAxis( const Types::Points< T >& points,
                                 const size_t axis );
         // Given a set of equally dimensional points and a specific
-        // axis find a median value of all the points on that axis
+        // axis find a median value of all the points on that axis. Ties
+        // go to the lower point index, see medianOfColumn().
+
+    template< typename T >
+    static T medianOfColumn( const Types::Points< T >& points,
+                             const Types::Indexes&     indexes,
+                             const size_t              axis,
+                             std::vector< T >&         column );
+        // Given the coordinates on axis of the points with indexes, stored
+        // in column in the same order, returns the one at position half
+        // of their count once sorted by coordinate and then by index.
+        // Equal coordinates differ only in the sign of zero, so the zero
+        // of the median is picked among the zero points by index, which
+        // keeps the result independent of the order of indexes. column is
+        // reordered.
 
     template< typename T >
     static Types::AxisMinMax< T >
@@ -44,6 +59,62 @@ struct Utils {
         // KDTREE_INVALID_POINT_DISTANCE in case points are of different
         // cardinality
 
+    template< typename T >
+    static double
+    squaredDistance( const Types::Point< T >& p1, const Types::Point< T >& p2 );
+        // Computes squared distance between two points of the same
+        // cardinality. Cardinality is not checked, callers are expected to
+        // validate it once at their entry point.
+
+    template< typename T >
+    static double
+    squaredDistanceToBox( const Types::Point< T >&      p,
+                          const Types::AxisMinMax< T >& box );
+        // Computes the smallest squared distance between a point and any
+        // point of an axis aligned box. Cardinality is not checked.
+
+    template< typename T >
+    static double
+    maxSquaredDistanceToBox( const Types::Point< T >&      p,
+                             const Types::AxisMinMax< T >& box );
+        // Computes the largest squared distance between a point and any
+        // point of an axis aligned box. Cardinality is not checked.
+
+    template< typename T >
+    static double
+    squaredDistanceBetweenBoxes( const Types::AxisMinMax< T >& box1,
+                                 const Types::AxisMinMax< T >& box2 );
+        // Computes the smallest squared distance between any two points of
+        // two axis aligned boxes. Cardinality is not checked.
+
+    template< typename T >
+    static double
+    maxSquaredDistanceBetweenBoxes( const Types::AxisMinMax< T >& box1,
+                                    const Types::AxisMinMax< T >& box2 );
+        // Computes the largest squared distance between any two points of
+        // two axis aligned boxes. Cardinality is not checked.
+
+    template< typename T >
+    static bool
+    boxContainsPoint( const Types::AxisMinMax< T >& box,
+                      const Types::Point< T >&      p );
+        // Returns true if the point lies inside of the axis aligned box,
+        // boundary included. Cardinality is not checked.
+
+    template< typename T >
+    static bool
+    boxContainsBox( const Types::AxisMinMax< T >& outer,
+                    const Types::AxisMinMax< T >& inner );
+        // Returns true if inner box lies inside of outer box, boundary
+        // included. Cardinality is not checked.
+
+    template< typename T >
+    static bool
+    boxesIntersect( const Types::AxisMinMax< T >& box1,
+                    const Types::AxisMinMax< T >& box2 );
+        // Returns true if two axis aligned boxes share at least one point.
+        // Cardinality is not checked.
+
     template< typename T >
     static double
     distance( const Types::Point< T >& p, const KDHyperplane< T >& plane );
@@ -114,13 +185,51 @@ Utils::medianValueInAxis( const Types::Points< T >& points,
         values.push_back( ( *it )[ axis ] );
     }
 
-    const size_t n = values.size() / 2;
+    Types::Indexes indexes( points.size() );
+    std::iota( indexes.begin(), indexes.end(), static_cast< size_t >( 0u ) );
+
+    return medianOfColumn( points, indexes, axis, values );
+}
+
+template< typename T >
+T
+Utils::medianOfColumn( const Types::Points< T >& points,
+                       const Types::Indexes&     indexes,
+                       const size_t              axis,
+                       std::vector< T >&         column )
+{
+    const size_t n = column.size() / 2u;
+    std::nth_element( column.begin(), column.begin() + n, column.end() );
 
-    std::nth_element( values.begin(),
-                      values.begin() + n,
-                      values.end() );
+    if ( !std::is_floating_point< T >::value ||
+         column[ n ] != static_cast< T >( 0 ) )
+    {
+        return column[ n ];
+    }
 
-    return values[ n ];
+    // The median is the zero of rank n - below among the zero points
+    Types::Indexes zeroIndexes;
+    for ( size_t j = 0; j < indexes.size(); ++j )
+    {
+        if ( points[ indexes[ j ] ][ axis ] == static_cast< T >( 0 ) )
+        {
+            zeroIndexes.push_back( indexes[ j ] );
+        }
+    }
+
+    const size_t below = std::count_if( column.begin(),
+                                        column.begin() + n,
+                                        []( const T& value )
+                                        {
+                                            return value <
+                                                   static_cast< T >( 0 );
+                                        } );
+    const size_t rank = n - below;
+    std::nth_element( zeroIndexes.begin(),
+                      zeroIndexes.begin() + rank,
+                      zeroIndexes.end() );
+
+    return points[ zeroIndexes[ rank ] ][ axis ];
 }
 
 template< typename T >
@@ -188,6 +297,166 @@ Utils::distance( const Types::Point< T >& p1, const Types::Point< T >& p2 )
     return sqrt( dist2 );
 }
 
+template< typename T >
+double
+Utils::squaredDistance( const Types::Point< T >& p1,
+                        const Types::Point< T >& p2 )
+{
+    double dist2 = 0.0L;
+
+    const size_t size = p1.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        const double temp = static_cast< double >( p1[ i ] ) - p2[ i ];
+        dist2 += temp * temp;
+    }
+
+    return dist2;
+}
+
+template< typename T >
+double
+Utils::squaredDistanceToBox( const Types::Point< T >&      p,
+                             const Types::AxisMinMax< T >& box )
+{
+    double dist2 = 0.0L;
+
+    const size_t size = box.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        double temp = 0.0L;
+        if ( p[ i ] < box[ i ].first )
+        {
+            temp = static_cast< double >( box[ i ].first ) - p[ i ];
+        }
+        else if ( p[ i ] > box[ i ].second )
+        {
+            temp = static_cast< double >( p[ i ] ) - box[ i ].second;
+        }
+        dist2 += temp * temp;
+    }
+
+    return dist2;
+}
+
+template< typename T >
+double
+Utils::maxSquaredDistanceToBox( const Types::Point< T >&      p,
+                                const Types::AxisMinMax< T >& box )
+{
+    double dist2 = 0.0L;
+
+    const size_t size = box.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        const double temp = std::max(
+                std::abs( static_cast< double >( p[ i ] ) - box[ i ].first ),
+                std::abs( static_cast< double >( p[ i ] ) - box[ i ].second ) );
+        dist2 += temp * temp;
+    }
+
+    return dist2;
+}
+
+template< typename T >
+double
+Utils::squaredDistanceBetweenBoxes( const Types::AxisMinMax< T >& box1,
+                                    const Types::AxisMinMax< T >& box2 )
+{
+    double dist2 = 0.0L;
+
+    const size_t size = box1.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        double temp = 0.0L;
+        if ( box1[ i ].second < box2[ i ].first )
+        {
+            temp = static_cast< double >( box2[ i ].first ) - box1[ i ].second;
+        }
+        else if ( box2[ i ].second < box1[ i ].first )
+        {
+            temp = static_cast< double >( box1[ i ].first ) - box2[ i ].second;
+        }
+        dist2 += temp * temp;
+    }
+
+    return dist2;
+}
+
+template< typename T >
+double
+Utils::maxSquaredDistanceBetweenBoxes( const Types::AxisMinMax< T >& box1,
+                                       const Types::AxisMinMax< T >& box2 )
+{
+    double dist2 = 0.0L;
+
+    const size_t size = box1.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        const double temp = std::max(
+                std::abs( static_cast< double >( box1[ i ].second ) -
+                          box2[ i ].first ),
+                std::abs( static_cast< double >( box2[ i ].second ) -
+                          box1[ i ].first ) );
+        dist2 += temp * temp;
+    }
+
+    return dist2;
+}
+
+template< typename T >
+bool
+Utils::boxContainsPoint( const Types::AxisMinMax< T >& box,
+                         const Types::Point< T >&      p )
+{
+    const size_t size = box.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        if ( p[ i ] < box[ i ].first || box[ i ].second < p[ i ] )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template< typename T >
+bool
+Utils::boxContainsBox( const Types::AxisMinMax< T >& outer,
+                       const Types::AxisMinMax< T >& inner )
+{
+    const size_t size = outer.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        if ( inner[ i ].first  < outer[ i ].first ||
+             outer[ i ].second < inner[ i ].second )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template< typename T >
+bool
+Utils::boxesIntersect( const Types::AxisMinMax< T >& box1,
+                       const Types::AxisMinMax< T >& box2 )
+{
+    const size_t size = box1.size();
+    for ( size_t i = 0u; i < size; ++i )
+    {
+        if ( box1[ i ].second < box2[ i ].first ||
+             box2[ i ].second < box1[ i ].first )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 template< typename T >
 double
 Utils::distance( const Types::Point< T >& p, const KDHyperplane< T >& plane )
@@ -1,6 +1,12 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <type_traits>
 
 #include "gtest/gtest.h"
 
@@ -35,7 +41,15 @@ public:
         // nothing to do here
     }
 
-    virtual const TestHyperplane chooseBestSplit(
+    TestKDTree( const TestPoints&        testPoints,
+                const Types::BuildMethod method,
+                const size_t             numThreads = 0u )
+            : KDTree< int >( testPoints, method, numThreads )
+    {
+        // nothing to do here
+    }
+
+    const TestHyperplane chooseBestSplit(
             const Types::Indexes& indexes ) const
     {
         return KDTree< int >::chooseBestSplit( indexes );
@@ -76,6 +90,54 @@ private:
 // HELPER FUNCTIONS
 //////////////////////////////////////////////////////////////////////////////
 
+void leafOrder( const KDNode< int >* root, Types::Indexes& order )
+{
+    if ( nullptr == root )
+    {
+        return;
+    }
+
+    if ( root->isLeaf() )
+    {
+        order.push_back( root->leafPointIndex() );
+        return;
+    }
+
+    leafOrder( root->left().get(),  order );
+    leafOrder( root->right().get(), order );
+}
+
+Types::Indexes leafOrder( const KDNode< int >* root )
+{
+    Types::Indexes order;
+    leafOrder( root, order );
+    return order;
+}
+
+bool sameStructure( const KDNode< int >* lhs, const KDNode< int >* rhs )
+{
+    if ( !lhs || !rhs )
+    {
+        return lhs == rhs;
+    }
+
+    return ( ( lhs->hyperplane()     == rhs->hyperplane()     ) &&
+             ( lhs->leafPointIndex() == rhs->leafPointIndex() ) &&
+             sameStructure( lhs->left().get(),  rhs->left().get()  ) &&
+             sameStructure( lhs->right().get(), rhs->right().get() ) );
+}
+
+size_t depth( const KDNode< int >* root )
+{
+    if ( nullptr == root )
+    {
+        return 0u;
+    }
+
+    return 1u + std::max( depth( root->left().get() ),
+                          depth( root->right().get() ) );
+}
+
 TestPoint bruteForceClosest( const TestPoints& points,
                              const TestPoint& pointOfInterest )
 {
@@ -124,6 +186,107 @@ size_t bruteForceClosestIndex( const std::vector< Types::Point< float > >& point
     return closestIndex;
 }
 
+template< typename T >
+void checkBlockedCorrespondences( const size_t dimension, const T offset )
+{
+    std::mt19937 generator( 23 );
+    std::uniform_real_distribution< T > coordinate( offset - 1, offset + 1 );
+
+    Types::Points< T > target( 700u, Types::Point< T >( dimension ) );
+    for ( size_t i = 0; i < target.size(); ++i )
+    {
+        for ( size_t k = 0; k < dimension; ++k )
+        {
+            target[ i ][ k ] = coordinate( generator );
+        }
+    }
+    // Ties go to the smaller index
+    target[ 650u ] = target[ 7u ];
+    target[ 651u ] = target[ 14u ];
+
+    // Source points are jittered targets, exact targets and far outliers
+    Types::Points< T > source;
+    for ( size_t i = 0; i < target.size(); i += 7u )
+    {
+        Types::Point< T > p = target[ i ];
+        if ( i % 3u == 0u )
+        {
+            p[ i % dimension ] += static_cast< T >( 0.01 );
+        }
+        if ( i % 5u == 0u )
+        {
+            p[ 0 ] += 50;
+        }
+        source.push_back( p );
+    }
+
+    const KDTree< T > tree( target );
+    const double maxDistance = 10.0;
+
+    const Types::Neighbours bounded =
+            tree.correspondences( source, maxDistance, Types::Neighbours(),
+                                  3u, true );
+    const Types::Neighbours unbounded =
+            tree.correspondences( source, Constants::KDTREE_MAX_DISTANCE,
+                                  Types::Neighbours(), 1u, true );
+    ASSERT_EQ( bounded.size(), source.size() );
+    ASSERT_EQ( unbounded.size(), source.size() );
+
+    for ( size_t i = 0; i < source.size(); ++i )
+    {
+        Types::Neighbour expected( Constants::KDTREE_MAX_DISTANCE,
+                                   Constants::KDTREE_ERROR_INDEX );
+        for ( size_t j = 0; j < target.size(); ++j )
+        {
+            const Types::Neighbour candidate(
+                    Utils::squaredDistance< T >( target[ j ], source[ i ] ),
+                    j );
+            if ( candidate < expected )
+            {
+                expected = candidate;
+            }
+        }
+
+        ASSERT_EQ( unbounded[ i ], expected );
+        if ( expected.first <= maxDistance * maxDistance )
+        {
+            ASSERT_EQ( bounded[ i ], expected );
+        }
+        else
+        {
+            ASSERT_EQ( bounded[ i ],
+                       Types::Neighbour( Constants::KDTREE_MAX_DISTANCE,
+                                         Constants::KDTREE_ERROR_INDEX ) );
+        }
+        ASSERT_EQ( bounded[ i ].second == Constants::KDTREE_ERROR_INDEX,
+                   ( 7u * i ) % 5u == 0u );
+    }
+
+    ASSERT_EQ( unbounded[ 1u ], Types::Neighbour( 0.0, 7u ) );
+    ASSERT_EQ( unbounded[ 2u ], Types::Neighbour( 0.0, 14u ) );
+    ASSERT_EQ( tree.correspondences( source, maxDistance, bounded, 2u, true ),
+               bounded );
+
+    // A stale warm start seeds the scan without changing its answer, and
+    // the default tree search gives the same result
+    Types::Neighbours stale( unbounded );
+    for ( size_t i = 0; i < stale.size(); ++i )
+    {
+        stale[ i ].second = ( 3u * i + 1u ) % target.size();
+    }
+    ASSERT_EQ( tree.correspondences( source, maxDistance, stale, 2u, true ),
+               bounded );
+    ASSERT_EQ( tree.correspondences( source, Constants::KDTREE_MAX_DISTANCE,
+                                     stale, 3u, true ),
+               unbounded );
+    ASSERT_EQ( tree.correspondences( source, maxDistance, Types::Neighbours(),
+                                     2u ),
+               bounded );
+    ASSERT_EQ( tree.correspondences( source, Constants::KDTREE_MAX_DISTANCE,
+                                     stale, 1u ),
+               unbounded );
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // TEST FUNCTIONS
 //////////////////////////////////////////////////////////////////////////////
@@ -1243,82 +1406,1427 @@ TEST( KDTREE, CompleteSanity )
     TestFileGuard guard( testFile );
 
     const std::string dataFilename = "data/sample_data.csv";
-    std::ifstream treeData( dataFilename );
+    Types::Points< float > treePoints;
 
-    ASSERT_TRUE( treeData.is_open() );
+    ASSERT_TRUE( Loader::readCsv( dataFilename, treePoints ) );
 
-    std::string line;
-    Types::Points< float > treePoints;
+    KDTree< float > serializedTree( treePoints );
+    std::cout << serializedTree << std::endl;
+
+    ASSERT_TRUE( serializedTree.serialize( testFile ) );
+
+    KDTree< float > deserializedTree;
+    ASSERT_TRUE( deserializedTree.deserialize( testFile ) );
+    std::cout << deserializedTree << std::endl;
+
+    const std::string queryFilename = "data/query_data.csv";
+    Types::Points< float > queryPoints;
+
+    ASSERT_TRUE( Loader::readCsv( queryFilename, queryPoints ) );
+
+    for ( size_t i = 0; i < queryPoints.size(); ++i )
+    {
+        const Types::Point< float >& queryPoint = queryPoints[ i ];
+
+        const size_t bruteIndex =
+                bruteForceClosestIndex( treePoints, queryPoint );
+        const size_t serializedTreeIndex =
+                serializedTree.nearestPointIndex( queryPoint ) ;
+        const size_t deserializedTreeIndex =
+                deserializedTree.nearestPointIndex( queryPoint ) ;
+
+        ASSERT_EQ( bruteIndex, serializedTreeIndex );
+        ASSERT_EQ( bruteIndex, deserializedTreeIndex );
+    }
+}
+
+TEST( KDTree, TreeOnDuplicatePoints )
+{
+    TestPoint p;
+    p.push_back( 3 );
+    p.push_back( 4 );
+
+    TestPoint q;
+    q.push_back( 3 );
+    q.push_back( 5 );
+
+    TestPoints sanityPoints;
+    sanityPoints.push_back( p );
+    sanityPoints.push_back( p );
+    sanityPoints.push_back( q );
+    sanityPoints.push_back( p );
+
+    TestKDTree sanityTree( sanityPoints );
+
+    ASSERT_EQ( sanityTree.points(), sanityPoints );
+    ASSERT_EQ( sanityTree.nearestPoint( p ), p );
+    ASSERT_EQ( sanityTree.nearestPoint( q ), q );
+    ASSERT_EQ( sanityTree.pointIndexesInRadius( p, 0.0 ).size(), 3u );
+}
 
-    while ( getline ( treeData, line ) )
+TEST( KDTree, SearchInRadius )
+{
+    TestPoints sanityPoints;
+    for ( int x = -10; x <= 10; x += 2 )
     {
-        Types::Point< float > treePoint;
+        for ( int y = -7; y <= 7; y += 3 )
+        {
+            TestPoint p;
+            p.push_back( x );
+            p.push_back( y );
+            sanityPoints.push_back( p );
+        }
+    }
+
+    TestKDTree emptyTree;
+    ASSERT_TRUE( emptyTree.pointIndexesInRadius( sanityPoints[ 0 ],
+                                                 1.0 ).empty() );
 
-        size_t pos = 0;
+    TestKDTree sanityTree( sanityPoints );
+    ASSERT_EQ( sanityTree.size(), sanityPoints.size() );
+    ASSERT_EQ( sanityTree.point( 3u ), sanityPoints[ 3u ] );
+
+    // Cardinality mismatch and negative radius
+    ASSERT_TRUE( sanityTree.pointIndexesInRadius( TestPoint( 3u, 0 ),
+                                                  5.0 ).empty() );
+    ASSERT_TRUE( sanityTree.pointIndexesInRadius( sanityPoints[ 0 ],
+                                                  -1.0 ).empty() );
 
-        while ( true )
+    const double radiuses[] = { 0.0, 1.0, 2.0, 3.0, 3.7, 6.5, 100.0 };
+
+    for ( int x = -12; x <= 12; ++x )
+    {
+        for ( int y = -9; y <= 9; ++y )
         {
-            treePoint.push_back( static_cast< float >( stof( line, &pos ) ) );
+            TestPoint pointOfInterest;
+            pointOfInterest.push_back( x );
+            pointOfInterest.push_back( y );
 
-            if ( line[ pos ] == ',')
+            for ( size_t r = 0; r < sizeof( radiuses ) / sizeof( double ); ++r )
             {
-                line = line.substr( pos + 1u );
+                Types::Indexes expected;
+                for ( size_t i = 0; i < sanityPoints.size(); ++i )
+                {
+                    if ( Utils::distance< int >( sanityPoints[ i ],
+                                                 pointOfInterest ) <=
+                         radiuses[ r ] )
+                    {
+                        expected.push_back( i );
+                    }
+                }
+
+                Types::Indexes found = sanityTree.pointIndexesInRadius(
+                        pointOfInterest, radiuses[ r ] );
+                std::sort( found.begin(), found.end() );
+
+                ASSERT_EQ( expected, found );
             }
-            else
+        }
+    }
+}
+
+TEST( KDTree, SearchKNearest )
+{
+    std::srand( 7 );
+
+    TestPoints sanityPoints;
+    for ( size_t i = 0; i < 300u; ++i )
+    {
+        TestPoint p;
+        p.push_back( std::rand() % 50 );
+        p.push_back( std::rand() % 50 );
+        p.push_back( std::rand() % 50 );
+        sanityPoints.push_back( p );
+    }
+
+    TestKDTree emptyTree;
+    ASSERT_TRUE( emptyTree.nearestPointIndexes( sanityPoints[ 0 ],
+                                                3u ).empty() );
+
+    TestKDTree sanityTree( sanityPoints );
+    ASSERT_TRUE( sanityTree.nearestPointIndexes( sanityPoints[ 0 ],
+                                                 0u ).empty() );
+    ASSERT_TRUE( sanityTree.nearestPointIndexes( TestPoint( 2u, 0 ),
+                                                 3u ).empty() );
+    ASSERT_EQ( sanityTree.nearestPointIndexes( sanityPoints[ 0 ],
+                                               1000u ).size(),
+               sanityPoints.size() );
+
+    for ( size_t q = 0; q < 200u; ++q )
+    {
+        TestPoint pointOfInterest;
+        pointOfInterest.push_back( std::rand() % 60 - 5 );
+        pointOfInterest.push_back( std::rand() % 60 - 5 );
+        pointOfInterest.push_back( std::rand() % 60 - 5 );
+
+        Types::Neighbours expected;
+        for ( size_t i = 0; i < sanityPoints.size(); ++i )
+        {
+            expected.push_back( Types::Neighbour(
+                    Utils::squaredDistance< int >( sanityPoints[ i ],
+                                                   pointOfInterest ),
+                    i ) );
+        }
+        std::sort( expected.begin(), expected.end() );
+
+        const size_t k = 1u + q % 10u;
+        const Types::Indexes found =
+                sanityTree.nearestPointIndexes( pointOfInterest, k );
+
+        ASSERT_EQ( found.size(), k );
+        for ( size_t i = 0; i < k; ++i )
+        {
+            ASSERT_EQ( found[ i ], expected[ i ].second );
+        }
+    }
+}
+
+TEST( KDTree, SubtreeCountsAndBounds )
+{
+    TestPoints sanityPoints;
+    for ( int i = 0; i < 9; ++i )
+    {
+        TestPoint p;
+        p.push_back( i );
+        p.push_back( ( i * 7 ) % 5 - 2 );
+        sanityPoints.push_back( p );
+    }
+
+    TestKDTree sanityTree( sanityPoints );
+
+    ASSERT_EQ( sanityTree.root()->count(), sanityPoints.size() );
+    ASSERT_EQ( sanityTree.root()->bounds(),
+               Utils::minMaxPerAxis< int >( sanityPoints ) );
+    ASSERT_EQ( sanityTree.root()->left()->count() +
+               sanityTree.root()->right()->count(),
+               sanityPoints.size() );
+
+    // Deserialization restores the summaries as well
+    TestFileGuard guard( testFile );
+    ASSERT_TRUE( sanityTree.serialize( testFile ) );
+
+    TestKDTree deserialized;
+    ASSERT_TRUE( deserialized.deserialize( testFile ) );
+    ASSERT_EQ( deserialized.root()->count(), sanityPoints.size() );
+    ASSERT_EQ( deserialized.root()->right()->bounds(),
+               sanityTree.root()->right()->bounds() );
+}
+
+TEST( KDTree, KernelDensity )
+{
+    std::srand( 3 );
+
+    Types::Points< double > samples;
+    for ( size_t i = 0; i < 2000u; ++i )
+    {
+        Types::Point< double > p;
+        p.push_back( std::rand() / static_cast< double >( RAND_MAX ) );
+        p.push_back( std::rand() / static_cast< double >( RAND_MAX ) );
+        samples.push_back( p );
+    }
+
+    Types::Points< double > queries;
+    for ( size_t i = 0; i < 300u; ++i )
+    {
+        Types::Point< double > p;
+        p.push_back( 1.4 * std::rand() / RAND_MAX - 0.2 );
+        p.push_back( 1.4 * std::rand() / RAND_MAX - 0.2 );
+        queries.push_back( p );
+    }
+
+    const double bandwidth = 0.05;
+    const double tolerance = 1e-3;
+
+    KDTree< double > emptyTree;
+    ASSERT_EQ( emptyTree.kernelDensity( queries[ 0 ], bandwidth ), 0.0 );
+
+    KDTree< double > tree( samples );
+    ASSERT_EQ( tree.kernelDensity( queries[ 0 ], 0.0 ),
+               Constants::KDTREE_INVALID_DENSITY );
+    ASSERT_EQ( tree.kernelDensity( Types::Point< double >( 3u, 0.0 ),
+                                   bandwidth ),
+               Constants::KDTREE_INVALID_DENSITY );
+    ASSERT_TRUE( tree.kernelDensities( queries, -1.0 ).empty() );
+
+    const double norm = 1.0 / ( 2.0 * M_PI * bandwidth * bandwidth );
+
+    const std::vector< double > batch =
+            tree.kernelDensities( queries, bandwidth, tolerance, 3u );
+    ASSERT_EQ( batch.size(), queries.size() );
+
+    for ( size_t q = 0; q < queries.size(); ++q )
+    {
+        double expected = 0.0;
+        for ( size_t i = 0; i < samples.size(); ++i )
+        {
+            expected += std::exp(
+                    -Utils::squaredDistance< double >( samples[ i ],
+                                                       queries[ q ] ) /
+                    ( 2.0 * bandwidth * bandwidth ) );
+        }
+        expected *= norm / samples.size();
+
+        ASSERT_NEAR( tree.kernelDensity( queries[ q ], bandwidth ),
+                     expected, 1e-9 );
+        ASSERT_NEAR( tree.kernelDensity( queries[ q ], bandwidth, tolerance ),
+                     expected, tolerance );
+        ASSERT_NEAR( batch[ q ], expected, tolerance );
+    }
+}
+
+TEST( KDTree, AggregateInBoxAndRadius )
+{
+    std::srand( 11 );
+
+    TestPoints sanityPoints;
+    std::vector< double > values;
+    for ( size_t i = 0; i < 500u; ++i )
+    {
+        TestPoint p;
+        p.push_back( std::rand() % 40 );
+        p.push_back( std::rand() % 40 );
+        sanityPoints.push_back( p );
+        values.push_back( static_cast< double >( std::rand() % 100 ) );
+    }
+
+    TestKDTree plainTree( sanityPoints );
+    ASSERT_TRUE( plainTree.values().empty() );
+
+    KDTree< int > valuedTree( sanityPoints, values );
+    ASSERT_EQ( valuedTree.values(), values );
+    ASSERT_EQ( valuedTree.points(), sanityPoints );
+
+    // Mismatching values are dropped
+    KDTree< int > mismatchTree( sanityPoints, std::vector< double >( 3u ) );
+    ASSERT_TRUE( mismatchTree.values().empty() );
+
+    // Copies keep the values
+    KDTree< int > copiedTree( valuedTree );
+    ASSERT_EQ( copiedTree, valuedTree );
+    ASSERT_NE( copiedTree, mismatchTree );
+
+    for ( int x = -5; x < 45; x += 3 )
+    {
+        for ( int y = -5; y < 45; y += 4 )
+        {
+            Types::AxisMinMax< int > box;
+            box.push_back( std::pair< int, int >( x, x + 1 + ( x + y ) % 17 ) );
+            box.push_back( std::pair< int, int >( y, y + 9 ) );
+
+            TestPoint center;
+            center.push_back( x );
+            center.push_back( y );
+            const double radius = 0.5 * ( 1 + ( x * y ) % 13 );
+
+            KDAggregate expectedBox;
+            KDAggregate expectedRadius;
+            Types::Indexes expectedIndexes;
+            for ( size_t i = 0; i < sanityPoints.size(); ++i )
             {
-                break;
+                if ( Utils::boxContainsPoint< int >( box, sanityPoints[ i ] ) )
+                {
+                    expectedBox += KDAggregate( 1u, values[ i ] );
+                    expectedIndexes.push_back( i );
+                }
+                if ( Utils::distance< int >( center, sanityPoints[ i ] ) <=
+                     radius )
+                {
+                    expectedRadius += KDAggregate( 1u, values[ i ] );
+                }
             }
+
+            Types::Indexes found = plainTree.pointIndexesInBox( box );
+            std::sort( found.begin(), found.end() );
+            ASSERT_EQ( found, expectedIndexes );
+
+            ASSERT_EQ( valuedTree.aggregateInBox( box ), expectedBox );
+            ASSERT_EQ( valuedTree.aggregateInRadius( center, radius ),
+                       expectedRadius );
+            ASSERT_EQ( plainTree.aggregateInBox( box ).count(),
+                       expectedBox.count() );
+            ASSERT_EQ( plainTree.aggregateInBox( box ).sum(), 0.0 );
         }
+    }
 
-        treePoints.push_back( treePoint );
+    // Cardinality mismatch
+    ASSERT_TRUE( valuedTree.pointIndexesInBox(
+            Types::AxisMinMax< int >( 3u ) ).empty() );
+    ASSERT_EQ( valuedTree.aggregateInBox( Types::AxisMinMax< int >( 1u ) ),
+               KDAggregate() );
+    ASSERT_EQ( valuedTree.aggregateInRadius( TestPoint( 1u ), 2.0 ),
+               KDAggregate() );
+}
+
+TEST( KDTree, Correspondences )
+{
+    std::srand( 5 );
+
+    Types::Points< double > target;
+    for ( size_t i = 0; i < 1000u; ++i )
+    {
+        Types::Point< double > p;
+        p.push_back( std::rand() / static_cast< double >( RAND_MAX ) );
+        p.push_back( std::rand() / static_cast< double >( RAND_MAX ) );
+        p.push_back( std::rand() / static_cast< double >( RAND_MAX ) );
+        target.push_back( p );
     }
-    treeData.close();
 
-    KDTree< float > serializedTree( treePoints );
-    std::cout << serializedTree << std::endl;
+    // Source cloud is the shifted target with a few far outliers
+    Types::Points< double > source;
+    for ( size_t i = 0; i < 400u; ++i )
+    {
+        Types::Point< double > p = target[ i ];
+        p[ 0 ] += 0.01;
+        p[ 1 ] -= 0.02;
+        if ( i % 50u == 0u )
+        {
+            p[ 2 ] += 3.0;
+        }
+        source.push_back( p );
+    }
 
-    ASSERT_TRUE( serializedTree.serialize( testFile ) );
+    KDTree< double > emptyTree;
+    ASSERT_TRUE( emptyTree.correspondences( source ).empty() );
 
-    KDTree< float > deserializedTree;
-    ASSERT_TRUE( deserializedTree.deserialize( testFile ) );
-    std::cout << deserializedTree << std::endl;
+    KDTree< double > tree( target );
+    ASSERT_TRUE( tree.correspondences(
+            Types::Points< double >( 1u, Types::Point< double >( 2u ) ) )
+                    .empty() );
 
-    const std::string queryFilename = "data/query_data.csv";
-    std::ifstream queryData( queryFilename );
+    const double maxDistance = 0.5;
+    const Types::Neighbours cold =
+            tree.correspondences( source, maxDistance, Types::Neighbours(), 3u );
+    ASSERT_EQ( cold.size(), source.size() );
+
+    for ( size_t i = 0; i < source.size(); ++i )
+    {
+        Types::Neighbour expected( Constants::KDTREE_MAX_DISTANCE,
+                                   Constants::KDTREE_ERROR_INDEX );
+        for ( size_t j = 0; j < target.size(); ++j )
+        {
+            const Types::Neighbour candidate(
+                    Utils::squaredDistance< double >( target[ j ],
+                                                      source[ i ] ),
+                    j );
+            if ( candidate.first <= maxDistance * maxDistance &&
+                 candidate < expected )
+            {
+                expected = candidate;
+            }
+        }
+
+        ASSERT_EQ( cold[ i ], expected );
+        ASSERT_EQ( cold[ i ].second == Constants::KDTREE_ERROR_INDEX,
+                   i % 50u == 0u );
+    }
+
+    // Warm start from the previous iteration gives the same answer, even
+    // after the source moved, and regardless of thread count
+    const Types::Neighbours warm =
+            tree.correspondences( source, maxDistance, cold, 1u );
+    ASSERT_EQ( warm, cold );
+
+    for ( size_t i = 0; i < source.size(); ++i )
+    {
+        source[ i ][ 2 ] += 0.015;
+    }
 
-    ASSERT_TRUE( queryData.is_open() );
+    ASSERT_EQ( tree.correspondences( source, maxDistance, cold, 2u ),
+               tree.correspondences( source, maxDistance ) );
 
-    while ( getline ( queryData, line ) )
+    // Without a cut-off every point finds a correspondence
+    const Types::Neighbours unbounded = tree.correspondences( source );
+    for ( size_t i = 0; i < source.size(); ++i )
     {
-        Types::Point< float > queryPoint;
+        ASSERT_NE( unbounded[ i ].second, Constants::KDTREE_ERROR_INDEX );
+    }
+}
+
+TEST( KDTree, CorrespondencesInHighDimensions )
+{
+    // The blocked search ranks every candidate exactly, also when a
+    // common offset makes the norms dwarf the distances
+    checkBlockedCorrespondences< double >( 128u, 0.0 );
+    checkBlockedCorrespondences< float  >( 128u, 0.0 );
+    checkBlockedCorrespondences< float  >( 257u, 100.0f );
+    checkBlockedCorrespondences< double >(
+            Constants::KDTREE_BLOCKED_SEARCH_MIN_DIMENSION, 100.0 );
+}
+
+TEST( KDTree, CorrespondencesOfLowIntrinsicDimension )
+{
+    // Points on a three dimensional patch embedded in 64 dimensions, the
+    // case the tree handles well and the blocked scan must not take over
+    const size_t dimension = 64u;
+    std::mt19937 generator( 31 );
+    std::uniform_real_distribution< double > latent( -10.0, 10.0 );
+    std::uniform_real_distribution< double > noise( -1e-3, 1e-3 );
 
-        size_t pos = 0;
-        while ( true )
+    Types::Points< double > basis( 3u, Types::Point< double >( dimension ) );
+    for ( size_t b = 0; b < basis.size(); ++b )
+    {
+        for ( size_t k = 0; k < dimension; ++k )
         {
-            queryPoint.push_back( stof( line, &pos ) );
+            basis[ b ][ k ] = noise( generator ) * 1e3;
+        }
+    }
 
-            if ( line[ pos ] == ',')
+    const auto sample = [ & ]()
+    {
+        const double u = latent( generator );
+        const double v = latent( generator );
+        const double w = latent( generator );
+        Types::Point< double > p( dimension );
+        for ( size_t k = 0; k < dimension; ++k )
+        {
+            p[ k ] = u * basis[ 0 ][ k ] + v * basis[ 1 ][ k ] +
+                     w * basis[ 2 ][ k ] + noise( generator );
+        }
+        return p;
+    };
+
+    Types::Points< double > target( 8000u );
+    std::generate( target.begin(), target.end(), sample );
+    Types::Points< double > source( 200u );
+    std::generate( source.begin(), source.end(), sample );
+
+    const KDTree< double > tree( target );
+    ASSERT_GE( dimension, Constants::KDTREE_BLOCKED_SEARCH_MIN_DIMENSION );
+    ASSERT_LE( target.size(), Constants::KDTREE_BLOCKED_SEARCH_MAX_POINTS );
+
+    const auto timed = [ & ]( const bool blocked, Types::Neighbours& out )
+    {
+        const auto start = std::chrono::steady_clock::now();
+        out = tree.correspondences( source, Constants::KDTREE_MAX_DISTANCE,
+                                    Types::Neighbours(), 1u, blocked );
+        return std::chrono::steady_clock::now() - start;
+    };
+
+    Types::Neighbours viaTree;
+    Types::Neighbours viaScan;
+    const auto treeTime = timed( false, viaTree );
+    const auto scanTime = timed( true, viaScan );
+
+    // The default is the tree search
+    ASSERT_EQ( tree.correspondences( source ), viaTree );
+    ASSERT_EQ( viaScan, viaTree );
+    for ( size_t i = 0; i < source.size(); i += 10u )
+    {
+        Types::Neighbour expected( Constants::KDTREE_MAX_DISTANCE,
+                                   Constants::KDTREE_ERROR_INDEX );
+        for ( size_t j = 0; j < target.size(); ++j )
+        {
+            const Types::Neighbour candidate(
+                    Utils::squaredDistance< double >( target[ j ],
+                                                      source[ i ] ),
+                    j );
+            if ( candidate < expected )
             {
-                line = line.substr( pos + 1u );
+                expected = candidate;
             }
-            else
+        }
+
+        ASSERT_EQ( viaTree[ i ], expected );
+    }
+
+    // Here the tree prunes nearly everything, while the scan touches
+    // every pair of source and tree points
+    ASSERT_LT( treeTime, scanTime );
+}
+
+TEST( KDTree, MortonBuild )
+{
+    std::srand( 17 );
+
+    TestPoints sanityPoints;
+    for ( size_t i = 0; i < 2000u; ++i )
+    {
+        TestPoint p;
+        p.push_back( std::rand() % 100 );
+        p.push_back( std::rand() % 100 );
+        p.push_back( std::rand() % 3 );
+        sanityPoints.push_back( p );
+    }
+    // Duplicates end up in the same Morton cell
+    sanityPoints.push_back( sanityPoints[ 0 ] );
+    sanityPoints.push_back( sanityPoints[ 0 ] );
+
+    TestKDTree medianTree( sanityPoints );
+    for ( size_t numThreads = 1u; numThreads <= 4u; numThreads *= 4u )
+    {
+        TestKDTree mortonTree( sanityPoints,
+                               Types::BuildMethod::MORTON,
+                               numThreads );
+
+        ASSERT_EQ( mortonTree.root()->count(), sanityPoints.size() );
+        ASSERT_EQ( mortonTree.root()->bounds(),
+                   Utils::minMaxPerAxis< int >( sanityPoints ) );
+
+        for ( size_t q = 0; q < 100u; ++q )
+        {
+            TestPoint pointOfInterest;
+            pointOfInterest.push_back( std::rand() % 120 - 10 );
+            pointOfInterest.push_back( std::rand() % 120 - 10 );
+            pointOfInterest.push_back( std::rand() % 5 - 1 );
+
+            ASSERT_EQ( mortonTree.nearestPointIndexes( pointOfInterest, 5u ),
+                       medianTree.nearestPointIndexes( pointOfInterest, 5u ) );
+
+            Types::Indexes mortonFound =
+                    mortonTree.pointIndexesInRadius( pointOfInterest, 9.0 );
+            Types::Indexes medianFound =
+                    medianTree.pointIndexesInRadius( pointOfInterest, 9.0 );
+            std::sort( mortonFound.begin(), mortonFound.end() );
+            std::sort( medianFound.begin(), medianFound.end() );
+            ASSERT_EQ( mortonFound, medianFound );
+        }
+    }
+
+    // High dimensional points fall back to the median split
+    TestPoints widePoints( 4u, TestPoint( 70u, 0 ) );
+    widePoints[ 1 ][ 3 ] = 1;
+    TestKDTree wideTree( widePoints, Types::BuildMethod::MORTON );
+    ASSERT_EQ( wideTree, TestKDTree( widePoints ) );
+
+    TestKDTree emptyTree( TestPoints(), Types::BuildMethod::MORTON );
+    ASSERT_EQ( emptyTree, TestKDTree() );
+}
+
+TEST( KDTree, PresortedBuild )
+{
+    std::srand( 23 );
+
+    TestPoints sanityPoints;
+    for ( size_t i = 0; i < 1500u; ++i )
+    {
+        TestPoint p;
+        p.push_back( std::rand() % 40 );
+        p.push_back( std::rand() % 90 );
+        p.push_back( std::rand() % 4 );
+        sanityPoints.push_back( p );
+    }
+    sanityPoints.push_back( sanityPoints[ 3 ] );
+    sanityPoints.push_back( sanityPoints[ 3 ] );
+    sanityPoints.push_back( sanityPoints[ 3 ] );
+
+    // Splits match the default heuristic exactly
+    TestKDTree medianTree( sanityPoints );
+    for ( size_t numThreads = 1u; numThreads <= 4u; numThreads *= 4u )
+    {
+        TestKDTree presortedTree( sanityPoints,
+                                  Types::BuildMethod::PRESORTED,
+                                  numThreads );
+        ASSERT_EQ( presortedTree, medianTree );
+        ASSERT_TRUE( sameStructure( presortedTree.root().get(),
+                                    medianTree.root().get() ) );
+    }
+
+    TestPoints identicalPoints( 5u, TestPoint( 2u, 7 ) );
+    TestKDTree identicalTree( identicalPoints );
+    TestKDTree identicalPresorted( identicalPoints,
+                                   Types::BuildMethod::PRESORTED );
+    ASSERT_TRUE( sameStructure( identicalPresorted.root().get(),
+                                identicalTree.root().get() ) );
+
+    TestPoints single( 1u, TestPoint( 2u, 7 ) );
+    TestKDTree singleTree( single, Types::BuildMethod::PRESORTED );
+    ASSERT_TRUE( singleTree.root()->isLeaf() );
+    ASSERT_EQ( singleTree.root()->leafPointIndex(), 0u );
+}
+
+TEST( KDTree, SplitPoliciesAndMetrics )
+{
+    static_assert( std::is_same< KDTree< int >,
+                                 KDTree< int,
+                                         KDMedianSplit< int >,
+                                         KDEuclideanMetric > >::value,
+                   "KDTree< T > must keep the original heuristic" );
+
+    typedef KDTree< int, KDMidpointSplit< int >, KDManhattanMetric >
+            ManhattanKDTree;
+
+    std::srand( 31 );
+
+    TestPoints sanityPoints;
+    for ( size_t i = 0; i < 500u; ++i )
+    {
+        TestPoint p;
+        p.push_back( std::rand() % 60 );
+        p.push_back( std::rand() % 60 );
+        p.push_back( std::rand() % 10 );
+        sanityPoints.push_back( p );
+    }
+    sanityPoints.push_back( sanityPoints[ 0 ] );
+
+    const ManhattanKDTree manhattanTree( sanityPoints );
+    const KDTree< int, KDMidpointSplit< int > > midpointTree( sanityPoints );
+
+    for ( size_t q = 0; q < 100u; ++q )
+    {
+        TestPoint pointOfInterest;
+        pointOfInterest.push_back( std::rand() % 70 - 5 );
+        pointOfInterest.push_back( std::rand() % 70 - 5 );
+        pointOfInterest.push_back( std::rand() % 12 - 1 );
+
+        Types::Neighbours manhattan;
+        Types::Neighbours euclidean;
+        for ( size_t i = 0; i < sanityPoints.size(); ++i )
+        {
+            manhattan.push_back( Types::Neighbour(
+                    KDManhattanMetric::rank( sanityPoints[ i ],
+                                             pointOfInterest ), i ) );
+            euclidean.push_back( Types::Neighbour(
+                    KDEuclideanMetric::rank( sanityPoints[ i ],
+                                             pointOfInterest ), i ) );
+        }
+        std::sort( manhattan.begin(), manhattan.end() );
+        std::sort( euclidean.begin(), euclidean.end() );
+
+        const size_t k = 1u + q % 7u;
+        const Types::Indexes manhattanFound =
+                manhattanTree.nearestPointIndexes( pointOfInterest, k );
+        const Types::Indexes euclideanFound =
+                midpointTree.nearestPointIndexes( pointOfInterest, k );
+        ASSERT_EQ( manhattanFound.size(), k );
+        ASSERT_EQ( euclideanFound.size(), k );
+        for ( size_t i = 0; i < k; ++i )
+        {
+            ASSERT_EQ( manhattanFound[ i ], manhattan[ i ].second );
+            ASSERT_EQ( euclideanFound[ i ], euclidean[ i ].second );
+        }
+
+        ASSERT_DOUBLE_EQ(
+                KDManhattanMetric::rank(
+                        sanityPoints[ manhattanTree.nearestPointIndex(
+                                pointOfInterest ) ],
+                        pointOfInterest ),
+                manhattan[ 0 ].first );
+
+        Types::Indexes expected;
+        for ( size_t i = 0; i < manhattan.size(); ++i )
+        {
+            if ( manhattan[ i ].first <= 12.0 )
             {
-                break;
+                expected.push_back( manhattan[ i ].second );
             }
         }
+        std::sort( expected.begin(), expected.end() );
 
-        const size_t bruteIndex =
-                bruteForceClosestIndex( treePoints, queryPoint );
-        const size_t serializedTreeIndex =
-                serializedTree.nearestPointIndex( queryPoint ) ;
-        const size_t deserializedTreeIndex =
-                deserializedTree.nearestPointIndex( queryPoint ) ;
+        Types::Indexes found =
+                manhattanTree.pointIndexesInRadius( pointOfInterest, 12.0 );
+        std::sort( found.begin(), found.end() );
+        ASSERT_EQ( found, expected );
+        ASSERT_EQ( manhattanTree.aggregateInRadius( pointOfInterest,
+                                                    12.0 ).count(),
+                   expected.size() );
+    }
+}
 
-        ASSERT_EQ( bruteIndex, serializedTreeIndex );
-        ASSERT_EQ( bruteIndex, deserializedTreeIndex );
+
+TEST( KDTree, ReorderIntoLeafOrder )
+{
+    TestFileGuard guard( testFile );
+    std::srand( 37 );
+
+    TestPoints sanityPoints;
+    for ( size_t i = 0; i < 800u; ++i )
+    {
+        TestPoint p;
+        p.push_back( std::rand() % 50 );
+        p.push_back( std::rand() % 50 );
+        sanityPoints.push_back( p );
+    }
+    sanityPoints.push_back( sanityPoints[ 5 ] );
+
+    const TestKDTree originalTree( sanityPoints );
+    TestKDTree reorderedTree( sanityPoints );
+    ASSERT_TRUE( reorderedTree.permutation().empty() );
+    ASSERT_EQ( reorderedTree.originalIndex( 7u ), 7u );
+
+    ASSERT_TRUE( reorderedTree.reorder() );
+    ASSERT_EQ( reorderedTree.permutation().size(), sanityPoints.size() );
+    ASSERT_NE( reorderedTree, originalTree );
+
+    // Leaves are numbered sequentially and refer to the moved points
+    Types::Indexes expectedOrder;
+    for ( size_t i = 0; i < sanityPoints.size(); ++i )
+    {
+        expectedOrder.push_back( i );
+        ASSERT_EQ( reorderedTree.points()[ i ],
+                   sanityPoints[ reorderedTree.originalIndex( i ) ] );
+    }
+    ASSERT_EQ( leafOrder( reorderedTree.root().get() ), expectedOrder );
+
+    for ( size_t q = 0; q < 100u; ++q )
+    {
+        TestPoint pointOfInterest;
+        pointOfInterest.push_back( std::rand() % 60 - 5 );
+        pointOfInterest.push_back( std::rand() % 60 - 5 );
+
+        const Types::Indexes expected =
+                originalTree.nearestPointIndexes( pointOfInterest, 4u );
+        const Types::Indexes found =
+                reorderedTree.nearestPointIndexes( pointOfInterest, 4u );
+        ASSERT_EQ( found.size(), expected.size() );
+        for ( size_t i = 0; i < found.size(); ++i )
+        {
+            // Ties between equally distant points may resolve differently
+            ASSERT_EQ( KDEuclideanMetric::rank(
+                               sanityPoints[ reorderedTree.originalIndex(
+                                       found[ i ] ) ],
+                               pointOfInterest ),
+                       KDEuclideanMetric::rank( sanityPoints[ expected[ i ] ],
+                                                pointOfInterest ) );
+        }
+    }
+
+    // Reordering twice keeps the tree and composes the permutation
+    TestKDTree twiceTree( sanityPoints );
+    ASSERT_TRUE( twiceTree.reorder() );
+    ASSERT_TRUE( twiceTree.reorder() );
+    ASSERT_EQ( twiceTree.permutation(), reorderedTree.permutation() );
+    ASSERT_EQ( twiceTree.points(), reorderedTree.points() );
+
+    // The permutation survives serialization
+    ASSERT_TRUE( reorderedTree.serialize( testFile ) );
+    TestKDTree deserialized;
+    ASSERT_TRUE( deserialized.deserialize( testFile ) );
+    ASSERT_EQ( deserialized.permutation(), reorderedTree.permutation() );
+    ASSERT_EQ( deserialized.points(), reorderedTree.points() );
+    ASSERT_EQ( leafOrder( deserialized.root().get() ), expectedOrder );
+
+    TestKDTree emptyTree;
+    ASSERT_TRUE( emptyTree.reorder() );
+    ASSERT_EQ( emptyTree, TestKDTree() );
+}
+
+TEST( KDTREE, DeserializeReportsMalformedInput )
+{
+    TestFileGuard guard( testFile );
+
+    TestPoints treePoints;
+    treePoints.push_back( TestPoint( { 1, 2 } ) );
+    treePoints.push_back( TestPoint( { 3, 4 } ) );
+    const TestKDTree sampleTree( treePoints );
+
+    TestKDTree deserialized;
+    ASSERT_EQ( deserialized.deserialize( "non_existent_tree_file.txt" ).code(),
+               KDStatus::Code::IO_ERROR );
+
+    const std::string header = Constants::KDTREE_SIMPLE_VARIETY + "\n";
+    const std::string leaf0  = Constants::KDTREE_LEAF_MARKER + "\n0\n";
+    const std::string leaf1  = Constants::KDTREE_LEAF_MARKER + "\n1\n";
+    const std::string split  = Constants::KDTREE_HYPERPLANE_MARKER + "\n";
+
+    struct Case {
+        std::string      contents;
+        KDStatus::Code   code;
+        size_t           line;
+    };
+
+    const Case cases[] = {
+        { "unknown\n",
+          KDStatus::Code::TYPE_MISMATCH,        1u },
+        { header + "two\n",
+          KDStatus::Code::PARSE_ERROR,          2u },
+        { header + "2\n1,2\n",
+          KDStatus::Code::PARSE_ERROR,          4u },
+        { header + "2\n1,2\n3\n",
+          KDStatus::Code::CARDINALITY_MISMATCH, 4u },
+        { header + "2\n1,2\n3,x\n",
+          KDStatus::Code::PARSE_ERROR,          4u },
+        { header + "2\n1,2\n3,4\n" + split + "0 2\n" + leaf0 + "LEAF\n2\n",
+          KDStatus::Code::CARDINALITY_MISMATCH, 10u },
+        { header + "2\n1,2\n3,4\n" + split + "2 2\n" + leaf0 + leaf1,
+          KDStatus::Code::CARDINALITY_MISMATCH, 6u },
+        { header + "2\n1,2\n3,4\n" + split + "0\n" + leaf0 + leaf1,
+          KDStatus::Code::PARSE_ERROR,          6u },
+        { header + "2\n1,2\n3,4\n" + split + "0 2\n" + leaf0 + leaf0,
+          KDStatus::Code::PARSE_ERROR,          10u },
+        { header + "2\n1,2\n3,4\n" + split + "0 2\n" + leaf0,
+          KDStatus::Code::PARSE_ERROR,          9u },
+        { header + "2\n1,2\n3,4\n" + split + "0 2\n" + leaf0 + leaf1 +
+          Constants::KDTREE_PERMUTATION_MARKER + "\n1\n2\n",
+          KDStatus::Code::PARSE_ERROR,          13u },
+    };
+
+    for ( size_t i = 0; i < sizeof( cases ) / sizeof( cases[ 0 ] ); ++i )
+    {
+        {
+            std::ofstream file( testFile.c_str(), std::ofstream::trunc );
+            file << cases[ i ].contents;
+        }
+
+        for ( size_t numThreads = 1u; numThreads <= 4u; numThreads *= 4u )
+        {
+            TestKDTree tree( treePoints );
+            const KDStatus status = tree.deserialize( testFile, numThreads );
+            ASSERT_EQ( status.code(), cases[ i ].code ) << i << " " << status;
+            ASSERT_EQ( status.line(), cases[ i ].line ) << i << " " << status;
+
+            // Failed deserialization keeps the tree
+            ASSERT_EQ( tree, sampleTree );
+            ASSERT_EQ( tree.nearestPointIndex( TestPoint( { 3, 3 } ) ), 1u );
+        }
+    }
+
+    // Queries of a wrong cardinality are rejected at the entry point
+    ASSERT_EQ( sampleTree.nearestPointIndex( TestPoint( { 3 } ) ),
+               Constants::KDTREE_ERROR_INDEX );
+    ASSERT_EQ( TestKDTree().nearestPointIndex( TestPoint( { 3, 3 } ) ),
+               Constants::KDTREE_ERROR_INDEX );
+}
+
+TEST( KDTree, ExactParallelSerialization )
+{
+    TestFileGuard guard( testFile );
+    const std::string otherFile = testFile + ".other";
+    TestFileGuard otherGuard( otherFile );
+
+    std::mt19937_64 generator( 41u );
+    std::uniform_real_distribution< double > coordinate( -1.0e3, 1.0e3 );
+
+    Types::Points< double > points( 3000u, Types::Point< double >( 3u ) );
+    for ( size_t i = 0; i < points.size(); ++i )
+    {
+        for ( size_t j = 0; j < points[ i ].size(); ++j )
+        {
+            points[ i ][ j ] = coordinate( generator );
+        }
+    }
+    points[ 1 ][ 0 ] = std::numeric_limits< double >::denorm_min();
+    points[ 2 ][ 1 ] = std::numeric_limits< double >::max();
+
+    KDTree< double > tree( points );
+    ASSERT_TRUE( tree.reorder() );
+    ASSERT_TRUE( tree.serialize( testFile, 1u ) );
+
+    // The file does not depend on the number of threads
+    for ( size_t numThreads = 2u; numThreads <= 5u; numThreads += 3u )
+    {
+        ASSERT_TRUE( tree.serialize( otherFile, numThreads ) );
+
+        std::string expected;
+        std::string contents;
+        ASSERT_TRUE( Text::readFile( testFile, expected ) );
+        ASSERT_TRUE( Text::readFile( otherFile, contents ) );
+        ASSERT_EQ( contents, expected );
+    }
+
+    // Points, hyperplanes and the permutation come back bit for bit
+    for ( size_t numThreads = 1u; numThreads <= 4u; numThreads *= 4u )
+    {
+        KDTree< double > deserialized;
+        ASSERT_TRUE( deserialized.deserialize( testFile, numThreads ) );
+        ASSERT_EQ( deserialized, tree );
+
+        ASSERT_TRUE( deserialized.serialize( otherFile, numThreads ) );
+        std::string expected;
+        std::string contents;
+        ASSERT_TRUE( Text::readFile( testFile, expected ) );
+        ASSERT_TRUE( Text::readFile( otherFile, contents ) );
+        ASSERT_EQ( contents, expected );
+
+        for ( size_t q = 0; q < 50u; ++q )
+        {
+            Types::Point< double > pointOfInterest( 3u );
+            for ( size_t j = 0; j < pointOfInterest.size(); ++j )
+            {
+                pointOfInterest[ j ] = coordinate( generator );
+            }
+            ASSERT_EQ( deserialized.nearestPointIndexes( pointOfInterest, 3u ),
+                       tree.nearestPointIndexes( pointOfInterest, 3u ) );
+        }
+    }
+}
+
+TEST( KDTree, ReproducibleBuilds )
+{
+    TestFileGuard guard( testFile );
+    const std::string otherFile = testFile + ".other";
+    TestFileGuard otherGuard( otherFile );
+
+    // Many equal coordinates, zeros of both signs among them
+    std::mt19937_64 generator( 43u );
+    const double coordinates[] = { -0.0, 0.0, 1.5, -2.0, 0.0, -0.0, 7.25 };
+    std::uniform_int_distribution< size_t > pick( 0u, 6u );
+    std::uniform_real_distribution< double > coordinate( -10.0, 10.0 );
+
+    Types::Points< double > points( 4000u, Types::Point< double >( 3u ) );
+    for ( size_t i = 0; i < points.size(); ++i )
+    {
+        for ( size_t j = 0; j < points[ i ].size(); ++j )
+        {
+            points[ i ][ j ] = i % 4u ? coordinates[ pick( generator ) ] :
+                                        coordinate( generator );
+        }
+    }
+
+    std::string median;
+    ASSERT_TRUE( KDTree< double >( points ).serialize( testFile, 1u ) );
+    ASSERT_TRUE( Text::readFile( testFile, median ) );
+
+    std::string morton;
+    ASSERT_TRUE( KDTree< double >( points, Types::BuildMethod::MORTON,
+                                   1u ).serialize( testFile, 1u ) );
+    ASSERT_TRUE( Text::readFile( testFile, morton ) );
+
+    // Every thread count, run twice to vary the interleaving, writes the
+    // same bytes, the presorted build the same as the median build
+    for ( size_t run = 0; run < 2u; ++run )
+    {
+        for ( size_t numThreads = 1u; numThreads <= 8u; numThreads *= 2u )
+        {
+            std::string contents;
+            ASSERT_TRUE( KDTree< double >( points,
+                                           Types::BuildMethod::PRESORTED,
+                                           numThreads ).serialize(
+                                 otherFile, numThreads ) );
+            ASSERT_TRUE( Text::readFile( otherFile, contents ) );
+            ASSERT_EQ( contents, median );
+
+            ASSERT_TRUE( KDTree< double >( points,
+                                           Types::BuildMethod::MORTON,
+                                           numThreads ).serialize(
+                                 otherFile, numThreads ) );
+            ASSERT_TRUE( Text::readFile( otherFile, contents ) );
+            ASSERT_EQ( contents, morton );
+        }
+    }
+}
+
+TEST( KDTree, MergeTrees )
+{
+    std::srand( 23 );
+
+    // Two regions side by side and a third one overlapping both
+    TestPoints westPoints;
+    TestPoints eastPoints;
+    TestPoints overlapPoints;
+    std::vector< double > westValues;
+    for ( size_t i = 0; i < 1000u; ++i )
+    {
+        westPoints.push_back( TestPoint( { std::rand() % 500,
+                                           std::rand() % 1000 } ) );
+        eastPoints.push_back( TestPoint( { 600 + std::rand() % 500,
+                                           std::rand() % 1000 } ) );
+        overlapPoints.push_back( TestPoint( { 400 + std::rand() % 300,
+                                              std::rand() % 1000 } ) );
+        westValues.push_back( static_cast< double >( i % 10 ) );
+    }
+
+    TestPoints allPoints = westPoints;
+    allPoints.insert( allPoints.end(), eastPoints.begin(), eastPoints.end() );
+
+    // Disjoint trees keep both roots under a new one
+    TestKDTree merged( westPoints );
+    const std::shared_ptr< KDNode< int > > westRoot = merged.root();
+    ASSERT_TRUE( merged.merge( TestKDTree( eastPoints ) ) );
+    ASSERT_EQ( merged.size(), allPoints.size() );
+    ASSERT_EQ( merged.points(), allPoints );
+    ASSERT_EQ( merged.root()->left(), westRoot );
+    ASSERT_EQ( merged.root()->count(), allPoints.size() );
+    ASSERT_EQ( merged.root()->bounds(),
+               Utils::minMaxPerAxis< int >( allPoints ) );
+    ASSERT_EQ( depth( merged.root().get() ),
+               depth( TestKDTree( eastPoints ).root().get() ) + 1u );
+
+    // Overlapping regions are rebuilt, the tree stays balanced
+    ASSERT_TRUE( merged.merge( TestKDTree( overlapPoints ) ) );
+    allPoints.insert( allPoints.end(), overlapPoints.begin(),
+                      overlapPoints.end() );
+    ASSERT_EQ( merged.points(), allPoints );
+    Types::Indexes order = leafOrder( merged.root().get() );
+    std::sort( order.begin(), order.end() );
+    for ( size_t i = 0; i < order.size(); ++i )
+    {
+        ASSERT_EQ( order[ i ], i );
+    }
+    ASSERT_LE( depth( merged.root().get() ),
+               depth( TestKDTree( allPoints ).root().get() ) * 2u );
+
+    for ( size_t q = 0; q < 200u; ++q )
+    {
+        const TestPoint pointOfInterest( { std::rand() % 1200 - 50,
+                                           std::rand() % 1100 - 50 } );
+        ASSERT_EQ( Utils::distance< int >(
+                           merged.nearestPoint( pointOfInterest ),
+                           pointOfInterest ),
+                   Utils::distance< int >(
+                           bruteForceClosest( allPoints, pointOfInterest ),
+                           pointOfInterest ) );
+
+        Types::Indexes found = merged.pointIndexesInRadius( pointOfInterest,
+                                                            40.0 );
+        Types::Indexes expected;
+        for ( size_t i = 0; i < allPoints.size(); ++i )
+        {
+            if ( Utils::distance< int >( allPoints[ i ], pointOfInterest ) <=
+                         40.0 )
+            {
+                expected.push_back( i );
+            }
+        }
+        std::sort( found.begin(), found.end() );
+        ASSERT_EQ( found, expected );
+    }
+
+    // Values follow their points, points without values count 0
+    KDTree< int > valued( westPoints, westValues );
+    ASSERT_TRUE( valued.merge( KDTree< int >( eastPoints ) ) );
+    ASSERT_EQ( valued.values().size(), 2000u );
+    Types::AxisMinMax< int > everything( 2u, std::pair< int, int >( -1, 2000 ) );
+    ASSERT_EQ( valued.aggregateInBox( everything ),
+               KDAggregate( 2000u, 4500.0 ) );
+
+    // Reordered trees carry their original indexes over
+    TestKDTree reordered( westPoints );
+    ASSERT_TRUE( reordered.reorder() );
+    ASSERT_TRUE( reordered.merge( TestKDTree( eastPoints ) ) );
+    ASSERT_EQ( reordered.originalIndex( 1000u + 7u ), 1000u + 7u );
+    ASSERT_EQ( reordered.points()[ 3u ],
+               westPoints[ reordered.originalIndex( 3u ) ] );
+
+    // Merging into an empty tree, with itself and of a mismatching tree
+    TestKDTree empty;
+    ASSERT_TRUE( empty.merge( TestKDTree( westPoints ) ) );
+    ASSERT_EQ( empty.points(), westPoints );
+    ASSERT_TRUE( empty.merge( empty ) );
+    ASSERT_EQ( empty.size(), 2000u );
+    ASSERT_EQ( empty.pointIndexesInRadius( westPoints[ 5 ], 0.0 ).size(), 2u );
+
+    const KDStatus status = empty.merge( TestKDTree( TestPoints(
+            { TestPoint( { 1, 2, 3 } ) } ) ) );
+    ASSERT_EQ( status.code(), KDStatus::Code::CARDINALITY_MISMATCH );
+    ASSERT_EQ( empty.size(), 2000u );
+}
+
+TEST( KDTree, EraseInBoxAndByPredicate )
+{
+    std::srand( 29 );
+
+    TestPoints sanityPoints;
+    std::vector< double > values;
+    for ( size_t i = 0; i < 3000u; ++i )
+    {
+        sanityPoints.push_back( TestPoint( { std::rand() % 1000,
+                                             std::rand() % 1000 } ) );
+        values.push_back( static_cast< double >( i ) );
+    }
+
+    // A region covering most of the tree
+    Types::AxisMinMax< int > region;
+    region.push_back( std::pair< int, int >( 100, 999 ) );
+    region.push_back( std::pair< int, int >( -5, 700 ) );
+
+    TestPoints remaining;
+    std::vector< double > remainingValues;
+    for ( size_t i = 0; i < sanityPoints.size(); ++i )
+    {
+        if ( !Utils::boxContainsPoint( region, sanityPoints[ i ] ) )
+        {
+            remaining.push_back( sanityPoints[ i ] );
+            remainingValues.push_back( values[ i ] );
+        }
+    }
+
+    KDTree< int > valued( sanityPoints, values );
+    ASSERT_EQ( valued.eraseIf( region ),
+               sanityPoints.size() - remaining.size() );
+    ASSERT_EQ( valued.points(), remaining );
+    ASSERT_EQ( valued.values(), remainingValues );
+    ASSERT_TRUE( valued.pointIndexesInBox( region ).empty() );
+
+    Types::AxisMinMax< int > everything( 2u, std::pair< int, int >( -1, 1000 ) );
+    double sum = 0.0;
+    for ( size_t i = 0; i < remainingValues.size(); ++i )
+    {
+        sum += remainingValues[ i ];
+    }
+    ASSERT_EQ( valued.aggregateInBox( everything ),
+               KDAggregate( remaining.size(), sum ) );
+
+    // The rest of the tree is balanced and answers queries
+    TestKDTree erased( sanityPoints );
+    ASSERT_EQ( erased.eraseIf( region ),
+               sanityPoints.size() - remaining.size() );
+    ASSERT_EQ( erased.root()->count(), remaining.size() );
+    ASSERT_EQ( erased.root()->bounds(),
+               Utils::minMaxPerAxis< int >( remaining ) );
+    Types::Indexes order = leafOrder( erased.root().get() );
+    std::sort( order.begin(), order.end() );
+    for ( size_t i = 0; i < order.size(); ++i )
+    {
+        ASSERT_EQ( order[ i ], i );
+    }
+    ASSERT_LE( depth( erased.root().get() ),
+               depth( TestKDTree( remaining ).root().get() ) * 2u );
+
+    for ( size_t q = 0; q < 200u; ++q )
+    {
+        const TestPoint pointOfInterest( { std::rand() % 1100 - 50,
+                                           std::rand() % 1100 - 50 } );
+        ASSERT_EQ( Utils::distance< int >(
+                           erased.nearestPoint( pointOfInterest ),
+                           pointOfInterest ),
+                   Utils::distance< int >(
+                           bruteForceClosest( remaining, pointOfInterest ),
+                           pointOfInterest ) );
+    }
+
+    // Regions without points and of a mismatching cardinality
+    ASSERT_EQ( erased.eraseIf( region ), 0u );
+    ASSERT_EQ( erased.eraseIf( Types::AxisMinMax< int >( 3u,
+                       std::pair< int, int >( 0, 1000 ) ) ), 0u );
+    ASSERT_EQ( erased.size(), remaining.size() );
+
+    // Predicates see the points before anything is erased
+    TestKDTree filtered( sanityPoints );
+    ASSERT_TRUE( filtered.reorder() );
+    const size_t numErased = filtered.eraseIf(
+        [ & ]( const size_t index )
+        {
+            return filtered.point( index )[ 0 ] % 3 == 0;
+        } );
+
+    TestPoints expected;
+    for ( size_t i = 0; i < sanityPoints.size(); ++i )
+    {
+        if ( sanityPoints[ i ][ 0 ] % 3 != 0 )
+        {
+            expected.push_back( sanityPoints[ i ] );
+        }
+    }
+    ASSERT_EQ( numErased, sanityPoints.size() - expected.size() );
+    ASSERT_EQ( filtered.size(), expected.size() );
+    for ( size_t i = 0; i < filtered.size(); ++i )
+    {
+        ASSERT_EQ( filtered.points()[ i ],
+                   expected[ filtered.originalIndex( i ) ] );
+    }
+    ASSERT_EQ( filtered.nearestPointIndexes( TestPoint( { 300, 300 } ),
+                                             5u ).size(), 5u );
+
+    // The compacted tree survives serialization
+    TestFileGuard guard( testFile );
+    ASSERT_TRUE( filtered.serialize( testFile ) );
+    TestKDTree deserialized;
+    ASSERT_TRUE( deserialized.deserialize( testFile ) );
+    ASSERT_EQ( deserialized, filtered );
+
+    ASSERT_EQ( filtered.eraseIf( []( const size_t ) { return true; } ),
+               expected.size() );
+    ASSERT_EQ( filtered.size(), 0u );
+    ASSERT_EQ( filtered.nearestPointIndex( TestPoint( { 1, 1 } ) ),
+               Constants::KDTREE_ERROR_INDEX );
+}
+
+TEST( KDTree, UpdateMovingPoints )
+{
+    std::srand( 31 );
+
+    TestPoints sanityPoints;
+    std::vector< double > values;
+    for ( size_t i = 0; i < 2000u; ++i )
+    {
+        sanityPoints.push_back( TestPoint( { std::rand() % 1000,
+                                             std::rand() % 1000 } ) );
+        values.push_back( static_cast< double >( i % 7 ) );
+    }
+
+    // Small moves stay within the loose cells
+    TestKDTree moved( sanityPoints );
+    KDTree< int > valued( sanityPoints, values );
+    const KDNode< int >* root = moved.root().get();
+    ASSERT_TRUE( moved.update( 0u, sanityPoints[ 0 ] ) );
+    ASSERT_EQ( moved.root().get(), root );
+    for ( size_t i = 0; i < sanityPoints.size(); i += 10u )
+    {
+        TestPoint point = sanityPoints[ i ];
+        point[ i % 2 ] += i % 3 == 0 ? 1 : 0;
+        ASSERT_TRUE( moved.update( i, point ) );
+        ASSERT_TRUE( valued.update( i, point ) );
+        sanityPoints[ i ] = moved.point( i );
+    }
+    ASSERT_EQ( moved.points(), sanityPoints );
+
+    // Large moves cross cells, after a quarter of the points the tree
+    // is rebuilt
+    for ( size_t step = 0; step < 700u; ++step )
+    {
+        const size_t index = std::rand() % sanityPoints.size();
+        const TestPoint point( { std::rand() % 1400 - 200,
+                                 std::rand() % 1400 - 200 } );
+        ASSERT_TRUE( moved.update( index, point ) );
+        ASSERT_TRUE( valued.update( index, point ) );
+        sanityPoints[ index ] = point;
+    }
+    ASSERT_EQ( moved.points(), sanityPoints );
+    ASSERT_EQ( moved.root()->count(), sanityPoints.size() );
+    ASSERT_NE( moved.root().get(), root );
+
+    Types::Indexes order = leafOrder( moved.root().get() );
+    std::sort( order.begin(), order.end() );
+    for ( size_t i = 0; i < order.size(); ++i )
+    {
+        ASSERT_EQ( order[ i ], i );
     }
 
-    queryData.close();
+    double sum = 0.0;
+    for ( size_t i = 0; i < values.size(); ++i )
+    {
+        sum += values[ i ];
+    }
+    Types::AxisMinMax< int > everything(
+            2u, std::pair< int, int >( -200, 1200 ) );
+    ASSERT_EQ( valued.aggregateInBox( everything ),
+               KDAggregate( sanityPoints.size(), sum ) );
+
+    // Queries match the moved points
+    Types::AxisMinMax< int > box;
+    box.push_back( std::pair< int, int >( 200, 600 ) );
+    box.push_back( std::pair< int, int >( -100, 300 ) );
+    Types::Indexes inBox = moved.pointIndexesInBox( box );
+    std::sort( inBox.begin(), inBox.end() );
+    Types::Indexes expectedInBox;
+    for ( size_t i = 0; i < sanityPoints.size(); ++i )
+    {
+        if ( Utils::boxContainsPoint( box, sanityPoints[ i ] ) )
+        {
+            expectedInBox.push_back( i );
+        }
+    }
+    ASSERT_EQ( inBox, expectedInBox );
+
+    for ( size_t q = 0; q < 200u; ++q )
+    {
+        const TestPoint pointOfInterest( { std::rand() % 1600 - 300,
+                                           std::rand() % 1600 - 300 } );
+        ASSERT_EQ( Utils::distance< int >(
+                           moved.nearestPoint( pointOfInterest ),
+                           pointOfInterest ),
+                   Utils::distance< int >(
+                           bruteForceClosest( sanityPoints,
+                                              pointOfInterest ),
+                           pointOfInterest ) );
+
+        Types::Indexes inRadius =
+                moved.pointIndexesInRadius( pointOfInterest, 60.0 );
+        std::sort( inRadius.begin(), inRadius.end() );
+        Types::Indexes expectedInRadius;
+        for ( size_t i = 0; i < sanityPoints.size(); ++i )
+        {
+            if ( Utils::distance< int >( sanityPoints[ i ],
+                                         pointOfInterest ) <= 60.0 )
+            {
+                expectedInRadius.push_back( i );
+            }
+        }
+        ASSERT_EQ( inRadius, expectedInRadius );
+    }
+
+    // Indexes out of range and points of a mismatching cardinality
+    ASSERT_EQ( moved.update( sanityPoints.size(), sanityPoints[ 0 ] ).code(),
+               KDStatus::Code::NOT_FOUND );
+    ASSERT_EQ( moved.update( 0u, TestPoint( 3u, 0 ) ).code(),
+               KDStatus::Code::CARDINALITY_MISMATCH );
+    ASSERT_EQ( moved.points(), sanityPoints );
+
+    // A lone point moves anywhere
+    TestKDTree single( TestPoints( 1u, TestPoint( { 5, 5 } ) ) );
+    ASSERT_TRUE( single.update( 0u, TestPoint( { -40, 70 } ) ) );
+    ASSERT_TRUE( single.update( 0u, TestPoint( { 900, -3 } ) ) );
+    ASSERT_EQ( single.nearestPoint( TestPoint( { 0, 0 } ) ),
+               TestPoint( { 900, -3 } ) );
 }
+TEST( KDTree, FindAndCollapseDuplicates )
+{
+    std::srand( 37 );
+
+    // Few distinct coordinates, most points lie on some hyperplane
+    TestPoints sanityPoints;
+    for ( size_t i = 0; i < 1500u; ++i )
+    {
+        sanityPoints.push_back( TestPoint( { std::rand() % 12,
+                                             std::rand() % 12,
+                                             std::rand() % 3 } ) );
+    }
+
+    TestKDTree emptyTree;
+    ASSERT_EQ( emptyTree.find( sanityPoints[ 0 ] ),
+               Constants::KDTREE_ERROR_INDEX );
+    ASSERT_TRUE( emptyTree.duplicates().empty() );
+
+    TestKDTree sanityTree( sanityPoints );
+    for ( int x = -1; x <= 12; ++x )
+    {
+        for ( int y = -1; y <= 12; ++y )
+        {
+            for ( int z = -1; z <= 3; ++z )
+            {
+                const TestPoint point( { x, y, z } );
+                const size_t index = sanityTree.find( point );
+                if ( std::find( sanityPoints.begin(), sanityPoints.end(),
+                                point ) == sanityPoints.end() )
+                {
+                    ASSERT_EQ( index, Constants::KDTREE_ERROR_INDEX );
+                }
+                else
+                {
+                    ASSERT_LT( index, sanityPoints.size() );
+                    ASSERT_EQ( sanityPoints[ index ], point );
+                }
+            }
+        }
+    }
+    ASSERT_EQ( sanityTree.find( TestPoint( { 1, 1 } ) ),
+               Constants::KDTREE_ERROR_INDEX );
+
+    // Groups of equal points against a quadratic scan
+    std::vector< Types::Indexes > expected;
+    std::vector< char > seen( sanityPoints.size(), 0 );
+    TestPoints unique;
+    for ( size_t i = 0; i < sanityPoints.size(); ++i )
+    {
+        if ( seen[ i ] )
+        {
+            continue;
+        }
+
+        unique.push_back( sanityPoints[ i ] );
+        Types::Indexes group( 1u, i );
+        for ( size_t j = i + 1u; j < sanityPoints.size(); ++j )
+        {
+            if ( sanityPoints[ j ] == sanityPoints[ i ] )
+            {
+                group.push_back( j );
+                seen[ j ] = 1;
+            }
+        }
+
+        if ( group.size() > 1u )
+        {
+            expected.push_back( group );
+        }
+    }
+    ASSERT_FALSE( expected.empty() );
+    ASSERT_EQ( sanityTree.duplicates(), expected );
 
+    // The first of every group stays
+    ASSERT_EQ( sanityTree.collapseDuplicates(),
+               sanityPoints.size() - unique.size() );
+    ASSERT_EQ( sanityTree.points(), unique );
+    ASSERT_TRUE( sanityTree.duplicates().empty() );
+    ASSERT_EQ( sanityTree.collapseDuplicates(), 0u );
+    for ( size_t i = 0; i < unique.size(); ++i )
+    {
+        ASSERT_EQ( sanityTree.find( unique[ i ] ), i );
+    }
+
+    // Moved points are found at their new position only
+    ASSERT_TRUE( sanityTree.update( 0u, TestPoint( { 40, -7, 1 } ) ) );
+    ASSERT_EQ( sanityTree.find( TestPoint( { 40, -7, 1 } ) ), 0u );
+    ASSERT_EQ( sanityTree.find( unique[ 0 ] ),
+               Constants::KDTREE_ERROR_INDEX );
+}
 } // namespace
\ No newline at end of file
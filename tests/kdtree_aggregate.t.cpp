@@ -0,0 +1,36 @@
+#include "gtest/gtest.h"
+
+#include "kdtree_aggregate.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( KDAggregate, TestUninitializedState )
+{
+    KDAggregate aggregate;
+
+    ASSERT_EQ( aggregate.count(), 0u );
+    ASSERT_EQ( aggregate.sum(),   0.0 );
+    ASSERT_EQ( aggregate.mean(),  0.0 );
+    ASSERT_EQ( aggregate, KDAggregate( 0u, 0.0 ) );
+
+    std::cout << aggregate << std::endl;
+}
+
+TEST( KDAggregate, Accumulate )
+{
+    KDAggregate aggregate( 2u, 3.0 );
+    aggregate += KDAggregate( 1u, 6.0 );
+
+    ASSERT_EQ( aggregate.count(), 3u );
+    ASSERT_EQ( aggregate.sum(),   9.0 );
+    ASSERT_EQ( aggregate.mean(),  3.0 );
+    ASSERT_NE( aggregate, KDAggregate( 3u, 8.0 ) );
+}
+
+} // namespace
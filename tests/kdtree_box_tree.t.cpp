@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "gtest/gtest.h"
+
+#include "kdtree_types.h"
+#include "kdtree.h"
+#include "kdtree_box_tree.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+typedef Types::Point< double >       TestPoint;
+typedef Types::Points< double >      TestPoints;
+typedef Types::AxisMinMax< double >  TestBox;
+typedef Types::Boxes< double >       TestBoxes;
+typedef KDTree< double >             TestKDTree;
+typedef KDBoxTree< double >          TestBoxTree;
+
+const std::string testFile = "really_long_and_unique_box_tree_file_name_42.txt";
+
+class TestFileGuard
+{
+public:
+    TestFileGuard( const std::string& testFileName )
+    : m_testFileName( testFileName )
+    {
+        // nothing to do here
+    }
+
+    ~TestFileGuard()
+    {
+        std::remove( m_testFileName.c_str() );
+    }
+
+private:
+    std::string   m_testFileName;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// HELPER FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+double randomValue()
+{
+    return std::rand() / static_cast< double >( RAND_MAX );
+}
+
+TestBoxes randomBoxes( const size_t size,
+                       const size_t dimension,
+                       const unsigned int seed = 42u )
+{
+    std::srand( seed );
+
+    // Mostly small boxes, some large ones and some degenerate into points
+    TestBoxes boxes;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        const double extent = i % 7u ? 0.05 : ( i % 2u ? 0.5 : 0.0 );
+        TestBox box;
+        for ( size_t j = 0; j < dimension; ++j )
+        {
+            const double low = randomValue();
+            box.push_back( std::make_pair( low, low + extent * randomValue() ) );
+        }
+        boxes.push_back( box );
+    }
+
+    return boxes;
+}
+
+TestPoints randomPoints( const size_t size,
+                         const size_t dimension,
+                         const unsigned int seed = 7u )
+{
+    std::srand( seed );
+
+    TestPoints points;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        TestPoint point;
+        for ( size_t j = 0; j < dimension; ++j )
+        {
+            point.push_back( randomValue() * 1.4 - 0.2 );
+        }
+        points.push_back( point );
+    }
+
+    return points;
+}
+
+Types::Indexes bruteForceNearest( const TestBoxes& boxes,
+                                  const TestPoint& query,
+                                  const size_t     k )
+{
+    Types::Neighbours ranked;
+    for ( size_t i = 0; i < boxes.size(); ++i )
+    {
+        ranked.push_back( std::make_pair(
+                Utils::squaredDistanceToBox( query, boxes[ i ] ), i ) );
+    }
+    std::sort( ranked.begin(), ranked.end() );
+
+    Types::Indexes result;
+    for ( size_t i = 0; i < std::min( k, ranked.size() ); ++i )
+    {
+        result.push_back( ranked[ i ].second );
+    }
+
+    return result;
+}
+
+Types::Indexes sorted( Types::Indexes indexes )
+{
+    std::sort( indexes.begin(), indexes.end() );
+    return indexes;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( KDBoxTree, Empty )
+{
+    const TestBoxTree empty;
+    const TestPoint origin( { 0.0, 0.0 } );
+    ASSERT_EQ( empty.size(), 0u );
+    ASSERT_EQ( empty.nearestBoxIndex( origin ), Constants::KDTREE_ERROR_INDEX );
+    ASSERT_TRUE( empty.nearestBoxIndexes( origin, 3u ).empty() );
+    ASSERT_TRUE( empty.nearestBoxes( TestPoints( { origin } ) ).empty() );
+    ASSERT_TRUE( empty.boxIndexesContaining( origin ).empty() );
+    ASSERT_TRUE( empty.boxIndexesOverlapping(
+                         TestBox( { { 0.0, 1.0 }, { 0.0, 1.0 } } ) ).empty() );
+
+    // Mixed dimensions and inverted bounds are rejected
+    const TestBoxTree mixed( TestBoxes( { TestBox( { { 0.0, 1.0 } } ),
+                                          TestBox( { { 0.0, 1.0 },
+                                                     { 0.0, 1.0 } } ) } ) );
+    ASSERT_EQ( mixed.size(), 0u );
+    const TestBoxTree inverted( TestBoxes( { TestBox( { { 1.0, 0.0 } } ) } ) );
+    ASSERT_EQ( inverted.size(), 0u );
+
+    const TestBoxTree single( TestBoxes( { TestBox( { { 0.0, 1.0 },
+                                                      { 2.0, 3.0 } } ) } ) );
+    ASSERT_EQ( single.numNodes(), 1u );
+    ASSERT_EQ( single.nearestBoxIndex( origin ), 0u );
+    ASSERT_EQ( single.boxIndexesContaining( TestPoint( { 0.5, 3.0 } ) ),
+               Types::Indexes( { 0u } ) );
+    ASSERT_TRUE( single.boxIndexesContaining( origin ).empty() );
+    ASSERT_EQ( single.nearestBoxIndex( TestPoint( { 0.0 } ) ),
+               Constants::KDTREE_ERROR_INDEX );
+}
+
+TEST( KDBoxTree, SameAnswersAsBruteForce )
+{
+    for ( const size_t dimension : { 2u, 3u, 5u } )
+    {
+        const TestBoxes  boxes   = randomBoxes( 3000u, dimension );
+        const TestPoints queries = randomPoints( 200u, dimension );
+        const TestBoxTree tree( boxes, 3u );
+
+        ASSERT_EQ( tree.size(), boxes.size() );
+        ASSERT_GT( tree.numNodes(), boxes.size() /
+                                    Constants::KDTREE_BOX_TREE_FANOUT );
+
+        for ( size_t i = 0; i < queries.size(); ++i )
+        {
+            const TestPoint& query = queries[ i ];
+
+            ASSERT_EQ( tree.nearestBoxIndex( query ),
+                       bruteForceNearest( boxes, query, 1u )[ 0 ] );
+            ASSERT_EQ( tree.nearestBoxIndexes( query, 10u ),
+                       bruteForceNearest( boxes, query, 10u ) );
+
+            Types::Indexes containing;
+            Types::Indexes overlapping;
+            TestBox window;
+            for ( size_t j = 0; j < dimension; ++j )
+            {
+                window.push_back( std::make_pair( query[ j ] - 0.03,
+                                                  query[ j ] + 0.03 ) );
+            }
+            for ( size_t j = 0; j < boxes.size(); ++j )
+            {
+                if ( Utils::boxContainsPoint( boxes[ j ], query ) )
+                {
+                    containing.push_back( j );
+                }
+                if ( Utils::boxesIntersect( boxes[ j ], window ) )
+                {
+                    overlapping.push_back( j );
+                }
+            }
+
+            ASSERT_EQ( sorted( tree.boxIndexesContaining( query ) ),
+                       containing );
+            ASSERT_EQ( sorted( tree.boxIndexesOverlapping( window ) ),
+                       overlapping );
+        }
+
+        ASSERT_EQ( tree.nearestBoxIndexes( queries[ 0 ], 5000u ).size(),
+                   boxes.size() );
+        ASSERT_TRUE( tree.nearestBoxIndexes( queries[ 0 ], 0u ).empty() );
+    }
+}
+
+TEST( KDBoxTree, PointBoxesMatchKDTree )
+{
+    // Degenerate boxes behave as their points
+    std::srand( 42u );
+    TestPoints points;
+    TestBoxes  boxes;
+    for ( size_t i = 0; i < 2000u; ++i )
+    {
+        const TestPoint point( { randomValue(), randomValue() } );
+        points.push_back( point );
+        boxes.push_back( TestBox( { { point[ 0 ], point[ 0 ] },
+                                    { point[ 1 ], point[ 1 ] } } ) );
+    }
+
+    const TestKDTree  kdtree( points );
+    const TestBoxTree tree( boxes );
+    const TestPoints  queries = randomPoints( 100u, 2u );
+    for ( size_t i = 0; i < queries.size(); ++i )
+    {
+        ASSERT_EQ( tree.nearestBoxIndex( queries[ i ] ),
+                   kdtree.nearestPointIndex( queries[ i ] ) );
+    }
+    ASSERT_EQ( tree.boxIndexesContaining( points[ 17 ] ),
+               Types::Indexes( { 17u } ) );
+}
+
+TEST( KDBoxTree, BatchNearestBoxes )
+{
+    const TestBoxes   boxes   = randomBoxes( 2000u, 3u );
+    const TestPoints  queries = randomPoints( 500u, 3u );
+    const TestBoxTree tree( boxes );
+
+    const Types::Neighbours single  = tree.nearestBoxes( queries, 1u );
+    const Types::Neighbours several = tree.nearestBoxes( queries, 4u );
+    ASSERT_EQ( single, several );
+    ASSERT_EQ( single.size(), queries.size() );
+
+    for ( size_t i = 0; i < queries.size(); ++i )
+    {
+        ASSERT_EQ( single[ i ].second, tree.nearestBoxIndex( queries[ i ] ) );
+        ASSERT_EQ( single[ i ].first,
+                   Utils::squaredDistanceToBox( queries[ i ],
+                                                boxes[ single[ i ].second ] ) );
+    }
+
+    // Any point of a mismatching cardinality fails the whole batch
+    TestPoints mismatching = queries;
+    mismatching.push_back( TestPoint( { 0.0 } ) );
+    ASSERT_TRUE( tree.nearestBoxes( mismatching ).empty() );
+}
+
+TEST( KDBoxTree, BuildDoesNotDependOnThreads )
+{
+    const TestBoxes   boxes = randomBoxes( 3000u, 3u );
+    const TestBoxTree single( boxes, 1u );
+    const TestBoxTree several( boxes, 4u );
+
+    ASSERT_EQ( single, several );
+    ASSERT_EQ( single.numNodes(), several.numNodes() );
+    ASSERT_EQ( single.boxes(), boxes );
+    ASSERT_EQ( single.box( 11u ), boxes[ 11u ] );
+    ASSERT_EQ( several.nearestBoxIndexes( TestPoint( { 0.5, 0.5, 0.5 } ), 7u ),
+               single.nearestBoxIndexes( TestPoint( { 0.5, 0.5, 0.5 } ), 7u ) );
+}
+
+TEST( KDBoxTree, Serialization )
+{
+    TestFileGuard guard( testFile );
+
+    const TestBoxes   boxes = randomBoxes( 2000u, 3u );
+    const TestBoxTree tree( boxes );
+
+    ASSERT_TRUE( tree.serialize( testFile, 3u ) );
+
+    TestBoxTree loaded;
+    ASSERT_TRUE( loaded.deserialize( testFile, 2u ) );
+    ASSERT_EQ( loaded, tree );
+    ASSERT_EQ( loaded.numNodes(), tree.numNodes() );
+    ASSERT_EQ( loaded.nearestBoxIndexes( TestPoint( { 0.1, 0.2, 0.3 } ), 6u ),
+               tree.nearestBoxIndexes( TestPoint( { 0.1, 0.2, 0.3 } ), 6u ) );
+
+    // A KDTree file is rejected, the loaded tree is kept
+    ASSERT_TRUE( TestKDTree( randomPoints( 10u, 3u ) ).serialize( testFile ) );
+    ASSERT_EQ( loaded.deserialize( testFile ).code(),
+               KDStatus::Code::TYPE_MISMATCH );
+    ASSERT_EQ( loaded, tree );
+
+    {
+        std::ofstream out( testFile.c_str() );
+        out << Constants::KDTREE_BOX_TREE_VARIETY << "\n2\n0,1,2,3\n0,1,2\n";
+    }
+    KDStatus status = loaded.deserialize( testFile );
+    ASSERT_EQ( status.code(), KDStatus::Code::PARSE_ERROR );
+    ASSERT_EQ( status.line(), 4u );
+
+    {
+        std::ofstream out( testFile.c_str() );
+        out << Constants::KDTREE_BOX_TREE_VARIETY << "\n2\n0,1,2,3\n1,0,2,3\n";
+    }
+    status = loaded.deserialize( testFile );
+    ASSERT_EQ( status.code(), KDStatus::Code::PARSE_ERROR );
+    ASSERT_EQ( status.line(), 4u );
+
+    {
+        std::ofstream out( testFile.c_str() );
+        out << Constants::KDTREE_BOX_TREE_VARIETY << "\n2\n0,1,2,3\n0,1\n";
+    }
+    status = loaded.deserialize( testFile );
+    ASSERT_EQ( status.code(), KDStatus::Code::CARDINALITY_MISMATCH );
+    ASSERT_EQ( status.line(), 4u );
+
+    ASSERT_EQ( loaded.deserialize( "no_such_box_tree_file" ).code(),
+               KDStatus::Code::IO_ERROR );
+    ASSERT_EQ( loaded, tree );
+}
+
+} // namespace
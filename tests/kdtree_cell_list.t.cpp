@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "gtest/gtest.h"
+
+#include "kdtree_types.h"
+#include "kdtree.h"
+#include "kdtree_cell_list.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+typedef Types::Point< double >   TestPoint;
+typedef Types::Points< double >  TestPoints;
+typedef KDTree< double >         TestKDTree;
+typedef CellListIndex< double >  TestCellList;
+
+const std::string testFile = "really_long_and_unique_cell_list_file_name_42.csv";
+
+class TestFileGuard
+{
+public:
+    TestFileGuard( const std::string& testFileName )
+    : m_testFileName( testFileName )
+    {
+        // nothing to do here
+    }
+
+    ~TestFileGuard()
+    {
+        std::remove( m_testFileName.c_str() );
+    }
+
+private:
+    std::string   m_testFileName;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// HELPER FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TestPoints randomPoints( const size_t size, const size_t dimension )
+{
+    std::srand( 42 );
+
+    TestPoints points;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        TestPoint point;
+        for ( size_t j = 0; j < dimension; ++j )
+        {
+            point.push_back( std::rand() / static_cast< double >( RAND_MAX ) );
+        }
+        points.push_back( point );
+    }
+
+    return points;
+}
+
+Types::Indexes sorted( Types::Indexes indexes )
+{
+    std::sort( indexes.begin(), indexes.end() );
+    return indexes;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( CellListIndex, Build )
+{
+    TestCellList index;
+
+    ASSERT_TRUE( index.build( TestPoints(), 1.0 ) );
+    ASSERT_EQ( index.size(), 0u );
+    ASSERT_TRUE( index.pointIndexesInRadius( TestPoint( { 0.0 } ),
+                                             1.0 ).empty() );
+
+    TestPoints mixed( { TestPoint( { 0.0, 0.0 } ), TestPoint( { 1.0 } ) } );
+    ASSERT_EQ( index.build( mixed, 1.0 ).code(),
+               KDStatus::Code::CARDINALITY_MISMATCH );
+    ASSERT_EQ( index.size(), 0u );
+
+    const TestPoints points = randomPoints( 100u, 2u );
+    ASSERT_EQ( index.build( points, 0.0 ).code(),
+               KDStatus::Code::SIZE_LIMIT );
+    ASSERT_EQ( index.build( points, -1.0 ).code(),
+               KDStatus::Code::SIZE_LIMIT );
+
+    ASSERT_TRUE( index.build( points, 0.25 ) );
+    ASSERT_EQ( index.size(), 100u );
+    ASSERT_EQ( index.dimension(), 2u );
+    ASSERT_FALSE( index.hashed() );
+    ASSERT_EQ( index.numBuckets(), 16u );
+
+    // Far more cells than points are hashed
+    ASSERT_TRUE( index.build( points, 0.001 ) );
+    ASSERT_TRUE( index.hashed() );
+    ASSERT_EQ( index.numBuckets(), 128u );
+}
+
+TEST( CellListIndex, PointIndexesInRadius )
+{
+    const TestPoints points  = randomPoints( 3000u, 3u );
+    const TestPoints queries = randomPoints( 200u, 3u );
+    const TestKDTree tree( points );
+
+    // Dense and hashed cells, radii below, at and above the cell size
+    const double cellSizes[] = { 0.1, 0.004 };
+    const double radii[]     = { 0.0, 0.03, 0.1, 0.35 };
+
+    for ( const double cellSize : cellSizes )
+    {
+        TestCellList index;
+        ASSERT_TRUE( index.build( points, cellSize, 3u ) );
+
+        for ( const double radius : radii )
+        {
+            for ( size_t i = 0; i < queries.size(); ++i )
+            {
+                // Shifted queries reach outside of the bounding box
+                TestPoint query = queries[ i ];
+                query[ i % 3u ] = query[ i % 3u ] * 1.4 - 0.2;
+
+                ASSERT_EQ( sorted( index.pointIndexesInRadius( query,
+                                                               radius ) ),
+                           sorted( tree.pointIndexesInRadius( query,
+                                                              radius ) ) );
+            }
+
+            // Points at exactly radius are found
+            ASSERT_EQ( sorted( index.pointIndexesInRadius( points[ 7 ],
+                                                           radius ) ),
+                       sorted( tree.pointIndexesInRadius( points[ 7 ],
+                                                          radius ) ) );
+        }
+
+        ASSERT_TRUE( index.pointIndexesInRadius( queries[ 0 ], -1.0 ).empty() );
+        ASSERT_TRUE( index.pointIndexesInRadius( TestPoint( { 0.5 } ),
+                                                 1.0 ).empty() );
+    }
+}
+
+TEST( CellListIndex, IntegerPoints )
+{
+    Types::Points< int > points;
+    for ( int x = 0; x < 20; ++x )
+    {
+        for ( int y = 0; y < 20; ++y )
+        {
+            points.push_back( Types::Point< int >( { x, y } ) );
+        }
+    }
+
+    CellListIndex< int > index;
+    ASSERT_TRUE( index.build( points, 2.0 ) );
+
+    // The 13 lattice points within 2 of an inner point
+    ASSERT_EQ( index.pointIndexesInRadius(
+                       Types::Point< int >( { 10, 10 } ), 2.0 ).size(),
+               13u );
+    ASSERT_EQ( index.pointIndexesInRadius(
+                       Types::Point< int >( { 0, 0 } ), 1.0 ).size(),
+               3u );
+}
+
+TEST( CellListIndex, NeighbourLists )
+{
+    const TestPoints points = randomPoints( 1500u, 3u );
+    const double     radius = 0.08;
+
+    TestCellList index;
+    ASSERT_TRUE( index.build( points, radius ) );
+
+    const KDKnnGraph graph = index.neighbourLists( radius, 1u );
+    ASSERT_EQ( graph.numVertices(), points.size() );
+
+    size_t numEdges = 0;
+    for ( size_t i = 0; i < points.size(); ++i )
+    {
+        Types::Indexes expected;
+        for ( size_t j = 0; j < points.size(); ++j )
+        {
+            if ( i != j && Utils::distance( points[ i ], points[ j ] ) <= radius )
+            {
+                expected.push_back( j );
+            }
+        }
+
+        ASSERT_EQ( graph.degree( i ), expected.size() );
+        numEdges += expected.size();
+
+        Types::Indexes found( graph.neighbours( i ),
+                              graph.neighbours( i ) + graph.degree( i ) );
+        ASSERT_EQ( sorted( found ), expected );
+
+        for ( size_t k = 1; k < graph.degree( i ); ++k )
+        {
+            ASSERT_LE( graph.distances( i )[ k - 1u ],
+                       graph.distances( i )[ k ] );
+        }
+        for ( size_t k = 0; k < graph.degree( i ); ++k )
+        {
+            ASSERT_FLOAT_EQ( graph.distances( i )[ k ],
+                             Utils::distance( points[ i ],
+                                              points[ found[ k ] ] ) );
+        }
+    }
+    ASSERT_EQ( graph.numEdges(), numEdges );
+
+    // Lists do not depend on the number of threads nor on hashing
+    ASSERT_EQ( index.neighbourLists( radius, 4u ), graph );
+
+    ASSERT_TRUE( index.build( points, radius / 20.0 ) );
+    ASSERT_TRUE( index.hashed() );
+    ASSERT_EQ( index.neighbourLists( radius, 3u ), graph );
+
+    ASSERT_EQ( index.neighbourLists( -1.0 ).numVertices(), 0u );
+}
+
+TEST( CellListIndex, FromCsv )
+{
+    TestFileGuard guard( testFile );
+
+    {
+        std::ofstream csv( testFile.c_str() );
+        csv << "0,0,0\n0.5,0,0\n3,3,3\n3,3.2,3\n";
+    }
+
+    TestPoints points;
+    ASSERT_TRUE( Loader::readCsv( testFile, points ) );
+
+    TestCellList index;
+    ASSERT_TRUE( index.build( points, 1.0 ) );
+
+    const KDKnnGraph graph = index.neighbourLists( 1.0 );
+    ASSERT_EQ( graph.numEdges(), 4u );
+    ASSERT_EQ( graph.neighbours( 0 )[ 0 ], 1u );
+    ASSERT_EQ( graph.neighbours( 3 )[ 0 ], 2u );
+}
+
+TEST( CellListIndex, GridRecommended )
+{
+    const TestPoints points = randomPoints( 10000u, 3u );
+
+    // About one point per cell and a few hundred per cell
+    ASSERT_TRUE( TestCellList::gridRecommended( points, 0.05 ) );
+    ASSERT_TRUE( TestCellList::gridRecommended( points, 0.3 ) );
+
+    // Probing the 3^D sparse cells beats the depth of the tree in 2-D,
+    // not yet in 3-D at this size nor in 6-D
+    ASSERT_TRUE( TestCellList::gridRecommended( randomPoints( 10000u, 2u ),
+                                                0.001 ) );
+    ASSERT_FALSE( TestCellList::gridRecommended( points, 0.001 ) );
+    ASSERT_FALSE( TestCellList::gridRecommended( randomPoints( 10000u, 6u ),
+                                                 0.01 ) );
+    ASSERT_TRUE( TestCellList::gridRecommended( randomPoints( 10000u, 6u ),
+                                                0.5 ) );
+
+    ASSERT_FALSE( TestCellList::gridRecommended( randomPoints( 10000u, 7u ),
+                                                 0.5 ) );
+    ASSERT_FALSE( TestCellList::gridRecommended( points, 0.0 ) );
+    ASSERT_FALSE( TestCellList::gridRecommended( TestPoints(), 1.0 ) );
+}
+
+} // namespace
@@ -0,0 +1,177 @@
+#include <cstdlib>
+
+#include "gtest/gtest.h"
+
+#include "kdtree_types.h"
+#include "kdtree.h"
+#include "kdtree_clustering.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+typedef Types::Point< double >   TestPoint;
+typedef Types::Points< double >  TestPoints;
+typedef KDTree< double >         TestKDTree;
+
+//////////////////////////////////////////////////////////////////////////////
+// HELPER FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TestPoint makePoint( const double x, const double y )
+{
+    TestPoint p;
+    p.push_back( x );
+    p.push_back( y );
+    return p;
+}
+
+TestPoints twoLinesAndNoise()
+{
+    TestPoints points;
+
+    // Cluster 0 : five points one unit apart
+    for ( int x = 0; x < 5; ++x )
+    {
+        points.push_back( makePoint( x, 0.0 ) );
+    }
+
+    // Noise
+    points.push_back( makePoint( 50.0, 50.0 ) );
+
+    // Cluster 1 : four points one unit apart
+    for ( int x = 100; x < 104; ++x )
+    {
+        points.push_back( makePoint( x, 0.5 ) );
+    }
+
+    return points;
+}
+
+TestPoints randomPoints( const size_t size )
+{
+    std::srand( 42 );
+
+    TestPoints points;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        points.push_back( makePoint( std::rand() % 1000 / 10.0,
+                                     std::rand() % 1000 / 10.0 ) );
+    }
+
+    return points;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( Clustering, DbscanOnEmptyTree )
+{
+    TestKDTree tree;
+
+    ASSERT_TRUE( Clustering::dbscan( tree, 1.0, 2u ).empty() );
+}
+
+TEST( Clustering, DbscanCoreBorderAndNoise )
+{
+    TestKDTree tree( twoLinesAndNoise() );
+
+    const Types::Indexes labels = Clustering::dbscan( tree, 1.0, 3u, 2u );
+
+    ASSERT_EQ( labels.size(), 10u );
+
+    for ( size_t i = 0; i < 5u; ++i )
+    {
+        ASSERT_EQ( labels[ i ], 0u );
+    }
+
+    ASSERT_EQ( labels[ 5u ], Constants::KDTREE_NOISE_LABEL );
+
+    for ( size_t i = 6u; i < 10u; ++i )
+    {
+        ASSERT_EQ( labels[ i ], 1u );
+    }
+}
+
+TEST( Clustering, DbscanAllNoise )
+{
+    TestKDTree tree( twoLinesAndNoise() );
+
+    const Types::Indexes labels = Clustering::dbscan( tree, 0.5, 2u );
+
+    for ( size_t i = 0; i < labels.size(); ++i )
+    {
+        ASSERT_EQ( labels[ i ], Constants::KDTREE_NOISE_LABEL );
+    }
+}
+
+TEST( Clustering, DbscanIndependentOfThreadCount )
+{
+    TestKDTree tree( randomPoints( 2000u ) );
+
+    const Types::Indexes sequential = Clustering::dbscan( tree, 2.0, 4u, 1u );
+
+    for ( size_t numThreads = 2u; numThreads < 6u; ++numThreads )
+    {
+        ASSERT_EQ( sequential,
+                   Clustering::dbscan( tree, 2.0, 4u, numThreads ) );
+    }
+}
+
+TEST( Clustering, EuclideanClusters )
+{
+    TestKDTree tree( twoLinesAndNoise() );
+
+    const Types::Clusters clusters =
+            Clustering::euclideanClusters( tree, 1.0, 2u, 100u, 3u );
+
+    ASSERT_EQ( clusters.size(), 2u );
+
+    Types::Indexes expected0;
+    for ( size_t i = 0; i < 5u; ++i )
+    {
+        expected0.push_back( i );
+    }
+
+    Types::Indexes expected1;
+    for ( size_t i = 6u; i < 10u; ++i )
+    {
+        expected1.push_back( i );
+    }
+
+    ASSERT_EQ( clusters[ 0 ], expected0 );
+    ASSERT_EQ( clusters[ 1 ], expected1 );
+
+    // Size limits drop clusters
+    const Types::Clusters small =
+            Clustering::euclideanClusters( tree, 1.0, 1u, 4u );
+
+    ASSERT_EQ( small.size(), 2u );
+    ASSERT_EQ( small[ 0 ], expected1 );
+    ASSERT_EQ( small[ 1 ], Types::Indexes( 1u, 5u ) );
+}
+
+TEST( Clustering, EuclideanClustersIndependentOfThreadCount )
+{
+    TestKDTree tree( randomPoints( 2000u ) );
+
+    const Types::Clusters sequential =
+            Clustering::euclideanClusters( tree, 1.5, 1u, 2000u, 1u );
+
+    size_t total = 0;
+    for ( size_t i = 0; i < sequential.size(); ++i )
+    {
+        total += sequential[ i ].size();
+    }
+    ASSERT_EQ( total, 2000u );
+
+    ASSERT_EQ( sequential,
+               Clustering::euclideanClusters( tree, 1.5, 1u, 2000u, 4u ) );
+}
+
+} // namespace
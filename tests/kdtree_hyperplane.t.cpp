@@ -141,7 +141,21 @@ TEST( KDHyperplane, TestDeserializedFail5 )
     const std::string emptySerialized = "1 not a double";
 
     TestHyperplane dummyHyperplane;
-    ASSERT_FALSE( dummyHyperplane.deserialize( emptySerialized ) );
+    ASSERT_EQ( dummyHyperplane.deserialize( emptySerialized ).code(),
+               KDStatus::Code::PARSE_ERROR );
+    ASSERT_EQ( dummyHyperplane, TestHyperplane() );
+}
+
+TEST( KDHyperplane, TestDeserializedFail6 )
+{
+    const std::string emptySerialized = "0 1.5garbage";
+
+    TestHyperplane dummyHyperplane;
+    ASSERT_EQ( dummyHyperplane.deserialize( emptySerialized ).code(),
+               KDStatus::Code::PARSE_ERROR );
+    ASSERT_EQ( dummyHyperplane, TestHyperplane() );
+    ASSERT_FALSE( dummyHyperplane.deserialize( "0 1.5 2" ) );
+    ASSERT_TRUE( dummyHyperplane.deserialize( "0 1.5 \r" ) );
 }
 
 TEST( KDHyperplane, TestDeserialized )
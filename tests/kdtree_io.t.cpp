@@ -0,0 +1,269 @@
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined( __linux__ ) && defined( __x86_64__ )
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "gtest/gtest.h"
+
+#include "kdtree_io.h"
+#include "kdtree_loader.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+const std::string testFile = "really_long_and_unique_async_io_file_name_42.bin";
+
+class TestFileGuard
+{
+public:
+    TestFileGuard( const std::string& testFileName )
+    : m_testFileName( testFileName )
+    {
+    }
+
+    ~TestFileGuard()
+    {
+        std::remove( m_testFileName.c_str() );
+    }
+
+private:
+    std::string   m_testFileName;
+};
+
+void writeFile( const std::string& contents )
+{
+    std::ofstream file( testFile.c_str(),
+                        std::ofstream::binary | std::ofstream::trunc );
+    file << contents;
+}
+
+std::vector< AsyncIO::Options > allOptions()
+{
+    std::vector< AsyncIO::Options > result;
+
+    std::vector< AsyncIO::Backend > backends( 1u, AsyncIO::Backend::THREADS );
+    if ( AsyncIO::ioUringAvailable() )
+    {
+        backends.push_back( AsyncIO::Backend::IO_URING );
+    }
+
+    for ( size_t i = 0; i < backends.size(); ++i )
+    {
+        for ( size_t queueDepth = 1u; queueDepth <= 3u; queueDepth += 2u )
+        {
+            for ( int direct = 0; direct < 2; ++direct )
+            {
+                AsyncIO::Options options;
+                options.blockSize  = 4096u;
+                options.queueDepth = queueDepth;
+                options.direct     = direct;
+                options.backend    = backends[ i ];
+                result.push_back( options );
+            }
+        }
+    }
+
+    return result;
+}
+
+#if defined( __linux__ ) && defined( __x86_64__ )
+// Makes every io_uring_enter() of the calling thread that submits entries
+// fail with EAGAIN, as it does when the kernel is out of memory. Returns
+// false if the filter could not be installed.
+bool failIoUringSubmissions()
+{
+    struct sock_filter filter[] = {
+        BPF_STMT( BPF_LD | BPF_W | BPF_ABS,
+                  offsetof( struct seccomp_data, arch ) ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 1, 0 ),
+        BPF_STMT( BPF_RET | BPF_K, SECCOMP_RET_ALLOW ),
+        BPF_STMT( BPF_LD | BPF_W | BPF_ABS,
+                  offsetof( struct seccomp_data, nr ) ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, __NR_io_uring_enter, 1, 0 ),
+        BPF_STMT( BPF_RET | BPF_K, SECCOMP_RET_ALLOW ),
+        // Low half of to_submit
+        BPF_STMT( BPF_LD | BPF_W | BPF_ABS,
+                  offsetof( struct seccomp_data, args[ 1 ] ) ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 1 ),
+        BPF_STMT( BPF_RET | BPF_K, SECCOMP_RET_ALLOW ),
+        BPF_STMT( BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EAGAIN ),
+    };
+    struct sock_fprog program = {
+        static_cast< unsigned short >( sizeof( filter ) /
+                                       sizeof( filter[ 0 ] ) ),
+        filter
+    };
+
+    return 0 == prctl( PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0 ) &&
+           0 == prctl( PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program );
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( AsyncIO, ReadBlocksInOrder )
+{
+    TestFileGuard guard( testFile );
+
+    std::mt19937 generator( 11u );
+    std::string expected( 5u * 4096u + 123u, '\0' );
+    for ( size_t i = 0; i < expected.size(); ++i )
+    {
+        expected[ i ] = static_cast< char >( generator() );
+    }
+    writeFile( expected );
+
+    const std::vector< AsyncIO::Options > options = allOptions();
+    for ( size_t i = 0; i < options.size(); ++i )
+    {
+        std::vector< size_t > sizes;
+        std::string contents;
+        ASSERT_TRUE( AsyncIO::readBlocks( testFile,
+            [ & ]( const char* data, const size_t size )
+            {
+                sizes.push_back( size );
+                contents.append( data, size );
+                return KDStatus();
+            },
+            options[ i ] ) );
+
+        ASSERT_EQ( contents, expected );
+        ASSERT_EQ( sizes, std::vector< size_t >( { 4096u, 4096u, 4096u,
+                                                   4096u, 4096u, 123u } ) );
+
+        contents.clear();
+        ASSERT_TRUE( AsyncIO::readFile( testFile, contents, options[ i ] ) );
+        ASSERT_EQ( contents, expected );
+    }
+
+    // Empty files have no blocks
+    writeFile( "" );
+    std::string contents( "stale" );
+    ASSERT_TRUE( AsyncIO::readFile( testFile, contents ) );
+    ASSERT_TRUE( contents.empty() );
+}
+
+TEST( AsyncIO, ReadBlocksFailures )
+{
+    TestFileGuard guard( testFile );
+
+    std::string contents;
+    ASSERT_EQ( AsyncIO::readFile( "non_existent_async_io_file.bin",
+                                  contents ).code(),
+               KDStatus::Code::IO_ERROR );
+
+    writeFile( std::string( 10u * 4096u, 'x' ) );
+
+    // The first failure of the consumer stops the read
+    const std::vector< AsyncIO::Options > options = allOptions();
+    for ( size_t i = 0; i < options.size(); ++i )
+    {
+        size_t calls = 0u;
+        const KDStatus status = AsyncIO::readBlocks( testFile,
+            [ & ]( const char*, const size_t )
+            {
+                return ++calls < 3u ? KDStatus() :
+                       KDStatus( KDStatus::Code::PARSE_ERROR, "stop", 7u );
+            },
+            options[ i ] );
+
+        ASSERT_EQ( status, KDStatus( KDStatus::Code::PARSE_ERROR, "", 7u ) );
+        ASSERT_EQ( calls, 3u );
+    }
+}
+
+TEST( AsyncIO, FailedSubmission )
+{
+#if defined( __linux__ ) && defined( __x86_64__ )
+    if ( !AsyncIO::ioUringAvailable() )
+    {
+        return;
+    }
+
+    TestFileGuard guard( testFile );
+    writeFile( std::string( 10u * 4096u, 'x' ) );
+
+    AsyncIO::Options options;
+    options.blockSize  = 4096u;
+    options.queueDepth = 3u;
+    options.backend    = AsyncIO::Backend::IO_URING;
+
+    // Submissions start failing while other reads are in flight. The
+    // filter cannot be lifted, so the read runs in a child process.
+    ASSERT_EXIT(
+        {
+            size_t calls = 0u;
+            const KDStatus status = AsyncIO::readBlocks( testFile,
+                [ & ]( const char*, const size_t )
+                {
+                    if ( 1u == ++calls && !failIoUringSubmissions() )
+                    {
+                        std::_Exit( 2 );
+                    }
+                    return KDStatus();
+                },
+                options );
+
+            std::_Exit( KDStatus::Code::IO_ERROR == status.code() &&
+                        1u == calls ? 0 : 1 );
+        },
+        ::testing::ExitedWithCode( 0 ), "" );
+#endif
+}
+
+TEST( AsyncIO, ReadCsvAcrossBlocks )
+{
+    TestFileGuard guard( testFile );
+
+    Types::Points< double > expected;
+    std::string contents;
+    for ( size_t i = 0; i < 2000u; ++i )
+    {
+        expected.push_back( Types::Point< double >(
+                { i * 0.5, -1.0 * i, i + 0.25 } ) );
+        contents += std::to_string( i * 0.5 ) + "," +
+                    std::to_string( -1.0 * i ) + "," +
+                    std::to_string( i + 0.25 ) + ( i % 2 ? "\r\n" : "\n" );
+    }
+    writeFile( contents + "\n1,2" );
+
+    // Lines spanning block boundaries keep their line numbers
+    const std::vector< AsyncIO::Options > options = allOptions();
+    for ( size_t i = 0; i < options.size(); ++i )
+    {
+        Types::Points< double > points;
+        const KDStatus status = Loader::readCsv( testFile, points,
+                                                 options[ i ] );
+        ASSERT_EQ( status.code(), KDStatus::Code::CARDINALITY_MISMATCH );
+        ASSERT_EQ( status.line(), 2002u );
+    }
+
+    writeFile( contents );
+    for ( size_t i = 0; i < options.size(); ++i )
+    {
+        Types::Points< double > points;
+        ASSERT_TRUE( Loader::readCsv( testFile, points, options[ i ] ) );
+        ASSERT_EQ( points, expected );
+    }
+}
+
+} // namespace
@@ -0,0 +1,231 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "gtest/gtest.h"
+
+#include "kdtree_types.h"
+#include "kdtree.h"
+#include "kdtree_knn_graph.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+typedef Types::Point< double >   TestPoint;
+typedef Types::Points< double >  TestPoints;
+typedef KDTree< double >         TestKDTree;
+
+const std::string testFile = "really_long_and_unique_knn_graph_file_name_42.bin";
+
+class TestFileGuard
+{
+public:
+    TestFileGuard( const std::string& testFileName )
+    : m_testFileName( testFileName )
+    {
+        // nothing to do here
+    }
+
+    ~TestFileGuard()
+    {
+        std::remove( m_testFileName.c_str() );
+    }
+
+private:
+    std::string   m_testFileName;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// HELPER FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TestPoints randomPoints( const size_t size, const size_t dimension )
+{
+    std::srand( 42 );
+
+    TestPoints points;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        TestPoint point;
+        for ( size_t j = 0; j < dimension; ++j )
+        {
+            point.push_back( std::rand() / static_cast< double >( RAND_MAX ) );
+        }
+        points.push_back( point );
+    }
+
+    return points;
+}
+
+Types::Neighbours bruteForceNeighbours( const TestPoints& points,
+                                        const size_t      index )
+{
+    Types::Neighbours neighbours;
+    for ( size_t i = 0; i < points.size(); ++i )
+    {
+        if ( i != index )
+        {
+            neighbours.push_back( Types::Neighbour(
+                    Utils::squaredDistance< double >( points[ i ],
+                                                      points[ index ] ),
+                    i ) );
+        }
+    }
+    std::sort( neighbours.begin(), neighbours.end() );
+
+    return neighbours;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( KDKnnGraph, TestUninitializedState )
+{
+    KDKnnGraph graph;
+
+    ASSERT_EQ( graph.numVertices(), 0u );
+    ASSERT_EQ( graph.numEdges(),    0u );
+    ASSERT_TRUE( graph == KDKnnGraph() );
+
+    std::cout << graph << std::endl;
+}
+
+TEST( KDKnnGraph, GraphOnTinyTrees )
+{
+    TestKDTree emptyTree;
+    ASSERT_EQ( emptyTree.buildKnnGraph( 3u ).numVertices(), 0u );
+
+    TestKDTree singleTree( randomPoints( 1u, 2u ) );
+    const KDKnnGraph single = singleTree.buildKnnGraph( 3u );
+    ASSERT_EQ( single.numVertices(), 1u );
+    ASSERT_EQ( single.numEdges(),    0u );
+
+    // k larger than the tree clamps to all the other points
+    TestKDTree smallTree( randomPoints( 4u, 2u ) );
+    const KDKnnGraph small = smallTree.buildKnnGraph( 10u );
+    ASSERT_EQ( small.numVertices(), 4u );
+    ASSERT_EQ( small.numEdges(),    12u );
+    ASSERT_EQ( small.degree( 2u ),  3u );
+}
+
+TEST( KDKnnGraph, ExactGraphMatchesBruteForce )
+{
+    const TestPoints points = randomPoints( 1500u, 3u );
+    TestKDTree tree( points );
+
+    const size_t k = 7u;
+    const KDKnnGraph graph = tree.buildKnnGraph( k, 0.0, 3u );
+
+    ASSERT_EQ( graph.numVertices(), points.size() );
+    ASSERT_EQ( graph.numEdges(),    points.size() * k );
+
+    for ( size_t v = 0; v < points.size(); ++v )
+    {
+        const Types::Neighbours expected = bruteForceNeighbours( points, v );
+
+        ASSERT_EQ( graph.degree( v ), k );
+        for ( size_t i = 0; i < k; ++i )
+        {
+            ASSERT_EQ( graph.neighbours( v )[ i ], expected[ i ].second );
+            ASSERT_FLOAT_EQ( graph.distances( v )[ i ],
+                             std::sqrt( expected[ i ].first ) );
+        }
+    }
+
+    // Thread count does not change the result
+    ASSERT_EQ( graph, tree.buildKnnGraph( k, 0.0, 1u ) );
+}
+
+TEST( KDKnnGraph, ApproximateGraphWithinTolerance )
+{
+    const TestPoints points = randomPoints( 1000u, 4u );
+    TestKDTree tree( points );
+
+    const size_t k       = 5u;
+    const double epsilon = 0.5;
+    const KDKnnGraph graph = tree.buildKnnGraph( k, epsilon, 2u );
+
+    for ( size_t v = 0; v < points.size(); ++v )
+    {
+        const Types::Neighbours expected = bruteForceNeighbours( points, v );
+
+        ASSERT_EQ( graph.degree( v ), k );
+        for ( size_t i = 0; i < k; ++i )
+        {
+            ASSERT_NE( graph.neighbours( v )[ i ], v );
+            ASSERT_LE( graph.distances( v )[ i ],
+                       ( 1.0 + epsilon ) * std::sqrt( expected[ i ].first ) +
+                       1e-6 );
+        }
+    }
+}
+
+TEST( KDKnnGraph, SerializeRoundTrip )
+{
+    TestFileGuard guard( testFile );
+
+    TestKDTree tree( randomPoints( 500u, 2u ) );
+    const KDKnnGraph graph = tree.buildKnnGraph( 4u );
+
+    ASSERT_TRUE( graph.serialize( testFile ) );
+
+    KDKnnGraph deserialized;
+    ASSERT_TRUE( deserialized.deserialize( testFile ) );
+    ASSERT_EQ( graph, deserialized );
+
+    ASSERT_FALSE( deserialized.deserialize( "non_existent_knn_graph.bin" ) );
+}
+
+TEST( KDKnnGraph, DeserializeRejectsCorruptFiles )
+{
+    TestFileGuard guard( testFile );
+
+    TestKDTree tree( randomPoints( 50u, 2u ) );
+    const KDKnnGraph graph = tree.buildKnnGraph( 3u );
+
+    const std::streamoff header = Constants::KDTREE_KNN_GRAPH_MAGIC.size();
+    const std::streamoff offsets = header + 2u * sizeof( uint64_t );
+    const std::streamoff neighbours =
+            offsets + ( graph.numVertices() + 1u ) * sizeof( uint64_t );
+
+    // Every corruption overwrites one 64 or 32 bit value of a good file
+    struct Corruption {
+        std::streamoff position;
+        uint64_t       value;
+        size_t         size;
+    };
+    const Corruption corruptions[] = {
+        { header,                         uint64_t( 1u ) << 60u, 8u },
+        { header + 8,                     uint64_t( 1u ) << 60u, 8u },
+        { header,                         0u,                    8u },
+        { offsets,                        1u,                    8u },
+        { offsets + 2 * 8,                0u,                    8u },
+        { neighbours + 5 * 4,             graph.numVertices(),   4u },
+    };
+
+    KDKnnGraph deserialized;
+    for ( const Corruption& corruption : corruptions )
+    {
+        ASSERT_TRUE( graph.serialize( testFile ) );
+        {
+            std::fstream file( testFile.c_str(), std::fstream::in |
+                                                 std::fstream::out |
+                                                 std::fstream::binary );
+            file.seekp( corruption.position );
+            file.write( reinterpret_cast< const char* >( &corruption.value ),
+                        corruption.size );
+        }
+
+        const KDStatus status = deserialized.deserialize( testFile );
+        ASSERT_EQ( status.code(), KDStatus::Code::PARSE_ERROR );
+        ASSERT_EQ( deserialized.numVertices(), 0u );
+    }
+}
+
+} // namespace
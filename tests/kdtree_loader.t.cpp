@@ -0,0 +1,169 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+#include "gtest/gtest.h"
+
+#include "kdtree_loader.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+const std::string testFile = "really_long_and_unique_loader_file_name_42.csv";
+
+class TestFileGuard
+{
+public:
+    TestFileGuard( const std::string& testFileName )
+    : m_testFileName( testFileName )
+    {
+        // nothing to do here
+    }
+
+    ~TestFileGuard()
+    {
+        std::remove( m_testFileName.c_str() );
+    }
+
+private:
+    std::string   m_testFileName;
+};
+
+void writeFile( const std::string& contents )
+{
+    std::ofstream file( testFile.c_str(), std::ofstream::trunc );
+    file << contents;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( Loader, ParseIndex )
+{
+    const std::string text = " 42 7 9";
+    const char* cursor = text.c_str();
+    const char* end    = cursor + text.size() - 2u;
+    size_t value = 0u;
+
+    ASSERT_TRUE( Loader::parseIndex( cursor, end, value ) );
+    ASSERT_EQ( value, 42u );
+    ASSERT_TRUE( Loader::parseIndex( cursor, end, value ) );
+    ASSERT_EQ( value, 7u );
+    ASSERT_EQ( cursor, end );
+    ASSERT_FALSE( Loader::parseIndex( cursor, end, value ) );
+    ASSERT_EQ( value, 7u );
+
+    const std::string negative = "-1";
+    cursor = negative.c_str();
+    ASSERT_FALSE( Loader::parseIndex( cursor,
+                                      cursor + negative.size(),
+                                      value ) );
+    ASSERT_EQ( cursor, negative.c_str() );
+
+    ASSERT_TRUE( Loader::parseIndex( std::string( "13\r" ), value ) );
+    ASSERT_EQ( value, 13u );
+    ASSERT_FALSE( Loader::parseIndex( std::string( "13 x" ), value ) );
+    ASSERT_FALSE( Loader::parseIndex( std::string( "" ), value ) );
+    ASSERT_FALSE( Loader::parseIndex(
+            std::string( "99999999999999999999999" ), value ) );
+    ASSERT_EQ( value, 13u );
+}
+
+TEST( Loader, ParseReal )
+{
+    const std::string text = "1.5 +2e3 -4.9e-324 1e-400 -0.0001e-400 1e400";
+    const char* cursor = text.c_str();
+    const char* end    = cursor + text.size();
+    double value = 0.0;
+
+    ASSERT_TRUE( Loader::parseReal( cursor, end, value ) );
+    ASSERT_EQ( value, 1.5 );
+    ASSERT_TRUE( Loader::parseReal( cursor, end, value ) );
+    ASSERT_EQ( value, 2000.0 );
+    ASSERT_TRUE( Loader::parseReal( cursor, end, value ) );
+    ASSERT_EQ( value, -std::numeric_limits< double >::denorm_min() );
+
+    // Underflow flushes to zero, overflow is rejected
+    ASSERT_TRUE( Loader::parseReal( cursor, end, value ) );
+    ASSERT_EQ( value, 0.0 );
+    ASSERT_FALSE( std::signbit( value ) );
+    ASSERT_TRUE( Loader::parseReal( cursor, end, value ) );
+    ASSERT_EQ( value, 0.0 );
+    ASSERT_TRUE( std::signbit( value ) );
+    ASSERT_FALSE( Loader::parseReal( cursor, end, value ) );
+    ASSERT_TRUE( std::signbit( value ) );
+
+    // Floats are parsed directly rather than rounded through a double
+    const std::string halfway = "1.00000005960464477539062500000001";
+    cursor = halfway.c_str();
+    float single = 0.0f;
+    ASSERT_TRUE( Loader::parseReal( cursor,
+                                    cursor + halfway.size(),
+                                    single ) );
+    ASSERT_EQ( single, std::nextafter( 1.0f, 2.0f ) );
+
+    const std::string tiny = "1e-50 1000000000000000000000000000000000000000";
+    cursor = tiny.c_str();
+    end    = cursor + tiny.size();
+    ASSERT_TRUE( Loader::parseReal( cursor, end, single ) );
+    ASSERT_EQ( single, 0.0f );
+    ASSERT_FALSE( Loader::parseReal( cursor, end, single ) );
+    ASSERT_EQ( single, 0.0f );
+}
+
+TEST( Loader, ParsePoint )
+{
+    Types::Point< double > point;
+
+    ASSERT_TRUE( Loader::parsePoint( std::string( "1, 2.5,-3\r" ), point ) );
+    ASSERT_EQ( point.size(), 3u );
+    ASSERT_EQ( point[ 1 ], 2.5 );
+
+    const KDStatus malformed =
+            Loader::parsePoint( std::string( "1,,3" ), point, 4u );
+    ASSERT_EQ( malformed.code(), KDStatus::Code::PARSE_ERROR );
+    ASSERT_EQ( malformed.line(), 4u );
+
+    ASSERT_FALSE( Loader::parsePoint( std::string( "1,2 3" ), point ) );
+    ASSERT_FALSE( Loader::parsePoint( std::string( "" ), point ) );
+
+    Types::Point< int > truncated;
+    ASSERT_TRUE( Loader::parsePoint( std::string( "1.7,2" ), truncated ) );
+    ASSERT_EQ( truncated, Types::Point< int >( { 1, 2 } ) );
+}
+
+TEST( Loader, ReadCsv )
+{
+    TestFileGuard guard( testFile );
+    Types::Points< double > points;
+
+    ASSERT_EQ( Loader::readCsv( "non_existent_loader_file.csv",
+                                points ).code(),
+               KDStatus::Code::IO_ERROR );
+
+    writeFile( "1,2\n\n3,4\r\n" );
+    ASSERT_TRUE( Loader::readCsv( testFile, points ) );
+    ASSERT_EQ( points.size(), 2u );
+    ASSERT_EQ( points[ 1 ], Types::Point< double >( { 3.0, 4.0 } ) );
+
+    // Points are kept on failure
+    writeFile( "1,2\n3,4\n5\n" );
+    const KDStatus mismatch = Loader::readCsv( testFile, points );
+    ASSERT_EQ( mismatch.code(), KDStatus::Code::CARDINALITY_MISMATCH );
+    ASSERT_EQ( mismatch.line(), 3u );
+    ASSERT_EQ( points.size(), 2u );
+
+    writeFile( "1,2\nx,4\n" );
+    const KDStatus malformed = Loader::readCsv( testFile, points );
+    ASSERT_EQ( malformed.code(), KDStatus::Code::PARSE_ERROR );
+    ASSERT_EQ( malformed.line(), 2u );
+}
+
+} // namespace
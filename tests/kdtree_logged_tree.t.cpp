@@ -0,0 +1,426 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "gtest/gtest.h"
+
+#include "kdtree_logged_tree.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+const std::string testFile = "really_long_and_unique_logged_tree_file_name_42.tree";
+const std::string logFile  = testFile + Constants::KDTREE_LOG_SUFFIX;
+
+class TestFileGuard
+{
+public:
+    TestFileGuard( const std::string& testFileName )
+    : m_testFileName( testFileName )
+    {
+        removeAll();
+    }
+
+    ~TestFileGuard()
+    {
+        removeAll();
+    }
+
+private:
+    void removeAll()
+    {
+        const std::string log = m_testFileName + Constants::KDTREE_LOG_SUFFIX;
+        std::remove( m_testFileName.c_str() );
+        std::remove( log.c_str() );
+        std::remove( ( m_testFileName +
+                       Constants::KDTREE_COMPACTION_SUFFIX ).c_str() );
+        std::remove( ( log + Constants::KDTREE_COMPACTION_SUFFIX ).c_str() );
+    }
+
+    std::string   m_testFileName;
+};
+
+typedef std::map< size_t, Types::Point< double > > Reference;
+
+Types::Point< double > randomPoint( std::mt19937& generator )
+{
+    std::uniform_real_distribution< double > coordinate( -100.0, 100.0 );
+
+    return Types::Point< double >( { coordinate( generator ),
+                                     coordinate( generator ) } );
+}
+
+// Compares every query of tree against brute force over reference
+void verify( const KDLoggedTree< double >& tree,
+             const Reference&              reference,
+             std::mt19937&                 generator )
+{
+    ASSERT_EQ( tree.size(), reference.size() );
+
+    for ( Reference::const_iterator it = reference.begin();
+          it != reference.end(); ++it )
+    {
+        ASSERT_TRUE( tree.contains( it->first ) );
+        ASSERT_EQ( tree.point( it->first ), it->second );
+    }
+
+    for ( size_t i = 0; i < 20u; ++i )
+    {
+        const Types::Point< double > query = randomPoint( generator );
+
+        double bestDistance = Constants::KDTREE_MAX_DISTANCE;
+        size_t bestId       = Constants::KDTREE_ERROR_INDEX;
+        Types::Indexes inRadius;
+        for ( Reference::const_iterator it = reference.begin();
+              it != reference.end(); ++it )
+        {
+            const double distance = Utils::squaredDistance( query, it->second );
+            if ( distance < bestDistance )
+            {
+                bestDistance = distance;
+                bestId       = it->first;
+            }
+            if ( distance <= 30.0 * 30.0 )
+            {
+                inRadius.push_back( it->first );
+            }
+        }
+
+        ASSERT_EQ( tree.nearestPointId( query ), bestId );
+
+        Types::Indexes found = tree.pointIdsInRadius( query, 30.0 );
+        std::sort( found.begin(), found.end() );
+        ASSERT_EQ( found, inRadius );
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( KDLoggedTree, UpdatesSurviveReopen )
+{
+    TestFileGuard guard( testFile );
+    std::mt19937 generator( 3u );
+    Reference reference;
+
+    {
+        KDLoggedTree< double > tree;
+        size_t id = 0u;
+        ASSERT_EQ( tree.insert( randomPoint( generator ), id ).code(),
+                   KDStatus::Code::IO_ERROR );
+
+        ASSERT_TRUE( tree.open( testFile ) );
+        tree.setSync( false );
+        ASSERT_EQ( tree.size(), 0u );
+        ASSERT_EQ( tree.nearestPointId( Types::Point< double >( { 0.0, 0.0 } ) ),
+                   Constants::KDTREE_ERROR_INDEX );
+
+        for ( size_t i = 0; i < 200u; ++i )
+        {
+            const Types::Point< double > point = randomPoint( generator );
+            ASSERT_TRUE( tree.insert( point, id ) );
+            ASSERT_EQ( id, i );
+            reference[ id ] = point;
+        }
+
+        for ( size_t i = 0; i < 200u; i += 3u )
+        {
+            ASSERT_TRUE( tree.erase( i ) );
+            reference.erase( i );
+        }
+
+        ASSERT_EQ( tree.erase( 0u ).code(), KDStatus::Code::NOT_FOUND );
+        ASSERT_EQ( tree.insert( Types::Point< double >( { 1.0 } ), id ).code(),
+                   KDStatus::Code::CARDINALITY_MISMATCH );
+        ASSERT_EQ( tree.pendingRecords(), 267u );
+
+        verify( tree, reference, generator );
+    }
+
+    // The whole state is recovered from the log alone
+    KDLoggedTree< double > tree;
+    ASSERT_TRUE( tree.open( testFile ) );
+    ASSERT_EQ( tree.pendingRecords(), 267u );
+    verify( tree, reference, generator );
+
+    // Ids of erased points are never reused
+    size_t id = 0u;
+    ASSERT_TRUE( tree.insert( randomPoint( generator ), id ) );
+    ASSERT_EQ( id, 200u );
+}
+
+TEST( KDLoggedTree, Compaction )
+{
+    TestFileGuard guard( testFile );
+    std::mt19937 generator( 5u );
+    Reference reference;
+
+    KDLoggedTree< double > tree;
+    ASSERT_TRUE( tree.open( testFile ) );
+    tree.setSync( false );
+    tree.setCompactionThreshold( 0u );
+
+    size_t id = 0u;
+    for ( size_t i = 0; i < 500u; ++i )
+    {
+        const Types::Point< double > point = randomPoint( generator );
+        ASSERT_TRUE( tree.insert( point, id ) );
+        reference[ id ] = point;
+    }
+
+    ASSERT_TRUE( tree.compact() );
+    ASSERT_EQ( tree.pendingRecords(), 0u );
+    verify( tree, reference, generator );
+
+    // Updates go on during a background compaction and are carried over
+    for ( size_t i = 0; i < 500u; i += 2u )
+    {
+        ASSERT_TRUE( tree.erase( i ) );
+        reference.erase( i );
+    }
+
+    ASSERT_TRUE( tree.startCompaction() );
+    for ( size_t i = 0; i < 100u; ++i )
+    {
+        const Types::Point< double > point = randomPoint( generator );
+        ASSERT_TRUE( tree.insert( point, id ) );
+        reference[ id ] = point;
+        ASSERT_TRUE( tree.erase( 1u + 4u * i ) );
+        reference.erase( 1u + 4u * i );
+    }
+    ASSERT_TRUE( tree.waitForCompaction() );
+    ASSERT_LE( tree.pendingRecords(), 200u );
+    verify( tree, reference, generator );
+
+    KDLoggedTree< double > reopened;
+    ASSERT_TRUE( reopened.open( testFile ) );
+    verify( reopened, reference, generator );
+
+    // Automatic compaction keeps the log short
+    reopened.setSync( false );
+    reopened.setCompactionThreshold( 50u );
+    for ( size_t i = 0; i < 300u; ++i )
+    {
+        const Types::Point< double > point = randomPoint( generator );
+        ASSERT_TRUE( reopened.insert( point, id ) );
+        reference[ id ] = point;
+    }
+    ASSERT_TRUE( reopened.waitForCompaction() );
+    ASSERT_LT( reopened.pendingRecords(), 300u );
+    verify( reopened, reference, generator );
+}
+
+TEST( KDLoggedTree, AdoptsPlainTree )
+{
+    TestFileGuard guard( testFile );
+    std::mt19937 generator( 7u );
+
+    Types::Points< double > points;
+    Reference reference;
+    for ( size_t i = 0; i < 100u; ++i )
+    {
+        points.push_back( randomPoint( generator ) );
+        reference[ i ] = points.back();
+    }
+
+    KDTree< double > plain( points );
+    ASSERT_TRUE( plain.reorder() );
+    ASSERT_TRUE( plain.serialize( testFile ) );
+
+    KDLoggedTree< double > tree;
+    ASSERT_TRUE( tree.open( testFile ) );
+    verify( tree, reference, generator );
+
+    size_t id = 0u;
+    ASSERT_TRUE( tree.insert( randomPoint( generator ), id ) );
+    ASSERT_EQ( id, 100u );
+}
+
+TEST( KDLoggedTree, NearestTiesAfterCompaction )
+{
+    TestFileGuard guard( testFile );
+    std::mt19937 generator( 11u );
+
+    KDLoggedTree< double > tree;
+    ASSERT_TRUE( tree.open( testFile ) );
+    tree.setSync( false );
+
+    // Corners of a square around the origin get ids in an order unrelated
+    // to where the compacted base puts them
+    const Types::Points< double > corners = { {  1.0, -1.0 }, { -1.0,  1.0 },
+                                              {  1.0,  1.0 }, { -1.0, -1.0 } };
+    size_t id = 0u;
+    for ( size_t i = 0; i < 200u; ++i )
+    {
+        Types::Point< double > point = randomPoint( generator );
+        point[ 0 ] += point[ 0 ] < 0.0 ? -5.0 : 5.0;
+        ASSERT_TRUE( tree.insert( i % 50u == 0u ? corners[ i / 50u ] : point,
+                                  id ) );
+    }
+    ASSERT_TRUE( tree.compact() );
+
+    const Types::Point< double > origin( 2u, 0.0 );
+    ASSERT_EQ( tree.nearestPointId( origin ), 0u );
+    ASSERT_TRUE( tree.erase( 0u ) );
+    ASSERT_EQ( tree.nearestPointId( origin ), 50u );
+    ASSERT_TRUE( tree.erase( 50u ) );
+    ASSERT_EQ( tree.nearestPointId( origin ), 100u );
+}
+
+TEST( KDLoggedTree, FailedAppend )
+{
+    TestFileGuard guard( testFile );
+    std::mt19937 generator( 13u );
+    Reference reference;
+
+    KDLoggedTree< double > tree;
+    ASSERT_TRUE( tree.open( testFile ) );
+
+    size_t id = 0u;
+    for ( size_t i = 0; i < 10u; ++i )
+    {
+        const Types::Point< double > point = randomPoint( generator );
+        ASSERT_TRUE( tree.insert( point, id ) );
+        reference[ id ] = point;
+    }
+
+    // A file size limit just past the log makes the next append short
+    struct stat info;
+    ASSERT_EQ( stat( logFile.c_str(), &info ), 0 );
+
+    struct rlimit previous;
+    ASSERT_EQ( getrlimit( RLIMIT_FSIZE, &previous ), 0 );
+    struct rlimit limited = previous;
+    limited.rlim_cur = static_cast< rlim_t >( info.st_size ) + 5u;
+
+    void ( *handler )( int ) = signal( SIGXFSZ, SIG_IGN );
+    ASSERT_EQ( setrlimit( RLIMIT_FSIZE, &limited ), 0 );
+    const KDStatus inserted = tree.insert( randomPoint( generator ), id );
+    const KDStatus erased   = tree.erase( 3u );
+    ASSERT_EQ( setrlimit( RLIMIT_FSIZE, &previous ), 0 );
+    signal( SIGXFSZ, handler );
+
+    ASSERT_EQ( inserted.code(), KDStatus::Code::IO_ERROR );
+    ASSERT_EQ( erased.code(), KDStatus::Code::IO_ERROR );
+    ASSERT_EQ( stat( logFile.c_str(), &info ), 0 );
+    ASSERT_EQ( static_cast< size_t >( info.st_size ),
+               static_cast< size_t >( limited.rlim_cur ) - 5u );
+
+    // The failed updates left no trace, the next insert reuses the id
+    const Types::Point< double > point = randomPoint( generator );
+    ASSERT_TRUE( tree.insert( point, id ) );
+    ASSERT_EQ( id, 10u );
+    reference[ id ] = point;
+    ASSERT_TRUE( tree.erase( 3u ) );
+    reference.erase( 3u );
+    verify( tree, reference, generator );
+
+    KDLoggedTree< double > reopened;
+    ASSERT_TRUE( reopened.open( testFile ) );
+    verify( reopened, reference, generator );
+}
+
+TEST( KDLoggedTree, Recovery )
+{
+    TestFileGuard guard( testFile );
+    std::mt19937 generator( 9u );
+    Reference reference;
+
+    {
+        KDLoggedTree< double > tree;
+        ASSERT_TRUE( tree.open( testFile ) );
+        tree.setSync( false );
+
+        size_t id = 0u;
+        for ( size_t i = 0; i < 50u; ++i )
+        {
+            const Types::Point< double > point = randomPoint( generator );
+            ASSERT_TRUE( tree.insert( point, id ) );
+            reference[ id ] = point;
+        }
+        ASSERT_TRUE( tree.compact() );
+        ASSERT_TRUE( tree.erase( 7u ) );
+        reference.erase( 7u );
+    }
+
+    // A torn last record is dropped and cut off the log
+    {
+        std::ofstream log( logFile.c_str(), std::ofstream::app );
+        log << Constants::KDTREE_LOG_INSERT_MARKER << " 50 1.5,";
+    }
+
+    {
+        KDLoggedTree< double > tree;
+        ASSERT_TRUE( tree.open( testFile ) );
+        verify( tree, reference, generator );
+
+        size_t id = 0u;
+        const Types::Point< double > point = randomPoint( generator );
+        ASSERT_TRUE( tree.insert( point, id ) );
+        ASSERT_EQ( id, 50u );
+        reference[ id ] = point;
+    }
+
+    // A compaction interrupted before renaming the base is rolled back
+    const std::string baseTemporary =
+            testFile + Constants::KDTREE_COMPACTION_SUFFIX;
+    const std::string logTemporary =
+            logFile + Constants::KDTREE_COMPACTION_SUFFIX;
+    {
+        std::ofstream base( baseTemporary.c_str() );
+        base << "garbage";
+        std::ofstream log( logTemporary.c_str() );
+        log << "garbage";
+    }
+
+    {
+        KDLoggedTree< double > tree;
+        ASSERT_TRUE( tree.open( testFile ) );
+        verify( tree, reference, generator );
+        ASSERT_FALSE( KDLogFile::exists( baseTemporary ) );
+        ASSERT_FALSE( KDLogFile::exists( logTemporary ) );
+    }
+
+    // One interrupted after renaming the base is completed
+    ASSERT_EQ( std::rename( logFile.c_str(), logTemporary.c_str() ), 0 );
+    {
+        std::ofstream log( logFile.c_str() );
+        log << "garbage";
+    }
+
+    {
+        KDLoggedTree< double > tree;
+        ASSERT_TRUE( tree.open( testFile ) );
+        verify( tree, reference, generator );
+        ASSERT_FALSE( KDLogFile::exists( logTemporary ) );
+    }
+
+    // Malformed records in the middle of the log are reported
+    {
+        std::ofstream log( logFile.c_str(), std::ofstream::app );
+        log << Constants::KDTREE_LOG_ERASE_MARKER << " x\n"
+            << Constants::KDTREE_LOG_ERASE_MARKER << " 8\n";
+    }
+
+    KDLoggedTree< double > tree;
+    const KDStatus status = tree.open( testFile );
+    ASSERT_EQ( status.code(), KDStatus::Code::PARSE_ERROR );
+    // Header, 50 base ids, ERASE 7, INSERT 50, malformed ERASE
+    ASSERT_EQ( status.line(), 3u + 50u + 3u );
+    ASSERT_EQ( tree.size(), 0u );
+}
+
+} // namespace
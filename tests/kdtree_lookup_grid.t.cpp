@@ -0,0 +1,153 @@
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "kdtree.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+template< typename T >
+size_t bruteForceNearest( const Types::Points< T >& points,
+                          const Types::Point< T >&  query )
+{
+    size_t best = 0u;
+    for ( size_t i = 1; i < points.size(); ++i )
+    {
+        if ( Utils::squaredDistance( points[ i ], query ) <
+             Utils::squaredDistance( points[ best ], query ) )
+        {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( KDLookupGrid, DefaultCellsPerAxis )
+{
+    ASSERT_EQ( KDLookupGrid< double >::defaultCellsPerAxis( 800u, 2u ), 10u );
+    ASSERT_EQ( KDLookupGrid< double >::defaultCellsPerAxis( 8000u, 3u ), 10u );
+    ASSERT_EQ( KDLookupGrid< double >::defaultCellsPerAxis( 1000u, 5u ), 0u );
+    ASSERT_EQ( KDLookupGrid< double >::defaultCellsPerAxis( 1u << 30, 2u ),
+               1024u );
+}
+
+TEST( KDLookupGrid, SameAnswersAsTheTree )
+{
+    std::mt19937 generator( 13u );
+    std::normal_distribution< double > clustered( 0.0, 1.0 );
+
+    for ( size_t dimension = 1u; dimension <= 3u; ++dimension )
+    {
+        Types::Points< double > points;
+        for ( size_t i = 0; i < 5000u; ++i )
+        {
+            Types::Point< double > point;
+            for ( size_t j = 0; j < dimension; ++j )
+            {
+                point.push_back( clustered( generator ) );
+            }
+            points.push_back( point );
+        }
+
+        KDTree< double > tree( points );
+        tree.buildLookupGrid();
+        ASSERT_FALSE( tree.lookupGrid().empty() );
+        ASSERT_GT( tree.lookupGrid().numStartNodes(), 1u );
+
+        // Queries inside, at the border of and beyond the grid
+        for ( size_t i = 0; i < 2000u; ++i )
+        {
+            Types::Point< double > query;
+            for ( size_t j = 0; j < dimension; ++j )
+            {
+                query.push_back( 1.5 * clustered( generator ) );
+            }
+            ASSERT_EQ( tree.nearestPointIndex( query ),
+                       bruteForceNearest( points, query ) );
+        }
+
+        for ( size_t i = 0; i < points.size(); i += 97u )
+        {
+            ASSERT_EQ( tree.nearestPointIndex( points[ i ] ), i );
+        }
+    }
+}
+
+TEST( KDLookupGrid, DegenerateAndIntegerPoints )
+{
+    // Every point shares the second coordinate
+    Types::Points< int > points;
+    for ( int x = 0; x < 64; ++x )
+    {
+        points.push_back( Types::Point< int >( { x * 3, 7 } ) );
+    }
+
+    KDTree< int > tree( points );
+    tree.buildLookupGrid( 16u );
+    ASSERT_EQ( tree.lookupGrid().numCells(), 256u );
+
+    for ( int x = -10; x < 200; ++x )
+    {
+        for ( int y = 0; y < 14; y += 3 )
+        {
+            const Types::Point< int > query( { x, y } );
+            const size_t index = tree.nearestPointIndex( query );
+            ASSERT_EQ( Utils::squaredDistance( points[ index ], query ),
+                       Utils::squaredDistance(
+                               points[ bruteForceNearest( points, query ) ],
+                               query ) );
+        }
+    }
+}
+
+TEST( KDLookupGrid, Lifetime )
+{
+    Types::Points< double > points;
+    for ( size_t i = 0; i < 1000u; ++i )
+    {
+        points.push_back( Types::Point< double >(
+                { static_cast< double >( i % 37 ),
+                  static_cast< double >( i % 41 ) } ) );
+    }
+
+    KDTree< double > tree( points );
+    ASSERT_TRUE( tree.lookupGrid().empty() );
+
+    tree.buildLookupGrid( 8u );
+    ASSERT_EQ( tree.lookupGrid().cellsPerAxis(), 8u );
+
+    // Copies carry the grid, reordering keeps the nodes it refers to
+    const KDTree< double > copy( tree );
+    ASSERT_EQ( copy.lookupGrid().cellsPerAxis(), 8u );
+
+    ASSERT_TRUE( tree.reorder() );
+    const Types::Point< double > query( { 10.2, 20.7 } );
+    ASSERT_EQ( Utils::squaredDistance(
+                       tree.point( tree.nearestPointIndex( query ) ), query ),
+               Utils::squaredDistance(
+                       points[ bruteForceNearest( points, query ) ], query ) );
+
+    tree.clearLookupGrid();
+    ASSERT_TRUE( tree.lookupGrid().empty() );
+
+    // Too many cells leave the grid empty
+    tree.buildLookupGrid( 2000u );
+    ASSERT_TRUE( tree.lookupGrid().empty() );
+
+    KDTree< double > empty;
+    empty.buildLookupGrid();
+    ASSERT_TRUE( empty.lookupGrid().empty() );
+}
+
+} // namespace
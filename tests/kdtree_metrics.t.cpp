@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+
+#include "kdtree_types.h"
+#include "kdtree_metrics.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+typedef Types::Point< int >       TestPoint;
+typedef Types::AxisMinMax< int >  TestBox;
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( Metrics, EuclideanRanks )
+{
+    TestPoint p1;
+    p1.push_back( 1 );
+    p1.push_back( 2 );
+
+    TestPoint p2;
+    p2.push_back( 4 );
+    p2.push_back( -2 );
+
+    TestBox box;
+    box.push_back( std::pair< int, int >( 3, 5 ) );
+    box.push_back( std::pair< int, int >( 0, 1 ) );
+
+    ASSERT_DOUBLE_EQ( KDEuclideanMetric::rank( p1, p2 ), 25.0 );
+    ASSERT_DOUBLE_EQ( KDEuclideanMetric::axisRank( -3.0 ), 9.0 );
+    ASSERT_DOUBLE_EQ( KDEuclideanMetric::rankToBox( p1, box ), 5.0 );
+    ASSERT_DOUBLE_EQ( KDEuclideanMetric::maxRankToBox( p1, box ), 20.0 );
+    ASSERT_DOUBLE_EQ( KDEuclideanMetric::toRank( 5.0 ), 25.0 );
+    ASSERT_DOUBLE_EQ( KDEuclideanMetric::fromRank( 25.0 ), 5.0 );
+}
+
+TEST( Metrics, ManhattanRanks )
+{
+    TestPoint p1;
+    p1.push_back( 1 );
+    p1.push_back( 2 );
+
+    TestPoint p2;
+    p2.push_back( 4 );
+    p2.push_back( -2 );
+
+    TestBox box;
+    box.push_back( std::pair< int, int >( 3, 5 ) );
+    box.push_back( std::pair< int, int >( 0, 1 ) );
+
+    ASSERT_DOUBLE_EQ( KDManhattanMetric::rank( p1, p2 ), 7.0 );
+    ASSERT_DOUBLE_EQ( KDManhattanMetric::axisRank( -3.0 ), 3.0 );
+    ASSERT_DOUBLE_EQ( KDManhattanMetric::rankToBox( p1, box ), 3.0 );
+    ASSERT_DOUBLE_EQ( KDManhattanMetric::maxRankToBox( p1, box ), 6.0 );
+    ASSERT_DOUBLE_EQ( KDManhattanMetric::toRank( 5.0 ), 5.0 );
+    ASSERT_DOUBLE_EQ( KDManhattanMetric::fromRank( 5.0 ), 5.0 );
+
+    // A point inside of the box
+    TestPoint inside;
+    inside.push_back( 4 );
+    inside.push_back( 1 );
+    ASSERT_DOUBLE_EQ( KDManhattanMetric::rankToBox( inside, box ), 0.0 );
+    ASSERT_DOUBLE_EQ( KDManhattanMetric::maxRankToBox( inside, box ), 2.0 );
+}
+
+} // namespace
@@ -0,0 +1,138 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "kdtree_morton.h"
+#include "kdtree_utils.h"
+
+using namespace datastructures;
+
+namespace {
+
+typedef Types::Point< int >  TestPoint;
+typedef Types::Points< int > TestPoints;
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( Morton, BitsPerAxis )
+{
+    ASSERT_EQ( Morton::bitsPerAxis( 0u ),  0u );
+    ASSERT_EQ( Morton::bitsPerAxis( 1u ),  32u );
+    ASSERT_EQ( Morton::bitsPerAxis( 2u ),  32u );
+    ASSERT_EQ( Morton::bitsPerAxis( 3u ),  21u );
+    ASSERT_EQ( Morton::bitsPerAxis( 5u ),  12u );
+    ASSERT_EQ( Morton::bitsPerAxis( 64u ), 1u );
+    ASSERT_EQ( Morton::bitsPerAxis( 65u ), 0u );
+}
+
+TEST( Morton, InterleaveFastPathsMatchGenericLoop )
+{
+    std::srand( 11 );
+
+    for ( size_t i = 0; i < 1000u; ++i )
+    {
+        std::vector< uint32_t > quantized2D;
+        quantized2D.push_back( static_cast< uint32_t >( std::rand() ) );
+        quantized2D.push_back( static_cast< uint32_t >( std::rand() ) );
+
+        std::vector< uint32_t > quantized3D;
+        quantized3D.push_back( std::rand() % ( 1u << 21 ) );
+        quantized3D.push_back( std::rand() % ( 1u << 21 ) );
+        quantized3D.push_back( std::rand() % ( 1u << 21 ) );
+
+        // 31 bits skips the fast path
+        uint64_t expected2D = Morton::interleave( quantized2D, 31u );
+        expected2D |= static_cast< uint64_t >( quantized2D[ 0 ] >> 31 ) << 62;
+        expected2D |= static_cast< uint64_t >( quantized2D[ 1 ] >> 31 ) << 63;
+        ASSERT_EQ( Morton::interleave( quantized2D, 32u ), expected2D );
+
+        uint64_t expected3D = 0u;
+        for ( size_t bit = 0; bit < 21u; ++bit )
+        {
+            for ( size_t axis = 0; axis < 3u; ++axis )
+            {
+                expected3D |= static_cast< uint64_t >(
+                        ( quantized3D[ axis ] >> bit ) & 1u )
+                        << ( bit * 3u + axis );
+            }
+        }
+        ASSERT_EQ( Morton::interleave( quantized3D, 21u ), expected3D );
+    }
+
+    std::vector< uint32_t > quantized;
+    quantized.push_back( 1u );
+    quantized.push_back( 0u );
+    quantized.push_back( 1u );
+    ASSERT_EQ( Morton::interleave( quantized, 21u ), 5u );
+}
+
+TEST( Morton, EncodeIsMonotonePerAxis )
+{
+    TestPoints points;
+    for ( int i = 0; i < 100; ++i )
+    {
+        TestPoint p;
+        p.push_back( i );
+        p.push_back( 7 );
+        points.push_back( p );
+    }
+
+    const std::vector< uint64_t > codes =
+            Morton::encode( points, Utils::minMaxPerAxis( points ), 3u );
+
+    ASSERT_EQ( codes.size(), points.size() );
+    for ( size_t i = 1; i < codes.size(); ++i )
+    {
+        ASSERT_LT( codes[ i - 1u ], codes[ i ] );
+    }
+
+    // Unsupported dimensions produce zero codes
+    TestPoints wide( 3u, TestPoint( 70u, 1 ) );
+    const std::vector< uint64_t > wideCodes =
+            Morton::encode( wide, Utils::minMaxPerAxis( wide ) );
+    ASSERT_EQ( wideCodes, std::vector< uint64_t >( 3u, 0u ) );
+}
+
+TEST( Morton, RadixSortIsStable )
+{
+    std::srand( 5 );
+
+    std::vector< uint64_t > codes;
+    Types::Indexes          indexes;
+    for ( size_t i = 0; i < 5000u; ++i )
+    {
+        codes.push_back( ( static_cast< uint64_t >( std::rand() % 64 ) << 40 ) |
+                         static_cast< uint64_t >( std::rand() % 4 ) );
+        indexes.push_back( i );
+    }
+
+    std::vector< std::pair< uint64_t, size_t > > expected;
+    for ( size_t i = 0; i < codes.size(); ++i )
+    {
+        expected.push_back( std::make_pair( codes[ i ], indexes[ i ] ) );
+    }
+    std::sort( expected.begin(), expected.end() );
+
+    for ( size_t numThreads = 1u; numThreads <= 7u; numThreads += 3u )
+    {
+        std::vector< uint64_t > sortedCodes   = codes;
+        Types::Indexes          sortedIndexes = indexes;
+        Morton::radixSort( sortedCodes, sortedIndexes, numThreads );
+
+        for ( size_t i = 0; i < expected.size(); ++i )
+        {
+            ASSERT_EQ( sortedCodes[ i ],   expected[ i ].first );
+            ASSERT_EQ( sortedIndexes[ i ], expected[ i ].second );
+        }
+    }
+
+    std::vector< uint64_t > single( 1u, 42u );
+    Types::Indexes singleIndex( 1u, 0u );
+    Morton::radixSort( single, singleIndex );
+    ASSERT_EQ( single[ 0 ], 42u );
+}
+
+} // namespace
@@ -144,4 +144,36 @@ TEST( KDNode, SanityLeaf )
     ASSERT_EQ( dummyLeafNode2, dummyLeafNode3 );
 }
 
+TEST( KDNode, CountAndBounds )
+{
+    const std::shared_ptr< TestNode >  leaf1( new TestNode( 0u ) );
+    const std::shared_ptr< TestNode >  leaf2( new TestNode( 1u ) );
+    const std::shared_ptr< TestNode >  inner(
+            new TestNode( TestHyperplane( 0u, 1 ), leaf1, leaf2 ) );
+    const std::shared_ptr< TestNode >  empty( new TestNode() );
+
+    ASSERT_EQ( empty->count(), 0u );
+    ASSERT_EQ( leaf1->count(), 1u );
+    ASSERT_EQ( inner->count(), 2u );
+
+    TestNode root( TestHyperplane( 1u, 5 ), inner, leaf1 );
+    ASSERT_EQ( root.count(), 3u );
+    ASSERT_TRUE( root.bounds().empty() );
+
+    Types::AxisMinMax< int > bounds;
+    bounds.push_back( std::pair< int, int >( -1, 3 ) );
+    root.setBounds( bounds );
+
+    ASSERT_EQ( root.bounds(), bounds );
+
+    ASSERT_EQ( root.sum(), 0.0 );
+    root.setSum( 4.5 );
+    ASSERT_EQ( root.sum(), 4.5 );
+
+    TestNode copied( root );
+    ASSERT_EQ( copied.count(),  3u );
+    ASSERT_EQ( copied.bounds(), bounds );
+    ASSERT_EQ( copied.sum(),    4.5 );
+}
+
 } // namespace
\ No newline at end of file
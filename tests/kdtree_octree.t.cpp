@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+#include "gtest/gtest.h"
+
+#include "kdtree_types.h"
+#include "kdtree.h"
+#include "kdtree_octree.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+typedef Types::Point< double >   TestPoint;
+typedef Types::Points< double >  TestPoints;
+typedef KDTree< double >         TestKDTree;
+typedef Octree< double >         TestOctree;
+
+const std::string testFile = "really_long_and_unique_octree_file_name_42.txt";
+
+class TestFileGuard
+{
+public:
+    TestFileGuard( const std::string& testFileName )
+    : m_testFileName( testFileName )
+    {
+        // nothing to do here
+    }
+
+    ~TestFileGuard()
+    {
+        std::remove( m_testFileName.c_str() );
+    }
+
+private:
+    std::string   m_testFileName;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// HELPER FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TestPoints randomPoints( const size_t size, const unsigned int seed = 42u )
+{
+    std::srand( seed );
+
+    // A coarse lattice for part of the points, so that there are
+    // duplicates and equally distant candidates
+    TestPoints points;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        TestPoint point;
+        for ( size_t j = 0; j < 3u; ++j )
+        {
+            const double value = std::rand() / static_cast< double >( RAND_MAX );
+            point.push_back( i % 3u ? value : static_cast< int >( value * 8.0 ) / 8.0 );
+        }
+        points.push_back( point );
+    }
+
+    return points;
+}
+
+Types::Indexes bruteForceNearest( const TestPoints& points,
+                                  const TestPoint&  query,
+                                  const size_t      k )
+{
+    std::vector< std::pair< double, size_t > > ranked;
+    for ( size_t i = 0; i < points.size(); ++i )
+    {
+        ranked.push_back( std::make_pair(
+                Utils::squaredDistance( points[ i ], query ), i ) );
+    }
+    std::sort( ranked.begin(), ranked.end() );
+
+    Types::Indexes result;
+    for ( size_t i = 0; i < std::min( k, ranked.size() ); ++i )
+    {
+        result.push_back( ranked[ i ].second );
+    }
+
+    return result;
+}
+
+Types::Indexes sorted( Types::Indexes indexes )
+{
+    std::sort( indexes.begin(), indexes.end() );
+    return indexes;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( Octree, Empty )
+{
+    const TestOctree empty;
+    ASSERT_EQ( empty.size(), 0u );
+    ASSERT_EQ( empty.nearestPointIndex( TestPoint( { 0.0, 0.0, 0.0 } ) ),
+               Constants::KDTREE_ERROR_INDEX );
+    ASSERT_TRUE( empty.nearestPoint( TestPoint( { 0.0, 0.0, 0.0 } ) ).empty() );
+    ASSERT_TRUE( empty.nearestPointIndexes( TestPoint( { 0.0, 0.0, 0.0 } ),
+                                            3u ).empty() );
+    ASSERT_TRUE( empty.pointIndexesInRadius( TestPoint( { 0.0, 0.0, 0.0 } ),
+                                             1.0 ).empty() );
+
+    // Only 3-D points are accepted
+    const TestOctree flat( TestPoints( { TestPoint( { 0.0, 1.0 } ) } ) );
+    ASSERT_EQ( flat.size(), 0u );
+
+    const TestOctree single( TestPoints( { TestPoint( { 1.0, 2.0, 3.0 } ) } ) );
+    ASSERT_EQ( single.numNodes(), 1u );
+    ASSERT_EQ( single.nearestPointIndex( TestPoint( { 0.0, 0.0, 0.0 } ) ), 0u );
+    ASSERT_EQ( single.nearestPointIndex( TestPoint( { 0.0, 0.0 } ) ),
+               Constants::KDTREE_ERROR_INDEX );
+}
+
+TEST( Octree, SameAnswersAsBruteForce )
+{
+    const TestPoints points  = randomPoints( 4000u );
+    const TestPoints queries = randomPoints( 300u, 7u );
+    const TestOctree tree( points, 3u );
+    const TestKDTree kdtree( points );
+
+    ASSERT_EQ( tree.size(), points.size() );
+    ASSERT_GT( tree.numNodes(), points.size() /
+                                Constants::KDTREE_OCTREE_BUCKET_SIZE );
+
+    for ( size_t i = 0; i < queries.size(); ++i )
+    {
+        // Some queries fall outside of the bounding box
+        TestPoint query = queries[ i ];
+        query[ i % 3u ] = query[ i % 3u ] * 1.5 - 0.25;
+
+        ASSERT_EQ( tree.nearestPointIndex( query ),
+                   bruteForceNearest( points, query, 1u )[ 0 ] );
+        ASSERT_EQ( tree.nearestPoint( query ),
+                   points[ tree.nearestPointIndex( query ) ] );
+        ASSERT_EQ( tree.nearestPointIndexes( query, 10u ),
+                   bruteForceNearest( points, query, 10u ) );
+
+        for ( const double radius : { 0.0, 0.05, 0.2, 2.0 } )
+        {
+            ASSERT_EQ( sorted( tree.pointIndexesInRadius( query, radius ) ),
+                       sorted( kdtree.pointIndexesInRadius( query, radius ) ) );
+        }
+    }
+
+    // Stored points, duplicates resolved to the smaller index
+    for ( size_t i = 0; i < points.size(); i += 37u )
+    {
+        ASSERT_EQ( tree.nearestPointIndex( points[ i ] ),
+                   bruteForceNearest( points, points[ i ], 1u )[ 0 ] );
+    }
+
+    ASSERT_EQ( tree.nearestPointIndexes( queries[ 0 ], 5000u ).size(),
+               points.size() );
+    ASSERT_TRUE( tree.nearestPointIndexes( queries[ 0 ], 0u ).empty() );
+    ASSERT_TRUE( tree.pointIndexesInRadius( queries[ 0 ], -1.0 ).empty() );
+}
+
+TEST( Octree, IdenticalPoints )
+{
+    // More identical points than fit into a bucket
+    TestPoints points( 100u, TestPoint( { 0.5, 0.5, 0.5 } ) );
+    points.push_back( TestPoint( { 1.0, 1.0, 1.0 } ) );
+
+    const TestOctree tree( points );
+    ASSERT_EQ( tree.nearestPointIndex( TestPoint( { 0.0, 0.0, 0.0 } ) ), 0u );
+    ASSERT_EQ( tree.nearestPointIndex( TestPoint( { 2.0, 2.0, 2.0 } ) ), 100u );
+    ASSERT_EQ( tree.pointIndexesInRadius( TestPoint( { 0.5, 0.5, 0.5 } ),
+                                          0.0 ).size(), 100u );
+}
+
+TEST( Octree, FloatPoints )
+{
+    Types::Points< float > points;
+    for ( size_t i = 0; i < 1000u; ++i )
+    {
+        points.push_back( Types::Point< float >(
+                { static_cast< float >( i % 10 ),
+                  static_cast< float >( ( i / 10 ) % 10 ),
+                  static_cast< float >( i / 100 ) } ) );
+    }
+
+    const Octree< float > tree( points );
+    ASSERT_EQ( tree.nearestPointIndex(
+                       Types::Point< float >( { 3.1f, 4.2f, 5.4f } ) ), 543u );
+    ASSERT_EQ( tree.pointIndexesInRadius(
+                       Types::Point< float >( { 5.0f, 5.0f, 5.0f } ),
+                       1.0 ).size(), 7u );
+}
+
+TEST( Octree, BuildDoesNotDependOnThreads )
+{
+    const TestPoints points = randomPoints( 3000u );
+    const TestOctree single( points, 1u );
+    const TestOctree several( points, 4u );
+
+    ASSERT_EQ( single, several );
+    ASSERT_EQ( single.numNodes(), several.numNodes() );
+
+    // Copies are plain data
+    const TestOctree copy( several );
+    ASSERT_EQ( copy.numNodes(), several.numNodes() );
+    ASSERT_EQ( copy.nearestPointIndexes( points[ 5 ], 4u ),
+               single.nearestPointIndexes( points[ 5 ], 4u ) );
+}
+
+TEST( Octree, Serialization )
+{
+    TestFileGuard guard( testFile );
+
+    const TestPoints points = randomPoints( 2000u );
+    const TestOctree tree( points );
+
+    ASSERT_TRUE( tree.serialize( testFile, 3u ) );
+
+    TestOctree loaded;
+    ASSERT_TRUE( loaded.deserialize( testFile, 2u ) );
+    ASSERT_EQ( loaded, tree );
+    ASSERT_EQ( loaded.numNodes(), tree.numNodes() );
+    ASSERT_EQ( loaded.nearestPointIndexes( points[ 9 ], 6u ),
+               tree.nearestPointIndexes( points[ 9 ], 6u ) );
+
+    // A KDTree file is rejected, the loaded tree is kept
+    ASSERT_TRUE( TestKDTree( points ).serialize( testFile ) );
+    ASSERT_EQ( loaded.deserialize( testFile ).code(),
+               KDStatus::Code::TYPE_MISMATCH );
+    ASSERT_EQ( loaded, tree );
+
+    {
+        std::ofstream out( testFile.c_str() );
+        out << Constants::KDTREE_OCTREE_VARIETY << "\n2\n1,2,3\n4,5\n";
+    }
+    const KDStatus status = loaded.deserialize( testFile );
+    ASSERT_EQ( status.code(), KDStatus::Code::CARDINALITY_MISMATCH );
+    ASSERT_EQ( status.line(), 4u );
+
+    ASSERT_EQ( loaded.deserialize( "no_such_octree_file" ).code(),
+               KDStatus::Code::IO_ERROR );
+    ASSERT_EQ( loaded, tree );
+}
+
+} // namespace
@@ -0,0 +1,67 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "kdtree_parallel.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( Parallel, NumThreads )
+{
+    ASSERT_EQ( Parallel::numThreads( 3u ), 3u );
+    ASSERT_GE( Parallel::numThreads( 0u ), 1u );
+}
+
+TEST( Parallel, ForEachRangeEmpty )
+{
+    size_t calls = 0;
+    Parallel::forEachRange( 0u, 4u,
+        [ & ]( const size_t, const size_t, const size_t ) { ++calls; } );
+
+    ASSERT_EQ( calls, 0u );
+}
+
+TEST( Parallel, ForEachRangeCoversEveryIndexOnce )
+{
+    for ( size_t numThreads = 1u; numThreads < 9u; ++numThreads )
+    {
+        std::vector< int > visits( 37u, 0 );
+
+        Parallel::forEachRange( visits.size(), numThreads,
+            [ & ]( const size_t begin, const size_t end, const size_t )
+            {
+                for ( size_t i = begin; i < end; ++i )
+                {
+                    ++visits[ i ];
+                }
+            } );
+
+        for ( size_t i = 0; i < visits.size(); ++i )
+        {
+            ASSERT_EQ( visits[ i ], 1 );
+        }
+    }
+}
+
+TEST( Parallel, ForEachRangeMoreThreadsThanWork )
+{
+    std::vector< size_t > chunks( 2u, 42u );
+
+    Parallel::forEachRange( 2u, 16u,
+        [ & ]( const size_t begin, const size_t end, const size_t chunk )
+        {
+            ASSERT_EQ( end, begin + 1u );
+            chunks[ begin ] = chunk;
+        } );
+
+    ASSERT_EQ( chunks[ 0 ], 0u );
+    ASSERT_EQ( chunks[ 1 ], 1u );
+}
+
+} // namespace
@@ -0,0 +1,155 @@
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "kdtree_query_cache.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr< const KDTree< double > > randomTree( const size_t size,
+                                                      const unsigned seed )
+{
+    std::mt19937 generator( seed );
+    std::uniform_real_distribution< double > coordinate( -10.0, 10.0 );
+
+    Types::Points< double > points;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        points.push_back( Types::Point< double >(
+                { coordinate( generator ), coordinate( generator ),
+                  coordinate( generator ) } ) );
+    }
+
+    return std::make_shared< const KDTree< double > >( points );
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( KDQueryCache, ExactEntries )
+{
+    const std::shared_ptr< const KDTree< double > > tree =
+            randomTree( 1000u, 1u );
+    KDQueryCache< double > cache( tree, 64u );
+
+    ASSERT_EQ( cache.nearestPointIndex( Types::Point< double >( { 1.0 } ) ),
+               Constants::KDTREE_ERROR_INDEX );
+
+    const Types::Point< double > query( { 1.0, 2.0, 3.0 } );
+    const size_t expected = tree->nearestPointIndex( query );
+    for ( size_t i = 0; i < 10u; ++i )
+    {
+        ASSERT_EQ( cache.nearestPointIndex( query ), expected );
+    }
+
+    KDCacheStatistics statistics = cache.statistics();
+    ASSERT_EQ( statistics.misses, 1u );
+    ASSERT_EQ( statistics.exactHits, 9u );
+    ASSERT_DOUBLE_EQ( statistics.hitRate(), 0.9 );
+
+    // Memory stays bounded
+    std::mt19937 generator( 2u );
+    std::uniform_real_distribution< double > coordinate( -10.0, 10.0 );
+    for ( size_t i = 0; i < 1000u; ++i )
+    {
+        const Types::Point< double > other(
+                { coordinate( generator ), coordinate( generator ),
+                  coordinate( generator ) } );
+        ASSERT_EQ( cache.nearestPointIndex( other ),
+                   tree->nearestPointIndex( other ) );
+    }
+    ASSERT_LE( cache.size(), 64u );
+
+    // A swapped tree never sees answers of the previous one
+    const std::shared_ptr< const KDTree< double > > other =
+            randomTree( 1000u, 3u );
+    cache.setTree( other );
+    cache.resetStatistics();
+    ASSERT_EQ( cache.size(), 0u );
+    ASSERT_EQ( cache.nearestPointIndex( query ),
+               other->nearestPointIndex( query ) );
+    ASSERT_EQ( cache.statistics().misses, 1u );
+
+    // A cache without capacity only forwards
+    KDQueryCache< double > disabled( tree, 0u );
+    ASSERT_EQ( disabled.nearestPointIndex( query ), expected );
+    ASSERT_EQ( disabled.size(), 0u );
+}
+
+TEST( KDQueryCache, CellEntriesStayExact )
+{
+    const std::shared_ptr< const KDTree< double > > tree =
+            randomTree( 200u, 4u );
+    KDQueryCache< double > cache( tree, 1u << 12, 0.25 );
+
+    std::mt19937 generator( 5u );
+    std::uniform_real_distribution< double > coordinate( -2.0, 2.0 );
+    for ( size_t i = 0; i < 20000u; ++i )
+    {
+        const Types::Point< double > query(
+                { coordinate( generator ), coordinate( generator ),
+                  coordinate( generator ) } );
+        ASSERT_EQ( cache.nearestPointIndex( query ),
+                   tree->nearestPointIndex( query ) );
+    }
+
+    // Most queries are answered by a handful of cells
+    const KDCacheStatistics statistics = cache.statistics();
+    ASSERT_GT( statistics.cellHits, 10000u );
+    ASSERT_GT( statistics.cellRejections, 0u );
+    ASSERT_EQ( statistics.cellHits + statistics.misses, 20000u );
+}
+
+TEST( KDQueryCache, ConcurrentLookups )
+{
+    const std::shared_ptr< const KDTree< double > > tree =
+            randomTree( 2000u, 6u );
+    KDQueryCache< double > cache( tree, 256u, 0.5 );
+
+    std::vector< std::thread > threads;
+    std::vector< size_t > failures( 4u, 0u );
+    for ( size_t t = 0; t < failures.size(); ++t )
+    {
+        threads.push_back( std::thread( [ &, t ]()
+            {
+                std::mt19937 generator( 7u );
+                std::uniform_int_distribution< int > coordinate( -20, 20 );
+                for ( size_t i = 0; i < 5000u; ++i )
+                {
+                    const Types::Point< double > query(
+                            { 0.5 * coordinate( generator ),
+                              0.5 * coordinate( generator ),
+                              0.5 * coordinate( generator ) } );
+                    if ( cache.nearestPointIndex( query ) !=
+                         tree->nearestPointIndex( query ) )
+                    {
+                        ++failures[ t ];
+                    }
+                    if ( 2500u == i && !t )
+                    {
+                        cache.setTree( tree );
+                    }
+                }
+            } ) );
+    }
+
+    for ( size_t t = 0; t < threads.size(); ++t )
+    {
+        threads[ t ].join();
+    }
+
+    ASSERT_EQ( failures, std::vector< size_t >( 4u, 0u ) );
+    ASSERT_LE( cache.size(), 256u );
+    ASSERT_GT( cache.statistics().hitRate(), 0.0 );
+}
+
+} // namespace
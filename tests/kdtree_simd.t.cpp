@@ -0,0 +1,229 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "kdtree_simd.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// HELPER FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+std::vector< Simd::Level > testedLevels()
+{
+    std::vector< Simd::Level > levels;
+    levels.push_back( Simd::Level::SCALAR );
+    if ( Simd::supportedLevel() >= Simd::Level::AVX2 )
+    {
+        levels.push_back( Simd::Level::AVX2 );
+    }
+    if ( Simd::supportedLevel() >= Simd::Level::AVX512 )
+    {
+        levels.push_back( Simd::Level::AVX512 );
+    }
+
+    return levels;
+}
+
+template< typename T >
+void checkKernels( const size_t size )
+{
+    std::vector< T >      values;
+    std::vector< size_t > indexes;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        values.push_back( static_cast< T >( std::rand() % 200 - 100 ) / 4 );
+        indexes.push_back( 1000u + i );
+    }
+
+    const T expectedMin = *std::min_element( values.begin(), values.end() );
+    const T expectedMax = *std::max_element( values.begin(), values.end() );
+    const T pivot = values[ size / 2u ];
+
+    std::vector< size_t > expectedLeft;
+    std::vector< size_t > expectedRight;
+    for ( size_t i = 0; i < size; ++i )
+    {
+        ( values[ i ] < pivot ? expectedLeft : expectedRight ).push_back(
+                indexes[ i ] );
+    }
+
+    const std::vector< Simd::Level > levels = testedLevels();
+    for ( size_t l = 0; l < levels.size(); ++l )
+    {
+        T min = 0;
+        T max = 0;
+        Simd::minMax( values.data(), size, min, max, levels[ l ] );
+        ASSERT_EQ( min, expectedMin );
+        ASSERT_EQ( max, expectedMax );
+
+        std::vector< size_t > left( size );
+        std::vector< size_t > right( size );
+        const size_t numLeft = Simd::partition( values.data(),
+                                                indexes.data(),
+                                                size,
+                                                pivot,
+                                                left.data(),
+                                                right.data(),
+                                                levels[ l ] );
+        left.resize( numLeft );
+        right.resize( size - numLeft );
+        ASSERT_EQ( left,  expectedLeft );
+        ASSERT_EQ( right, expectedRight );
+    }
+}
+
+template< typename T >
+void checkSquaredDistances( const size_t numQueries,
+                            const size_t numPoints,
+                            const size_t dimension )
+{
+    std::vector< std::vector< T > > queries( numQueries,
+                                             std::vector< T >( dimension ) );
+    std::vector< std::vector< T > > points( numPoints,
+                                            std::vector< T >( dimension ) );
+    std::vector< const T* > queryRows;
+    std::vector< const T* > pointRows;
+    std::vector< double >   queryNorms;
+    std::vector< double >   pointNorms;
+
+    for ( size_t i = 0; i < numQueries; ++i )
+    {
+        double norm = 0.0;
+        for ( size_t k = 0; k < dimension; ++k )
+        {
+            queries[ i ][ k ] = static_cast< T >( std::rand() % 200 - 100 ) / 8;
+            norm += static_cast< double >( queries[ i ][ k ] ) *
+                    queries[ i ][ k ];
+        }
+        queryRows.push_back( queries[ i ].data() );
+        queryNorms.push_back( norm );
+    }
+
+    for ( size_t j = 0; j < numPoints; ++j )
+    {
+        double norm = 0.0;
+        for ( size_t k = 0; k < dimension; ++k )
+        {
+            points[ j ][ k ] = static_cast< T >( std::rand() % 200 - 100 ) / 8;
+            norm += static_cast< double >( points[ j ][ k ] ) *
+                    points[ j ][ k ];
+        }
+        pointRows.push_back( points[ j ].data() );
+        pointNorms.push_back( norm );
+    }
+
+    const std::vector< Simd::Level > levels = testedLevels();
+    for ( size_t l = 0; l < levels.size(); ++l )
+    {
+        std::vector< double > distances( numQueries * numPoints, -1.0 );
+        Simd::squaredDistances( queryRows.data(), numQueries,
+                                pointRows.data(), numPoints, dimension,
+                                queryNorms.data(), pointNorms.data(),
+                                distances.data(), levels[ l ] );
+
+        for ( size_t i = 0; i < numQueries; ++i )
+        {
+            for ( size_t j = 0; j < numPoints; ++j )
+            {
+                double expected = 0.0;
+                for ( size_t k = 0; k < dimension; ++k )
+                {
+                    const double difference =
+                            static_cast< double >( queries[ i ][ k ] ) -
+                            points[ j ][ k ];
+                    expected += difference * difference;
+                }
+
+                ASSERT_NEAR( distances[ i * numPoints + j ], expected,
+                             2.0 * ( dimension + 4u ) *
+                             std::numeric_limits< T >::epsilon() *
+                             ( queryNorms[ i ] + pointNorms[ j ] ) );
+            }
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( Simd, KernelsMatchScalarLoops )
+{
+    std::srand( 13 );
+
+    // Sizes around every vector width exercise the tails
+    for ( size_t size = 1u; size <= 40u; ++size )
+    {
+        checkKernels< double >( size );
+        checkKernels< float  >( size );
+        checkKernels< int    >( size );
+    }
+
+    checkKernels< double >( 10007u );
+    checkKernels< float  >( 10007u );
+}
+
+TEST( Simd, SquaredDistancesMatchScalarLoops )
+{
+    std::srand( 29 );
+
+    // Counts around the register tiles and dimensions around every vector
+    // width exercise the edges
+    for ( size_t numQueries = 1u; numQueries <= 9u; ++numQueries )
+    {
+        for ( size_t numPoints = 1u; numPoints <= 9u; ++numPoints )
+        {
+            for ( size_t dimension = 1u; dimension <= 33u; dimension += 4u )
+            {
+                checkSquaredDistances< double >( numQueries, numPoints,
+                                                 dimension );
+                checkSquaredDistances< float  >( numQueries, numPoints,
+                                                 dimension );
+            }
+        }
+    }
+
+    checkSquaredDistances< double >( 13u, 130u, 257u );
+    checkSquaredDistances< float  >( 13u, 130u, 1024u );
+
+    // Identical rows are never reported at a negative distance
+    const float row[ 3 ] = { 0.1f, 0.2f, 0.3f };
+    const float* rows[ 1 ] = { row };
+    const double norm = 0.1f * 0.1f + 0.2f * 0.2f + 0.3f * 0.3f;
+    double distance = -1.0;
+    Simd::squaredDistances( rows, 1u, rows, 1u, 3u, &norm, &norm, &distance );
+    ASSERT_GE( distance, 0.0 );
+}
+
+TEST( Simd, PartitionKeepsOrderOfTies )
+{
+    const std::vector< double > values( 21u, 3.0 );
+    std::vector< size_t > indexes;
+    for ( size_t i = 0; i < values.size(); ++i )
+    {
+        indexes.push_back( values.size() - i );
+    }
+
+    std::vector< size_t > left( values.size() );
+    std::vector< size_t > right( values.size() );
+    ASSERT_EQ( Simd::partition( values.data(), indexes.data(),
+                                values.size(), 3.0,
+                                left.data(), right.data() ), 0u );
+    ASSERT_EQ( right, indexes );
+
+    ASSERT_EQ( Simd::partition( values.data(), indexes.data(),
+                                values.size(), 3.5,
+                                left.data(), right.data() ),
+               values.size() );
+    ASSERT_EQ( left, indexes );
+}
+
+} // namespace
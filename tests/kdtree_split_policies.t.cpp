@@ -0,0 +1,117 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <type_traits>
+
+#include "kdtree_types.h"
+#include "kdtree_utils.h"
+#include "kdtree_split_policies.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// LOCAL TYPES AND DEFINITIONS
+//////////////////////////////////////////////////////////////////////////////
+
+typedef Types::Point< int >   TestPoint;
+typedef Types::Points< int >  TestPoints;
+typedef KDHyperplane< int >   TestHyperplane;
+
+static_assert( std::is_trivially_copyable< TestHyperplane >::value,
+               "KDHyperplane must stay trivially copyable" );
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( SplitPolicies, MedianSplitMatchesUtils )
+{
+    std::srand( 29 );
+
+    for ( size_t trial = 0; trial < 50u; ++trial )
+    {
+        TestPoints points;
+        Types::Indexes indexes;
+        for ( size_t i = 0; i < 2u + trial; ++i )
+        {
+            TestPoint p;
+            p.push_back( std::rand() % 30 );
+            p.push_back( std::rand() % 20 );
+            p.push_back( std::rand() % 30 );
+            points.push_back( p );
+            indexes.push_back( i );
+        }
+
+        const size_t axis = Utils::axisOfHighestVariance< int >( points );
+        ASSERT_EQ( KDMedianSplit< int >::chooseBestSplit( points, indexes ),
+                   TestHyperplane(
+                           axis,
+                           Utils::medianValueInAxis< int >( points, axis ) ) );
+    }
+}
+
+TEST( SplitPolicies, MedianTiesGoToLowestIndex )
+{
+    // -0 and +0 compare equal, the median is the zero of the lowest index
+    // among the zeros of its rank whatever the order of the indexes
+    Types::Points< double > points;
+    const double coordinates[] = { 0.0, -0.0, -0.0, 1.0, 0.0, -1.0, -0.0 };
+    for ( size_t i = 0; i < sizeof( coordinates ) / sizeof( double ); ++i )
+    {
+        points.push_back( Types::Point< double >( 1u, coordinates[ i ] ) );
+    }
+
+    Types::Indexes indexes;
+    for ( size_t i = 0; i < points.size(); ++i )
+    {
+        indexes.push_back( points.size() - 1u - i );
+    }
+
+    for ( size_t shift = 0; shift < indexes.size(); ++shift )
+    {
+        std::rotate( indexes.begin(), indexes.begin() + 1, indexes.end() );
+        const double value =
+                KDMedianSplit< double >::chooseBestSplit( points,
+                                                          indexes ).value();
+        ASSERT_EQ( value, 0.0 );
+        ASSERT_TRUE( std::signbit( value ) );
+    }
+    ASSERT_TRUE( std::signbit(
+            Utils::medianValueInAxis< double >( points, 0u ) ) );
+
+    indexes.pop_back();
+    ASSERT_FALSE( std::signbit(
+            KDMedianSplit< double >::chooseBestSplit( points,
+                                                      indexes ).value() ) );
+}
+
+TEST( SplitPolicies, MidpointSplit )
+{
+    TestPoints points;
+    for ( int i = 0; i < 5; ++i )
+    {
+        TestPoint p;
+        p.push_back( i );
+        p.push_back( i * i );
+        points.push_back( p );
+    }
+
+    Types::Indexes indexes;
+    indexes.push_back( 0u );
+    indexes.push_back( 4u );
+    indexes.push_back( 2u );
+    ASSERT_EQ( KDMidpointSplit< int >::chooseBestSplit( points, indexes ),
+               TestHyperplane( 1u, 8 ) );
+
+    indexes.clear();
+    indexes.push_back( 1u );
+    indexes.push_back( 2u );
+    ASSERT_EQ( KDMidpointSplit< int >::chooseBestSplit( points, indexes ),
+               TestHyperplane( 1u, 2 ) );
+}
+
+} // namespace
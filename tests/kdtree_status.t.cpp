@@ -0,0 +1,41 @@
+#include "gtest/gtest.h"
+
+#include "kdtree_status.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( KDStatus, TestUninitializedState )
+{
+    KDStatus status;
+
+    ASSERT_TRUE( status );
+    ASSERT_EQ( status.code(), KDStatus::Code::OK );
+    ASSERT_EQ( status.line(), 0u );
+    ASSERT_STREQ( status.message(), "" );
+
+    std::cout << status << std::endl;
+}
+
+TEST( KDStatus, Failure )
+{
+    const KDStatus status( KDStatus::Code::PARSE_ERROR, "malformed", 3u );
+
+    ASSERT_FALSE( status );
+    ASSERT_EQ( status.code(), KDStatus::Code::PARSE_ERROR );
+    ASSERT_EQ( status.line(), 3u );
+    ASSERT_STREQ( status.message(), "malformed" );
+
+    ASSERT_EQ( status, KDStatus( KDStatus::Code::PARSE_ERROR, "other", 3u ) );
+    ASSERT_NE( status, KDStatus( KDStatus::Code::PARSE_ERROR, "malformed" ) );
+    ASSERT_NE( status, KDStatus() );
+
+    std::cout << status << std::endl;
+}
+
+} // namespace
@@ -0,0 +1,85 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "kdtree_text.h"
+#include "kdtree_loader.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( Text, AppendNumberRoundTrip )
+{
+    std::string out;
+    Text::appendNumber( out, 0.1 );
+    Text::appendNumber( out, 42 );
+    ASSERT_EQ( out, "0.142" );
+
+    std::mt19937_64 generator( 7u );
+    for ( size_t i = 0; i < 10000u; ++i )
+    {
+        // Random bit patterns cover denormals and extreme exponents
+        const uint64_t bits = generator();
+        double value;
+        std::memcpy( &value, &bits, sizeof( value ) );
+        if ( std::isnan( value ) )
+        {
+            continue;
+        }
+
+        out.clear();
+        Text::appendNumber( out, value );
+        const char* cursor = out.data();
+        double parsed;
+        ASSERT_TRUE( Loader::parseReal( cursor, out.data() + out.size(),
+                                        parsed ) ) << out;
+        ASSERT_EQ( parsed, value ) << out;
+
+        const float single = static_cast< float >( value );
+        out.clear();
+        Text::appendNumber( out, single );
+        cursor = out.data();
+        float parsedSingle;
+        ASSERT_TRUE( Loader::parseReal( cursor, out.data() + out.size(),
+                                        parsedSingle ) ) << out;
+        ASSERT_EQ( parsedSingle, single ) << out;
+    }
+}
+
+TEST( Text, SplitLines )
+{
+    const std::string contents = "a\r\n\nbc\nd";
+
+    for ( size_t numThreads = 1u; numThreads <= 8u; ++numThreads )
+    {
+        std::vector< const char* > lines;
+        Text::splitLines( contents, lines, numThreads );
+
+        ASSERT_EQ( lines.size(), 5u );
+        ASSERT_TRUE( Text::lineEquals( lines, 0u, "a" ) );
+        ASSERT_TRUE( Text::lineEquals( lines, 1u, "" ) );
+        ASSERT_TRUE( Text::lineEquals( lines, 2u, "bc" ) );
+        ASSERT_TRUE( Text::lineEquals( lines, 3u, "d" ) );
+        ASSERT_EQ( Text::lineEnd( lines, 3u ),
+                   contents.data() + contents.size() );
+    }
+
+    std::vector< const char* > lines;
+    Text::splitLines( std::string( "a\n" ), lines );
+    ASSERT_EQ( lines.size(), 2u );
+
+    const std::string empty;
+    Text::splitLines( empty, lines );
+    ASSERT_EQ( lines.size(), 1u );
+}
+
+} // namespace
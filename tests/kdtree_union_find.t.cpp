@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+
+#include "kdtree_parallel.h"
+#include "kdtree_union_find.h"
+
+using namespace datastructures;
+
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////
+// TEST FUNCTIONS
+//////////////////////////////////////////////////////////////////////////////
+
+TEST( KDUnionFind, TestUninitializedState )
+{
+    KDUnionFind unionFind( 5u );
+
+    ASSERT_EQ( unionFind.size(), 5u );
+    for ( size_t i = 0; i < unionFind.size(); ++i )
+    {
+        ASSERT_EQ( unionFind.find( i ), i );
+    }
+}
+
+TEST( KDUnionFind, RepresentativeIsSmallestMember )
+{
+    KDUnionFind unionFind( 6u );
+
+    ASSERT_TRUE ( unionFind.unite( 4u, 5u ) );
+    ASSERT_TRUE ( unionFind.unite( 5u, 2u ) );
+    ASSERT_FALSE( unionFind.unite( 2u, 4u ) );
+    ASSERT_TRUE ( unionFind.unite( 3u, 1u ) );
+
+    ASSERT_EQ( unionFind.find( 0u ), 0u );
+    ASSERT_EQ( unionFind.find( 1u ), 1u );
+    ASSERT_EQ( unionFind.find( 2u ), 2u );
+    ASSERT_EQ( unionFind.find( 3u ), 1u );
+    ASSERT_EQ( unionFind.find( 4u ), 2u );
+    ASSERT_EQ( unionFind.find( 5u ), 2u );
+
+    ASSERT_TRUE( unionFind.unite( 5u, 3u ) );
+    ASSERT_EQ( unionFind.find( 4u ), 1u );
+}
+
+TEST( KDUnionFind, ConcurrentChain )
+{
+    const size_t size = 10000u;
+    KDUnionFind unionFind( size );
+
+    Parallel::forEachRange( size - 1u, 4u,
+        [ & ]( const size_t begin, const size_t end, const size_t )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                unionFind.unite( i + 1u, i );
+            }
+        } );
+
+    for ( size_t i = 0; i < size; ++i )
+    {
+        ASSERT_EQ( unionFind.find( i ), 0u );
+    }
+}
+
+} // namespace
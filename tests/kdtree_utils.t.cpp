@@ -204,4 +204,86 @@ TEST( Utils, DistancePointToPlane )
                Utils::distance( p1, hyperplane2 ) );
 }
 
+TEST( Utils, DistancesToBoxes )
+{
+    Types::AxisMinMax< int > box1;
+    box1.push_back( std::pair< int, int >( 0, 2 ) );
+    box1.push_back( std::pair< int, int >( 0, 1 ) );
+
+    Types::AxisMinMax< int > box2;
+    box2.push_back( std::pair< int, int >( 5, 6 ) );
+    box2.push_back( std::pair< int, int >( -1, 0 ) );
+
+    TestPoint inside;
+    inside.push_back( 1 );
+    inside.push_back( 1 );
+
+    TestPoint outside;
+    outside.push_back( -3 );
+    outside.push_back(  5 );
+
+    ASSERT_EQ(  0.0L, Utils::squaredDistanceToBox( inside, box1 ) );
+    ASSERT_EQ(  2.0L, Utils::maxSquaredDistanceToBox( inside, box1 ) );
+    ASSERT_EQ( 25.0L, Utils::squaredDistanceToBox( outside, box1 ) );
+    ASSERT_EQ( 50.0L, Utils::maxSquaredDistanceToBox( outside, box1 ) );
+
+    ASSERT_EQ(  9.0L, Utils::squaredDistanceBetweenBoxes( box1, box2 ) );
+    ASSERT_EQ(  9.0L, Utils::squaredDistanceBetweenBoxes( box2, box1 ) );
+    ASSERT_EQ( 40.0L, Utils::maxSquaredDistanceBetweenBoxes( box1, box2 ) );
+    ASSERT_EQ( 40.0L, Utils::maxSquaredDistanceBetweenBoxes( box2, box1 ) );
+    ASSERT_EQ(  0.0L, Utils::squaredDistanceBetweenBoxes( box1, box1 ) );
+}
+
+TEST( Utils, SquaredDistanceBetweenPoints )
+{
+    TestPoint p1;
+    p1.push_back( 0 );
+    p1.push_back( 3 );
+
+    TestPoint p2;
+    p2.push_back( 4 );
+    p2.push_back( 0 );
+
+    ASSERT_EQ( 25.0L, Utils::squaredDistance( p1, p2 ) );
+    ASSERT_EQ(  0.0L, Utils::squaredDistance( p1, p1 ) );
+}
+
+TEST( Utils, BoxContainment )
+{
+    Types::AxisMinMax< int > outer;
+    outer.push_back( std::pair< int, int >( 0, 4 ) );
+    outer.push_back( std::pair< int, int >( 0, 4 ) );
+
+    Types::AxisMinMax< int > inner;
+    inner.push_back( std::pair< int, int >( 1, 4 ) );
+    inner.push_back( std::pair< int, int >( 0, 2 ) );
+
+    Types::AxisMinMax< int > touching;
+    touching.push_back( std::pair< int, int >( 4, 6 ) );
+    touching.push_back( std::pair< int, int >( 3, 9 ) );
+
+    Types::AxisMinMax< int > apart;
+    apart.push_back( std::pair< int, int >( 5, 6 ) );
+    apart.push_back( std::pair< int, int >( 0, 1 ) );
+
+    ASSERT_TRUE ( Utils::boxContainsBox( outer, inner ) );
+    ASSERT_FALSE( Utils::boxContainsBox( inner, outer ) );
+    ASSERT_FALSE( Utils::boxContainsBox( outer, touching ) );
+
+    ASSERT_TRUE ( Utils::boxesIntersect( outer, touching ) );
+    ASSERT_TRUE ( Utils::boxesIntersect( inner, outer ) );
+    ASSERT_FALSE( Utils::boxesIntersect( outer, apart ) );
+
+    TestPoint corner;
+    corner.push_back( 4 );
+    corner.push_back( 0 );
+
+    TestPoint outside;
+    outside.push_back( 2 );
+    outside.push_back( 5 );
+
+    ASSERT_TRUE ( Utils::boxContainsPoint( outer, corner ) );
+    ASSERT_FALSE( Utils::boxContainsPoint( outer, outside ) );
+}
+
 } // namespace
\ No newline at end of file